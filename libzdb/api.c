@@ -141,6 +141,10 @@ static zdb_api_t *api_set_handler_userkey(namespace_t *ns, void *key, size_t ksi
     if(offset == 0)
         return zdb_api_reply_error("Cannot write data right now");
 
+    // previous payload is superseded
+    if(existing)
+        data_invalidate(ns->data, existing->dataid, existing->offset);
+
     zdb_debug("[+] api: set: userkey: ");
     zdb_debughex(key, ksize);
 
@@ -222,6 +226,10 @@ static zdb_api_t *api_set_handler_sequential(namespace_t *ns, void *key, size_t
     if(offset == 0)
         return zdb_api_reply(ZDB_API_INTERNAL_ERROR, NULL);
 
+    // previous payload is superseded
+    if(existing)
+        data_invalidate(ns->data, existing->dataid, existing->offset);
+
     zdb_debug("[+] api: set: sequential-key: ");
     zdb_debughex(&id, idlength);
 
@@ -317,7 +325,7 @@ zdb_api_t *zdb_api_get(namespace_t *ns, void *key, size_t ksize) {
     index_entry_t *entry = NULL;
 
     // fetching index entry for this key
-    if(!(entry = index_get(ns->index, key, ksize))) {
+    if(!(entry = index_lookup(ns->index, key, ksize))) {
         zdb_debug("[-] api: get: key not found\n");
         return zdb_api_reply(ZDB_API_NOT_FOUND, NULL);
     }
@@ -351,7 +359,7 @@ zdb_api_t *zdb_api_get(namespace_t *ns, void *key, size_t ksize) {
 // DATASET
 //
 zdb_api_t *zdb_api_exists(namespace_t *ns, void *key, size_t ksize) {
-    index_entry_t *entry = index_get(ns->index, key, ksize);
+    index_entry_t *entry = index_lookup(ns->index, key, ksize);
 
     zdb_debug("[+] api: exists: entry found: %s\n", (entry ? "yes" : "no"));
 
@@ -411,6 +419,9 @@ zdb_api_t *zdb_api_del(namespace_t *ns, void *key, size_t ksize) {
         return zdb_api_reply(ZDB_API_INTERNAL_ERROR, NULL);
     }
 
+    // drop the deleted payload from values cache
+    data_invalidate(ns->data, entry->dataid, entry->offset);
+
     // mark index entry as deleted
     if(index_entry_delete(ns->index, entry)) {
         zdb_debug("[-] command: del: index delete flag failed\n");
@@ -424,8 +435,8 @@ index_root_t *zdb_index_init_lazy(zdb_settings_t *settings, char *indexdir, void
     return index_init_lazy(settings, indexdir, namespace);
 }
 
-index_root_t *zdb_index_init(zdb_settings_t *settings, char *indexdir, void *namespace, index_branch_t **branches) {
-    return index_init(settings, indexdir, namespace, branches);
+index_root_t *zdb_index_init(zdb_settings_t *settings, char *indexdir, void *namespace) {
+    return index_init(settings, indexdir, namespace);
 }
 
 uint64_t zdb_index_availity_check(index_root_t *root) {
@@ -464,6 +475,10 @@ off_t zdb_index_raw_offset(index_root_t *root) {
     return lseek(root->indexfd, 0, SEEK_CUR);
 }
 
+index_item_t *zdb_index_item_next(char *buffer, size_t length, size_t *offset) {
+    return index_item_next(buffer, length, offset);
+}
+
 void zdb_index_close(index_root_t *root) {
     index_close(root);
 }
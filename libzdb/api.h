@@ -56,7 +56,7 @@
     void zdb_index_close(index_root_t *zdbindex);
 
     index_root_t *zdb_index_init_lazy(zdb_settings_t *settings, char *indexdir, void *namespace);
-    index_root_t *zdb_index_init(zdb_settings_t *settings, char *indexdir, void *namespace, index_branch_t **branches);
+    index_root_t *zdb_index_init(zdb_settings_t *settings, char *indexdir, void *namespace);
     uint64_t zdb_index_availity_check(index_root_t *root);
 
     // index header validity
@@ -66,6 +66,7 @@
     // low level index
     index_item_t *zdb_index_raw_fetch_entry(index_root_t *root);
     off_t zdb_index_raw_offset(index_root_t *root);
+    index_item_t *zdb_index_item_next(char *buffer, size_t length, size_t *offset);
     uint64_t zdb_index_next_id(index_root_t *root);
 
     // internal checksum
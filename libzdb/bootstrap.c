@@ -41,6 +41,18 @@ zdb_settings_t *zdb_initialize() {
     // restriction, library doesn't restrict anything
     s->mode = ZDB_MODE_MIX;
 
+    // linked-list branches stays the default in-memory
+    // index engine, hashtable needs to be explicitly requested
+    s->engine = ZDB_INDEX_BRANCHES;
+
+    // index files (and namespaces) are loaded using
+    // a small pool of threads on startup
+    s->loadthreads = ZDB_DEFAULT_LOADTHREADS;
+    s->fdcache = ZDB_DEFAULT_FDCACHE;
+    s->datacache = ZDB_DEFAULT_DATACACHE;
+    s->seqtable = 0;
+    s->seqmmap = 0;
+
     // resetting values
     s->verbose = 0;
     s->dump = 0;
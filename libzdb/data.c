@@ -5,6 +5,7 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <dirent.h>
 #include <fcntl.h>
 #include <limits.h>
@@ -65,14 +66,18 @@ static inline int data_sync_check(data_root_t *root, int fd) {
 // this function takes an extra argument "syncer" which explicitly
 // ask to check if we need to do some sync-check or not
 //
-// this is useful when writing data, we write the header then the payload
-// so we can avoid to do two sync calls (only one when done)
-static int data_write(int fd, void *buffer, size_t length, int syncer, data_root_t *root) {
+// buffers are provided as an iovec list, this way header and payload
+// can be written with a single syscall
+static int data_writev(int fd, struct iovec *iov, int iovcnt, int syncer, data_root_t *root) {
+    size_t length = 0;
     ssize_t response;
 
+    for(int i = 0; i < iovcnt; i++)
+        length += iov[i].iov_len;
+
     zdb_debug("[+] data: writing %lu bytes to fd %d\n", length, fd);
 
-    if((response = write(fd, buffer, length)) < 0) {
+    if((response = writev(fd, iov, iovcnt)) < 0) {
         // update statistics
         zdb_rootsettings.stats.datawritefailed += 1;
 
@@ -100,6 +105,15 @@ static int data_write(int fd, void *buffer, size_t length, int syncer, data_root
     return 1;
 }
 
+static int data_write(int fd, void *buffer, size_t length, int syncer, data_root_t *root) {
+    struct iovec iov = {
+        .iov_base = buffer,
+        .iov_len = length,
+    };
+
+    return data_writev(fd, &iov, 1, syncer, root);
+}
+
 // if one datafile is not found while trying to open it
 // this can call external hook to request that missing file
 //
@@ -210,32 +224,42 @@ data_header_t *data_descriptor_validate(data_header_t *header, data_root_t *root
 // main function to call when you need to deal with data id
 // this function takes care to open the right file id:
 //  - if you want the current opened file id, you have thid fd
+//  - if the file was recently used, you'll receive the cached fd
 //  - if the file is not opened yet, you'll receive a new fd
-// you need to call the .... to be consistant about cleaning this
-// file open, if a new one was opened
+// you need to call the data_release_dataid to be consistant about
+// cleaning this file open, if a new one was opened
 //
 // if the data id could not be opened, -1 is returned
 static inline int data_grab_dataid(data_root_t *root, fileid_t dataid) {
     int fd = root->datafd;
 
     if(root->dataid != dataid) {
+        if((fd = fdcache_get(&root->fdcache, dataid)) >= 0)
+            return fd;
+
         // the requested datafile is not the current datafile opened
-        // we will re-open the expected datafile temporarily
+        // we will re-open the expected datafile and keep it opened
         zdb_debug("[-] data: switching file: %d, requested: %d\n", root->dataid, dataid);
         if((fd = data_open_id(root, dataid)) < 0)
             return -1;
+
+        fdcache_put(&root->fdcache, dataid, fd);
     }
 
     return fd;
 }
 
 static inline void data_release_dataid(data_root_t *root, fileid_t dataid, int fd) {
-    // if the requested data id (or fd) is not the one
-    // currently in use by the main structure, we close it
-    // since it was temporary
-    if(root->dataid != dataid) {
+    (void) dataid;
+
+    // current datafile is owned by the main structure
+    if(fd == root->datafd)
+        return;
+
+    // if the descriptor is not part of the cache (cache
+    // disabled or full), we close it since it was temporary
+    if(fdcache_release(&root->fdcache, fd))
         close(fd);
-    }
 }
 
 //
@@ -286,18 +310,17 @@ static void data_open_final(data_root_t *root) {
         zdb_debug("[+] data: file opened in read-only mode\n");
     }
 
-    // jumping to the first entry
-    lseek(root->datafd, sizeof(data_header_t), SEEK_SET);
-
     // reading all indexes to find where is the last one
+    // starting from the first entry
     data_entry_header_t header;
+    off_t offset = sizeof(data_header_t);
     int entries = 0;
 
     zdb_debug("[+] data: reading file, finding last entry\n");
 
-    while(read(root->datafd, &header, sizeof(data_entry_header_t)) == sizeof(data_entry_header_t)) {
-        root->previous = lseek(root->datafd, 0, SEEK_CUR) - sizeof(data_entry_header_t);
-        lseek(root->datafd, header.datalength + header.idlength, SEEK_CUR);
+    while(pread(root->datafd, &header, sizeof(data_entry_header_t), offset) == sizeof(data_entry_header_t)) {
+        root->previous = offset;
+        offset += sizeof(data_entry_header_t) + header.datalength + header.idlength;
 
         entries += 1;
     }
@@ -345,8 +368,13 @@ size_t data_jump_next(data_root_t *root, fileid_t newid) {
 // compute a crc32 of the payload
 // this function uses Intel CRC32 (SSE4.2) intrinsic (SIMD)
 uint32_t data_crc32(const uint8_t *bytes, ssize_t length) {
+    return data_crc32_update(0, bytes, length);
+}
+
+// continue a crc32 with the next bytes of the payload, the crc of
+// a payload can be computed chunk per chunk, starting from zero
+uint32_t data_crc32_update(uint32_t hash, const uint8_t *bytes, ssize_t length) {
     uint64_t *input = (uint64_t *) bytes;
-    uint32_t hash = 0;
     ssize_t i = 0;
 
     for(i = 0; i < length - 8; i += 8)
@@ -361,10 +389,7 @@ uint32_t data_crc32(const uint8_t *bytes, ssize_t length) {
 static size_t data_length_from_offset(int fd, size_t offset) {
     data_entry_header_t header;
 
-    // moving to the header offset
-    lseek(fd, offset, SEEK_SET);
-
-    if(read(fd, &header, sizeof(data_entry_header_t)) != sizeof(data_entry_header_t)) {
+    if(pread(fd, &header, sizeof(data_entry_header_t), offset) != sizeof(data_entry_header_t)) {
         zdb_warnp("incorrect data header read");
         return 0;
     }
@@ -392,17 +417,16 @@ static inline data_payload_t data_get_real(int fd, size_t offset, size_t length,
         zdb_debug("[+] data: length from datafile: %zu\n", length);
     }
 
-    // positioning datafile to expected offset
-    // and skiping header (pointing to payload)
-    lseek(fd, offset + sizeof(data_entry_header_t) + idlength, SEEK_SET);
+    // payload is located after the header and the key
+    offset += sizeof(data_entry_header_t) + idlength;
 
     // allocating buffer from length
     // (from index or data header, we don't care)
     payload.buffer = malloc(length);
     payload.length = length;
 
-    if(read(fd, payload.buffer, length) != (ssize_t) length) {
-        zdb_rootsettings.stats.datareadfailed += 1;
+    if(pread(fd, payload.buffer, length, offset) != (ssize_t) length) {
+        zdb_atomic_add(zdb_rootsettings.stats.datareadfailed, 1);
         zdb_warnp("data_get: incorrect read length");
 
         free(payload.buffer);
@@ -410,7 +434,7 @@ static inline data_payload_t data_get_real(int fd, size_t offset, size_t length,
     }
 
     // update statistics
-    zdb_rootsettings.stats.datadiskread += length;
+    zdb_atomic_add(zdb_rootsettings.stats.datadiskread, length);
 
     return payload;
 }
@@ -418,15 +442,35 @@ static inline data_payload_t data_get_real(int fd, size_t offset, size_t length,
 // wrapper for data_get_real, which opens the right dataid
 // allowing to do only what's necessary and this wrapper
 // just prepares the right data id
-data_payload_t data_get(data_root_t *root, size_t offset, size_t length, fileid_t dataid, uint8_t idlength) {
-    int fd;
+// payload still in memory, caller owns the buffer and will free
+// it, a copy is returned, buffer is NULL when the payload needs
+// to be read from disk (nothing is accounted in that case)
+data_payload_t data_get_cached(data_root_t *root, size_t offset, fileid_t dataid) {
     data_payload_t payload = {
         .buffer = NULL,
         .length = 0
     };
 
+    if((payload.buffer = datacache_fetch(root, dataid, offset, &payload.length))) {
+        zdb_atomic_add(root->stats.hits, 1);
+        zdb_atomic_add(zdb_rootsettings.stats.datacachehit, 1);
+    }
+
+    return payload;
+}
+
+data_payload_t data_get(data_root_t *root, size_t offset, size_t length, fileid_t dataid, uint8_t idlength) {
+    int fd;
+    data_payload_t payload;
+
     zdb_debug("[+] data: request data: id %u, offset %lu, length: %lu\n", dataid, offset, length);
 
+    if((payload = data_get_cached(root, offset, dataid)).buffer)
+        return payload;
+
+    zdb_atomic_add(root->stats.faults, 1);
+    zdb_atomic_add(zdb_rootsettings.stats.datacachemiss, 1);
+
     // acquire data id fd
     if((fd = data_grab_dataid(root, dataid)) < 0)
         return payload;
@@ -436,46 +480,324 @@ data_payload_t data_get(data_root_t *root, size_t offset, size_t length, fileid_
     // release dataid
     data_release_dataid(root, dataid, fd);
 
+    if(payload.buffer && root->cache)
+        datacache_insert(root, dataid, offset, payload.buffer, payload.length);
+
     return payload;
 }
 
+// window of a payload still in memory, like data_get_cached
+data_payload_t data_get_range_cached(data_root_t *root, size_t offset, fileid_t dataid, size_t start, size_t length) {
+    data_payload_t payload = {
+        .buffer = NULL,
+        .length = 0
+    };
+
+    if((payload.buffer = datacache_fetch_range(root, dataid, offset, start, length))) {
+        zdb_atomic_add(root->stats.hits, 1);
+        zdb_atomic_add(zdb_rootsettings.stats.datacachehit, 1);
+        payload.length = length;
+    }
+
+    return payload;
+}
+
+// read only a window of a payload, window needs to be inside the
+// payload (caller checks it against index entry length), only the
+// requested bytes are read from disk, window is not cached
+data_payload_t data_get_range(data_root_t *root, size_t offset, fileid_t dataid, uint8_t idlength, size_t start, size_t length) {
+    data_payload_t payload;
+    int fd;
+
+    zdb_debug("[+] data: request range: id %u, offset %lu, start %lu, length: %lu\n", dataid, offset, start, length);
+
+    if((payload = data_get_range_cached(root, offset, dataid, start, length)).buffer)
+        return payload;
+
+    zdb_atomic_add(root->stats.faults, 1);
+    zdb_atomic_add(zdb_rootsettings.stats.datacachemiss, 1);
+
+    if((fd = data_grab_dataid(root, dataid)) < 0)
+        return payload;
+
+    if(!(payload.buffer = malloc(length ? length : 1))) {
+        zdb_warnp("data_get_range: malloc");
+        data_release_dataid(root, dataid, fd);
+        return payload;
+    }
+
+    payload.length = length;
+
+    if(pread(fd, payload.buffer, length, data_payload_offset(offset, idlength) + start) != (ssize_t) length) {
+        zdb_atomic_add(zdb_rootsettings.stats.datareadfailed, 1);
+        zdb_warnp("data_get_range: incorrect read length");
+
+        free(payload.buffer);
+        payload.buffer = NULL;
+    }
+
+    zdb_atomic_add(zdb_rootsettings.stats.datadiskread, length);
+    data_release_dataid(root, dataid, fd);
+
+    return payload;
+}
+
+//
+// batch read
+//
+// payloads are read ordered by location (datafile, then offset), each
+// datafile is grabbed once and read forward, payloads close to each
+// other are read with a single preadv, what's between them (header and
+// key of the next entry, deleted entries, ...) lands on a scratch buffer
+//
+static int data_batch_compare(const void *a, const void *b) {
+    const data_batch_t *x = *(const data_batch_t **) a;
+    const data_batch_t *y = *(const data_batch_t **) b;
+
+    if(x->dataid != y->dataid)
+        return (x->dataid < y->dataid) ? -1 : 1;
+
+    if(x->offset != y->offset)
+        return (x->offset < y->offset) ? -1 : 1;
+
+    return 0;
+}
+
+static inline size_t data_batch_start(data_batch_t *item) {
+    return data_payload_offset(item->offset, item->idlength);
+}
+
+// amount of items (from the first one) which can be read at once
+static size_t data_batch_run(data_batch_t **items, size_t length) {
+    size_t run = 1;
+
+    // unknown length needs the header to be read first
+    if(items[0]->length == 0)
+        return 1;
+
+    while(run < length && run < DATA_BATCH_IOV / 2) {
+        size_t end = data_batch_start(items[run - 1]) + items[run - 1]->length;
+        size_t next = data_batch_start(items[run]);
+
+        // same entry requested twice (or overlapping) are read apart
+        if(items[run]->length == 0 || next < end || next - end > DATA_BATCH_GAP)
+            break;
+
+        run += 1;
+    }
+
+    return run;
+}
+
+static void data_batch_read(int fd, data_batch_t **items, size_t length) {
+    unsigned char scratch[DATA_BATCH_GAP];
+    struct iovec iov[DATA_BATCH_IOV];
+    size_t offset = data_batch_start(items[0]);
+    size_t expected = 0;
+    int iovcnt = 0;
+
+    if(length == 1) {
+        data_batch_t *item = items[0];
+        item->payload = data_get_real(fd, item->offset, item->length, item->idlength);
+        return;
+    }
+
+    for(size_t i = 0; i < length; i++) {
+        data_batch_t *item = items[i];
+
+        if(i > 0) {
+            size_t end = data_batch_start(items[i - 1]) + items[i - 1]->length;
+
+            iov[iovcnt].iov_base = scratch;
+            iov[iovcnt].iov_len = data_batch_start(item) - end;
+            expected += iov[iovcnt].iov_len;
+            iovcnt += 1;
+        }
+
+        if(!(item->payload.buffer = malloc(item->length)))
+            zdb_diep("data_get_batch: malloc");
+
+        item->payload.length = item->length;
+
+        iov[iovcnt].iov_base = item->payload.buffer;
+        iov[iovcnt].iov_len = item->length;
+        expected += item->length;
+        iovcnt += 1;
+    }
+
+    zdb_debug("[+] data: batch: reading %zu payloads (%zu bytes) at %zu\n", length, expected, offset);
+
+    if(preadv(fd, iov, iovcnt, offset) != (ssize_t) expected) {
+        zdb_atomic_add(zdb_rootsettings.stats.datareadfailed, 1);
+        zdb_warnp("data_get_batch: incorrect read length");
+
+        for(size_t i = 0; i < length; i++) {
+            free(items[i]->payload.buffer);
+            items[i]->payload.buffer = NULL;
+        }
+    }
+
+    // update statistics
+    zdb_atomic_add(zdb_rootsettings.stats.datadiskread, expected);
+}
+
+// read a set of payloads at once, like data_get for each of them,
+// items payload are filled in place, caller owns the buffers and
+// a NULL buffer means the payload could not be read
+void data_get_batch(data_root_t *root, data_batch_t *batch, size_t length) {
+    data_batch_t **pending;
+    size_t missing = 0;
+
+    if(!(pending = malloc(sizeof(data_batch_t *) * length)))
+        zdb_diep("data_get_batch: malloc");
+
+    for(size_t i = 0; i < length; i++) {
+        data_batch_t *item = &batch[i];
+
+        if((item->payload = data_get_cached(root, item->offset, item->dataid)).buffer)
+            continue;
+
+        pending[missing++] = item;
+    }
+
+    qsort(pending, missing, sizeof(data_batch_t *), data_batch_compare);
+
+    zdb_atomic_add(root->stats.faults, missing);
+    zdb_atomic_add(zdb_rootsettings.stats.datacachemiss, missing);
+
+    for(size_t i = 0; i < missing; ) {
+        fileid_t dataid = pending[i]->dataid;
+        size_t last = i;
+        int fd;
+
+        while(last < missing && pending[last]->dataid == dataid)
+            last += 1;
+
+        // acquire data id fd, once for all payloads of this file
+        if((fd = data_grab_dataid(root, dataid)) < 0) {
+            i = last;
+            continue;
+        }
+
+        while(i < last) {
+            size_t run = data_batch_run(pending + i, last - i);
+            data_batch_read(fd, pending + i, run);
+            i += run;
+        }
+
+        data_release_dataid(root, dataid, fd);
+    }
+
+    if(root->cache) {
+        for(size_t i = 0; i < missing; i++) {
+            data_batch_t *item = pending[i];
+
+            if(item->payload.buffer)
+                datacache_insert(root, item->dataid, item->offset, item->payload.buffer, item->payload.length);
+        }
+    }
+
+    free(pending);
+}
+
+// payload at this location is superseded (key overwritten
+// or deleted), dropping it from values cache
+void data_invalidate(data_root_t *root, fileid_t dataid, size_t offset) {
+    datacache_invalidate(root, dataid, offset);
+}
+
+// enable or disable admission of this root on values cache
+void data_cache_admission(data_root_t *root, int enabled) {
+    root->cache = enabled;
+
+    if(!enabled)
+        datacache_purge(root);
+}
+
+// payload read by the caller itself (eg: asynchronous read), kept
+// in memory like any payload read by data_get
+void data_cache_insert(data_root_t *root, fileid_t dataid, size_t offset, void *buffer, size_t length) {
+    if(root->cache)
+        datacache_insert(root, dataid, offset, buffer, length);
+}
+
+// offset of the payload of an entry, from the entry offset
+size_t data_payload_offset(size_t offset, uint8_t idlength) {
+    return offset + sizeof(data_entry_header_t) + idlength;
+}
+
+// grab the descriptor of the datafile containing a payload, without
+// reading the payload, this allows caller to send it straight
+// from the file (eg: sendfile)
+//
+// length is the amount of bytes which will be read, for statistics, the
+// descriptor needs to be released with data_payload_release
+int data_payload_grab(data_root_t *root, fileid_t dataid, size_t length) {
+    int fd;
+
+    if((fd = data_grab_dataid(root, dataid)) < 0)
+        return -1;
+
+    // update statistics, large payloads are not cached
+    zdb_atomic_add(zdb_rootsettings.stats.datadiskread, length);
+    zdb_atomic_add(zdb_rootsettings.stats.datacachemiss, 1);
+    zdb_atomic_add(root->stats.faults, 1);
+
+    return fd;
+}
+
+void data_payload_release(data_root_t *root, fileid_t dataid, int fd) {
+    data_release_dataid(root, dataid, fd);
+}
+
 
 // check payload integrity from any datafile
 // real implementation
 static inline int data_check_real(int fd, size_t offset) {
     unsigned char *buffer;
     data_entry_header_t header;
+    uint32_t integrity = 0;
 
-    // positioning to the expected offset in the datafile
-    lseek(fd, offset, SEEK_SET);
-
-    if(read(fd, &header, sizeof(data_entry_header_t)) != (ssize_t) sizeof(data_entry_header_t)) {
+    if(pread(fd, &header, sizeof(data_entry_header_t), offset) != (ssize_t) sizeof(data_entry_header_t)) {
         zdb_warnp("data: checker: header read");
         return -1;
     }
 
-    // skipping the key, set buffer to payload position
-    lseek(fd, header.idlength, SEEK_CUR);
+    // skipping header and key, pointing to the payload
+    offset += sizeof(data_entry_header_t) + header.idlength;
 
-    // allocating buffer from header's length
-    buffer = malloc(header.datalength);
+    // payload is read chunk per chunk, large (streamed)
+    // payloads are not loaded in memory at once
+    size_t chunk = (header.datalength < DATA_CHECK_CHUNK) ? header.datalength : DATA_CHECK_CHUNK;
 
-    if(read(fd, buffer, header.datalength) != (ssize_t) header.datalength) {
-        // update statistics
-        zdb_rootsettings.stats.datareadfailed += 1;
+    if(!(buffer = malloc(chunk ? chunk : 1)))
+        zdb_diep("data: checker: malloc");
 
-        zdb_warnp("data: checker: payload read");
-        free(buffer);
-        return -1;
-    }
+    for(size_t checked = 0; checked < header.datalength; ) {
+        size_t length = header.datalength - checked;
 
-    // update statistics
-    zdb_rootsettings.stats.datadiskread += header.datalength;
+        if(length > chunk)
+            length = chunk;
+
+        if(pread(fd, buffer, length, offset + checked) != (ssize_t) length) {
+            // update statistics
+            zdb_atomic_add(zdb_rootsettings.stats.datareadfailed, 1);
+
+            zdb_warnp("data: checker: payload read");
+            free(buffer);
+            return -1;
+        }
+
+        // checking integrity of the payload
+        integrity = data_crc32_update(integrity, buffer, length);
+        checked += length;
+    }
 
-    // checking integrity of the payload
-    uint32_t integrity = data_crc32(buffer, header.datalength);
     free(buffer);
 
+    // update statistics
+    zdb_atomic_add(zdb_rootsettings.stats.datadiskread, header.datalength);
+
     zdb_debug("[+] data: checker: %08x <> %08x\n", integrity, header.integrity);
 
     // comparing with header
@@ -524,19 +846,21 @@ size_t data_insert(data_root_t *root, data_request_t *source) {
     // data offset will always be >= 1 (see initializer notes)
     // we can use 0 as error detection
 
-    if(!data_write(root->datafd, header, headerlength, 0, root)) {
-        zdb_verbose("[-] data header: write failed\n");
+    // header and payload are written at once, this avoid
+    // an extra syscall and keep the entry contiguous
+    struct iovec iov[2] = {
+        {.iov_base = header, .iov_len = headerlength},
+        {.iov_base = source->data, .iov_len = source->datalength},
+    };
+
+    if(!data_writev(root->datafd, iov, 2, 1, root)) {
+        zdb_verbose("[-] data entry: write failed\n");
         free(header);
         return 0;
     }
 
     free(header);
 
-    if(!data_write(root->datafd, source->data, source->datalength, 1, root)) {
-        zdb_verbose("[-] data payload: write failed\n");
-        return 0;
-    }
-
     // set this current offset as the latest
     // offset inserted
     root->previous = offset;
@@ -544,6 +868,83 @@ size_t data_insert(data_root_t *root, data_request_t *source) {
     return offset;
 }
 
+// insert several entries at once, offset of each entry is set on offsets,
+// headers and payloads are written with a single writev (split if there
+// are more buffers than DATA_BATCH_IOV) and the sync check is done once, after
+// the last write
+//
+// returns the amount of entries written, entries are written in order,
+// on error, the first ones could be written but not the following ones
+size_t data_insert_batch(data_root_t *root, data_request_t *requests, size_t length, size_t *offsets) {
+    size_t offset = lseek(root->datafd, 0, SEEK_END);
+    size_t headerslength = 0;
+    size_t previous = root->previous;
+    size_t written = 0;
+    unsigned char *headers;
+    struct iovec *iov;
+
+    for(size_t i = 0; i < length; i++)
+        headerslength += sizeof(data_entry_header_t) + requests[i].idlength;
+
+    if(!(headers = malloc(headerslength)))
+        zdb_diep("data_insert_batch: malloc");
+
+    if(!(iov = malloc(sizeof(struct iovec) * length * 2)))
+        zdb_diep("data_insert_batch: iov: malloc");
+
+    unsigned char *cursor = headers;
+
+    for(size_t i = 0; i < length; i++) {
+        data_request_t *source = &requests[i];
+        data_entry_header_t *header = (data_entry_header_t *) cursor;
+        size_t headerlength = sizeof(data_entry_header_t) + source->idlength;
+
+        header->idlength = source->idlength;
+        header->datalength = source->datalength;
+        header->previous = previous;
+        header->integrity = source->crc;
+        header->flags = source->flags;
+        header->timestamp = time(NULL);
+
+        memcpy(header->id, source->vid, source->idlength);
+
+        iov[i * 2].iov_base = header;
+        iov[i * 2].iov_len = headerlength;
+        iov[i * 2 + 1].iov_base = source->data;
+        iov[i * 2 + 1].iov_len = source->datalength;
+
+        offsets[i] = offset;
+        previous = offset;
+
+        offset += headerlength + source->datalength;
+        cursor += headerlength;
+    }
+
+    while(written < length) {
+        size_t chunk = length - written;
+
+        if(chunk > DATA_BATCH_IOV / 2)
+            chunk = DATA_BATCH_IOV / 2;
+
+        int syncer = (written + chunk == length);
+
+        if(!data_writev(root->datafd, iov + (written * 2), chunk * 2, syncer, root)) {
+            zdb_verbose("[-] data entry: batch write failed\n");
+            break;
+        }
+
+        written += chunk;
+
+        // set latest offset inserted
+        root->previous = offsets[written - 1];
+    }
+
+    free(headers);
+    free(iov);
+
+    return written;
+}
+
 // return the offset of the next entry which will be added
 // you probably don't need this, you should get the offset back
 // when data is really inserted, but this could be needed, for
@@ -553,6 +954,190 @@ size_t data_next_offset(data_root_t *root) {
     return lseek(root->datafd, 0, SEEK_END);
 }
 
+//
+// streamed entries
+//
+// large payloads are written to the datafile while received, the entry
+// header is written first, flagged streaming (not valid), and the space
+// of the whole payload is reserved right after it, next entries are
+// appended after that space, meanwhile
+//
+// payload is written with its own descriptor (positioned writes, the
+// datafile descriptor is append-only) and is not related to the root,
+// data_stream_write can be called without holding anything
+//
+// when the payload is complete, the header is updated with the crc and
+// without the streaming flag, if the stream is aborted, the entry is
+// dropped if nothing was added after it, otherwise it stays flagged
+// streaming on the datafile and is ignored (like a deleted entry)
+//
+int data_stream_begin(data_root_t *root, data_stream_t *stream, data_request_t *source) {
+    size_t offset = lseek(root->datafd, 0, SEEK_END);
+    size_t headerlength = sizeof(data_entry_header_t) + source->idlength;
+    data_entry_header_t *header;
+
+    if((stream->fd = open(root->datafile, O_RDWR)) < 0) {
+        zdb_warnp(root->datafile);
+        return 1;
+    }
+
+    // reserving space for the payload, file is
+    // extended up to the end of the payload
+    if(ftruncate(stream->fd, offset + headerlength + source->datalength) < 0) {
+        zdb_warnp("data_stream_begin: ftruncate");
+        close(stream->fd);
+        stream->fd = -1;
+        return 1;
+    }
+
+    if(!(header = malloc(headerlength)))
+        zdb_diep("data_stream_begin: malloc");
+
+    header->idlength = source->idlength;
+    header->datalength = source->datalength;
+    header->previous = root->previous;
+    header->integrity = 0;
+    header->flags = source->flags | DATA_ENTRY_STREAMING;
+    header->timestamp = source->timestamp;
+
+    memcpy(header->id, source->vid, source->idlength);
+
+    if(pwrite(stream->fd, header, headerlength, offset) != (ssize_t) headerlength) {
+        zdb_warnp("data_stream_begin: header write");
+        zdb_atomic_add(zdb_rootsettings.stats.datawritefailed, 1);
+
+        if(ftruncate(stream->fd, offset) < 0)
+            zdb_warnp("data_stream_begin: rollback");
+
+        close(stream->fd);
+        stream->fd = -1;
+        free(header);
+        return 1;
+    }
+
+    free(header);
+
+    zdb_atomic_add(zdb_rootsettings.stats.datadiskwrite, headerlength);
+
+    stream->dataid = root->dataid;
+    stream->offset = offset;
+    stream->payload = offset + headerlength;
+    stream->previous = root->previous;
+    stream->length = source->datalength;
+    stream->written = 0;
+    stream->crc = 0;
+
+    // set this entry as the latest offset inserted
+    root->previous = offset;
+
+    return 0;
+}
+
+// append the next chunk of the payload
+int data_stream_write(data_stream_t *stream, void *buffer, size_t length) {
+    unsigned char *source = buffer;
+    size_t written = 0;
+    ssize_t response;
+
+    if(stream->written + length > stream->length) {
+        zdb_logerr("[-] data stream: payload larger than expected\n");
+        return 1;
+    }
+
+    while(written < length) {
+        response = pwrite(stream->fd, source + written, length - written, stream->payload + stream->written + written);
+
+        if(response < 0) {
+            zdb_warnp("data stream write");
+            return data_stream_written(stream, buffer, length, errno);
+        }
+
+        written += response;
+    }
+
+    return data_stream_written(stream, buffer, length, 0);
+}
+
+// chunk written at the end of the payload written so far (see
+// data_stream_offset) by the caller itself (eg: asynchronous write),
+// error is the errno of the write, zero if fully written
+int data_stream_written(data_stream_t *stream, void *buffer, size_t length, int error) {
+    if(error) {
+        zdb_atomic_add(zdb_rootsettings.stats.datawritefailed, 1);
+        return 1;
+    }
+
+    zdb_atomic_add(zdb_rootsettings.stats.datadiskwrite, length);
+
+    stream->crc = data_crc32_update(stream->crc, buffer, length);
+    stream->written += length;
+
+    return 0;
+}
+
+// datafile offset of the next chunk
+size_t data_stream_offset(data_stream_t *stream) {
+    return stream->payload + stream->written;
+}
+
+// payload complete, validate the entry
+int data_stream_commit(data_root_t *root, data_stream_t *stream) {
+    data_entry_header_t header;
+
+    if(stream->written != stream->length) {
+        zdb_logerr("[-] data stream: payload incomplete\n");
+        return 1;
+    }
+
+    if(pread(stream->fd, &header, sizeof(data_entry_header_t), stream->offset) != sizeof(data_entry_header_t)) {
+        zdb_warnp("data_stream_commit: header read");
+        return 1;
+    }
+
+    header.integrity = stream->crc;
+    header.flags &= ~DATA_ENTRY_STREAMING;
+
+    if(pwrite(stream->fd, &header, sizeof(data_entry_header_t), stream->offset) != sizeof(data_entry_header_t)) {
+        zdb_warnp("data_stream_commit: header write");
+        zdb_atomic_add(zdb_rootsettings.stats.datawritefailed, 1);
+        zdb_atomic_add(root->stats.errors, 1);
+        root->stats.lasterr = time(NULL);
+        return 1;
+    }
+
+    data_sync_check(root, stream->fd);
+
+    close(stream->fd);
+    stream->fd = -1;
+
+    return 0;
+}
+
+// stream cancelled, root can be NULL if the datafile
+// is not in use anymore (namespace removed or reloaded)
+void data_stream_abort(data_root_t *root, data_stream_t *stream) {
+    if(stream->fd >= 0)
+        close(stream->fd);
+
+    stream->fd = -1;
+
+    // something was appended after the entry, or datafile
+    // changed, entry stays on the datafile flagged streaming
+    if(!root || root->dataid != stream->dataid || root->previous != stream->offset) {
+        zdb_debug("[-] data: stream aborted, entry flagged on the datafile\n");
+        return;
+    }
+
+    zdb_debug("[-] data: stream aborted, dropping last entry\n");
+
+    if(ftruncate(root->datafd, stream->offset) < 0) {
+        zdb_warnp("data_stream_abort: ftruncate");
+        return;
+    }
+
+    root->previous = stream->previous;
+}
+
 int data_entry_is_deleted(data_entry_header_t *entry) {
     return (entry->flags & DATA_ENTRY_DELETED);
 }
@@ -592,6 +1177,9 @@ void data_destroy(data_root_t *root) {
     if(root->datafd > 0)
         close(root->datafd);
 
+    fdcache_free(&root->fdcache);
+    datacache_purge(root);
+
     free(root->datafile);
     free(root);
 }
@@ -609,6 +1197,8 @@ data_root_t *data_init_lazy(zdb_settings_t *settings, char *datapath, fileid_t d
     root->previous = 0;
 
     memset(&root->stats, 0x00, sizeof(data_stats_t));
+    fdcache_init(&root->fdcache, settings->fdcache);
+    root->cache = 1;
 
     data_set_id(root);
 
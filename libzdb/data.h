@@ -6,8 +6,8 @@
 
     // data statistics
     typedef struct data_stats_t {
-        size_t hits;     // amount of data hit requested (not used yet)
-        size_t faults;   // amount of data hit missed (not used yet)
+        size_t hits;     // amount of payload served from values cache
+        size_t faults;   // amount of payload read from datafiles
         size_t errors;   // amount of io (read/write) error
         time_t lasterr;  // last error timestamp
 
@@ -26,6 +26,8 @@
         time_t lastsync;    // keep track when the last sync was explictly made
         size_t previous;    // keep latest offset inserted to the datafile
         data_stats_t stats; // data statistics (session time)
+        fdcache_t fdcache;  // read-only descriptors of older datafiles
+        int cache;          // payloads read are admitted on values cache
 
     } data_root_t;
 
@@ -45,6 +47,7 @@
     typedef enum data_flags_t {
         DATA_ENTRY_DELETED   = 1,       // flag entry as deleted
         DATA_ENTRY_TRUNCATED = 1 << 1,  // used on compaction, tell entry was truncated
+        DATA_ENTRY_STREAMING = 1 << 2,  // streamed payload not completed, entry is not valid
 
     } data_flags_t;
 
@@ -110,6 +113,42 @@
 
     } data_request_t;
 
+    // one payload requested by a batch read (see data_get_batch)
+    // location comes from the index entry, payload is filled by the read
+    typedef struct data_batch_t {
+        fileid_t dataid;         // datafile id
+        uint32_t offset;         // entry offset on the datafile
+        uint32_t length;         // payload length
+        uint8_t idlength;        // key length (header is followed by the key)
+        data_payload_t payload;  // payload read, buffer is NULL on error
+
+    } data_batch_t;
+
+    // payload written to the datafile while it's received, chunk per
+    // chunk, without keeping it in memory (see data_stream_begin)
+    typedef struct data_stream_t {
+        int fd;            // descriptor used to write the payload
+        fileid_t dataid;   // datafile id
+        size_t offset;     // entry offset on the datafile
+        size_t payload;    // payload offset on the datafile
+        size_t previous;   // previous entry offset, before this one
+        uint32_t length;   // payload length expected
+        uint32_t written;  // payload length written so far
+        uint32_t crc;      // crc32 of the payload written so far
+
+    } data_stream_t;
+
+    // two payloads closer than this (header and key of the
+    // next entry included) are read with the same syscall
+    #define DATA_BATCH_GAP  4096
+
+    // payload integrity check reads large payloads by chunk
+    #define DATA_CHECK_CHUNK  1024 * 1024
+
+    // maximum buffers provided to a single read or write
+    // syscall (IOV_MAX on linux and most systems)
+    #define DATA_BATCH_IOV  1024
+
     data_root_t *data_init(zdb_settings_t *settings, char *datapath, fileid_t dataid);
     data_root_t *data_init_lazy(zdb_settings_t *settings, char *datapath, fileid_t dataid);
     int data_open_id_mode(data_root_t *root, fileid_t id, int mode);
@@ -124,18 +163,38 @@
     void data_delete_files(data_root_t *root);
 
     uint32_t data_crc32(const uint8_t *bytes, ssize_t length);
+    uint32_t data_crc32_update(uint32_t hash, const uint8_t *bytes, ssize_t length);
 
     data_payload_t data_get(data_root_t *root, size_t offset, size_t length, fileid_t dataid, uint8_t idlength);
+    data_payload_t data_get_cached(data_root_t *root, size_t offset, fileid_t dataid);
+    data_payload_t data_get_range_cached(data_root_t *root, size_t offset, fileid_t dataid, size_t start, size_t length);
+    data_payload_t data_get_range(data_root_t *root, size_t offset, fileid_t dataid, uint8_t idlength, size_t start, size_t length);
+    void data_get_batch(data_root_t *root, data_batch_t *batch, size_t length);
+    void data_invalidate(data_root_t *root, fileid_t dataid, size_t offset);
+    void data_cache_admission(data_root_t *root, int enabled);
+    void data_cache_insert(data_root_t *root, fileid_t dataid, size_t offset, void *buffer, size_t length);
     int data_check(data_root_t *root, size_t offset, fileid_t dataid);
 
+    size_t data_payload_offset(size_t offset, uint8_t idlength);
+    int data_payload_grab(data_root_t *root, fileid_t dataid, size_t length);
+    void data_payload_release(data_root_t *root, fileid_t dataid, int fd);
+
     // size_t data_match(data_root_t *root, void *id, uint8_t idlength, size_t offset, fileid_t dataid);
 
     int data_delete(data_root_t *root, void *id, uint8_t idlength);
 
     // size_t data_insert(data_root_t *root, unsigned char *data, uint32_t datalength, void *vid, uint8_t idlength, uint8_t flags);
     size_t data_insert(data_root_t *root, data_request_t *source);
+    size_t data_insert_batch(data_root_t *root, data_request_t *requests, size_t length, size_t *offsets);
     size_t data_next_offset(data_root_t *root);
 
+    int data_stream_begin(data_root_t *root, data_stream_t *stream, data_request_t *source);
+    int data_stream_write(data_stream_t *stream, void *buffer, size_t length);
+    int data_stream_written(data_stream_t *stream, void *buffer, size_t length, int error);
+    size_t data_stream_offset(data_stream_t *stream);
+    int data_stream_commit(data_root_t *root, data_stream_t *stream);
+    void data_stream_abort(data_root_t *root, data_stream_t *stream);
+
     data_scan_t data_previous_header(data_root_t *root, fileid_t dataid, size_t offset);
     data_scan_t data_next_header(data_root_t *root, fileid_t dataid, size_t offset);
     data_scan_t data_first_header(data_root_t *root);
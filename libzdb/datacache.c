@@ -0,0 +1,425 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "libzdb.h"
+#include "libzdb_private.h"
+
+//
+// values cache
+//
+// hot keys are read from the datafile on each request, even if the
+// kernel page cache keeps the file in memory, each read costs a syscall
+// and a copy, this cache keeps recently read payloads in memory, keyed
+// by their location (data root, datafile id, offset)
+//
+// datafiles are append-only, a location always points to the same
+// payload, an overwritten or deleted key simply stops being requested,
+// its location is still dropped explicitly to release memory early,
+// the whole root is purged when destroyed (reload, flush, removal)
+// since files can be rewritten from scratch after that
+//
+// eviction follows S3-FIFO: new objects enter a small probation queue
+// (10% of the cache), objects not accessed again while in that queue
+// are evicted early and only their key is kept on a ghost queue, this
+// way a scan (one-time reads) never flushes the main queue, objects
+// accessed again (or coming back from the ghost queue) are promoted to
+// the main queue, which is a fifo with a second chance (access counter)
+//
+// the cache is shared by all namespaces and bounded in bytes, it can
+// be used by concurrent readers, everything is done under a single lock,
+// payloads are copied out while the lock is held
+//
+static datacache_t cache = {
+    .size = 0,
+};
+
+static pthread_mutex_t cachelock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline size_t datacache_cost(datacache_entry_t *entry) {
+    return sizeof(datacache_entry_t) + entry->length;
+}
+
+static inline size_t datacache_hash(void *owner, fileid_t dataid, size_t offset) {
+    uint64_t key = (uint64_t) (uintptr_t) owner;
+
+    key ^= ((uint64_t) dataid << 48) ^ offset;
+
+    // 64 bits mixer (splitmix64 finalizer)
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+    key = key ^ (key >> 31);
+
+    return (size_t) key & (cache.nbuckets - 1);
+}
+
+//
+// fifo queues
+//
+static void datacache_queue_push(datacache_entry_t *entry, datacache_queue_id_t id) {
+    datacache_queue_t *queue = &cache.queues[id];
+
+    entry->queue = id;
+    entry->qnext = NULL;
+    entry->qprev = queue->tail;
+
+    if(queue->tail)
+        queue->tail->qnext = entry;
+
+    queue->tail = entry;
+
+    if(!queue->head)
+        queue->head = entry;
+
+    queue->length += 1;
+    queue->size += datacache_cost(entry);
+}
+
+static void datacache_queue_unlink(datacache_entry_t *entry) {
+    datacache_queue_t *queue = &cache.queues[entry->queue];
+
+    if(entry->qprev)
+        entry->qprev->qnext = entry->qnext;
+
+    if(entry->qnext)
+        entry->qnext->qprev = entry->qprev;
+
+    if(queue->head == entry)
+        queue->head = entry->qnext;
+
+    if(queue->tail == entry)
+        queue->tail = entry->qprev;
+
+    queue->length -= 1;
+    queue->size -= datacache_cost(entry);
+}
+
+//
+// hash table
+//
+static void datacache_rehash(size_t nbuckets) {
+    datacache_entry_t **previous = cache.buckets;
+    size_t length = cache.nbuckets;
+
+    if(!(cache.buckets = calloc(nbuckets, sizeof(datacache_entry_t *)))) {
+        // keep previous table, chains will just be longer
+        zdb_warnp("datacache: calloc");
+        cache.buckets = previous;
+        return;
+    }
+
+    cache.nbuckets = nbuckets;
+
+    for(size_t i = 0; i < length; i++) {
+        datacache_entry_t *entry = previous[i];
+
+        while(entry) {
+            datacache_entry_t *next = entry->hnext;
+            size_t bucket = datacache_hash(entry->owner, entry->dataid, entry->offset);
+
+            entry->hnext = cache.buckets[bucket];
+            cache.buckets[bucket] = entry;
+
+            entry = next;
+        }
+    }
+
+    free(previous);
+}
+
+static datacache_entry_t *datacache_find(void *owner, fileid_t dataid, size_t offset) {
+    size_t bucket = datacache_hash(owner, dataid, offset);
+
+    for(datacache_entry_t *entry = cache.buckets[bucket]; entry; entry = entry->hnext)
+        if(entry->offset == offset && entry->dataid == dataid && entry->owner == owner)
+            return entry;
+
+    return NULL;
+}
+
+static void datacache_unhash(datacache_entry_t *entry) {
+    size_t bucket = datacache_hash(entry->owner, entry->dataid, entry->offset);
+    datacache_entry_t **link = &cache.buckets[bucket];
+
+    while(*link != entry)
+        link = &(*link)->hnext;
+
+    *link = entry->hnext;
+    cache.entries -= 1;
+}
+
+// release the payload of an entry, entry is still valid
+static void datacache_release(datacache_entry_t *entry) {
+    cache.usage -= datacache_cost(entry);
+
+    free(entry->buffer);
+    entry->buffer = NULL;
+}
+
+// remove completely an entry, from any queue
+static void datacache_drop(datacache_entry_t *entry) {
+    datacache_queue_unlink(entry);
+    datacache_unhash(entry);
+
+    if(entry->queue != DATACACHE_GHOST)
+        datacache_release(entry);
+
+    free(entry);
+}
+
+//
+// eviction
+//
+static void datacache_ghost_trim() {
+    datacache_queue_t *ghost = &cache.queues[DATACACHE_GHOST];
+    size_t limit = cache.queues[DATACACHE_SMALL].length + cache.queues[DATACACHE_MAIN].length;
+
+    while(ghost->length > limit)
+        datacache_drop(ghost->head);
+}
+
+static void datacache_evict_small() {
+    datacache_entry_t *entry = cache.queues[DATACACHE_SMALL].head;
+
+    datacache_queue_unlink(entry);
+
+    // accessed again while on probation, promoted
+    if(entry->freq > 0) {
+        entry->freq = 0;
+        datacache_queue_push(entry, DATACACHE_MAIN);
+        return;
+    }
+
+    // one-time access, only keep track of the key
+    datacache_release(entry);
+    cache.evicted += 1;
+
+    datacache_queue_push(entry, DATACACHE_GHOST);
+    datacache_ghost_trim();
+}
+
+static void datacache_evict_main() {
+    datacache_entry_t *entry = cache.queues[DATACACHE_MAIN].head;
+
+    // second chance, reinserted with one access less
+    if(entry->freq > 0) {
+        datacache_queue_unlink(entry);
+        entry->freq -= 1;
+        datacache_queue_push(entry, DATACACHE_MAIN);
+        return;
+    }
+
+    datacache_drop(entry);
+    cache.evicted += 1;
+}
+
+static void datacache_evict(size_t needed) {
+    datacache_queue_t *small = &cache.queues[DATACACHE_SMALL];
+    datacache_queue_t *primary = &cache.queues[DATACACHE_MAIN];
+
+    while(cache.usage + needed > cache.size) {
+        if(small->length && (small->size > cache.size / 10 || primary->length == 0)) {
+            datacache_evict_small();
+            continue;
+        }
+
+        if(primary->length == 0)
+            return;
+
+        datacache_evict_main();
+    }
+}
+
+//
+// public interface
+//
+void datacache_init(size_t size) {
+    memset(&cache, 0x00, sizeof(datacache_t));
+
+    // cache disabled
+    if(size == 0)
+        return;
+
+    cache.nbuckets = 1024;
+
+    if(!(cache.buckets = calloc(cache.nbuckets, sizeof(datacache_entry_t *))))
+        zdb_diep("datacache: calloc");
+
+    cache.size = size;
+
+    zdb_verbose("[+] datacache: values cache enabled, %.2f MB\n", MB(size));
+}
+
+void datacache_destroy() {
+    for(size_t i = 0; i < 3; i++) {
+        while(cache.queues[i].head)
+            datacache_drop(cache.queues[i].head);
+    }
+
+    free(cache.buckets);
+    memset(&cache, 0x00, sizeof(datacache_t));
+}
+
+datacache_t *datacache_get() {
+    return &cache;
+}
+
+// returns a copy of the cached payload of this location, NULL if the
+// payload is not in memory, caller owns the copy and needs to free it
+void *datacache_fetch(void *owner, fileid_t dataid, size_t offset, size_t *length) {
+    datacache_entry_t *entry;
+    void *buffer = NULL;
+
+    if(cache.size == 0)
+        return NULL;
+
+    pthread_mutex_lock(&cachelock);
+
+    if(!(entry = datacache_find(owner, dataid, offset)) || entry->queue == DATACACHE_GHOST) {
+        pthread_mutex_unlock(&cachelock);
+        return NULL;
+    }
+
+    if(entry->freq < DATACACHE_FREQ_MAX)
+        entry->freq += 1;
+
+    if((buffer = malloc(entry->length))) {
+        memcpy(buffer, entry->buffer, entry->length);
+        *length = entry->length;
+    }
+
+    pthread_mutex_unlock(&cachelock);
+
+    return buffer;
+}
+
+// same as datacache_fetch, only a window of the payload is copied,
+// window needs to be inside the payload
+void *datacache_fetch_range(void *owner, fileid_t dataid, size_t offset, size_t start, size_t length) {
+    datacache_entry_t *entry;
+    void *buffer = NULL;
+
+    if(cache.size == 0)
+        return NULL;
+
+    pthread_mutex_lock(&cachelock);
+
+    if(!(entry = datacache_find(owner, dataid, offset)) || entry->queue == DATACACHE_GHOST) {
+        pthread_mutex_unlock(&cachelock);
+        return NULL;
+    }
+
+    if(start + length > entry->length) {
+        pthread_mutex_unlock(&cachelock);
+        return NULL;
+    }
+
+    if(entry->freq < DATACACHE_FREQ_MAX)
+        entry->freq += 1;
+
+    if((buffer = malloc(length ? length : 1)))
+        memcpy(buffer, (uint8_t *) entry->buffer + start, length);
+
+    pthread_mutex_unlock(&cachelock);
+
+    return buffer;
+}
+
+// keep a copy of a payload freshly read from disk
+void datacache_insert(void *owner, fileid_t dataid, size_t offset, void *buffer, size_t length) {
+    datacache_entry_t *entry;
+    datacache_queue_id_t target = DATACACHE_SMALL;
+
+    if(cache.size == 0 || length > cache.size / DATACACHE_OBJECT_RATIO)
+        return;
+
+    pthread_mutex_lock(&cachelock);
+
+    if((entry = datacache_find(owner, dataid, offset))) {
+        // payload already in memory
+        if(entry->queue != DATACACHE_GHOST) {
+            pthread_mutex_unlock(&cachelock);
+            return;
+        }
+
+        // recently evicted from probation, this key is requested
+        // again, it goes straight to the main queue
+        datacache_drop(entry);
+        target = DATACACHE_MAIN;
+    }
+
+    if(!(entry = calloc(1, sizeof(datacache_entry_t)))) {
+        zdb_warnp("datacache: calloc");
+        pthread_mutex_unlock(&cachelock);
+        return;
+    }
+
+    if(!(entry->buffer = malloc(length))) {
+        zdb_warnp("datacache: malloc");
+        pthread_mutex_unlock(&cachelock);
+        free(entry);
+        return;
+    }
+
+    memcpy(entry->buffer, buffer, length);
+
+    entry->owner = owner;
+    entry->dataid = dataid;
+    entry->offset = offset;
+    entry->length = length;
+
+    datacache_evict(datacache_cost(entry));
+
+    if(cache.entries >= cache.nbuckets)
+        datacache_rehash(cache.nbuckets * 2);
+
+    size_t bucket = datacache_hash(owner, dataid, offset);
+    entry->hnext = cache.buckets[bucket];
+    cache.buckets[bucket] = entry;
+    cache.entries += 1;
+
+    datacache_queue_push(entry, target);
+    cache.usage += datacache_cost(entry);
+    cache.admitted += 1;
+
+    pthread_mutex_unlock(&cachelock);
+}
+
+// location superseded (key overwritten or deleted)
+void datacache_invalidate(void *owner, fileid_t dataid, size_t offset) {
+    datacache_entry_t *entry;
+
+    if(cache.size == 0)
+        return;
+
+    pthread_mutex_lock(&cachelock);
+
+    if((entry = datacache_find(owner, dataid, offset)))
+        datacache_drop(entry);
+
+    pthread_mutex_unlock(&cachelock);
+}
+
+// drop everything owned by a root
+void datacache_purge(void *owner) {
+    if(cache.size == 0)
+        return;
+
+    pthread_mutex_lock(&cachelock);
+
+    for(size_t i = 0; i < cache.nbuckets; i++) {
+        datacache_entry_t *entry = cache.buckets[i];
+
+        while(entry) {
+            datacache_entry_t *next = entry->hnext;
+
+            if(entry->owner == owner)
+                datacache_drop(entry);
+
+            entry = next;
+        }
+    }
+
+    pthread_mutex_unlock(&cachelock);
+}
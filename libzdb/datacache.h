@@ -0,0 +1,71 @@
+#ifndef __ZDB_DATACACHE_H
+    #define __ZDB_DATACACHE_H
+
+    // default size (in bytes) of the values cache, shared
+    // by all namespaces (zero: cache disabled)
+    #define ZDB_DEFAULT_DATACACHE  0
+
+    // objects larger than this fraction of the cache
+    // are never admitted
+    #define DATACACHE_OBJECT_RATIO  16
+
+    // access counter saturation, an object in the main
+    // queue survives this amount of eviction rounds
+    #define DATACACHE_FREQ_MAX  3
+
+    typedef enum datacache_queue_id_t {
+        DATACACHE_SMALL,  // probation queue, fresh objects
+        DATACACHE_MAIN,   // objects accessed at least twice
+        DATACACHE_GHOST,  // recently evicted keys, without payload
+
+    } datacache_queue_id_t;
+
+    typedef struct datacache_entry_t {
+        void *owner;             // data root which owns this value
+        fileid_t dataid;         // datafile id
+        size_t offset;           // entry offset on the datafile
+        uint8_t freq;            // access counter (see DATACACHE_FREQ_MAX)
+        uint8_t queue;           // queue holding this entry (datacache_queue_id_t)
+        uint32_t length;         // payload length
+        void *buffer;            // payload (NULL on ghost queue)
+
+        struct datacache_entry_t *hnext;  // hash bucket chain
+        struct datacache_entry_t *qprev;  // queue links
+        struct datacache_entry_t *qnext;
+
+    } datacache_entry_t;
+
+    typedef struct datacache_queue_t {
+        datacache_entry_t *head;  // oldest entry, evicted first
+        datacache_entry_t *tail;  // newest entry
+        size_t length;            // amount of entries
+        size_t size;              // payload bytes (and overhead) used
+
+    } datacache_queue_t;
+
+    // bounded values cache in front of datafiles reads, following
+    // the S3-FIFO eviction policy (small, main and ghost fifo queues)
+    typedef struct datacache_t {
+        size_t size;                // maximum amount of bytes (zero: disabled)
+        size_t usage;               // bytes used by small and main queues
+        datacache_queue_t queues[3];
+
+        datacache_entry_t **buckets;
+        size_t nbuckets;            // amount of buckets (power of two)
+        size_t entries;             // entries hashed (including ghosts)
+
+        size_t admitted;            // amount of objects inserted
+        size_t evicted;             // amount of objects evicted
+
+    } datacache_t;
+
+    void datacache_init(size_t size);
+    void datacache_destroy();
+    datacache_t *datacache_get();
+
+    void *datacache_fetch(void *owner, fileid_t dataid, size_t offset, size_t *length);
+    void *datacache_fetch_range(void *owner, fileid_t dataid, size_t offset, size_t start, size_t length);
+    void datacache_insert(void *owner, fileid_t dataid, size_t offset, void *buffer, size_t length);
+    void datacache_invalidate(void *owner, fileid_t dataid, size_t offset);
+    void datacache_purge(void *owner);
+#endif
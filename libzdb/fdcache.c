@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "libzdb.h"
+#include "libzdb_private.h"
+
+//
+// file descriptors cache
+//
+// current index and data files are always kept opened, but reading an
+// older file (get on an old key, scan, history, ...) needs to open it
+// and close it for each request, with lot of files and random reads
+// this costs two syscalls and a path lookup per request
+//
+// each index and data root keeps a small list of read-only descriptors
+// on older files, the list is small (a few entries), a linear walk is
+// cheaper than anything else, when the list is full the least recently
+// used descriptor is closed
+//
+// files are never rewritten in place by the server (except flags updated
+// through a read-write descriptor, which is visible by any descriptor),
+// descriptors are only closed when the root is destroyed (reload, flush,
+// namespace removed) which is needed to see files changed externally
+// (eg: compaction)
+//
+// with several reactors, readers of the same namespace can use the list
+// at the same time, each descriptor returned is referenced until released
+// and only unreferenced descriptors are evicted
+//
+
+void fdcache_init(fdcache_t *cache, size_t size) {
+    memset(cache, 0x00, sizeof(fdcache_t));
+    pthread_mutex_init(&cache->lock, NULL);
+
+    // cache disabled
+    if(size == 0)
+        return;
+
+    if(!(cache->entries = calloc(sizeof(fdcache_entry_t), size)))
+        zdb_diep("fdcache: calloc");
+
+    cache->size = size;
+}
+
+// close every descriptors, cache is still usable
+void fdcache_clean(fdcache_t *cache) {
+    for(size_t i = 0; i < cache->length; i++)
+        close(cache->entries[i].fd);
+
+    cache->length = 0;
+}
+
+void fdcache_free(fdcache_t *cache) {
+    fdcache_clean(cache);
+    free(cache->entries);
+
+    cache->entries = NULL;
+    cache->size = 0;
+
+    pthread_mutex_destroy(&cache->lock);
+}
+
+// returns the cached descriptor of this file, -1 if not cached
+// the descriptor needs to be released with fdcache_release
+int fdcache_get(fdcache_t *cache, fileid_t fileid) {
+    int fd = -1;
+
+    pthread_mutex_lock(&cache->lock);
+
+    for(size_t i = 0; i < cache->length; i++) {
+        if(cache->entries[i].fileid == fileid) {
+            cache->entries[i].used = ++cache->clock;
+            cache->entries[i].refs += 1;
+            cache->hits += 1;
+
+            fd = cache->entries[i].fd;
+            break;
+        }
+    }
+
+    if(fd < 0)
+        cache->misses += 1;
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return fd;
+}
+
+// keep a descriptor freshly opened, returns 1 if the descriptor was not
+// kept (cache disabled or every descriptor in use, or file cached in the
+// meantime), caller needs to close it itself after use in that case
+int fdcache_put(fdcache_t *cache, fileid_t fileid, int fd) {
+    fdcache_entry_t *entry = NULL;
+
+    if(cache->size == 0)
+        return 1;
+
+    pthread_mutex_lock(&cache->lock);
+
+    for(size_t i = 0; i < cache->length; i++) {
+        if(cache->entries[i].fileid == fileid) {
+            pthread_mutex_unlock(&cache->lock);
+            return 1;
+        }
+    }
+
+    if(cache->length < cache->size) {
+        entry = &cache->entries[cache->length++];
+
+    } else {
+        // cache full, evicting least recently used
+        for(size_t i = 0; i < cache->length; i++) {
+            if(cache->entries[i].refs)
+                continue;
+
+            if(!entry || cache->entries[i].used < entry->used)
+                entry = &cache->entries[i];
+        }
+
+        if(!entry) {
+            pthread_mutex_unlock(&cache->lock);
+            return 1;
+        }
+
+        zdb_debug("[+] fdcache: evicting file %u (fd %d)\n", entry->fileid, entry->fd);
+        close(entry->fd);
+    }
+
+    entry->fileid = fileid;
+    entry->fd = fd;
+    entry->used = ++cache->clock;
+    entry->refs = 1;
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return 0;
+}
+
+// reader done with a descriptor, returns 1 if the descriptor
+// is not part of the cache, caller needs to close it
+int fdcache_release(fdcache_t *cache, int fd) {
+    int value = 1;
+
+    if(cache->size == 0)
+        return 1;
+
+    pthread_mutex_lock(&cache->lock);
+
+    for(size_t i = 0; i < cache->length; i++) {
+        if(cache->entries[i].fd == fd) {
+            cache->entries[i].refs -= 1;
+            value = 0;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return value;
+}
@@ -0,0 +1,39 @@
+#ifndef __ZDB_FDCACHE_H
+    #define __ZDB_FDCACHE_H
+
+    // default amount of read-only file descriptors kept
+    // opened per namespace, for index and data files each
+    #define ZDB_DEFAULT_FDCACHE  8
+
+    typedef struct fdcache_entry_t {
+        fileid_t fileid;  // file id opened
+        int fd;           // read-only file descriptor
+        uint64_t used;    // last access (cache clock)
+        uint32_t refs;    // amount of readers using the descriptor
+
+    } fdcache_entry_t;
+
+    // bounded list of read-only file descriptors of older (non-current)
+    // index or data files, least recently used one is closed when full
+    //
+    // the list can be used by concurrent readers, a descriptor in use
+    // is never closed by an eviction
+    typedef struct fdcache_t {
+        pthread_mutex_t lock;
+        fdcache_entry_t *entries;
+        size_t length;    // amount of entries in use
+        size_t size;      // maximum amount of entries (zero: cache disabled)
+        uint64_t clock;   // access counter
+        size_t hits;      // amount of lookup found in cache
+        size_t misses;    // amount of lookup which needed an open
+
+    } fdcache_t;
+
+    void fdcache_init(fdcache_t *cache, size_t size);
+    void fdcache_free(fdcache_t *cache);
+    void fdcache_clean(fdcache_t *cache);
+
+    int fdcache_get(fdcache_t *cache, fileid_t fileid);
+    int fdcache_put(fdcache_t *cache, fileid_t fileid, int fd);
+    int fdcache_release(fdcache_t *cache, int fd);
+#endif
@@ -11,6 +11,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <limits.h>
 #include <ftw.h>
 #include "libzdb.h"
@@ -92,6 +93,78 @@ int zdb_dir_clean_payload(char *path) {
     return nftw(path, dir_clean_cb, 64, FTW_DEPTH | FTW_PHYS);
 }
 
+//
+// file mapping
+//
+// files are only parsed from begin to end (index and data files), the
+// mapping is advised sequential, kernel reads ahead and can drop pages
+// already parsed, nothing is copied in userspace
+//
+int zdb_file_map(int fd, zdb_map_t *map) {
+    struct stat sb;
+
+    map->buffer = NULL;
+    map->length = 0;
+    map->mapped = 0;
+
+    if(fstat(fd, &sb) < 0) {
+        zdb_warnp("file map: fstat");
+        return 1;
+    }
+
+    // nothing to map, empty view
+    if(sb.st_size == 0)
+        return 0;
+
+    map->length = sb.st_size;
+
+    void *buffer = mmap(NULL, map->length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if(buffer != MAP_FAILED) {
+        madvise(buffer, map->length, MADV_SEQUENTIAL);
+
+        map->buffer = buffer;
+        map->mapped = 1;
+
+        return 0;
+    }
+
+    // mapping not supported by the filesystem, fallback
+    // to a plain copy of the file
+    zdb_debug("[-] file map: mmap failed, reading file\n");
+
+    if(!(map->buffer = malloc(map->length))) {
+        zdb_warnp("file map: malloc");
+        return 1;
+    }
+
+    for(size_t done = 0; done < map->length; ) {
+        ssize_t chunk = pread(fd, map->buffer + done, map->length - done, done);
+
+        if(chunk <= 0) {
+            zdb_warnp("file map: read");
+            free(map->buffer);
+            map->buffer = NULL;
+            return 1;
+        }
+
+        done += chunk;
+    }
+
+    return 0;
+}
+
+void zdb_file_unmap(zdb_map_t *map) {
+    if(map->mapped)
+        munmap(map->buffer, map->length);
+    else
+        free(map->buffer);
+
+    map->buffer = NULL;
+    map->length = 0;
+    map->mapped = 0;
+}
+
 int zdb_file_exists(char *path) {
     struct stat sb;
 
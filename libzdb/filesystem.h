@@ -7,6 +7,18 @@
     int zdb_dir_clean_payload(char *path);
     int zdb_file_exists(char *path);
 
+    // read-only view of a whole file, mapped in memory when
+    // possible, otherwise read into an allocated buffer
+    typedef struct zdb_map_t {
+        char *buffer;     // file contents
+        size_t length;    // file length
+        int mapped;       // buffer is a memory mapping (not allocated)
+
+    } zdb_map_t;
+
+    int zdb_file_map(int fd, zdb_map_t *map);
+    void zdb_file_unmap(zdb_map_t *map);
+
     #define ZDB_FILE_EXISTS             0
     #define ZDB_DIRECTORY_EXISTS        1
     #define ZDB_PATH_NOT_AVAILABLE      2
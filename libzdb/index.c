@@ -40,7 +40,6 @@ void index_entry_dump(index_entry_t *entry) {
 #ifdef RELEASE
     (void) entry;
 #else
-    zdb_debug("[+] index: entry dump: namespace  : %p\n", entry->namespace);
     zdb_debug("[+] index: entry dump: id length  : %" PRIu8  "\n", entry->idlength);
     zdb_debug("[+] index: entry dump: idx offset : %" PRIu32 "\n", entry->idxoffset);
     zdb_debug("[+] index: entry dump: idx fileid : %" PRIu32 "\n", entry->indexid);
@@ -129,12 +128,14 @@ int index_write(int fd, void *buffer, size_t length, index_root_t *root) {
     return 1;
 }
 
-static int index_read(int fd, void *buffer, size_t length) {
+// positional read, file offset is not modified which
+// makes descriptors safely shareable (see fdcache)
+static int index_read(int fd, void *buffer, size_t length, off_t offset) {
     ssize_t response;
 
-    if((response = read(fd, buffer, length)) < 0) {
+    if((response = pread(fd, buffer, length, offset)) < 0) {
         // update statistics
-        zdb_rootsettings.stats.idxreadfailed += 1;
+        zdb_atomic_add(zdb_rootsettings.stats.idxreadfailed, 1);
 
         zdb_warnp("index read");
         return 0;
@@ -154,12 +155,12 @@ static int index_read(int fd, void *buffer, size_t length) {
     }
 
     // update statistics
-    zdb_rootsettings.stats.idxdiskread += length;
+    zdb_atomic_add(zdb_rootsettings.stats.idxdiskread, length);
 
     return 1;
 }
 
-static char *index_set_id_buffer(char *buffer, char *indexdir, fileid_t indexid) {
+char *index_set_id_buffer(char *buffer, char *indexdir, fileid_t indexid) {
     sprintf(buffer, "%s/zdb-index-%05u", indexdir, indexid);
     return buffer;
 }
@@ -254,28 +255,40 @@ int index_open_readwrite_oneshot(index_root_t *root, fileid_t fileid) {
 // you need to call the index_release_dataid to be consistant about cleaning this
 // file open, if a new one was opened
 //
+// older files are kept opened (see fdcache.c), the same fd is
+// returned for a file recently used
+//
 // if the index id could not be opened, -1 is returned
 inline int index_grab_fileid(index_root_t *root, fileid_t fileid) {
     int fd = root->indexfd;
 
     if(root->indexid != fileid) {
+        if((fd = fdcache_get(&root->fdcache, fileid)) >= 0)
+            return fd;
+
         // the requested datafile is not the current datafile opened
-        // we will re-open the expected datafile temporary
+        // we will re-open the expected datafile and keep it opened
         zdb_debug("[-] index: switching file: current: %d, requested: %d\n", root->indexid, fileid);
         if((fd = index_open_file_readonly(root, fileid)) < 0)
             return -1;
+
+        fdcache_put(&root->fdcache, fileid, fd);
     }
 
     return fd;
 }
 
 inline void index_release_fileid(index_root_t *root, fileid_t fileid, int fd) {
-    // if the requested file id (or fd) is not the one
-    // currently used by the main structure, we close it
-    // since it was temporary
-    if(root->indexid != fileid) {
+    (void) fileid;
+
+    // current index file is owned by the main structure
+    if(fd == root->indexfd)
+        return;
+
+    // if the descriptor is not part of the cache (cache
+    // disabled or full), we close it since it was temporary
+    if(fdcache_release(&root->fdcache, fd))
         close(fd);
-    }
 }
 
 
@@ -364,6 +377,10 @@ size_t index_jump_next(index_root_t *root) {
     zdb_verbose("[+] index: closing current index file\n");
     index_close(root);
 
+    // current file is sealed now
+    if(root->seqviews)
+        index_seqview_map(root, root->indexid);
+
     // moving to the next file
     uint64_t fileid = root->indexid + 1;
     root->nextid = 0;
@@ -415,9 +432,9 @@ uint32_t index_next_objectid(index_root_t *root) {
     return root->nextid;
 }
 
-// perform the basic "hashing" (crc based) used to point to the expected branch
-// we only keep partial amount of the result to not fill the memory too fast
-uint32_t index_key_hash(unsigned char *id, uint8_t idlength) {
+// perform the basic "hashing" (crc based) of a key, full 32 bits
+// result is used as it by the hashtable engine
+uint32_t index_key_crc(unsigned char *id, uint8_t idlength) {
     uint64_t *input = (uint64_t *) id;
     uint32_t hash = 0;
     ssize_t i = 0;
@@ -428,24 +445,27 @@ uint32_t index_key_hash(unsigned char *id, uint8_t idlength) {
     for(; i < idlength; i++)
         hash = _mm_crc32_u8(hash, id[i]);
 
-    return hash & buckets_mask;
+    return hash;
 }
 
-// main look-up function, used to get an entry from the memory index
-index_entry_t *index_entry_get(index_root_t *root, unsigned char *id, uint8_t idlength) {
-    uint32_t branchkey = index_key_hash(id, idlength);
-    index_branch_t *branch = index_branch_get(root->branches, branchkey);
+// hash used to point to the expected branch
+// we only keep partial amount of the result, depending of the
+// amount of buckets allocated for this index
+uint32_t index_key_hash(index_root_t *root, unsigned char *id, uint8_t idlength) {
+    return index_key_crc(id, idlength) & (root->buckets - 1);
+}
+
+static index_entry_t *index_branch_lookup(index_arena_t *arena, index_branch_t *branch, unsigned char *id, uint8_t idlength) {
     index_entry_t *entry;
 
     // branch not exists
     if(!branch)
         return NULL;
 
-    for(entry = branch->list; entry; entry = entry->next) {
-        if(entry->idlength != idlength)
-            continue;
+    for(uint32_t handle = branch->list; handle; handle = entry->next) {
+        entry = index_arena_entry(arena, handle);
 
-        if(entry->namespace != root->namespace)
+        if(entry->idlength != idlength)
             continue;
 
         if(memcmp(entry->id, id, idlength) == 0)
@@ -455,6 +475,31 @@ index_entry_t *index_entry_get(index_root_t *root, unsigned char *id, uint8_t id
     return NULL;
 }
 
+// main look-up function, used to get an entry from the memory index
+index_entry_t *index_entry_get(index_root_t *root, unsigned char *id, uint8_t idlength) {
+    uint32_t crc = index_key_crc(id, idlength);
+    index_entry_t *entry;
+
+    if(root->engine == ZDB_INDEX_HASHTABLE) {
+        if(!root->hash)
+            return NULL;
+
+        return index_hash_get(root->hash, crc, id, idlength);
+    }
+
+    // running in a mode without index
+    if(!root->branches)
+        return NULL;
+
+    index_branch_t *branch = index_branch_get(root->branches, crc & (root->buckets - 1));
+
+    if((entry = index_branch_lookup(root->arena, branch, id, idlength)))
+        return entry;
+
+    // resize in progress, key could be not yet moved
+    return index_branch_lookup(root->arena, index_buckets_previous(root, crc), id, idlength);
+}
+
 // read an index entry from disk
 // we assume we know enough data to do everything in a single read call
 // which means we need to know the offset and id length beforehand
@@ -472,23 +517,20 @@ index_item_t *index_item_get_disk(index_root_t *root, fileid_t indexid, size_t o
     if(!(item = malloc(length)))
         return NULL;
 
-    // open requested file
-    if((fd = index_open_file_readonly(root, indexid)) < 0) {
+    // open requested file (or reuse it)
+    if((fd = index_grab_fileid(root, indexid)) < 0) {
         free(item);
         return NULL;
     }
 
-    // seek to requested offset
-    lseek(fd, offset, SEEK_SET);
-
     // read expected entry
-    if(!index_read(fd, item, length)) {
-        close(fd);
+    if(!index_read(fd, item, length, offset)) {
+        index_release_fileid(root, indexid, fd);
         free(item);
         return NULL;
     }
 
-    close(fd);
+    index_release_fileid(root, indexid, fd);
 
     return item;
 }
@@ -497,7 +539,6 @@ index_item_t *index_item_get_disk(index_root_t *root, fileid_t indexid, size_t o
 // useless reallocation
 // this item will be used to move from an index_entry_t (disk) to index_item_t (memory)
 index_item_t *index_transition = NULL;
-index_entry_t *index_reusable_entry = NULL;
 
 
 // IMPORTANT:
@@ -519,27 +560,65 @@ int index_entry_delete_memory(index_root_t *root, index_entry_t *entry) {
     root->stats.datasize -= entry->length;
     root->stats.size -= sizeof(index_entry_t) + entry->idlength;
 
+    // entry will be released, removing it from ordered index first
+    if(root->tree && index_tree_remove(root->tree, entry))
+        zdb_danger("[-] index: entry delete memory: entry not found on ordered index");
+
+    if(root->engine == ZDB_INDEX_HASHTABLE) {
+        // running in a mode without index, let's just skip this
+        if(root->hash == NULL)
+            return 0;
+
+        zdb_debug("[+] index: delete memory: removing entry from memory\n");
+
+        uint32_t crc = index_key_crc(entry->id, entry->idlength);
+        uint32_t handle;
+
+        if(!(handle = index_hash_remove(root->hash, crc, entry))) {
+            zdb_danger("[-] index: entry delete memory: entry not found on hashtable");
+            return 1;
+        }
+
+        index_arena_release(root->arena, handle);
+
+        index_resize_step(root, INDEX_RESIZE_STEPS);
+
+        return 0;
+    }
+
     // running in a mode without index, let's just skip this
     if(root->branches == NULL)
         return 0;
 
-    uint32_t branchkey = index_key_hash(entry->id, entry->idlength);
-    index_branch_t *branch = index_branch_get(root->branches, branchkey);
-    index_entry_t *previous = index_branch_get_previous(branch, entry);
+    uint32_t crc = index_key_crc(entry->id, entry->idlength);
+    index_branch_t *branch = index_branch_get(root->branches, crc & (root->buckets - 1));
+    uint32_t handle = INDEX_HANDLE_NULL;
+    uint32_t previous = INDEX_HANDLE_NULL;
+
+    if(branch)
+        handle = index_branch_find(root->arena, branch, entry, &previous);
+
+    // entry not found, resize in progress, entry could
+    // be not yet moved from previous buckets
+    if(!handle && (branch = index_buckets_previous(root, crc)))
+        handle = index_branch_find(root->arena, branch, entry, &previous);
 
     zdb_debug("[+] index: delete memory: removing entry from memory\n");
 
-    if(previous == entry) {
+    if(!handle) {
         zdb_danger("[-] index: entry delete memory: something wrong happens");
         zdb_danger("[-] index: entry delete memory: branches seems buggy");
         return 1;
     }
 
-    // removing entry from global branch
-    index_branch_remove(branch, entry, previous);
+    // removing entry from index branch
+    index_branch_remove(root->arena, branch, handle, previous);
 
-    // cleaning memory object
-    free(entry);
+    // giving back entry to the arena
+    index_arena_release(root->arena, handle);
+
+    // shrink memory index if needed, one small step at a time
+    index_resize_step(root, INDEX_RESIZE_STEPS);
 
     return 0;
 }
@@ -554,16 +633,22 @@ int index_entry_delete_disk(index_root_t *root, index_entry_t *entry) {
     // this affect the memory object (runtime)
     entry->flags |= INDEX_ENTRY_DELETED;
 
+    // entry not written yet (batch in progress), updating it in place
+    if(root->batch.active && entry->indexid == root->indexid && entry->idxoffset >= root->batch.base) {
+        index_item_t *item = (index_item_t *) (root->batch.buffer + (entry->idxoffset - root->batch.base));
+        item->flags = entry->flags;
+        return 0;
+    }
+
     // (re-)open the expected index file, in read-write mode
     if((fd = index_open_file_readwrite(root, entry->indexid)) < 0)
         return 1;
 
     // jump to the right offset for this entry
     zdb_debug("[+] index: delete: reading %lu bytes at offset %" PRIu32 "\n", entrylength, entry->idxoffset);
-    lseek(fd, entry->idxoffset, SEEK_SET);
 
     // reading the exact entry from disk
-    if(read(fd, index_transition, entrylength) != (ssize_t) entrylength) {
+    if(pread(fd, index_transition, entrylength, entry->idxoffset) != (ssize_t) entrylength) {
         zdb_warnp("index_entry_delete read");
         close(fd);
         return 1;
@@ -574,13 +659,11 @@ int index_entry_delete_disk(index_root_t *root, index_entry_t *entry) {
     // update the flags
     index_transition->flags = entry->flags;
 
-    // rollback to point to the entry again
+    // overwrite the key at the same offset
     zdb_debug("[+] index: delete: overwriting key\n");
-    lseek(fd, entry->idxoffset, SEEK_SET);
 
-    // overwrite the key
     // FIXME: why not using index_write ?
-    if(write(fd, index_transition, entrylength) != (ssize_t) entrylength) {
+    if(pwrite(fd, index_transition, entrylength, entry->idxoffset) != (ssize_t) entrylength) {
         zdb_warnp("index_entry_delete write");
 
         // FIXME: not needed if using index_write
@@ -593,6 +676,14 @@ int index_entry_delete_disk(index_root_t *root, index_entry_t *entry) {
 
     close(fd);
 
+    // in sequential mode, the key is the sequential id
+    if(root->mode == ZDB_MODE_SEQUENTIAL) {
+        uint32_t key;
+
+        memcpy(&key, entry->id, sizeof(uint32_t));
+        index_seqtable_set(root, key, index_transition);
+    }
+
     // flag index entry as dirty, it was just modified
     index_dirty_set(root, entry->indexid, 1);
 
@@ -721,64 +812,183 @@ size_t index_offset_objectid(uint32_t objectid) {
     return offset;
 }
 
-// iterate over all entries in a single branch
-// and remove if this entry is related to requested namespace
-static inline size_t index_clean_namespace_branch(index_branch_t *branch, void *namespace) {
-    index_entry_t *entry = branch->list;
-    index_entry_t *previous = NULL;
-    size_t deleted  = 0;
+// remove all the keys of a namespace from the index
+//
+// each index owns it's own memory index, this only costs
+// the size of this index (buckets allocated), entries are
+// released at once by resetting the arena
+int index_clean_namespace(index_root_t *root, void *namespace) {
+    size_t deleted = 0;
 
-    while(entry) {
-        if(entry->namespace != namespace) {
-            // keeping this key, looking forward
-            previous = entry;
-            entry = entry->next;
-            continue;
-        }
+    (void) namespace;
 
-        #ifndef RELEASE
-        zdb_log("[+] index: namespace cleaner: free: ");
-        zdb_hexdump(entry->id, entry->idlength);
-        printf("\n"); // FIXME
-        #endif
+    zdb_debug("[+] index: starting namespace cleaner\n");
+
+    if(root->tree)
+        index_tree_clean(root->tree);
+
+    if(root->engine == ZDB_INDEX_HASHTABLE) {
+        if(!root->hash)
+            return 0;
+
+        deleted = index_hash_length(root->hash);
+        index_hash_clean(root->hash);
 
-        // okay, we need to remove this key
-        index_entry_t *next = entry->next;
-        index_entry_t *removed = index_branch_remove(branch, entry, previous);
+    } else {
+        if(!root->branches)
+            return 0;
 
-        free(removed);
-        deleted += 1;
+        for(uint32_t b = 0; b < root->buckets; b++)
+            if(root->branches[b])
+                deleted += root->branches[b]->length;
 
-        entry = next;
+        if(root->migration.branches) {
+            for(uint32_t b = 0; b < root->migration.buckets; b++)
+                if(root->migration.branches[b])
+                    deleted += root->migration.branches[b]->length;
+
+            // no need to keep previous buckets anymore
+            index_buckets_free(root->migration.branches, root->migration.buckets);
+            memset(&root->migration, 0x00, sizeof(index_migration_t));
+        }
+
+        index_buckets_clean(root->branches, root->buckets);
     }
 
-    return deleted;
+    // all entries are gone, releasing slabs in one shot
+    index_arena_reset(root->arena);
+
+    zdb_debug("[+] index: namespace cleaner: %lu keys removed\n", deleted);
+
+    return 0;
 }
 
-// remove specific namespace from the index
-//
-// we use a global index for everything, when removing a
-// namespace, we walk over all the keys and remove keys matching
-// to this namespace
-int index_clean_namespace(index_root_t *root, void *namespace) {
-    index_branch_t **branches = root->branches;
-    size_t deleted = 0;
+// call 'callback' on each entry in memory of that index, walking
+// stops if callback returns non-zero, returns amount of entries visited
+size_t index_walk(index_root_t *root, int (*callback)(index_entry_t *, void *), void *userptr) {
+    size_t visited = 0;
+
+    if(root->engine == ZDB_INDEX_HASHTABLE) {
+        if(!root->hash)
+            return 0;
 
-    if(!branches)
+        size_t slot = 0;
+        index_entry_t *entry;
+
+        while((entry = index_hash_next(root->hash, &slot))) {
+            visited += 1;
+
+            if(callback(entry, userptr))
+                return visited;
+        }
+
+        return visited;
+    }
+
+    if(!root->branches)
         return 0;
 
-    zdb_debug("[+] index: starting namespace cleaner\n");
+    // walking over the current buckets then the previous ones
+    // if a resize is in progress
+    index_branch_t **arrays[2] = {root->branches, root->migration.branches};
+    uint32_t buckets[2] = {root->buckets, root->migration.buckets};
 
-    for(uint32_t b = 0; b < buckets_branches; b++) {
-        if(!branches[b])
+    for(int i = 0; i < 2; i++) {
+        if(!arrays[i])
             continue;
 
-        deleted += index_clean_namespace_branch(branches[b], namespace);
+        for(uint32_t b = 0; b < buckets[i]; b++) {
+            if(!arrays[i][b])
+                continue;
+
+            index_entry_t *entry;
+
+            for(uint32_t handle = arrays[i][b]->list; handle; handle = entry->next) {
+                entry = index_arena_entry(root->arena, handle);
+                visited += 1;
+
+                if(callback(entry, userptr))
+                    return visited;
+            }
+        }
     }
 
-    zdb_debug("[+] index: namespace cleaner: %lu keys removed\n", deleted);
+    return visited;
+}
 
-    return 0;
+//
+// incremental resize of the memory index
+//
+// memory index (branches or hashtable) grows and shrinks with the amount of
+// keys, without doing the full rehash at once, each step only moves a bounded
+// amount of branches (or group of slots), steps are made on each insertion and
+// deletion and can be made by caller when it's idle
+//
+
+// check if a resize is needed and move up to 'steps' branches (or
+// group of slots), returns the amount of work still pending
+size_t index_resize_step(index_root_t *root, size_t steps) {
+    if(root->engine == ZDB_INDEX_HASHTABLE) {
+        if(!root->hash)
+            return 0;
+
+        index_hash_resize_check(root->hash);
+        return index_hash_migrate(root->hash, steps * INDEX_HASH_GROUP);
+    }
+
+    if(!root->branches)
+        return 0;
+
+    index_buckets_resize_check(root);
+    return index_buckets_migrate(root, steps);
+}
+
+// complete any resize in progress, in one shot
+void index_resize_finish(index_root_t *root) {
+    if(root->hash && root->hash->previous)
+        index_hash_migrate(root->hash, root->hash->previous->capacity);
+
+    if(root->migration.branches)
+        index_buckets_migrate(root, root->migration.buckets);
+}
+
+int index_resize_pending(index_root_t *root) {
+    if(root->hash)
+        return root->hash->previous != NULL;
+
+    return root->migration.branches != NULL;
+}
+
+// amount of buckets (or slots) available in memory index
+size_t index_capacity(index_root_t *root) {
+    if(root->hash)
+        return root->hash->capacity;
+
+    return root->buckets;
+}
+
+// ratio between the amount of keys and the amount of buckets (or slots)
+double index_load_factor(index_root_t *root) {
+    size_t capacity = index_capacity(root);
+
+    if(capacity == 0)
+        return 0;
+
+    if(root->hash)
+        return index_hash_length(root->hash) / (double) capacity;
+
+    return root->stats.entries / (double) capacity;
+}
+
+// percentage of the resize in progress, 100 if nothing is in progress
+double index_resize_progress(index_root_t *root) {
+    if(root->hash && root->hash->previous)
+        return (root->hash->migrated * 100.0) / root->hash->previous->capacity;
+
+    if(root->migration.branches)
+        return (root->migration.position * 100.0) / root->migration.buckets;
+
+    return 100.0;
 }
 
 //
@@ -1,6 +1,9 @@
 #ifndef __ZDB_INDEX_H
     #define __ZDB_INDEX_H
 
+    // key length is uint8_t
+    #define MAX_KEY_LENGTH  (1 << 8) - 1
+
     typedef enum index_mode_t {
         // default key-value store
         ZDB_MODE_KEY_VALUE = 0,
@@ -32,6 +35,20 @@
     // don't forget to adapt correctly the handlers
     // function pointers (basicly for GET and SET)
 
+    // in-memory index engine used to lookup keys
+    // in key-value mode
+    typedef enum index_engine_t {
+        // lazy allocated branches of linked-list (see index_branch.c)
+        ZDB_INDEX_BRANCHES = 0,
+
+        // open-addressing table, one per index (see index_hash.c)
+        ZDB_INDEX_HASHTABLE = 1,
+
+        // amount of engines available
+        ZDB_INDEX_ENGINES
+
+    } index_engine_t;
+
 
     // index file header
     // this file is more there for information
@@ -75,30 +92,28 @@
     } index_flags_t;
 
     typedef struct index_entry_t {
-        // linked list pointer
-        struct index_entry_t *next;
-
-        // pointer to source namespace
-        // index should not be aware of his namespace
-        // but since we use a single big index, we need to
-        // be able to make namespace distinction
-        // note: another approch could be separate branch-list per namespace
-        // note 2: we keep a void pointer, we will only compare address and not
-        //         the object itself, this make some opacity later if we change
-        //         and reduce issue with circular inclusion
-        void *namespace;
+        // linked list handle (see index_arena.c), next entry on the
+        // same branch, zero if this is the last one
+        uint32_t next;
+
+        // note: there is no reference to the namespace, each index
+        //       owns it's own branches (or table), entries of different
+        //       namespaces are never mixed
+        //
+        // note 2: fields are ordered by size to avoid padding, this
+        //         struct is allocated for each key in memory
 
-        uint8_t idlength;    // length of the id, here uint8_t limits to 256 bytes
         uint32_t offset;     // offset on the corresponding datafile
         uint32_t idxoffset;  // offset on the index file (index file id is the same as data file)
         uint32_t length;     // length of the payload on the datafile
-        uint8_t flags;       // keep deleted flags (should be index_flags_t type)
-        fileid_t dataid;     // datafile id where payload is located
-        fileid_t indexid;    // indexfile id where this index entry is located
         uint32_t crc;        // the data payload crc32
-        fileid_t parentid;   // parent index file id (history)
         uint32_t parentoff;  // parent index file offset (history)
         uint32_t timestamp;  // unix timestamp of key creation
+        fileid_t dataid;     // datafile id where payload is located
+        fileid_t indexid;    // indexfile id where this index entry is located
+        fileid_t parentid;   // parent index file id (history)
+        uint8_t flags;       // keep deleted flags (should be index_flags_t type)
+        uint8_t idlength;    // length of the id, here uint8_t limits to 256 bytes
         unsigned char id[];  // the id accessor, dynamically loaded
 
     } index_entry_t;
@@ -119,12 +134,120 @@
     // - id 0001: [...................]
     // - id 0002: [...]
     typedef struct index_branch_t {
-        size_t length;       // length of this branch (count of entries)
-        index_entry_t *list; // entry point of the linked list
-        index_entry_t *last; // pointer to the last item, quicker to append
+        uint32_t length;     // length of this branch (count of entries)
+        uint32_t list;       // entry point of the linked list (handle)
+        uint32_t last;       // handle of the last item, quicker to append
 
     } index_branch_t;
 
+    // entries are not allocated one by one, they are allocated in slabs
+    // of fixed size entries (depending of the key length), each entry
+    // is pointed by a 32 bits handle (slab id and position in the slab)
+    typedef struct index_slab_t {
+        uint8_t *buffer;     // entries storage
+        uint32_t entrysize;  // size of one entry on this slab
+        uint32_t used;       // amount of entries already handed out
+
+    } index_slab_t;
+
+    // amount of size classes, one class per 8 bytes of key length
+    #define INDEX_ARENA_CLASSES  ((MAX_KEY_LENGTH + 1) / 8 + 1)
+
+    typedef struct index_arena_t {
+        index_slab_t *slabs;  // slabs list (first one is never used)
+        uint32_t allocated;   // amount of slabs allocated on the list
+        uint32_t length;      // amount of slabs used on the list
+        size_t size;          // amount of bytes allocated for entries
+
+        uint32_t current[INDEX_ARENA_CLASSES];   // slab currently filled, per class
+        uint32_t freelist[INDEX_ARENA_CLASSES];  // released entries handles, per class
+
+    } index_arena_t;
+
+    // open-addressing table, slots are probed by group
+    // of 16 control tags, see index_hash.c for details
+    typedef struct index_hash_t {
+        uint8_t *tags;          // one control tag per slot
+        uint32_t *slots;        // entries handle, same position as tags
+        index_arena_t *arena;   // arena where entries handle are allocated
+        size_t capacity;        // amount of slots (power of two)
+        size_t length;          // amount of entries in the table
+        size_t deleted;         // amount of tombstones slots
+
+        struct index_hash_t *previous; // table being migrated (incremental resize)
+        size_t migrated;               // amount of slots of previous table already moved
+
+    } index_hash_t;
+
+    // optional ordered index (b+tree) of the entries, kept alongside
+    // the branches (or hashtable), see index_tree.c for details
+    #define INDEX_TREE_ORDER  64
+
+    // copy of a key, used as separator on internal nodes
+    typedef struct index_tree_key_t {
+        uint8_t length;
+        unsigned char id[];
+
+    } index_tree_key_t;
+
+    // common header of leaves and internal nodes
+    typedef struct index_tree_node_t {
+        uint16_t length;  // amount of entries (leaf) or children (internal node)
+        uint8_t leaf;     // leaf or internal node
+
+    } index_tree_node_t;
+
+    typedef struct index_tree_leaf_t {
+        index_tree_node_t header;
+
+        struct index_tree_leaf_t *next;      // next leaf, in key order
+        struct index_tree_leaf_t *previous;  // previous leaf, in key order
+
+        index_entry_t *entries[INDEX_TREE_ORDER];
+
+    } index_tree_leaf_t;
+
+    typedef struct index_tree_internal_t {
+        index_tree_node_t header;
+
+        index_tree_node_t *children[INDEX_TREE_ORDER];
+
+        // lower bound of each children, first one is not used
+        index_tree_key_t *keys[INDEX_TREE_ORDER];
+
+    } index_tree_internal_t;
+
+    typedef struct index_tree_t {
+        index_tree_node_t *root;
+        size_t length;   // amount of entries
+        size_t size;     // amount of bytes allocated (nodes and separators)
+        uint32_t depth;  // amount of levels (one when root is a leaf)
+
+    } index_tree_t;
+
+    // incremental resize of the branches, the previous array
+    // is kept until all of his branches were moved to the new one
+    typedef struct index_migration_t {
+        index_branch_t **branches; // previous branches being moved
+        uint32_t buckets;          // amount of previous branches
+        uint32_t position;         // next previous branch to move
+
+    } index_migration_t;
+
+    // high-water mark of a checkpoint: everything written on index files
+    // before this position is contained in the checkpoint, only what's
+    // after needs to be replayed
+    typedef struct index_checkpoint_t {
+        fileid_t indexid;    // index file id of the mark
+        uint32_t offset;     // offset (end of last entry) in that file
+        uint32_t previous;   // offset of the last entry in that file (root->previous)
+        uint32_t nextid;     // root->nextid at this position
+        uint64_t nextentry;  // root->nextentry at this position
+        uint64_t entries;    // amount of entries in memory at this position
+        uint64_t timestamp;  // unix timestamp when the mark was taken
+
+    } index_checkpoint_t;
+
     // index status flags
     // keep some heatly status of the index
     typedef enum index_status_t {
@@ -149,13 +272,56 @@
 
     } index_seqid_t;
 
+    // optional in-memory copy of sequential index entries, indexed
+    // by sequential id, fixed stride (no key stored, the key is the
+    // slot position), a get only needs the datafile read
+    typedef struct index_seqslot_t {
+        uint32_t offset;     // offset on the datafile
+        uint32_t length;     // payload length
+        uint32_t crc;        // payload crc
+        uint32_t timestamp;  // creation or update time
+        uint32_t parentoff;  // history: offset of previous entry on index
+        fileid_t dataid;     // datafile id
+        fileid_t parentid;   // history: index file id of previous entry
+        uint8_t flags;       // entry flags (deleted, ...)
+
+    } index_seqslot_t;
+
+    // one slot per possible sequential id at most (uint32_t),
+    // amount of slots doesn't fit an uint32_t itself
+    #define INDEX_SEQTABLE_INITIAL  1024
+    #define INDEX_SEQTABLE_MAXIMUM  ((size_t) UINT32_MAX + 1)
+
+    typedef struct index_seqtable_t {
+        size_t allocated;
+        size_t length;
+        index_seqslot_t *slots;
+
+    } index_seqtable_t;
+
+    // optional read-only mapping of sealed sequential index files,
+    // indexed by file id, entries are read in place (see index_seq.c)
+    typedef struct index_seqview_t {
+        char *buffer;    // file mapping (NULL when not mapped)
+        size_t length;   // mapping length
+
+    } index_seqview_t;
+
+    typedef struct index_seqviews_t {
+        uint32_t allocated;
+        uint32_t length;        // amount of files mapped
+        size_t size;            // amount of bytes mapped
+        index_seqview_t *views;
+
+    } index_seqviews_t;
+
     // index statistics
     typedef struct index_stats_t {
         size_t size;     // in memory index size usage (in bytes)
         size_t datasize; // data payload size
         size_t entries;  // keys count
-        size_t hits;     // amount of index hit requested (not used yet)
-        size_t faults;   // amount of index hit missed (not used yet)
+        size_t hits;     // amount of read lookup which found a live key
+        size_t faults;   // amount of read lookup on missing or deleted key
         size_t errors;   // amount of io (read/write) error
         time_t lasterr;  // last error timestamp
 
@@ -168,6 +334,18 @@
 
     } index_dirty_t;
 
+    // entries appended while a batch is in progress are not written
+    // one by one, they are serialized here (in file order) and written
+    // at once when the batch is committed (see index_batch_begin)
+    typedef struct index_batch_t {
+        uint8_t *buffer;   // serialized entries
+        size_t length;     // amount of bytes used on buffer
+        size_t allocated;  // amount of bytes allocated
+        size_t base;       // offset on the index file of the first entry
+        int active;        // batch in progress
+
+    } index_batch_t;
+
     //
     // global root memory structure of the index
     //
@@ -180,18 +358,30 @@
         uint32_t nextid;    // next-id is a localfile id used in direct mode (next id on this file)
         int sync;           // flag to force write sync
         int synctime;       // force sync index after this amount of time
+        int loadthreads;    // amount of loader workers (read-ahead of index files)
         time_t lastsync;    // keep track when the last sync was explictly made
         index_mode_t mode;  // running mode for that index
         time_t rotate;      // last time file were rotate (jumped to next file)
         int updated;        // does current index changed since opened
 
-        void *namespace;    // see index_entry_t, same reason
+        void *namespace;    // namespace owning this index (opaque pointer)
 
         index_seqid_t *seqid;      // sequential fileid mapping
-        index_branch_t **branches; // list of branches (explained later)
+        index_seqtable_t *seqtable; // sequential entries in memory, optional
+        index_seqviews_t *seqviews; // sealed sequential files mapped, optional
+        index_branch_t **branches; // list of branches (explained later), owned by this index
+        uint32_t buckets;          // amount of branches allocated (power of two)
+        index_migration_t migration; // branches resize in progress
+        index_hash_t *hash;        // open-addressing table (hashtable engine)
+        index_arena_t *arena;      // entries allocator, owned by this index
+        index_tree_t *tree;        // ordered index, optional (see index_tree.c)
+        index_engine_t engine;     // in-memory engine used by this index
         index_status_t status;     // index health
         index_stats_t stats;       // index statistics
+        index_checkpoint_t checkpoint; // position of the last checkpoint written (or loaded)
         index_dirty_t dirty;       // bitmap of dirty index files
+        fdcache_t fdcache;         // read-only descriptors of older index files
+        index_batch_t batch;       // pending entries, not written yet
 
         // dirty index are index files overwritten because of update
         // it's useful to know which index files are updated, in case of
@@ -255,8 +445,6 @@
     } index_dirty_list_t;
 
 
-    // key length is uint8_t
-    #define MAX_KEY_LENGTH  (1 << 8) - 1
 
     size_t index_jump_next(index_root_t *root);
     int index_emergency(index_root_t *root);
@@ -282,16 +470,14 @@
 
     int index_clean_namespace(index_root_t *root, void *namespace);
 
-    extern index_entry_t *index_reusable_entry;
-
     // extern but not really public functions
     // used by index_loader
     int index_write(int fd, void *buffer, size_t length, index_root_t *root);
     void index_set_id(index_root_t *root, fileid_t fileid);
+    char *index_set_id_buffer(char *buffer, char *indexdir, fileid_t indexid);
     void index_open_final(index_root_t *root);
 
     extern index_item_t *index_transition;
-    extern index_entry_t *index_reusable_entry;
 
     size_t index_next_offset(index_root_t *root);
     size_t index_offset_objectid(uint32_t idobj);
@@ -307,7 +493,22 @@
     void index_item_header_dump(index_item_t *item);
     void index_entry_dump(index_entry_t *entry);
 
-    uint32_t index_key_hash(unsigned char *id, uint8_t idlength);
+    uint32_t index_key_crc(unsigned char *id, uint8_t idlength);
+    uint32_t index_key_hash(index_root_t *root, unsigned char *id, uint8_t idlength);
+
+    size_t index_walk(index_root_t *root, int (*callback)(index_entry_t *, void *), void *userptr);
+
+    // amount of branches (or groups of slots) moved on each
+    // resize step, when a resize is in progress
+    #define INDEX_RESIZE_STEPS       16
+    #define INDEX_RESIZE_IDLE_STEPS  4096
+
+    size_t index_resize_step(index_root_t *root, size_t steps);
+    void index_resize_finish(index_root_t *root);
+    int index_resize_pending(index_root_t *root);
+    size_t index_capacity(index_root_t *root);
+    double index_load_factor(index_root_t *root);
+    double index_resize_progress(index_root_t *root);
 
     // open index _without_ setting internal fd
     int index_open_file_readonly(index_root_t *root, fileid_t fileid);
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include "libzdb.h"
+#include "libzdb_private.h"
+
+//
+// index entries allocator
+//
+// allocating each entry with it's own malloc costs allocator overhead
+// for each key and lot of allocations when loading large index, instead
+// entries are allocated inside large slabs, each slab contains entries
+// of the same size class (key length rounded to 8 bytes)
+//
+// an entry is pointed by a 32 bits handle:
+//
+//   [ slab id (20 bits) ][ position in the slab (12 bits) ]
+//
+// slab id zero is never used, so handle zero can be used as a null value,
+// since slabs are never moved, a pointer to an entry stays valid until
+// the entry is released
+//
+// released entries are kept on a free-list per size class (the handle of
+// the next free entry is written in place of the released entry), when
+// the index is cleaned, all slabs are released at once, without walking
+// any entry
+//
+// slabs are allocated for their full size, but memory is only touched
+// when entries are used, slab buffers are large enough to be mapped
+// directly by the allocator, untouched pages are not really consumed
+//
+
+static inline uint8_t index_arena_class(uint8_t idlength) {
+    return (idlength + 7) / 8;
+}
+
+size_t index_arena_entrysize(uint8_t idlength) {
+    return sizeof(index_entry_t) + (index_arena_class(idlength) * 8);
+}
+
+index_arena_t *index_arena_init() {
+    index_arena_t *arena;
+
+    if(!(arena = calloc(sizeof(index_arena_t), 1))) {
+        zdb_warnp("index arena: calloc");
+        return NULL;
+    }
+
+    // first slab is never used, handle zero means null
+    arena->length = 1;
+
+    return arena;
+}
+
+// release all slabs (and all entries) at once
+void index_arena_reset(index_arena_t *arena) {
+    for(uint32_t i = 1; i < arena->length; i++)
+        free(arena->slabs[i].buffer);
+
+    free(arena->slabs);
+
+    arena->slabs = NULL;
+    arena->allocated = 0;
+    arena->length = 1;
+    arena->size = 0;
+
+    memset(arena->current, 0x00, sizeof(arena->current));
+    memset(arena->freelist, 0x00, sizeof(arena->freelist));
+}
+
+void index_arena_free(index_arena_t *arena) {
+    if(!arena)
+        return;
+
+    index_arena_reset(arena);
+    free(arena);
+}
+
+index_entry_t *index_arena_entry(index_arena_t *arena, uint32_t handle) {
+    index_slab_t *slab = &arena->slabs[handle >> INDEX_ARENA_SLAB_BITS];
+    return (index_entry_t *) (slab->buffer + ((handle & INDEX_ARENA_SLAB_MASK) * slab->entrysize));
+}
+
+static uint32_t index_arena_slab_new(index_arena_t *arena, size_t entrysize) {
+    // handle doesn't allow more slabs
+    if(arena->length == (1 << (32 - INDEX_ARENA_SLAB_BITS))) {
+        zdb_danger("[-] index arena: maximum amount of slabs reached");
+        return 0;
+    }
+
+    if(arena->length >= arena->allocated) {
+        uint32_t allocated = arena->allocated ? arena->allocated * 2 : 64;
+        index_slab_t *slabs;
+
+        if(!(slabs = realloc(arena->slabs, sizeof(index_slab_t) * allocated))) {
+            zdb_warnp("index arena: slabs realloc");
+            return 0;
+        }
+
+        arena->slabs = slabs;
+        arena->allocated = allocated;
+    }
+
+    index_slab_t *slab = &arena->slabs[arena->length];
+
+    if(!(slab->buffer = malloc(entrysize * INDEX_ARENA_SLAB_LENGTH))) {
+        zdb_warnp("index arena: slab malloc");
+        return 0;
+    }
+
+    slab->entrysize = entrysize;
+    slab->used = 0;
+
+    arena->size += entrysize * INDEX_ARENA_SLAB_LENGTH;
+
+    return arena->length++;
+}
+
+// allocate an entry which can contains a key of 'idlength' bytes
+// entry is zeroed, returns the entry handle or INDEX_HANDLE_NULL
+uint32_t index_arena_alloc(index_arena_t *arena, uint8_t idlength) {
+    uint8_t sclass = index_arena_class(idlength);
+    size_t entrysize = index_arena_entrysize(idlength);
+    uint32_t handle;
+
+    if((handle = arena->freelist[sclass])) {
+        index_entry_t *entry = index_arena_entry(arena, handle);
+
+        // next free entry handle is stored in place
+        arena->freelist[sclass] = entry->next;
+        memset(entry, 0x00, entrysize);
+
+        return handle;
+    }
+
+    uint32_t slabid = arena->current[sclass];
+
+    if(!slabid || arena->slabs[slabid].used == INDEX_ARENA_SLAB_LENGTH) {
+        if(!(slabid = index_arena_slab_new(arena, entrysize)))
+            return INDEX_HANDLE_NULL;
+
+        arena->current[sclass] = slabid;
+    }
+
+    index_slab_t *slab = &arena->slabs[slabid];
+    handle = (slabid << INDEX_ARENA_SLAB_BITS) | slab->used;
+    slab->used += 1;
+
+    memset(index_arena_entry(arena, handle), 0x00, entrysize);
+
+    return handle;
+}
+
+// put an entry back to the free-list of it's class
+void index_arena_release(index_arena_t *arena, uint32_t handle) {
+    index_entry_t *entry = index_arena_entry(arena, handle);
+    uint8_t sclass = index_arena_class(entry->idlength);
+
+    entry->next = arena->freelist[sclass];
+    arena->freelist[sclass] = handle;
+}
@@ -0,0 +1,21 @@
+#ifndef __ZDB_INDEX_ARENA_H
+    #define __ZDB_INDEX_ARENA_H
+
+    // amount of entries per slab (bits of the handle used for position)
+    #define INDEX_ARENA_SLAB_BITS   12
+    #define INDEX_ARENA_SLAB_LENGTH (1 << INDEX_ARENA_SLAB_BITS)
+    #define INDEX_ARENA_SLAB_MASK   (INDEX_ARENA_SLAB_LENGTH - 1)
+
+    // handle value used as 'no entry'
+    #define INDEX_HANDLE_NULL       0
+
+    index_arena_t *index_arena_init();
+    void index_arena_free(index_arena_t *arena);
+    void index_arena_reset(index_arena_t *arena);
+
+    uint32_t index_arena_alloc(index_arena_t *arena, uint8_t idlength);
+    void index_arena_release(index_arena_t *arena, uint32_t handle);
+    index_entry_t *index_arena_entry(index_arena_t *arena, uint32_t handle);
+
+    size_t index_arena_entrysize(uint8_t idlength);
+#endif
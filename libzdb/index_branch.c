@@ -6,7 +6,7 @@
 #include "libzdb.h"
 #include "libzdb_private.h"
 
-// maximum allowed branch in memory
+// maximum allowed branch in memory, per index
 //
 // this settings is mainly the most important to
 // determine the keys lookup time
@@ -19,8 +19,10 @@
 // the bucket, but using a full 32-bits hashlist would
 // consume more than (2^32 * 8) bytes of memory (on 64-bits)
 //
-// the default settings sets this to 24 bits, which allows
-// 16 millions direct entries, collisions uses linked-list
+// each index starts with a small amount of buckets and
+// grows when it gets more keys, up to this limit, the default
+// settings sets this to 24 bits, which allows 16 millions
+// direct entries, collisions uses linked-list
 //
 // makes sur mask and amount of branch are always in relation
 // use 'index_set_buckets_bits' to be sure
@@ -42,8 +44,157 @@ int index_set_buckets_bits(uint8_t bits) {
 // this allows us to use a lot of branches (buckets_branches) in this case)
 // without consuming all the memory if we don't need it
 //
-index_branch_t **index_buckets_init() {
-    return (index_branch_t **) calloc(sizeof(index_branch_t *), buckets_branches);
+// each index owns it's own buckets array, so cleaning an index
+// only costs the size of that index
+//
+index_branch_t **index_buckets_init(uint32_t buckets) {
+    return (index_branch_t **) calloc(sizeof(index_branch_t *), buckets);
+}
+
+// free every branches of a buckets array, entries are owned
+// by the index arena and are not released here
+// array itself is kept and can be reused
+void index_buckets_clean(index_branch_t **branches, uint32_t buckets) {
+    if(!branches)
+        return;
+
+    for(uint32_t b = 0; b < buckets; b++) {
+        index_branch_free(branches, b);
+        branches[b] = NULL;
+    }
+}
+
+void index_buckets_free(index_branch_t **branches, uint32_t buckets) {
+    index_buckets_clean(branches, buckets);
+    free(branches);
+}
+
+// returns the amount of buckets which keeps an average
+// of one entry per branch, within the allowed limits
+uint32_t index_buckets_fit(size_t entries) {
+    uint32_t buckets = INDEX_BUCKETS_INITIAL;
+
+    while(buckets < entries && buckets < buckets_branches)
+        buckets <<= 1;
+
+    if(buckets > buckets_branches)
+        buckets = buckets_branches;
+
+    return buckets;
+}
+
+//
+// incremental resize
+//
+// when the buckets array needs to grow (or shrink), a new array is
+// allocated and the current one is kept as 'migration' array, new keys
+// always go to the new array and lookup check both arrays
+//
+// each call to 'index_buckets_migrate' moves a bounded amount of branches
+// from the previous array to the new one, when everything is moved, the
+// previous array is released
+//
+// this avoid a single request to pay a full rehash of the index
+//
+int index_buckets_resize(index_root_t *root, uint32_t buckets) {
+    index_branch_t **branches;
+
+    // finishing any previous resize still in progress
+    if(root->migration.branches)
+        index_buckets_migrate(root, root->migration.buckets);
+
+    zdb_debug("[+] index: resizing buckets: %u -> %u\n", root->buckets, buckets);
+
+    if(!(branches = index_buckets_init(buckets))) {
+        zdb_warnp("index: buckets resize: calloc");
+        return 1;
+    }
+
+    root->migration.branches = root->branches;
+    root->migration.buckets = root->buckets;
+    root->migration.position = 0;
+
+    root->branches = branches;
+    root->buckets = buckets;
+
+    return 0;
+}
+
+// move up to 'steps' branches from the previous array to the current one
+// returns the amount of branches still needed to be moved
+uint32_t index_buckets_migrate(index_root_t *root, uint32_t steps) {
+    index_migration_t *migration = &root->migration;
+    uint32_t mask = root->buckets - 1;
+
+    if(!migration->branches)
+        return 0;
+
+    uint32_t end = migration->position + steps;
+    if(end > migration->buckets || end < migration->position)
+        end = migration->buckets;
+
+    for(uint32_t b = migration->position; b < end; b++) {
+        index_branch_t *branch = migration->branches[b];
+
+        if(!branch)
+            continue;
+
+        uint32_t handle = branch->list;
+        uint32_t next = INDEX_HANDLE_NULL;
+
+        for(; handle; handle = next) {
+            index_entry_t *entry = index_arena_entry(root->arena, handle);
+            next = entry->next;
+
+            uint32_t branchkey = index_key_crc(entry->id, entry->idlength) & mask;
+            index_branch_append(root->arena, root->branches, branchkey, handle);
+        }
+
+        free(branch);
+        migration->branches[b] = NULL;
+    }
+
+    migration->position = end;
+
+    if(migration->position < migration->buckets)
+        return migration->buckets - migration->position;
+
+    zdb_debug("[+] index: buckets resize completed (%u buckets)\n", root->buckets);
+
+    free(migration->branches);
+    migration->branches = NULL;
+    migration->buckets = 0;
+    migration->position = 0;
+
+    return 0;
+}
+
+// start a resize if the amount of entries doesn't match the amount
+// of buckets anymore: more than two entries per branch on average, or
+// less than one entry per height branches
+int index_buckets_resize_check(index_root_t *root) {
+    size_t entries = root->stats.entries;
+
+    if(entries > (size_t) root->buckets * 2 && root->buckets < buckets_branches)
+        return index_buckets_resize(root, index_buckets_fit(entries)) == 0;
+
+    // shrinking only when nothing is in progress
+    if(root->migration.branches)
+        return 0;
+
+    if(entries * 8 < root->buckets && root->buckets > INDEX_BUCKETS_INITIAL)
+        return index_buckets_resize(root, index_buckets_fit(entries)) == 0;
+
+    return 0;
+}
+
+// returns the branch of the previous array where this
+// key could be, if this branch was not yet moved
+index_branch_t *index_buckets_previous(index_root_t *root, uint32_t crc) {
+    if(!root->migration.branches)
+        return NULL;
+
+    return root->migration.branches[crc & (root->migration.buckets - 1)];
 }
 
 index_branch_t *index_branch_init(index_branch_t **branches, uint32_t branchid) {
@@ -53,8 +204,8 @@ index_branch_t *index_branch_init(index_branch_t **branches, uint32_t branchid)
     index_branch_t *branch = branches[branchid];
 
     branch->length = 0;
-    branch->last = NULL;
-    branch->list = NULL;
+    branch->last = INDEX_HANDLE_NULL;
+    branch->list = INDEX_HANDLE_NULL;
 
     return branch;
 }
@@ -64,17 +215,8 @@ void index_branch_free(index_branch_t **branches, uint32_t branchid) {
     if(!branches[branchid])
         return;
 
-    index_entry_t *entry = branches[branchid]->list;
-    index_entry_t *next = NULL;
-
-    // deleting branch content by
-    // iterate over the linked-list
-    for(; entry; entry = next) {
-        next = entry->next;
-        free(entry);
-    }
-
-    // deleting branch
+    // entries are released in bulk by the arena,
+    // only the branch itself needs to be free'd
     free(branches[branchid]);
 }
 
@@ -102,11 +244,11 @@ index_branch_t *index_branch_get_allocate(index_branch_t **branches, uint32_t br
 // only occures here
 //
 // if there is no index, we just skip the appending
-index_entry_t *index_branch_append(index_branch_t **branches, uint32_t branchid, index_entry_t *entry) {
+uint32_t index_branch_append(index_arena_t *arena, index_branch_t **branches, uint32_t branchid, uint32_t handle) {
     index_branch_t *branch;
 
     if(!branches)
-        return NULL;
+        return INDEX_HANDLE_NULL;
 
     // grabbing the branch
     branch = index_branch_get_allocate(branches, branchid);
@@ -115,60 +257,64 @@ index_entry_t *index_branch_append(index_branch_t **branches, uint32_t branchid,
     // adding this item and pointing previous last one
     // to this new one
     if(!branch->list)
-        branch->list = entry;
+        branch->list = handle;
 
     if(branch->last)
-        branch->last->next = entry;
+        index_arena_entry(arena, branch->last)->next = handle;
 
-    branch->last = entry;
-    entry->next = NULL;
+    branch->last = handle;
+    index_arena_entry(arena, handle)->next = INDEX_HANDLE_NULL;
 
-    return entry;
+    return handle;
 }
 
 // remove one entry on this branch
 // since it's a linked-list, we need to know which entry was the previous one
 // we use a single-direction linked-list
 //
-// removing an entry from the list don't free this entry, is just re-order
+// removing an entry from the list don't release this entry, is just re-order
 // list to keep it coherent
-index_entry_t *index_branch_remove(index_branch_t *branch, index_entry_t *entry, index_entry_t *previous) {
+uint32_t index_branch_remove(index_arena_t *arena, index_branch_t *branch, uint32_t handle, uint32_t previous) {
+    index_entry_t *entry = index_arena_entry(arena, handle);
+
     // removing the first entry
-    if(branch->list == entry)
+    if(branch->list == handle)
         branch->list = entry->next;
 
     // skipping this entry, linking next from previous
     // to our next one
     if(previous)
-        previous->next = entry->next;
+        index_arena_entry(arena, previous)->next = entry->next;
 
     // if our entry was the last one
     // the new last one is the previous one
-    if(branch->last == entry)
+    if(branch->last == handle)
         branch->last = previous;
 
     branch->length -= 1;
 
-    return entry;
+    return handle;
 }
 
-// iterate over a branch and try to find the previous entry of the given entry
-// if by mystake, the entry was not found on the branch, we returns the entry itself
-// if entry was the first entry, previous will also be NULL
-index_entry_t *index_branch_get_previous(index_branch_t *branch, index_entry_t *entry) {
-    index_entry_t *previous = NULL;
-    index_entry_t *iterator = branch->list;
+// iterate over a branch and try to find the given entry, returns the handle
+// of this entry and set 'previous' to the handle of the previous one
+// (null handle if entry was the first entry)
+//
+// if the entry was not found on the branch, null handle is returned
+uint32_t index_branch_find(index_arena_t *arena, index_branch_t *branch, index_entry_t *entry, uint32_t *previous) {
+    uint32_t iterator = branch->list;
+
+    *previous = INDEX_HANDLE_NULL;
 
-    while(iterator && iterator != entry) {
-        previous = iterator;
-        iterator = iterator->next;
-    }
+    while(iterator) {
+        index_entry_t *item = index_arena_entry(arena, iterator);
 
-    // we reached the end of the list, without finding
-    // a matching entry, this is mostly a mistake from caller
-    // let's notify it by replying with it's own object
-    if(!iterator)
-        return entry;
+        if(item == entry)
+            return iterator;
+
+        *previous = iterator;
+        iterator = item->next;
+    }
 
-    return previous;
+    return INDEX_HANDLE_NULL;
 }
@@ -1,12 +1,22 @@
 #ifndef __ZDB_INDEX_BRANCH_H
     #define __ZDB_INDEX_BRANCH_H
 
-    // buckets
+    // initial amount of buckets allocated per index
+    #define INDEX_BUCKETS_INITIAL  (1 << 12)
+
+    // buckets (maximum allowed per index)
     extern uint32_t buckets_branches;
     extern uint32_t buckets_mask;
 
     int index_set_buckets_bits(uint8_t bits);
-    index_branch_t **index_buckets_init();
+    index_branch_t **index_buckets_init(uint32_t buckets);
+    void index_buckets_clean(index_branch_t **branches, uint32_t buckets);
+    void index_buckets_free(index_branch_t **branches, uint32_t buckets);
+    uint32_t index_buckets_fit(size_t entries);
+    int index_buckets_resize(index_root_t *root, uint32_t buckets);
+    int index_buckets_resize_check(index_root_t *root);
+    uint32_t index_buckets_migrate(index_root_t *root, uint32_t steps);
+    index_branch_t *index_buckets_previous(index_root_t *root, uint32_t crc);
 
     // initializers
     index_branch_t *index_branch_init(index_branch_t **branches, uint32_t branchid);
@@ -15,7 +25,7 @@
     // accessors
     index_branch_t *index_branch_get(index_branch_t **branches, uint32_t branchid);
     index_branch_t *index_branch_get_allocate(index_branch_t **branches, uint32_t branchid);
-    index_entry_t *index_branch_append(index_branch_t **branches, uint32_t branchid, index_entry_t *entry);
-    index_entry_t *index_branch_remove(index_branch_t *branch, index_entry_t *entry, index_entry_t *previous);
-    index_entry_t *index_branch_get_previous(index_branch_t *branch, index_entry_t *entry);
+    uint32_t index_branch_append(index_arena_t *arena, index_branch_t **branches, uint32_t branchid, uint32_t handle);
+    uint32_t index_branch_remove(index_arena_t *arena, index_branch_t *branch, uint32_t handle, uint32_t previous);
+    uint32_t index_branch_find(index_arena_t *arena, index_branch_t *branch, index_entry_t *entry, uint32_t *previous);
 #endif
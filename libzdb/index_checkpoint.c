@@ -0,0 +1,540 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <x86intrin.h>
+#include "libzdb.h"
+#include "libzdb_private.h"
+
+//
+// index checkpoint
+//
+// loading an index means replaying every entry ever written on the index
+// files (including overwritten and deleted keys), the loading time depends
+// on the write history and not on the amount of keys
+//
+// a checkpoint is a snapshot of the live entries of the memory index, with
+// the position (index file id and offset) of the last entry written when the
+// snapshot was taken (high-water mark), on startup, the checkpoint is loaded
+// in one shot and only the index entries written after the mark are replayed
+//
+// there is one exception to the always-append index files: a deletion flags
+// the entry in place, even if that entry is before the mark, to catch them,
+// index files modified after the mark was taken are scanned for deleted
+// entries (only flags are checked, nothing is replayed)
+//
+// checkpoint is only used in key-value mode, anything which doesn't match
+// (corrupted file, index files rewritten, ...) discard the checkpoint and
+// the full replay is done like before
+//
+
+static uint32_t index_checkpoint_crc(uint32_t hash, const uint8_t *bytes, size_t length) {
+    size_t i = 0;
+
+    for(; i + 8 <= length; i += 8)
+        hash = _mm_crc32_u64(hash, *((uint64_t *) (bytes + i)));
+
+    for(; i < length; i++)
+        hash = _mm_crc32_u8(hash, bytes[i]);
+
+    return hash;
+}
+
+static char *index_checkpoint_path(index_root_t *root, char *buffer, char *suffix) {
+    snprintf(buffer, ZDB_PATH_MAX, "%s/" INDEX_CHECKPOINT_FILENAME "%s", root->indexdir, suffix);
+    return buffer;
+}
+
+// read the header and the last entry before the mark, on the mark index file
+// returns 0 if the mark matches the file
+static int index_checkpoint_lastentry(index_root_t *root, index_checkpoint_t *mark, uint64_t *created, uint32_t *lastcrc) {
+    char buffer[sizeof(index_item_t) + MAX_KEY_LENGTH + 1];
+    index_item_t *item = (index_item_t *) buffer;
+    index_header_t header;
+    struct stat sb;
+    int fd;
+
+    if((fd = index_open_file_readonly(root, mark->indexid)) < 0)
+        return 1;
+
+    if(fstat(fd, &sb) < 0 || sb.st_size < (off_t) mark->offset)
+        goto failed;
+
+    if(pread(fd, &header, sizeof(header), 0) != sizeof(header))
+        goto failed;
+
+    *created = header.created;
+    *lastcrc = 0;
+
+    // no entries before the mark on this file
+    if(mark->offset <= sizeof(index_header_t)) {
+        close(fd);
+        return 0;
+    }
+
+    size_t length = mark->offset - mark->previous;
+
+    if(mark->previous < sizeof(index_header_t) || length < sizeof(index_item_t) || length > sizeof(buffer))
+        goto failed;
+
+    if(pread(fd, buffer, length, mark->previous) != (ssize_t) length)
+        goto failed;
+
+    // last entry needs to end exactly on the mark
+    if(sizeof(index_item_t) + item->idlength != length)
+        goto failed;
+
+    // flags can be updated in place (deletion)
+    item->flags = 0;
+    *lastcrc = index_checkpoint_crc(0, (uint8_t *) buffer, length);
+
+    close(fd);
+    return 0;
+
+failed:
+    close(fd);
+    return 1;
+}
+
+//
+// writer
+//
+
+// take a mark of the current position of the index, this needs to be
+// called when no write is in progress (eg: before forking a writer)
+void index_checkpoint_mark(index_root_t *root, index_checkpoint_t *mark) {
+    mark->indexid = root->indexid;
+    mark->offset = lseek(root->indexfd, 0, SEEK_END);
+    mark->previous = root->previous;
+    mark->nextid = root->nextid;
+    mark->nextentry = root->nextentry;
+    mark->entries = root->stats.entries;
+    mark->timestamp = time(NULL);
+}
+
+// returns 1 if the index changed since the last checkpoint
+int index_checkpoint_needed(index_root_t *root) {
+    index_checkpoint_t *last = &root->checkpoint;
+
+    if(root->mode != ZDB_MODE_KEY_VALUE || !root->arena)
+        return 0;
+
+    if(root->status & INDEX_READ_ONLY)
+        return 0;
+
+    if(root->indexid != last->indexid || root->stats.entries != last->entries)
+        return 1;
+
+    return lseek(root->indexfd, 0, SEEK_END) != (off_t) last->offset;
+}
+
+typedef struct index_checkpoint_writer_t {
+    int fd;
+    uint8_t *buffer;
+    size_t used;
+    size_t length;
+    uint64_t entries;
+    uint64_t written;
+    uint32_t integrity;
+    int error;
+
+} index_checkpoint_writer_t;
+
+#define INDEX_CHECKPOINT_BUFFER  (1024 * 1024)
+
+static void index_checkpoint_flush(index_checkpoint_writer_t *writer) {
+    if(writer->used == 0 || writer->error)
+        return;
+
+    if(write(writer->fd, writer->buffer, writer->used) != (ssize_t) writer->used) {
+        zdb_warnp("index checkpoint: write");
+        writer->error = 1;
+    }
+
+    writer->integrity = index_checkpoint_crc(writer->integrity, writer->buffer, writer->used);
+    writer->written += writer->used;
+    writer->used = 0;
+}
+
+static int index_checkpoint_walker(index_entry_t *entry, void *userptr) {
+    index_checkpoint_writer_t *writer = (index_checkpoint_writer_t *) userptr;
+    size_t length = sizeof(index_checkpoint_item_t) + entry->idlength;
+
+    // entry kept in memory after a failed write
+    if(index_entry_is_deleted(entry))
+        return 0;
+
+    if(writer->used + length > writer->length)
+        index_checkpoint_flush(writer);
+
+    index_checkpoint_item_t *item = (index_checkpoint_item_t *) (writer->buffer + writer->used);
+
+    item->idlength = entry->idlength;
+    item->flags = entry->flags;
+    item->dataid = entry->dataid;
+    item->indexid = entry->indexid;
+    item->parentid = entry->parentid;
+    item->offset = entry->offset;
+    item->idxoffset = entry->idxoffset;
+    item->length = entry->length;
+    item->crc = entry->crc;
+    item->parentoff = entry->parentoff;
+    item->timestamp = entry->timestamp;
+    memcpy(item->id, entry->id, entry->idlength);
+
+    writer->used += length;
+    writer->entries += 1;
+
+    return writer->error;
+}
+
+// write a checkpoint of the memory index, the checkpoint is written on
+// a temporary file and renamed when complete, an existing checkpoint
+// is never partially overwritten
+int index_checkpoint_write(index_root_t *root, index_checkpoint_t *mark) {
+    char filename[ZDB_PATH_MAX];
+    char temporary[ZDB_PATH_MAX];
+    index_checkpoint_header_t header;
+    index_checkpoint_writer_t writer;
+
+    memset(&header, 0x00, sizeof(header));
+    memset(&writer, 0x00, sizeof(writer));
+
+    memcpy(header.magic, "ZCP0", 4);
+    header.version = INDEX_CHECKPOINT_VERSION;
+    header.mode = root->mode;
+    header.indexid = mark->indexid;
+    header.offset = mark->offset;
+    header.previous = mark->previous;
+    header.nextid = mark->nextid;
+    header.nextentry = mark->nextentry;
+    header.timestamp = mark->timestamp;
+
+    uint64_t created;
+    uint32_t lastcrc;
+
+    if(index_checkpoint_lastentry(root, mark, &created, &lastcrc)) {
+        zdb_danger("[-] index checkpoint: could not read index file at the mark");
+        return 1;
+    }
+
+    header.filecreated = created;
+    header.lastcrc = lastcrc;
+
+    index_checkpoint_path(root, filename, "");
+    index_checkpoint_path(root, temporary, ".tmp");
+
+    if((writer.fd = open(temporary, O_CREAT | O_TRUNC | O_WRONLY, 0600)) < 0) {
+        zdb_warnp(temporary);
+        return 1;
+    }
+
+    if(!(writer.buffer = malloc(INDEX_CHECKPOINT_BUFFER))) {
+        zdb_warnp("index checkpoint: malloc");
+        close(writer.fd);
+        return 1;
+    }
+
+    writer.length = INDEX_CHECKPOINT_BUFFER;
+
+    // header is written again when everything is done
+    if(write(writer.fd, &header, sizeof(header)) != sizeof(header))
+        writer.error = 1;
+
+    index_walk(root, index_checkpoint_walker, &writer);
+    index_checkpoint_flush(&writer);
+
+    header.entries = writer.entries;
+    header.length = writer.written;
+    header.integrity = writer.integrity;
+
+    if(!writer.error && pwrite(writer.fd, &header, sizeof(header), 0) != sizeof(header))
+        writer.error = 1;
+
+    if(!writer.error && fsync(writer.fd) < 0)
+        writer.error = 1;
+
+    free(writer.buffer);
+    close(writer.fd);
+
+    if(writer.error) {
+        zdb_danger("[-] index checkpoint: %s: could not write checkpoint", temporary);
+        unlink(temporary);
+        return 1;
+    }
+
+    if(rename(temporary, filename) < 0) {
+        zdb_warnp(filename);
+        unlink(temporary);
+        return 1;
+    }
+
+    zdb_verbose("[+] index checkpoint: %s: %" PRIu64 " entries written (%.2f MB)\n", filename, header.entries, MB(header.length));
+
+    return 0;
+}
+
+void index_checkpoint_delete(index_root_t *root) {
+    char filename[ZDB_PATH_MAX];
+
+    index_checkpoint_path(root, filename, "");
+
+    if(unlink(filename) < 0 && errno != ENOENT)
+        zdb_warnp(filename);
+}
+
+//
+// loader
+//
+typedef struct index_checkpoint_deleted_t {
+    uint64_t *positions;   // (fileid << 32 | offset) of entries deleted in place
+    size_t length;
+    size_t allocated;
+
+} index_checkpoint_deleted_t;
+
+static int index_checkpoint_position_cmp(const void *a, const void *b) {
+    uint64_t x = *((uint64_t *) a);
+    uint64_t y = *((uint64_t *) b);
+
+    return (x > y) - (x < y);
+}
+
+// collect deleted entries of an index file, up to 'limit' bytes
+static int index_checkpoint_scan(index_root_t *root, fileid_t fileid, size_t limit, index_checkpoint_deleted_t *deleted) {
+    zdb_map_t map;
+    int fd;
+
+    if((fd = index_open_file_readonly(root, fileid)) < 0)
+        return 1;
+
+    if(zdb_file_map(fd, &map)) {
+        close(fd);
+        return 1;
+    }
+
+    close(fd);
+
+    if(limit == 0 || limit > map.length)
+        limit = map.length;
+
+    size_t offset = sizeof(index_header_t);
+    size_t current = offset;
+    index_item_t *item;
+
+    while((item = index_item_next(map.buffer, limit, &offset))) {
+        if(item->flags & INDEX_ENTRY_DELETED) {
+            if(deleted->length == deleted->allocated) {
+                deleted->allocated = deleted->allocated ? deleted->allocated * 2 : 1024;
+
+                if(!(deleted->positions = realloc(deleted->positions, deleted->allocated * sizeof(uint64_t))))
+                    zdb_diep("index checkpoint: scan: realloc");
+            }
+
+            deleted->positions[deleted->length++] = ((uint64_t) fileid << 32) | current;
+        }
+
+        current = offset;
+    }
+
+    zdb_file_unmap(&map);
+
+    return 0;
+}
+
+// index files modified after the mark could contains entries flagged
+// deleted in place, file containing the mark is always checked
+static int index_checkpoint_deletions(index_root_t *root, index_checkpoint_header_t *header, index_checkpoint_deleted_t *deleted) {
+    char filename[ZDB_PATH_MAX + 1];
+    struct stat sb;
+
+    for(fileid_t fileid = 0; fileid <= header->indexid; fileid++) {
+        index_set_id_buffer(filename, root->indexdir, fileid);
+
+        if(stat(filename, &sb) < 0)
+            return 1;
+
+        // one second of margin, filesystem timestamp granularity
+        if(fileid < header->indexid && (uint64_t) sb.st_mtime + 1 < header->timestamp)
+            continue;
+
+        zdb_debug("[+] index checkpoint: scanning deletion on file %u\n", fileid);
+
+        size_t limit = (fileid == header->indexid) ? header->offset : 0;
+
+        if(index_checkpoint_scan(root, fileid, limit, deleted))
+            return 1;
+    }
+
+    qsort(deleted->positions, deleted->length, sizeof(uint64_t), index_checkpoint_position_cmp);
+
+    return 0;
+}
+
+static int index_checkpoint_is_deleted(index_checkpoint_deleted_t *deleted, index_checkpoint_item_t *item) {
+    uint64_t position = ((uint64_t) item->indexid << 32) | item->idxoffset;
+
+    if(deleted->length == 0)
+        return 0;
+
+    return bsearch(&position, deleted->positions, deleted->length, sizeof(uint64_t), index_checkpoint_position_cmp) != NULL;
+}
+
+// validate the checkpoint against the index files, nothing is changed
+// on the index if anything doesn't match
+static char *index_checkpoint_validate(index_root_t *root, int fd, index_checkpoint_header_t *header, uint64_t maxfile) {
+    index_checkpoint_t mark;
+    uint64_t created;
+    uint32_t lastcrc;
+    struct stat sb;
+    char *buffer;
+
+    if(memcmp(header->magic, "ZCP0", 4) || header->version != INDEX_CHECKPOINT_VERSION) {
+        zdb_warning("[-] index checkpoint: invalid header, ignoring checkpoint");
+        return NULL;
+    }
+
+    if(header->mode != root->mode || header->indexid >= maxfile) {
+        zdb_warning("[-] index checkpoint: checkpoint doesn't match index, ignoring checkpoint");
+        return NULL;
+    }
+
+    if(fstat(fd, &sb) < 0 || (uint64_t) sb.st_size != sizeof(index_checkpoint_header_t) + header->length) {
+        zdb_warning("[-] index checkpoint: truncated checkpoint, ignoring checkpoint");
+        return NULL;
+    }
+
+    mark.indexid = header->indexid;
+    mark.offset = header->offset;
+    mark.previous = header->previous;
+
+    if(index_checkpoint_lastentry(root, &mark, &created, &lastcrc) || created != header->filecreated || lastcrc != header->lastcrc) {
+        zdb_warning("[-] index checkpoint: index files changed since checkpoint, ignoring checkpoint");
+        return NULL;
+    }
+
+    if(!(buffer = malloc(header->length + 1))) {
+        zdb_warnp("index checkpoint: malloc");
+        return NULL;
+    }
+
+    if(index_load_read(fd, buffer, header->length)) {
+        zdb_warning("[-] index checkpoint: could not read checkpoint, ignoring checkpoint");
+        free(buffer);
+        return NULL;
+    }
+
+    if(index_checkpoint_crc(0, (uint8_t *) buffer, header->length) != header->integrity) {
+        zdb_warning("[-] index checkpoint: corrupted checkpoint, ignoring checkpoint");
+        free(buffer);
+        return NULL;
+    }
+
+    return buffer;
+}
+
+// load the checkpoint into the (empty) memory index, returns 0 if the checkpoint
+// was loaded, in that case, replay needs to start at the mark set in root->checkpoint
+int index_checkpoint_load(index_root_t *root, uint64_t maxfile) {
+    index_checkpoint_deleted_t deleted = {NULL, 0, 0};
+    index_checkpoint_header_t header;
+    char filename[ZDB_PATH_MAX];
+    char *buffer;
+    int fd;
+
+    index_checkpoint_path(root, filename, "");
+
+    if((fd = open(filename, O_RDONLY)) < 0) {
+        zdb_debug("[+] index checkpoint: no checkpoint found\n");
+        return 1;
+    }
+
+    zdb_verbose("[+] index checkpoint: loading %s\n", filename);
+
+    if(read(fd, &header, sizeof(header)) != sizeof(header)) {
+        zdb_warning("[-] index checkpoint: could not read header, ignoring checkpoint");
+        close(fd);
+        return 1;
+    }
+
+    buffer = index_checkpoint_validate(root, fd, &header, maxfile);
+    close(fd);
+
+    if(!buffer)
+        return 1;
+
+    if(index_checkpoint_deletions(root, &header, &deleted)) {
+        zdb_warning("[-] index checkpoint: could not scan index files, ignoring checkpoint");
+        free(deleted.positions);
+        free(buffer);
+        return 1;
+    }
+
+    size_t offset = 0;
+    uint64_t skipped = 0;
+
+    for(uint64_t i = 0; i < header.entries && offset < header.length; i++) {
+        index_checkpoint_item_t *item = (index_checkpoint_item_t *) (buffer + offset);
+        offset += sizeof(index_checkpoint_item_t) + item->idlength;
+
+        // entry deleted after the checkpoint
+        if(index_checkpoint_is_deleted(&deleted, item)) {
+            skipped += 1;
+            continue;
+        }
+
+        index_entry_t source = {
+            .idlength = item->idlength,
+            .offset = item->offset,
+            .idxoffset = item->idxoffset,
+            .length = item->length,
+            .crc = item->crc,
+            .parentoff = item->parentoff,
+            .timestamp = item->timestamp,
+            .indexid = item->indexid,
+            .parentid = item->parentid,
+            .flags = item->flags,
+        };
+
+        index_set_t setter = {
+            .entry = &source,
+            .id = item->id,
+        };
+
+        // keys are unique on the checkpoint, no lookup needed
+        index_entry_t *entry;
+        if(!(entry = index_insert_memory_handler_memkey(root, &setter)))
+            zdb_diep("index checkpoint: insert");
+
+        // insertion handler set dataid from current index id
+        entry->dataid = item->dataid;
+    }
+
+    free(deleted.positions);
+    free(buffer);
+
+    // restoring state at the mark, replay continues from there
+    root->nextid = header.nextid;
+    root->nextentry = header.nextentry;
+    root->previous = header.previous;
+
+    root->checkpoint.indexid = header.indexid;
+    root->checkpoint.offset = header.offset;
+    root->checkpoint.previous = header.previous;
+    root->checkpoint.nextid = header.nextid;
+    root->checkpoint.nextentry = header.nextentry;
+    root->checkpoint.entries = header.entries - skipped;
+    root->checkpoint.timestamp = header.timestamp;
+
+    zdb_verbose("[+] index checkpoint: %" PRIu64 " entries loaded (%" PRIu64 " deleted since)\n", header.entries - skipped, skipped);
+    zdb_verbose("[+] index checkpoint: replaying from file %u, offset %u\n", header.indexid, header.offset);
+
+    return 0;
+}
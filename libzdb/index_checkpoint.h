@@ -0,0 +1,49 @@
+#ifndef __ZDB_INDEX_CHECKPOINT_H
+    #define __ZDB_INDEX_CHECKPOINT_H
+
+    // checkpoint filename, inside the index directory of the namespace
+    #define INDEX_CHECKPOINT_FILENAME  "zdb-checkpoint"
+    #define INDEX_CHECKPOINT_VERSION   1
+
+    // checkpoint file header, followed by 'entries' items
+    typedef struct index_checkpoint_header_t {
+        char magic[4];         // four magic bytes to recognize the file
+        uint32_t version;      // file version
+        uint8_t mode;          // running mode of the index
+        fileid_t indexid;      // high-water mark: index file id
+        uint32_t offset;       // high-water mark: offset on that file
+        uint32_t previous;     // offset of the last entry before the mark
+        uint32_t nextid;       // root->nextid at the mark
+        uint64_t nextentry;    // root->nextentry at the mark
+        uint64_t timestamp;    // unix timestamp of the mark
+        uint64_t filecreated;  // creation time of the mark index file
+        uint32_t lastcrc;      // crc of the last entry before the mark (flags excluded)
+        uint64_t entries;      // amount of items following
+        uint64_t length;       // length of the items
+        uint32_t integrity;    // crc of the items
+
+    } __attribute__((packed)) index_checkpoint_header_t;
+
+    // one live entry of the memory index
+    typedef struct index_checkpoint_item_t {
+        uint8_t idlength;
+        uint8_t flags;
+        fileid_t dataid;
+        fileid_t indexid;
+        fileid_t parentid;
+        uint32_t offset;
+        uint32_t idxoffset;
+        uint32_t length;
+        uint32_t crc;
+        uint32_t parentoff;
+        uint32_t timestamp;
+        unsigned char id[];
+
+    } __attribute__((packed)) index_checkpoint_item_t;
+
+    void index_checkpoint_mark(index_root_t *root, index_checkpoint_t *mark);
+    int index_checkpoint_needed(index_root_t *root);
+    int index_checkpoint_write(index_root_t *root, index_checkpoint_t *mark);
+    int index_checkpoint_load(index_root_t *root, uint64_t maxfile);
+    void index_checkpoint_delete(index_root_t *root);
+#endif
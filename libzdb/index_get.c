@@ -13,7 +13,16 @@ static index_entry_t *index_get_handler_memkey(index_root_t *index, void *id, ui
     return index_entry_get(index, id, idlength);
 }
 
+// in sequential mode, entries are not kept in memory, the entry read
+// from disk is converted into this buffer which is reused for each
+// request, there is one buffer per thread since readers can run
+// concurrently, the entry is valid until the next get on the same thread
+static __thread unsigned char index_sequential_buffer[sizeof(index_entry_t) + MAX_KEY_LENGTH]
+    __attribute__((aligned(__alignof__(index_entry_t))));
+
 static index_entry_t *index_get_handler_sequential(index_root_t *index, void *id, uint8_t idlength) {
+    index_entry_t *index_reusable_entry = (index_entry_t *) index_sequential_buffer;
+
     if(idlength != sizeof(uint32_t)) {
         zdb_debug("[-] index: sequential get: invalid key length (%u <> %ld)\n", idlength, sizeof(uint32_t));
         return NULL;
@@ -30,10 +39,38 @@ static index_entry_t *index_get_handler_sequential(index_root_t *index, void *id
     uint32_t relative = key - seqmap->seqid;
     uint32_t offset = index_seq_offset(relative);
 
-    // reading index on disk
-    index_item_t *item;
+    // entries kept in memory, no index read needed
+    if(index->seqtable) {
+        index_seqslot_t *slot;
+
+        if(!(slot = index_seqtable_get(index, key)))
+            return NULL;
+
+        memcpy(index_reusable_entry->id, &key, sizeof(uint32_t));
+        index_reusable_entry->idlength = sizeof(uint32_t);
+        index_reusable_entry->offset = slot->offset;
+        index_reusable_entry->dataid = slot->dataid;
+        index_reusable_entry->indexid = seqmap->fileid;
+        index_reusable_entry->flags = slot->flags;
+        index_reusable_entry->idxoffset = offset;
+        index_reusable_entry->crc = slot->crc;
+        index_reusable_entry->parentid = slot->parentid;
+        index_reusable_entry->parentoff = slot->parentoff;
+        index_reusable_entry->timestamp = slot->timestamp;
+        index_reusable_entry->length = slot->length;
+
+        return index_reusable_entry;
+    }
+
+    // sealed file mapped, entry is read in place,
+    // otherwise reading index on disk
+    index_item_t *item = NULL;
+    index_item_t *mapped = NULL;
 
-    if(!(item = index_item_get_disk(index, seqmap->fileid, offset, sizeof(uint32_t))))
+    if(index->seqviews)
+        mapped = item = index_seqview_item(index, seqmap->fileid, offset);
+
+    if(!item && !(item = index_item_get_disk(index, seqmap->fileid, offset, sizeof(uint32_t))))
         return NULL;
 
     memcpy(index_reusable_entry->id, item->id, item->idlength);
@@ -52,7 +89,8 @@ static index_entry_t *index_get_handler_sequential(index_root_t *index, void *id
     // index_entry_dump(index_reusable_entry);
 
     // cleaning intermediate object
-    free(item);
+    if(item != mapped)
+        free(item);
 
     return index_reusable_entry;
 }
@@ -84,6 +122,21 @@ index_entry_t *index_get(index_root_t *index, void *id, uint8_t idlength) {
     return entry;
 }
 
+// same as index_get, for keys requested by a client read (get, exists),
+// hits and faults are counted, existence checks made by writes are not
+index_entry_t *index_lookup(index_root_t *index, void *id, uint8_t idlength) {
+    index_entry_t *entry;
+
+    if(!(entry = index_get(index, id, idlength))) {
+        zdb_atomic_add(index->stats.faults, 1);
+        return NULL;
+    }
+
+    zdb_atomic_add(index->stats.hits, 1);
+
+    return entry;
+}
+
 //
 // low level helper
 //
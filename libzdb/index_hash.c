@@ -0,0 +1,445 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <emmintrin.h>
+#include "libzdb.h"
+#include "libzdb_private.h"
+
+//
+// open-addressing index table
+//
+// this is an alternative to the branches (linked-list) system, based on
+// the 'swiss table' design: entries handles are stored on a flat array
+// and each slot have a one byte control tag, kept on a separated array
+// so a group of 16 tags can be compared in a single sse2 instruction
+//
+// a control tag can be:
+//   - 1000 0000 (0x80): slot is empty
+//   - 1111 1110 (0xfe): slot was used but entry was removed (tombstone)
+//   - 0xxx xxxx       : slot is used, the 7 bits are the lower bits of the hash
+//
+// the upper bits of the hash point to the first group to probe, if key
+// is not found on that group and the group doesn't contains any empty
+// slot, next group is probed (triangular probing over groups)
+//
+// a lookup usually costs one cache line for the tags and one for the
+// entry itself, instead of walking a linked-list of entries
+//
+// entries themself are allocated on the index arena (see index_arena.c),
+// table only keeps 32 bits handles, entries are never free'd by the table
+//
+// table never reach more than 7/8 of slots used (including tombstones),
+// which ensure there is always an empty slot to stop probing
+//
+// resizing is incremental: when the table needs to grow (or shrink), the
+// current table becomes the 'previous' one and a new empty table is allocated,
+// new keys always go to the new table, lookup and removal check both tables,
+// and each call to 'index_hash_migrate' moves a bounded amount of slots from
+// the previous table to the new one, until the previous one is empty
+//
+
+static inline uint32_t index_hash_match(uint8_t *group, uint8_t tag) {
+    __m128i ctrl = _mm_loadu_si128((__m128i *) group);
+    __m128i match = _mm_set1_epi8((char) tag);
+
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, match));
+}
+
+// empty and deleted tags are the only ones with the high bit set
+static inline uint32_t index_hash_match_free(uint8_t *group) {
+    __m128i ctrl = _mm_loadu_si128((__m128i *) group);
+    return (uint32_t) _mm_movemask_epi8(ctrl);
+}
+
+static inline uint8_t index_hash_tag(uint32_t crc) {
+    return crc & 0x7f;
+}
+
+static inline size_t index_hash_group(index_hash_t *hash, uint32_t crc) {
+    size_t groups = hash->capacity / INDEX_HASH_GROUP;
+    return ((size_t) crc >> 7) & (groups - 1);
+}
+
+static inline size_t index_hash_probe(index_hash_t *hash, size_t group, size_t step) {
+    size_t groups = hash->capacity / INDEX_HASH_GROUP;
+    return (group + step) & (groups - 1);
+}
+
+static int index_hash_allocate(index_hash_t *hash, size_t capacity) {
+    if(!(hash->tags = malloc(capacity))) {
+        zdb_warnp("index hash: tags malloc");
+        return 1;
+    }
+
+    if(!(hash->slots = calloc(sizeof(uint32_t), capacity))) {
+        zdb_warnp("index hash: slots calloc");
+        free(hash->tags);
+        return 1;
+    }
+
+    memset(hash->tags, INDEX_HASH_EMPTY, capacity);
+
+    hash->capacity = capacity;
+    hash->length = 0;
+    hash->deleted = 0;
+    hash->previous = NULL;
+    hash->migrated = 0;
+
+    return 0;
+}
+
+// returns the smallest capacity which keeps the table
+// half empty with this amount of entries
+static size_t index_hash_fit(size_t entries) {
+    size_t slots = INDEX_HASH_INITIAL;
+
+    while(slots < entries * 2)
+        slots <<= 1;
+
+    return slots;
+}
+
+// capacity is rounded to the next power of two
+// and is never smaller than the initial size
+index_hash_t *index_hash_init(index_arena_t *arena, size_t capacity) {
+    index_hash_t *hash;
+    size_t slots = INDEX_HASH_INITIAL;
+
+    while(slots < capacity)
+        slots <<= 1;
+
+    if(!(hash = malloc(sizeof(index_hash_t)))) {
+        zdb_warnp("index hash: malloc");
+        return NULL;
+    }
+
+    if(index_hash_allocate(hash, slots)) {
+        free(hash);
+        return NULL;
+    }
+
+    hash->arena = arena;
+
+    return hash;
+}
+
+static void index_hash_clean_table(index_hash_t *hash) {
+    for(size_t i = 0; i < hash->capacity; i++) {
+        if(hash->tags[i] & INDEX_HASH_EMPTY)
+            continue;
+
+        hash->slots[i] = INDEX_HANDLE_NULL;
+    }
+
+    memset(hash->tags, INDEX_HASH_EMPTY, hash->capacity);
+
+    hash->length = 0;
+    hash->deleted = 0;
+}
+
+static void index_hash_free_previous(index_hash_t *hash) {
+    free(hash->previous->tags);
+    free(hash->previous->slots);
+    free(hash->previous);
+
+    hash->previous = NULL;
+    hash->migrated = 0;
+}
+
+// remove every entries contained in the table, table itself
+// is kept and ready to be reused, entries are owned by the
+// arena and needs to be released there
+void index_hash_clean(index_hash_t *hash) {
+    if(hash->previous) {
+        index_hash_clean_table(hash->previous);
+        index_hash_free_previous(hash);
+    }
+
+    index_hash_clean_table(hash);
+}
+
+void index_hash_free(index_hash_t *hash) {
+    if(!hash)
+        return;
+
+    index_hash_clean(hash);
+
+    free(hash->tags);
+    free(hash->slots);
+    free(hash);
+}
+
+// total amount of entries, including entries not yet migrated
+size_t index_hash_length(index_hash_t *hash) {
+    return hash->length + (hash->previous ? hash->previous->length : 0);
+}
+
+static index_entry_t *index_hash_lookup(index_hash_t *hash, uint32_t crc, unsigned char *id, uint8_t idlength) {
+    uint8_t tag = index_hash_tag(crc);
+    size_t group = index_hash_group(hash, crc);
+
+    for(size_t step = 1; ; step++) {
+        size_t base = group * INDEX_HASH_GROUP;
+        uint8_t *tags = hash->tags + base;
+        uint32_t match = index_hash_match(tags, tag);
+
+        while(match) {
+            size_t slot = base + __builtin_ctz(match);
+            index_entry_t *entry = index_arena_entry(hash->arena, hash->slots[slot]);
+
+            if(entry->idlength == idlength && memcmp(entry->id, id, idlength) == 0)
+                return entry;
+
+            // clear lowest bit set
+            match &= match - 1;
+        }
+
+        // an empty slot on this group means the key
+        // was never pushed further
+        if(index_hash_match(tags, INDEX_HASH_EMPTY))
+            return NULL;
+
+        group = index_hash_probe(hash, group, step);
+    }
+
+    return NULL;
+}
+
+index_entry_t *index_hash_get(index_hash_t *hash, uint32_t crc, unsigned char *id, uint8_t idlength) {
+    index_entry_t *entry;
+
+    if((entry = index_hash_lookup(hash, crc, id, idlength)))
+        return entry;
+
+    // key not yet moved to the new table
+    if(hash->previous)
+        return index_hash_lookup(hash->previous, crc, id, idlength);
+
+    return NULL;
+}
+
+// find a free slot (empty or deleted) for that hash
+static size_t index_hash_find_free(index_hash_t *hash, uint32_t crc) {
+    size_t group = index_hash_group(hash, crc);
+
+    for(size_t step = 1; ; step++) {
+        size_t base = group * INDEX_HASH_GROUP;
+        uint32_t match = index_hash_match_free(hash->tags + base);
+
+        if(match)
+            return base + __builtin_ctz(match);
+
+        group = index_hash_probe(hash, group, step);
+    }
+
+    return 0;
+}
+
+static void index_hash_place(index_hash_t *hash, uint32_t crc, uint32_t handle) {
+    size_t slot = index_hash_find_free(hash, crc);
+
+    if(hash->tags[slot] == INDEX_HASH_DELETED)
+        hash->deleted -= 1;
+
+    hash->tags[slot] = index_hash_tag(crc);
+    hash->slots[slot] = handle;
+    hash->length += 1;
+}
+
+// start an incremental resize, current table becomes the previous one
+// and a new empty table is allocated, if a resize was already in progress
+// it's completed first
+static int index_hash_resize(index_hash_t *hash, size_t capacity) {
+    index_hash_t *previous;
+
+    if(hash->previous)
+        index_hash_migrate(hash, hash->previous->capacity);
+
+    zdb_debug("[+] index hash: resizing %lu entries (%lu -> %lu slots)\n", hash->length, hash->capacity, capacity);
+
+    if(!(previous = malloc(sizeof(index_hash_t)))) {
+        zdb_warnp("index hash: resize: malloc");
+        return 1;
+    }
+
+    *previous = *hash;
+
+    if(index_hash_allocate(hash, capacity)) {
+        *hash = *previous;
+        free(previous);
+        return 1;
+    }
+
+    hash->previous = previous;
+    hash->migrated = 0;
+
+    return 0;
+}
+
+// move up to 'slots' slots from the previous table to the current one
+// returns the amount of slots still needed to be moved
+size_t index_hash_migrate(index_hash_t *hash, size_t slots) {
+    index_hash_t *previous = hash->previous;
+
+    if(!previous)
+        return 0;
+
+    size_t end = hash->migrated + slots;
+    if(end > previous->capacity || end < hash->migrated)
+        end = previous->capacity;
+
+    for(size_t i = hash->migrated; i < end; i++) {
+        if(previous->tags[i] & INDEX_HASH_EMPTY)
+            continue;
+
+        uint32_t handle = previous->slots[i];
+        index_entry_t *entry = index_arena_entry(hash->arena, handle);
+        uint32_t crc = index_key_crc(entry->id, entry->idlength);
+
+        // keep a tombstone, some keys not yet moved
+        // could have been probed further
+        previous->tags[i] = INDEX_HASH_DELETED;
+        previous->slots[i] = INDEX_HANDLE_NULL;
+        previous->length -= 1;
+        previous->deleted += 1;
+
+        index_hash_place(hash, crc, handle);
+    }
+
+    hash->migrated = end;
+
+    if(hash->migrated < previous->capacity)
+        return previous->capacity - hash->migrated;
+
+    zdb_debug("[+] index hash: resize completed (%lu slots)\n", hash->capacity);
+    index_hash_free_previous(hash);
+
+    return 0;
+}
+
+// start a shrink resize if the table is mostly empty
+// growing is handled by insertion itself
+int index_hash_resize_check(index_hash_t *hash) {
+    if(hash->previous)
+        return 0;
+
+    if(hash->capacity <= INDEX_HASH_INITIAL)
+        return 0;
+
+    if(hash->length * 8 >= hash->capacity)
+        return 0;
+
+    return index_hash_resize(hash, index_hash_fit(hash->length)) == 0;
+}
+
+// insert an entry handle, caller needs to ensure the key is not
+// already present in the table, returns zero on success
+int index_hash_insert(index_hash_t *hash, uint32_t crc, uint32_t handle) {
+    // keep the load factor under 7/8, entries not yet moved are
+    // counted too since they will land on this table
+    size_t load = hash->length + hash->deleted + (hash->previous ? hash->previous->length : 0);
+
+    if((load + 1) * 8 > hash->capacity * 7) {
+        // if tombstones are the main reason of the load
+        // the new table could have the same size
+        if(index_hash_resize(hash, index_hash_fit(index_hash_length(hash) + 1)))
+            return 1;
+    }
+
+    index_hash_place(hash, crc, handle);
+
+    return 0;
+}
+
+static uint32_t index_hash_delete(index_hash_t *hash, uint32_t crc, index_entry_t *entry) {
+    uint8_t tag = index_hash_tag(crc);
+    size_t group = index_hash_group(hash, crc);
+
+    for(size_t step = 1; ; step++) {
+        size_t base = group * INDEX_HASH_GROUP;
+        uint8_t *tags = hash->tags + base;
+        uint32_t match = index_hash_match(tags, tag);
+
+        while(match) {
+            size_t slot = base + __builtin_ctz(match);
+            uint32_t handle = hash->slots[slot];
+
+            if(index_arena_entry(hash->arena, handle) == entry) {
+                // if the group still have an empty slot, this group was
+                // never full and no probing went further, slot can be
+                // set empty, otherwise we need to keep a tombstone
+                if(index_hash_match(tags, INDEX_HASH_EMPTY)) {
+                    hash->tags[slot] = INDEX_HASH_EMPTY;
+
+                } else {
+                    hash->tags[slot] = INDEX_HASH_DELETED;
+                    hash->deleted += 1;
+                }
+
+                hash->slots[slot] = INDEX_HANDLE_NULL;
+                hash->length -= 1;
+
+                return handle;
+            }
+
+            match &= match - 1;
+        }
+
+        if(index_hash_match(tags, INDEX_HASH_EMPTY))
+            return INDEX_HANDLE_NULL;
+
+        group = index_hash_probe(hash, group, step);
+    }
+
+    return INDEX_HANDLE_NULL;
+}
+
+// remove an entry from the table, entry is not released from the
+// arena, returns the handle of the removed entry (or null handle)
+uint32_t index_hash_remove(index_hash_t *hash, uint32_t crc, index_entry_t *entry) {
+    uint32_t handle;
+
+    if((handle = index_hash_delete(hash, crc, entry)))
+        return handle;
+
+    if(hash->previous)
+        return index_hash_delete(hash->previous, crc, entry);
+
+    return INDEX_HANDLE_NULL;
+}
+
+// iterate over entries, slot needs to be initialized to zero
+// and is updated to the next position to check, slots after
+// the current capacity point to the previous table
+index_entry_t *index_hash_next(index_hash_t *hash, size_t *slot) {
+    size_t total = hash->capacity + (hash->previous ? hash->previous->capacity : 0);
+
+    for(; *slot < total; *slot += 1) {
+        index_hash_t *table = hash;
+        size_t position = *slot;
+
+        if(position >= hash->capacity) {
+            table = hash->previous;
+            position -= hash->capacity;
+        }
+
+        if(table->tags[position] & INDEX_HASH_EMPTY)
+            continue;
+
+        *slot += 1;
+
+        return index_arena_entry(hash->arena, table->slots[position]);
+    }
+
+    return NULL;
+}
+
+// memory used by the table itself (not the entries)
+size_t index_hash_overhead(index_hash_t *hash) {
+    size_t slots = hash->capacity + (hash->previous ? hash->previous->capacity : 0);
+    size_t tables = hash->previous ? 2 : 1;
+
+    return (tables * sizeof(index_hash_t)) + (slots * (sizeof(uint8_t) + sizeof(uint32_t)));
+}
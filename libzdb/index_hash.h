@@ -0,0 +1,28 @@
+#ifndef __ZDB_INDEX_HASH_H
+    #define __ZDB_INDEX_HASH_H
+
+    // amount of slots probed at once (one sse2 register)
+    #define INDEX_HASH_GROUP      16
+
+    // initial amount of slots allocated for a fresh table
+    #define INDEX_HASH_INITIAL    1024
+
+    // control tags special values
+    #define INDEX_HASH_EMPTY      0x80
+    #define INDEX_HASH_DELETED    0xfe
+
+    index_hash_t *index_hash_init(index_arena_t *arena, size_t capacity);
+    void index_hash_free(index_hash_t *hash);
+    void index_hash_clean(index_hash_t *hash);
+
+    index_entry_t *index_hash_get(index_hash_t *hash, uint32_t crc, unsigned char *id, uint8_t idlength);
+    int index_hash_insert(index_hash_t *hash, uint32_t crc, uint32_t handle);
+    uint32_t index_hash_remove(index_hash_t *hash, uint32_t crc, index_entry_t *entry);
+    index_entry_t *index_hash_next(index_hash_t *hash, size_t *slot);
+
+    size_t index_hash_length(index_hash_t *hash);
+    size_t index_hash_migrate(index_hash_t *hash, size_t slots);
+    int index_hash_resize_check(index_hash_t *hash);
+
+    size_t index_hash_overhead(index_hash_t *hash);
+#endif
@@ -10,6 +10,7 @@
 #include <limits.h>
 #include <time.h>
 #include <errno.h>
+#include <pthread.h>
 #include "libzdb.h"
 #include "libzdb_private.h"
 
@@ -24,6 +25,32 @@ static inline void index_dump_entry(index_entry_t *entry) {
 
 // dumps the current index load
 // fulldump flags enable printing each entry
+static int index_dump_walker(index_entry_t *entry, void *userptr) {
+    (void) userptr;
+
+    index_dump_entry(entry);
+    return 0;
+}
+
+static void index_dump_arena(index_root_t *root) {
+    index_arena_t *arena = root->arena;
+
+    // first slab is never used
+    zdb_verbose("[+] index: entries arena: %u slabs, %.2f MB\n", arena->length - 1, MB(arena->size));
+}
+
+static void index_dump_hash(index_root_t *root, int fulldump) {
+    if(fulldump)
+        index_walk(root, index_dump_walker, NULL);
+
+    zdb_verbose("[+] index: uses: %lu slots (%lu used)\n", root->hash->capacity, index_hash_length(root->hash));
+
+    size_t overhead = index_hash_overhead(root->hash);
+    zdb_verbose("[+] index: memory overhead: %.2f KB (%lu bytes)\n", KB(overhead), overhead);
+
+    index_dump_arena(root);
+}
+
 static void index_dump(index_root_t *root, int fulldump) {
     size_t branches = 0;
 
@@ -32,8 +59,21 @@ static void index_dump(index_root_t *root, int fulldump) {
     if(fulldump)
         zdb_log("[+] ===========================\n");
 
+    if(root->engine == ZDB_INDEX_HASHTABLE) {
+        index_dump_hash(root, fulldump);
+
+        if(fulldump) {
+            if(root->stats.entries == 0)
+                zdb_log("[+] index is empty\n");
+
+            zdb_log("[+] ===========================\n");
+        }
+
+        return;
+    }
+
     // iterating over each buckets
-    for(uint32_t b = 0; b < buckets_branches; b++) {
+    for(uint32_t b = 0; b < root->buckets; b++) {
         index_branch_t *branch = index_branch_get(root->branches, b);
 
         // skipping empty branch
@@ -41,14 +81,16 @@ static void index_dump(index_root_t *root, int fulldump) {
             continue;
 
         branches += 1;
-        index_entry_t *entry = branch->list;
 
         if(!fulldump)
             continue;
 
         // iterating over the linked-list
-        for(; entry; entry = entry->next)
+        for(uint32_t handle = branch->list; handle; ) {
+            index_entry_t *entry = index_arena_entry(root->arena, handle);
             index_dump_entry(entry);
+            handle = entry->next;
+        }
     }
 
     if(fulldump) {
@@ -58,15 +100,17 @@ static void index_dump(index_root_t *root, int fulldump) {
         zdb_log("[+] ===========================\n");
     }
 
-    zdb_verbose("[+] index: uses: %lu branches\n", branches);
+    zdb_verbose("[+] index: uses: %lu branches (%u allocated)\n", branches, root->buckets);
 
     // overhead contains:
     // - the buffer allocated to hold each (future) branches pointer
     // - the branch struct itself for each branch
-    size_t overhead = (buckets_branches * sizeof(index_branch_t **)) +
+    size_t overhead = (root->buckets * sizeof(index_branch_t **)) +
                       (branches * sizeof(index_branch_t));
 
     zdb_verbose("[+] index: memory overhead: %.2f KB (%lu bytes)\n", KB(overhead), overhead);
+
+    index_dump_arena(root);
 }
 
 static void index_dump_statistics(index_root_t *root) {
@@ -173,6 +217,254 @@ index_header_t *index_descriptor_validate(index_header_t *header, index_root_t *
     return header;
 }
 
+// read a full file, handling short reads (large files)
+int index_load_read(int fd, char *buffer, size_t length) {
+    size_t done = 0;
+
+    while(done < length) {
+        ssize_t chunk = read(fd, buffer + done, length - done);
+
+        if(chunk <= 0)
+            return 1;
+
+        done += chunk;
+    }
+
+    return 0;
+}
+
+// walk over entries of a loaded file and returns the length
+// covered by complete entries, an entry truncated at the end
+// of the file (eg: crash during write) is not part of it
+static size_t index_load_scan(char *buffer, size_t length) {
+    size_t offset = sizeof(index_header_t);
+
+    while(index_item_next(buffer, length, &offset))
+        ;
+
+    return offset;
+}
+
+// returns the complete entry at 'offset' on a loaded (or mapped) index
+// file and moves 'offset' to the next entry, entries are parsed in place
+// NULL is returned when there is no more complete entry
+index_item_t *index_item_next(char *buffer, size_t length, size_t *offset) {
+    if(*offset + sizeof(index_item_t) > length)
+        return NULL;
+
+    index_item_t *item = (index_item_t *) (buffer + *offset);
+    size_t entrylength = sizeof(index_item_t) + item->idlength;
+
+    if(*offset + entrylength > length)
+        return NULL;
+
+    *offset += entrylength;
+
+    return item;
+}
+
+//
+// parallel loading
+//
+// index files needs to be replayed in order (a key can be overwritten
+// or deleted by a later file), but reading them and splitting them into
+// entries doesn't depends on anything else, loader workers read next files
+// while the current one is replayed into memory by the loading thread
+//
+// each worker owns a slot, file 'n' is read by worker '(n - first) % workers' and a slot
+// is reused only when the replay of it's previous file is done, this limits
+// the amount of files kept in memory to the amount of workers
+//
+// files are mapped (see zdb_file_map) and not copied, scanning entries
+// by the worker faults pages in before the loading thread needs them
+//
+// memory index is only modified by the loading thread, no lock is needed
+// on the index itself
+//
+typedef struct index_preload_t {
+    fileid_t fileid;   // file id contained on this slot
+    zdb_map_t map;     // whole file contents, empty if file could not be read
+    size_t valid;      // length covered by complete entries
+    int ready;         // slot contains a file ready to be replayed
+
+} index_preload_t;
+
+typedef struct index_loader_t {
+    index_root_t *root;        // index being loaded (read-only for workers)
+    uint64_t first;            // first file to read
+    uint64_t maxfile;          // amount of files to read
+    int workers;               // amount of workers (and slots)
+    int stop;                  // loading thread doesn't need more files
+    index_preload_t *slots;    // one slot per worker
+    pthread_t *threads;        // workers threads
+    pthread_mutex_t lock;      // protect slots and stop flag
+    pthread_cond_t cond;       // slot ready or slot released
+
+} index_loader_t;
+
+typedef struct index_worker_t {
+    index_loader_t *loader;
+    int id;
+
+} index_worker_t;
+
+static void index_preload_read(index_loader_t *loader, index_preload_t *preload, fileid_t fileid) {
+    char filename[ZDB_PATH_MAX + 1];
+    int fd;
+
+    preload->fileid = fileid;
+    preload->valid = 0;
+    memset(&preload->map, 0x00, sizeof(zdb_map_t));
+
+    index_set_id_buffer(filename, loader->root->indexdir, fileid);
+
+    if((fd = open(filename, O_RDONLY)) < 0)
+        return;
+
+    // mapping is still valid after closing the file
+    if(zdb_file_map(fd, &preload->map)) {
+        close(fd);
+        return;
+    }
+
+    close(fd);
+
+    if(preload->map.buffer)
+        preload->valid = index_load_scan(preload->map.buffer, preload->map.length);
+}
+
+static void *index_loader_worker(void *args) {
+    index_worker_t *worker = (index_worker_t *) args;
+    index_loader_t *loader = worker->loader;
+    index_preload_t *slot = &loader->slots[worker->id];
+
+    for(uint64_t fileid = loader->first + worker->id; fileid < loader->maxfile; fileid += loader->workers) {
+        index_preload_t preload;
+
+        // reading the file without any lock
+        index_preload_read(loader, &preload, fileid);
+
+        pthread_mutex_lock(&loader->lock);
+
+        // waiting previous file of this slot to be replayed
+        while(slot->ready && !loader->stop)
+            pthread_cond_wait(&loader->cond, &loader->lock);
+
+        if(loader->stop) {
+            pthread_mutex_unlock(&loader->lock);
+            zdb_file_unmap(&preload.map);
+            break;
+        }
+
+        *slot = preload;
+        slot->ready = 1;
+
+        pthread_cond_broadcast(&loader->cond);
+        pthread_mutex_unlock(&loader->lock);
+    }
+
+    free(worker);
+
+    return NULL;
+}
+
+static index_loader_t *index_loader_start(index_root_t *root, uint64_t first, uint64_t maxfile) {
+    index_loader_t *loader;
+    int workers = root->loadthreads;
+
+    // no need of more workers than files
+    if((uint64_t) workers > maxfile - first)
+        workers = maxfile - first;
+
+    // a single file (or a single worker) is loaded
+    // like before, directly by the loading thread
+    if(workers < 2)
+        return NULL;
+
+    if(!(loader = calloc(sizeof(index_loader_t), 1))) {
+        zdb_warnp("index loader: calloc");
+        return NULL;
+    }
+
+    loader->root = root;
+    loader->first = first;
+    loader->maxfile = maxfile;
+    loader->workers = workers;
+
+    if(!(loader->slots = calloc(sizeof(index_preload_t), workers)))
+        zdb_diep("index loader: slots: calloc");
+
+    if(!(loader->threads = calloc(sizeof(pthread_t), workers)))
+        zdb_diep("index loader: threads: calloc");
+
+    pthread_mutex_init(&loader->lock, NULL);
+    pthread_cond_init(&loader->cond, NULL);
+
+    zdb_debug("[+] index: loader: starting %d workers for %lu files\n", workers, maxfile - first);
+
+    for(int i = 0; i < workers; i++) {
+        index_worker_t *worker;
+
+        if(!(worker = malloc(sizeof(index_worker_t))))
+            zdb_diep("index loader: worker: malloc");
+
+        worker->loader = loader;
+        worker->id = i;
+
+        if(pthread_create(&loader->threads[i], NULL, index_loader_worker, worker))
+            zdb_diep("index loader: pthread_create");
+    }
+
+    return loader;
+}
+
+// wait for a file to be read by a worker, returned slot
+// needs to be released with 'index_loader_release'
+static index_preload_t *index_loader_wait(index_loader_t *loader, uint64_t fileid) {
+    index_preload_t *slot = &loader->slots[(fileid - loader->first) % loader->workers];
+
+    pthread_mutex_lock(&loader->lock);
+
+    while(!(slot->ready && slot->fileid == fileid))
+        pthread_cond_wait(&loader->cond, &loader->lock);
+
+    pthread_mutex_unlock(&loader->lock);
+
+    return slot;
+}
+
+static void index_loader_release(index_loader_t *loader, index_preload_t *slot) {
+    pthread_mutex_lock(&loader->lock);
+
+    zdb_file_unmap(&slot->map);
+    slot->ready = 0;
+
+    pthread_cond_broadcast(&loader->cond);
+    pthread_mutex_unlock(&loader->lock);
+}
+
+// stop workers (even if all files were not replayed) and
+// release everything not consumed
+static void index_loader_stop(index_loader_t *loader) {
+    pthread_mutex_lock(&loader->lock);
+    loader->stop = 1;
+    pthread_cond_broadcast(&loader->cond);
+    pthread_mutex_unlock(&loader->lock);
+
+    for(int i = 0; i < loader->workers; i++)
+        pthread_join(loader->threads[i], NULL);
+
+    for(int i = 0; i < loader->workers; i++)
+        zdb_file_unmap(&loader->slots[i].map);
+
+    pthread_mutex_destroy(&loader->lock);
+    pthread_cond_destroy(&loader->cond);
+
+    free(loader->threads);
+    free(loader->slots);
+    free(loader);
+}
+
 // opening, reading then closing the index file
 // if the index was created, 0 is returned
 //
@@ -180,7 +472,13 @@ index_header_t *index_descriptor_validate(index_header_t *header, index_root_t *
 // if this one was not existing, but if the first one already exists
 // this should not create any new index (when loading we will never create
 // any new index until we don't have new data to add)
-static size_t index_load_file(index_root_t *root) {
+//
+// if 'preload' is set, file contents was already read by a loader
+// worker and is used as long as it matches the file on disk
+//
+// if 'from' is set, entries before this offset are already loaded
+// (checkpoint) and only entries after it are replayed
+static size_t index_load_file(index_root_t *root, index_preload_t *preload, size_t from) {
     index_header_t header;
     ssize_t length;
 
@@ -272,22 +570,36 @@ static size_t index_load_file(index_root_t *root) {
     zdb_verbose("[+] index: populating: %s\n", root->indexfile);
 
     // index seems in a good state
-    // let's load it completely in memory now
-    char *filebuf;
+    // let's map it completely in memory now, entries
+    // are parsed in place, without any copy
+    zdb_map_t map;
     off_t fullsize = lseek(root->indexfd, 0, SEEK_END);
+    size_t validsize;
 
-    zdb_debug("[+] index: loading in memory file: %.2f MB\n", MB(fullsize));
+    zdb_debug("[+] index: mapping in memory file: %.2f MB\n", MB(fullsize));
 
-    if(!(filebuf = malloc(fullsize)))
-        zdb_diep("index buffer: malloc");
+    if(preload && preload->map.buffer && preload->map.length == (size_t) fullsize) {
+        // file already mapped by a loader worker, taking
+        // ownership of the mapping
+        map = preload->map;
+        validsize = preload->valid;
+        memset(&preload->map, 0x00, sizeof(zdb_map_t));
 
-    lseek(root->indexfd, 0, SEEK_SET);
-    if(read(root->indexfd, filebuf, fullsize) != fullsize)
-        zdb_diep("index buffer: read");
+    } else {
+        if(zdb_file_map(root->indexfd, &map) || map.length != (size_t) fullsize)
+            zdb_diep("index buffer: map");
+
+        validsize = index_load_scan(map.buffer, fullsize);
+    }
+
+    char *filebuf = map.buffer;
+
+    if(validsize < (size_t) fullsize)
+        zdb_warning("[-] index: %s: incomplete entry at offset %lu, ignored", root->indexfile, validsize);
 
     // positioning seeker to beginin of index entries
     char *initseeker = filebuf + sizeof(index_header_t);
-    char *seeker = initseeker;
+    char *seeker = (from > sizeof(index_header_t)) ? filebuf + from : initseeker;
 
     // reading the index, populating memory
     //
@@ -299,10 +611,11 @@ static size_t index_load_file(index_root_t *root) {
 
     // ensure nextid is zero, because this id
     // is relative to the indexfile, we start to populate
-    // this file, starting from zero
-    root->nextid = 0;
+    // this file, starting from zero (or from the checkpoint)
+    if(seeker == initseeker)
+        root->nextid = 0;
 
-    while(seeker < filebuf + fullsize) {
+    while(seeker < filebuf + validsize) {
         index_entry_t *fresh = NULL;
 
         entry = (index_item_t *) seeker;
@@ -335,6 +648,10 @@ static size_t index_load_file(index_root_t *root) {
             // index_seqid_dump(root);
         }
 
+        // entry position is the sequential id
+        if(root->seqtable)
+            index_seqtable_set(root, root->nextentry, entry);
+
         // insert this entry like it was inserted by a user
         // this allows us to keep a generic way of inserting data and keeping a
         // single point of logic when adding data (logic for overwrite, resize bucket, ...)
@@ -359,8 +676,8 @@ static size_t index_load_file(index_root_t *root) {
 
     zdb_debug("[+] index: last offset: %lu\n", root->previous);
 
-    // freeing buffer memory
-    free(filebuf);
+    // releasing file mapping
+    zdb_file_unmap(&map);
 
     // this file is done
     close(root->indexfd);
@@ -394,28 +711,58 @@ uint64_t index_availity_check(index_root_t *root) {
 // if no index files exists, we create the original one
 void index_internal_load(index_root_t *root) {
     uint64_t maxfile = index_availity_check(root);
+    uint64_t firstfile = 0;
+    size_t from = 0;
     uint64_t fileid;
 
     if(maxfile > 0) {
-        // opening all index files one by one
-        for(fileid = 0; fileid < maxfile; fileid++) {
+        // starting from the checkpoint, if there is a valid one,
+        // only files after the checkpoint mark needs to be replayed
+        if(index_checkpoint_load(root, maxfile) == 0) {
+            firstfile = root->checkpoint.indexid;
+            from = root->checkpoint.offset;
+        }
+
+        // reading files ahead in parallel, if enabled
+        index_loader_t *loader = index_loader_start(root, firstfile, maxfile);
+
+        // replaying all index files one by one
+        for(fileid = firstfile; fileid < maxfile; fileid++) {
+            index_preload_t *preload = NULL;
+            size_t loaded;
+
             index_set_id(root, fileid);
 
-            if(index_load_file(root) == 0) {
+            if(loader)
+                preload = index_loader_wait(loader, fileid);
+
+            loaded = index_load_file(root, preload, (fileid == firstfile) ? from : 0);
+
+            if(preload)
+                index_loader_release(loader, preload);
+
+            if(loaded == 0) {
                 zdb_verbose("[-] index: loader: something went wrong with index %d\n", root->indexid);
                 break;
             }
         }
 
+        if(loader)
+            index_loader_stop(loader);
+
     } else {
         // we need to create the index
         index_set_id(root, 0);
-        if(index_load_file(root) != 0) {
+        if(index_load_file(root, NULL, 0) != 0) {
             zdb_verbose("[-] index: loader: seems initial index could not be created\n");
             return;
         }
     }
 
+    // nobody is waiting on this index yet, there is no need
+    // to keep a resize in progress
+    index_resize_finish(root);
+
     if(root->seqid && root->seqid->length == 0) {
         zdb_debug("[+] index: loader: fresh database created in sequential mode\n");
         zdb_debug("[+] index: loader: initializing default seqmap\n");
@@ -460,23 +807,6 @@ void index_internal_allocate_single() {
     // allocating transition variable, a reusable item
     if(!(index_transition = malloc(sizeof(index_item_t) + MAX_KEY_LENGTH + 1)))
         zdb_diep("malloc");
-
-    // avoid already allocated buffer
-    if(index_reusable_entry)
-        return;
-
-    // in direct key mode, more over, we allocate a re-usable
-    // index_entry_t which will be adapted each time
-    // using the requested key, like this we can use the same
-    // implementation for everything
-    //
-    // in the default mode, the key is always kept in memory
-    // and never free'd, that's why we will allocate a one-time
-    // object now and reuse the same all the time
-    //
-    // this is allocated, when index mode can be different on runtime
-    if(!(index_reusable_entry = (index_entry_t *) malloc(sizeof(index_entry_t) + MAX_KEY_LENGTH)))
-        zdb_diep("malloc");
 }
 
 index_seqid_t *index_allocate_seqid() {
@@ -511,13 +841,21 @@ index_root_t *index_init_lazy(zdb_settings_t *settings, char *indexdir, void *na
     root->previous = 0;
     root->sync = settings->sync;
     root->synctime = settings->synctime;
+    root->loadthreads = settings->loadthreads;
     root->lastsync = 0;
     root->status = INDEX_NOT_LOADED | INDEX_HEALTHY;
     root->branches = NULL;
+    root->buckets = 0;
+    root->hash = NULL;
+    root->arena = NULL;
+    root->tree = NULL;
+    root->engine = settings->engine;
     root->namespace = namespace;
     root->mode = settings->mode;
     root->rotate = time(NULL);
 
+    fdcache_init(&root->fdcache, settings->fdcache);
+
     index_dirty_resize(root, 1);
 
     // switching to default mode when mix enabled
@@ -533,6 +871,39 @@ index_root_t *index_rehash(index_root_t *root) {
         if(root->seqid == NULL)
             root->seqid = index_allocate_seqid();
 
+    if(root->mode == ZDB_MODE_SEQUENTIAL && zdb_rootsettings.seqtable)
+        if(root->seqtable == NULL)
+            root->seqtable = index_seqtable_init();
+
+    // entries table already avoids index reads, no need of both
+    if(root->mode == ZDB_MODE_SEQUENTIAL && zdb_rootsettings.seqmmap && !root->seqtable)
+        if(root->seqviews == NULL)
+            root->seqviews = index_seqviews_init();
+
+    // each index owns it's own memory index and entries
+    // allocator, only needed in key-value mode
+    if(root->mode == ZDB_MODE_KEY_VALUE && root->arena == NULL)
+        if(!(root->arena = index_arena_init()))
+            zdb_diep("index loader: arena allocation");
+
+    if(root->mode == ZDB_MODE_KEY_VALUE && root->engine == ZDB_INDEX_HASHTABLE)
+        if(root->hash == NULL)
+            if(!(root->hash = index_hash_init(root->arena, INDEX_HASH_INITIAL)))
+                zdb_diep("index loader: hashtable allocation");
+
+    if(root->mode == ZDB_MODE_KEY_VALUE && root->engine == ZDB_INDEX_BRANCHES) {
+        if(root->branches == NULL) {
+            root->buckets = INDEX_BUCKETS_INITIAL;
+
+            // never use more than the maximum allowed
+            if(root->buckets > buckets_branches)
+                root->buckets = buckets_branches;
+
+            if(!(root->branches = index_buckets_init(root->buckets)))
+                zdb_diep("index loader: buckets allocation");
+        }
+    }
+
     // since this function will be called for each namespace
     // we will not allocate all the time the reusable variables
     // but this is the 'main entry' of index loading, so doing this
@@ -543,16 +914,18 @@ index_root_t *index_rehash(index_root_t *root) {
 }
 
 // create an index and load files
-index_root_t *index_init(zdb_settings_t *settings, char *indexdir, void *namespace, index_branch_t **branches) {
+index_root_t *index_init(zdb_settings_t *settings, char *indexdir, void *namespace) {
     zdb_debug("[+] index: initializing\n");
 
     index_root_t *root = index_init_lazy(settings, indexdir, namespace);
-    root->branches = branches;
 
     // initialize internal pointers
     index_rehash(root);
     index_internal_load(root);
 
+    if(root->seqviews)
+        index_seqviews_load(root);
+
     if(root->mode == ZDB_MODE_KEY_VALUE)
         index_dump(root, settings->dump);
 
@@ -572,6 +945,10 @@ void index_destroy(index_root_t *root) {
     if(root->indexfd > 0)
         close(root->indexfd);
 
+    // older files could be changed (eg: compaction)
+    // next root will open them again
+    fdcache_free(&root->fdcache);
+
     // delete root object
     free(root->indexfile);
     free(root->dirty.map);
@@ -581,6 +958,17 @@ void index_destroy(index_root_t *root) {
         free(root->seqid);
     }
 
+    index_seqtable_free(root->seqtable);
+    index_seqviews_free(root->seqviews);
+
+    // memory index is owned by the index, remaining
+    // entries are released with the arena
+    index_hash_free(root->hash);
+    index_buckets_free(root->branches, root->buckets);
+    index_buckets_free(root->migration.branches, root->migration.buckets);
+    index_arena_free(root->arena);
+    index_tree_free(root->tree);
+
     free(root);
 }
 
@@ -591,14 +979,12 @@ void index_destroy(index_root_t *root) {
 void index_destroy_global() {
     free(index_transition);
     index_transition = NULL;
-
-    free(index_reusable_entry);
-    index_reusable_entry = NULL;
 }
 
 // delete index files (not the namespace descriptor)
 void index_delete_files(index_root_t *root) {
     zdb_dir_clean_payload(root->indexdir);
+    index_checkpoint_delete(root);
 }
 
 // update (rewrite) current index header
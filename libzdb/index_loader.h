@@ -5,13 +5,15 @@
     index_header_t index_initialize(int fd, fileid_t indexid, index_root_t *root);
 
     // initialize the whole index system
-    index_root_t *index_init(zdb_settings_t *settings, char *indexdir, void *namespace, index_branch_t **branches);
+    index_root_t *index_init(zdb_settings_t *settings, char *indexdir, void *namespace);
     index_root_t *index_init_lazy(zdb_settings_t *settings, char *indexdir, void *namespace);
 
     // internal functions
     index_root_t *index_rehash(index_root_t *root);
     void index_internal_load(index_root_t *root);
     void index_internal_allocate_single();
+    int index_load_read(int fd, char *buffer, size_t length);
+    index_item_t *index_item_next(char *buffer, size_t length, size_t *offset);
 
     // sanity check
     uint64_t index_availity_check(index_root_t *root);
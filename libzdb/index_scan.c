@@ -12,20 +12,6 @@
 #include "libzdb.h"
 #include "libzdb_private.h"
 
-//
-// walk functions
-//
-static inline index_scan_t index_scan_error(index_scan_t original, index_scan_status_t error) {
-    // clean any remaning memory
-    free(original.header);
-
-    // ensure we reset everything
-    original.header = NULL;
-    original.status = error;
-
-    return original;
-}
-
 //
 // oops, some mistake happened
 //
@@ -72,468 +58,284 @@ void __ditry_seqmode_fix(index_item_t *source, off_t original) {
         source->previous = 1;
 }
 
-// RSCAN implementation
-static index_scan_t index_previous_header_real(index_scan_t scan) {
-    index_item_t source;
-
-    // special dirty-fix case, please see __ditry_seqmode_fix function
-    if(scan.target == 1) {
-        // forcing last entry position
-        scan.target = lseek(scan.fd, 0, SEEK_END);
-        scan.target -= sizeof(index_item_t) + sizeof(uint32_t);
-    }
-
-    // if scan.target is not set yet, we don't know the expected
-    // offset of the previous header, let's read the header
-    // of the current entry and find out which is the next one
-    if(scan.target == 0) {
-        off_t current = lseek(scan.fd, scan.original, SEEK_SET);
-
-        if(read(scan.fd, &source, sizeof(index_item_t)) != sizeof(index_item_t)) {
-            zdb_warnp("index rscan: previous-header: could not read original offset file");
-            return index_scan_error(scan, INDEX_SCAN_UNEXPECTED);
-        }
-
-        __ditry_seqmode_fix(&source, scan.original);
-        index_item_header_dump(&source);
-
-        if(source.previous >= current) {
-            zdb_debug("[+] index rscan: previous-header: previous offset (%u) in previous file\n", source.previous);
-            return index_scan_error(scan, INDEX_SCAN_REQUEST_PREVIOUS);
-        }
-
-        scan.target = source.previous;
-
-        // rollback special case when pointing to the first entry
-        if(scan.target == 1)
-            scan.target = sizeof(index_header_t);
-    }
-
-    zdb_debug("[+] index rscan: previous-header: offset: %u\n", source.previous);
-
-    // at that point, we know scan.target is set to the expected value
-    if(scan.target == 0) {
-        zdb_debug("[+] index rscan: previous-header: zero reached, nothing to rollback\n");
-        return index_scan_error(scan, INDEX_SCAN_NO_MORE_DATA);
-    }
-
-    // special dirty-fix case, please see __ditry_seqmode_fix function
-    if(scan.target == 1) {
-        scan.target = 0;
-        return index_scan_error(scan, INDEX_SCAN_REQUEST_PREVIOUS);
-    }
-
-    // jumping to previous object
-    lseek(scan.fd, scan.target, SEEK_SET);
-
-    // reading the fixed-length
-    if(read(scan.fd, &source, sizeof(index_item_t)) != sizeof(index_item_t)) {
-        zdb_warnp("index rscan: previous-header: could not read previous offset datafile");
-        return index_scan_error(scan, INDEX_SCAN_UNEXPECTED);
-    }
-
-    __ditry_seqmode_fix(&source, scan.target);
-
-    // checking if entry is deleted
-    if(source.flags & INDEX_ENTRY_DELETED) {
-        zdb_debug("[+] index rscan: previous-header: data is deleted, going one more before\n");
-
-        // set the 'new' original to this offset
-        scan.original = scan.target;
-
-        // reset target, so next time we come here, we will refetch previous
-        // entry and use the mechanism to check if it's the previous file and
-        // so on
-        scan.target = 0;
-
-        // let's notify source this entry was deleted and we
-        // should retrigger the fetch
-        return index_scan_error(scan, INDEX_SCAN_DELETED);
-    }
+//
+// index cursor
+//
+// SCAN and RSCAN walk over index files entry per entry, instead of
+// reading each entry header and id with their own syscalls, the file is
+// read by large aligned blocks and entries are parsed from the block,
+// deleted entries are skipped in memory
+//
+// forward, next entry is right after the current one (header and id),
+// the first entry of the next file follows the last one of a file
+//
+// backward, 'previous' field of an entry points to the previous one, when
+// this offset is not before the current one, previous entry is on the
+// previous file (see __ditry_seqmode_fix for sequential mode)
+//
+// cursor keeps the descriptor of the file walked, it needs to be freed
+// before any change on the index (cursor lives during a single command)
+//
+index_cursor_t *index_cursor_new(index_root_t *root) {
+    index_cursor_t *cursor;
 
-    if(!(scan.header = (index_item_t *) malloc(sizeof(index_item_t) + source.idlength))) {
-        zdb_warnp("index rscan: previous-header: malloc");
-        return index_scan_error(scan, INDEX_SCAN_UNEXPECTED);
+    if(!(cursor = calloc(sizeof(index_cursor_t), 1))) {
+        zdb_warnp("index cursor: calloc");
+        return NULL;
     }
 
-    // reading the full header to target
-    *scan.header = source;
-
-    if(read(scan.fd, scan.header->id, scan.header->idlength) != (ssize_t) scan.header->idlength) {
-        zdb_warnp("index rscan: previous-header: could not read id from datafile");
-        return index_scan_error(scan, INDEX_SCAN_UNEXPECTED);
+    if(!(cursor->block = malloc(INDEX_CURSOR_BLOCK))) {
+        zdb_warnp("index cursor: malloc");
+        free(cursor);
+        return NULL;
     }
 
-    zdb_debug("[+] index rscan: previous-header: entry found\n");
-    scan.status = INDEX_SCAN_SUCCESS;
+    cursor->root = root;
+    cursor->fd = -1;
 
-    return scan;
+    return cursor;
 }
 
-index_scan_t index_previous_header(index_root_t *root, fileid_t fileid, size_t offset) {
-    index_scan_t scan = {
-        .fd = 0,
-        .fileid = fileid,
-        .original = offset, // offset of the 'current' key
-        .target = 0,        // offset of the 'previous' key
-        .header = NULL,     // the previous header
-        .status = INDEX_SCAN_UNEXPECTED,
-    };
-
-    while(1) {
-        // acquire file id fd
-        if((scan.fd = index_grab_fileid(root, scan.fileid)) < 0) {
-            zdb_debug("[-] index rscan: previous-header: could not open requested file id (%u)\n", scan.fileid);
-            return index_scan_error(scan, INDEX_SCAN_NO_MORE_DATA);
-        }
+static void index_cursor_close(index_cursor_t *cursor) {
+    if(cursor->fd < 0)
+        return;
 
-        // trying to get entry
-        scan = index_previous_header_real(scan);
+    index_release_fileid(cursor->root, cursor->fileid, cursor->fd);
 
-        // release fileid
-        index_release_fileid(root, scan.fileid, scan.fd);
+    cursor->fd = -1;
+    cursor->blockoffset = 0;
+    cursor->blocklength = 0;
+}
 
-        if(scan.status == INDEX_SCAN_SUCCESS)
-            return scan;
+void index_cursor_free(index_cursor_t *cursor) {
+    index_cursor_close(cursor);
 
-        if(scan.status == INDEX_SCAN_UNEXPECTED)
-            return scan;
+    free(cursor->block);
+    free(cursor);
+}
 
-        if(scan.status == INDEX_SCAN_NO_MORE_DATA)
-            return scan;
+// switch the cursor to another index file
+static int index_cursor_open(index_cursor_t *cursor, fileid_t fileid) {
+    if(cursor->fd >= 0 && cursor->fileid == fileid)
+        return 0;
 
-        // entry was deleted, scan object is updated
-        // we need to retry fetching new data
-        if(scan.status == INDEX_SCAN_DELETED)
-            continue;
+    index_cursor_close(cursor);
 
-        if(scan.status == INDEX_SCAN_REQUEST_PREVIOUS)
-            scan.fileid = scan.fileid - 1;
+    if((cursor->fd = index_grab_fileid(cursor->root, fileid)) < 0) {
+        zdb_debug("[-] index cursor: could not open requested file id (%u)\n", fileid);
+        return 1;
     }
 
-    // never reached
-}
-
-// SCAN implementation
-static index_scan_t index_next_header_real(index_scan_t scan) {
-    index_item_t source;
+    cursor->fileid = fileid;
 
-    // if scan.target is not set yet, we don't know the expected
-    // offset of the next header, let's read the header
-    // of the current entry and find out which is the next one
-    if(scan.target == 0) {
-        lseek(scan.fd, scan.original, SEEK_SET);
+    return 0;
+}
 
-        if(read(scan.fd, &source, sizeof(index_item_t)) != sizeof(index_item_t)) {
-            zdb_warnp("index scan: next-header: could not read original offset indexfile");
-            return index_scan_error(scan, INDEX_SCAN_UNEXPECTED);
-        }
+// returns a pointer to [offset, offset + length] from the file, a new
+// block is read when it's not on the current block, walking forward the
+// block starts at offset, backward the block ends after the largest
+// entry possible at offset, this way entries before are read at once
+//
+// returns NULL when the file doesn't contains this range
+static unsigned char *index_cursor_fetch(index_cursor_t *cursor, size_t offset, size_t length, int backward) {
+    if(offset >= cursor->blockoffset && offset + length <= cursor->blockoffset + cursor->blocklength)
+        return cursor->block + (offset - cursor->blockoffset);
 
-        zdb_debug("[+] index scan: next-header: this id length: %u\n", source.idlength);
+    size_t start = offset & ~((size_t) INDEX_CURSOR_ALIGN - 1);
 
-        // next header is at offset + this header + payload
-        scan.target = scan.original + sizeof(index_item_t);
-        scan.target += source.idlength;
+    if(backward) {
+        size_t end = offset + sizeof(index_item_t) + UINT8_MAX;
+        end = (end + INDEX_CURSOR_ALIGN - 1) & ~((size_t) INDEX_CURSOR_ALIGN - 1);
+        start = (end > INDEX_CURSOR_BLOCK) ? end - INDEX_CURSOR_BLOCK : 0;
     }
 
-    // jumping to next object
-    lseek(scan.fd, scan.target, SEEK_SET);
+    ssize_t response = pread(cursor->fd, cursor->block, INDEX_CURSOR_BLOCK, start);
 
-    // reading the fixed-length
-    if(read(scan.fd, &source, sizeof(index_item_t)) != sizeof(index_item_t)) {
-        // zdb_warnp("index scan: next-header: could not read next offset indexfile");
-        // this mean the entry expected is the first of the next indexfile
-        scan.target = sizeof(index_header_t);
-        return index_scan_error(scan, INDEX_SCAN_EOF_REACHED);
-    }
-
-    // checking if entry is deleted
-    if(source.flags & INDEX_ENTRY_DELETED) {
-        zdb_debug("[+] index scan: next-header: offset %lu deleted, going one further\n", scan.target);
+    cursor->blockoffset = start;
+    cursor->blocklength = (response > 0) ? response : 0;
+    cursor->reads += 1;
 
-        // set the 'new' original to this offset
-        scan.original = scan.target;
+    if(response < 0)
+        zdb_warnp("index cursor: pread");
 
-        // reset target, so next time we come here, we will refetch previous
-        // entry and use the mechanism to check if it's the previous file and
-        // so on
-        scan.target = 0;
-
-        // let's notify source this entry was deleted and we
-        // should retrigger the fetch
-        return index_scan_error(scan, INDEX_SCAN_DELETED);
-    }
+    if(offset + length > cursor->blockoffset + cursor->blocklength)
+        return NULL;
 
+    return cursor->block + (offset - cursor->blockoffset);
+}
 
-    if(!(scan.header = (index_item_t *) malloc(sizeof(index_item_t) + source.idlength))) {
-        zdb_warnp("index scan: next-header: malloc");
-        return index_scan_error(scan, INDEX_SCAN_UNEXPECTED);
-    }
+// entry (header and id) at offset on the current file
+static index_item_t *index_cursor_read(index_cursor_t *cursor, size_t offset, int backward) {
+    index_item_t *item;
 
-    // reading the full header to target
-    *scan.header = source;
+    if(!(item = (index_item_t *) index_cursor_fetch(cursor, offset, sizeof(index_item_t), backward)))
+        return NULL;
 
-    if(read(scan.fd, scan.header->id, scan.header->idlength) != (ssize_t) scan.header->idlength) {
-        zdb_warnp("index scan: next-header: could not read id from datafile");
-        return index_scan_error(scan, INDEX_SCAN_UNEXPECTED);
-    }
-
-    index_item_header_dump(&source);
+    return (index_item_t *) index_cursor_fetch(cursor, offset, sizeof(index_item_t) + item->idlength, backward);
+}
 
-    zdb_debug("[+] index scan: next-header: entry found\n");
-    scan.status = INDEX_SCAN_SUCCESS;
+static index_scan_status_t index_cursor_found(index_cursor_t *cursor, index_item_t *item, size_t offset) {
+    cursor->item = item;
+    cursor->offset = offset;
+    cursor->entries += 1;
 
-    return scan;
+    return INDEX_SCAN_SUCCESS;
 }
 
-index_scan_t index_next_header(index_root_t *root, fileid_t fileid, size_t offset) {
-    index_scan_t scan = {
-        .fd = 0,
-        .fileid = fileid,
-        .original = offset, // offset of the 'current' key
-        .target = 0,        // offset of the expected next header
-        .header = NULL,     // the new header
-        .status = INDEX_SCAN_UNEXPECTED,
-    };
+// from offset (included) to the first entry not deleted
+static index_scan_status_t index_cursor_forward(index_cursor_t *cursor, size_t offset) {
+    index_item_t *item;
 
     while(1) {
-        // acquire file id fd
-        if((scan.fd = index_grab_fileid(root, fileid)) < 0) {
-            zdb_debug("[-] index scan: next-header: could not open requested file id (%u)\n", fileid);
-            return index_scan_error(scan, INDEX_SCAN_NO_MORE_DATA);
-        }
+        if(!(item = index_cursor_read(cursor, offset, 0))) {
+            // end of this file, next entry is the
+            // first one of the next index file
+            if(index_cursor_open(cursor, cursor->fileid + 1))
+                return INDEX_SCAN_NO_MORE_DATA;
 
-        // trying to get entry
-        scan = index_next_header_real(scan);
-
-        // release fileid
-        index_release_fileid(root, fileid, scan.fd);
-
-        if(scan.status == INDEX_SCAN_SUCCESS)
-            return scan;
-
-        if(scan.status == INDEX_SCAN_UNEXPECTED)
-            return scan;
-
-        // entry was deleted, scan object is updated
-        // we need to retry fetching new data
-        if(scan.status == INDEX_SCAN_DELETED)
+            offset = sizeof(index_header_t);
             continue;
-
-        if(scan.status == INDEX_SCAN_EOF_REACHED) {
-            zdb_debug("[-] index scan: next-header: eof reached\n");
-            fileid += 1;
-            scan.fileid = fileid;
         }
-    }
 
-    // never reached
-}
-
-static index_scan_t index_first_header_real(index_scan_t scan) {
-    index_item_t source;
+        if(!(item->flags & INDEX_ENTRY_DELETED))
+            return index_cursor_found(cursor, item, offset);
 
-    // jumping to next object
-    lseek(scan.fd, scan.target, SEEK_SET);
-
-    // reading the fixed-length
-    if(read(scan.fd, &source, sizeof(index_item_t)) != sizeof(index_item_t)) {
-        zdb_warnp("data: first-header: could not read next offset datafile");
-        // this mean the data expected is the first of the next datafile
-        scan.target = sizeof(index_header_t);
-        return index_scan_error(scan, INDEX_SCAN_EOF_REACHED);
+        cursor->deleted += 1;
+        offset += sizeof(index_item_t) + item->idlength;
     }
+}
 
-    index_item_header_dump(&source);
+// previous entry is the last one of a previous file, 'previous' is its
+// offset, in sequential mode this field can't be trusted and the last
+// entry is found from the file size (see __ditry_seqmode_fix), files
+// without entries are skipped
+static index_item_t *index_cursor_previous_file(index_cursor_t *cursor, size_t previous, size_t *offset) {
+    index_item_t *item;
 
-    // checking if entry is deleted
-    if(source.flags & INDEX_ENTRY_DELETED) {
-        // zdb_debug("[+] data: first-header: data is deleted, going one further\n");
+    while(cursor->fileid > 0) {
+        if(index_cursor_open(cursor, cursor->fileid - 1))
+            return NULL;
 
-        // jump to the next entry
-        scan.target += sizeof(index_item_t);
-        scan.target += source.idlength;
+        *offset = previous;
 
-        // let's notify source this entry was deleted and we
-        // should retrigger the fetch
-        return index_scan_error(scan, INDEX_SCAN_DELETED);
-    }
+        if(zdb_rootsettings.mode == ZDB_MODE_SEQUENTIAL || zdb_rootsettings.mode == ZDB_MODE_DIRECT_KEY) {
+            off_t end = lseek(cursor->fd, 0, SEEK_END);
 
-    if(!(scan.header = (index_item_t *) malloc(sizeof(index_item_t) + source.idlength))) {
-        zdb_warnp("index scan: first-header: malloc");
-        return index_scan_error(scan, INDEX_SCAN_UNEXPECTED);
-    }
+            if(end < (off_t) (sizeof(index_header_t) + sizeof(index_item_t) + sizeof(uint32_t)))
+                continue;
 
-    // reading the full header to target
-    *scan.header = source;
+            *offset = end - sizeof(index_item_t) - sizeof(uint32_t);
+        }
 
-    if(read(scan.fd, scan.header->id, scan.header->idlength) != (ssize_t) scan.header->idlength) {
-        zdb_warnp("index scan: first-header: could not read id from datafile");
-        return index_scan_error(scan, INDEX_SCAN_UNEXPECTED);
+        if((item = index_cursor_read(cursor, *offset, 1)))
+            return item;
     }
 
-    zdb_debug("[+] index scan: first-header: entry found\n");
-    scan.status = INDEX_SCAN_SUCCESS;
-
-    return scan;
+    return NULL;
 }
 
-
-index_scan_t index_first_header(index_root_t *root) {
-    index_scan_t scan = {
-        .fd = 0,
-        .fileid = 0,
-        .original = sizeof(index_header_t), // offset of the first key
-        .target = sizeof(index_header_t),   // again offset of the first key
-        .header = NULL,
-        .status = INDEX_SCAN_UNEXPECTED,
-    };
-
+// from the entry at offset (item) to the first entry
+// before it which is not deleted
+static index_scan_status_t index_cursor_backward(index_cursor_t *cursor, index_item_t *item, size_t offset) {
     while(1) {
-        // acquire data id fd
-        if((scan.fd = index_grab_fileid(root, scan.fileid)) < 0) {
-            zdb_debug("[-] index scan: first-header: could not open requested file id (%u)\n", scan.fileid);
-            return index_scan_error(scan, INDEX_SCAN_NO_MORE_DATA);
-        }
-
-        scan = index_first_header_real(scan);
+        index_item_t source = *item;
 
-        // release fileid
-        index_release_fileid(root, scan.fileid, scan.fd);
+        __ditry_seqmode_fix(&source, offset);
 
-        if(scan.status == INDEX_SCAN_SUCCESS)
-            return scan;
+        if(source.previous >= offset) {
+            if(!(item = index_cursor_previous_file(cursor, source.previous, &offset)))
+                return INDEX_SCAN_NO_MORE_DATA;
 
-        if(scan.status == INDEX_SCAN_UNEXPECTED)
-            return scan;
+        } else if(source.previous == 0) {
+            zdb_debug("[+] index cursor: zero reached, nothing to rollback\n");
+            return INDEX_SCAN_NO_MORE_DATA;
 
-        // entry was deleted, scan object is updated
-        // we need to retry fetching new data
-        if(scan.status == INDEX_SCAN_DELETED)
-            continue;
+        } else {
+            // special dirty-fix case, first entry of this file
+            offset = (source.previous == 1) ? sizeof(index_header_t) : source.previous;
 
-        if(scan.status == INDEX_SCAN_EOF_REACHED) {
-            zdb_debug("[-] index scan: next-header: eof reached\n");
-            scan.fileid = scan.fileid + 1;
+            if(!(item = index_cursor_read(cursor, offset, 1))) {
+                zdb_debug("[-] index cursor: could not read entry %u/%lu\n", cursor->fileid, offset);
+                return INDEX_SCAN_UNEXPECTED;
+            }
         }
-    }
-
-    // never reached
-}
-
-static index_scan_t index_last_header_real(index_scan_t scan) {
-    index_item_t source;
 
-    zdb_debug("[+] index scan: last-header: trying previous offset: %lu\n", scan.target);
+        if(!(item->flags & INDEX_ENTRY_DELETED))
+            return index_cursor_found(cursor, item, offset);
 
-    // at that point, we know scan.target is set to the expected value
-    if(scan.target == 0) {
-        zdb_debug("[+] index scan: last-header: zero reached, nothing to rollback\n");
-        return index_scan_error(scan, INDEX_SCAN_NO_MORE_DATA);
-    }
-
-    // special dirty-fix case, please see __ditry_seqmode_fix function
-    if(scan.target == 1) {
-        // forcing last entry position
-        scan.target = lseek(scan.fd, 0, SEEK_END);
-        scan.target -= sizeof(index_item_t) + sizeof(uint32_t);
-    }
-
-    // jumping to previous object
-    lseek(scan.fd, scan.target, SEEK_SET);
-
-    // reading the fixed-length
-    if(read(scan.fd, &source, sizeof(index_item_t)) != sizeof(index_item_t)) {
-        zdb_warnp("index scan: previous-header: could not read previous offset indexfile");
-        return index_scan_error(scan, INDEX_SCAN_UNEXPECTED);
+        cursor->deleted += 1;
     }
+}
 
-    __ditry_seqmode_fix(&source, scan.target);
-    index_item_header_dump(&source);
+// set cursor on an existing entry (eg: from a SCAN key), next
+// and previous calls are relative to this entry
+void index_cursor_seek(index_cursor_t *cursor, fileid_t fileid, size_t offset) {
+    if(cursor->fd >= 0 && cursor->fileid != fileid)
+        index_cursor_close(cursor);
 
-    // checking if entry is deleted
-    if(source.flags & INDEX_ENTRY_DELETED) {
-        off_t current = scan.target;
+    cursor->fileid = fileid;
+    cursor->offset = offset;
+    cursor->item = NULL;
+}
 
-        zdb_debug("[+] index scan: last-header: data is deleted, going one previous\n");
+index_scan_status_t index_cursor_first(index_cursor_t *cursor) {
+    if(index_cursor_open(cursor, 0))
+        return INDEX_SCAN_NO_MORE_DATA;
 
-        // reset target, so next time we come here, we will refetch previous
-        // entry and use the mechanism to check if it's the previous file and
-        // so on
-        scan.target = source.previous;
+    return index_cursor_forward(cursor, sizeof(index_header_t));
+}
 
-        if(source.previous >= current || source.previous == 1) {
-            zdb_debug("[+] index scan: last-header: previous offset in previous file\n");
-            return index_scan_error(scan, INDEX_SCAN_REQUEST_PREVIOUS);
-        }
+index_scan_status_t index_cursor_last(index_cursor_t *cursor) {
+    index_root_t *root = cursor->root;
+    size_t offset = root->previous;
+    index_item_t *item;
 
-        // let's notify source this entry was deleted and we
-        // should retrigger the fetch
-        return index_scan_error(scan, INDEX_SCAN_DELETED);
-    }
+    if(offset < sizeof(index_header_t))
+        return INDEX_SCAN_NO_MORE_DATA;
 
-    if(!(scan.header = (index_item_t *) malloc(sizeof(index_item_t) + source.idlength))) {
-        zdb_warnp("data: last-header: malloc");
-        return index_scan_error(scan, INDEX_SCAN_UNEXPECTED);
-    }
+    if(index_cursor_open(cursor, root->indexid))
+        return INDEX_SCAN_NO_MORE_DATA;
 
-    // reading the full header to target
-    *scan.header = source;
+    // nothing written since last jump, last entry
+    // is still the last one of a previous file
+    if(!(item = index_cursor_read(cursor, offset, 1)))
+        if(!(item = index_cursor_previous_file(cursor, offset, &offset)))
+            return INDEX_SCAN_NO_MORE_DATA;
 
-    if(read(scan.fd, scan.header->id, scan.header->idlength) != (ssize_t) scan.header->idlength) {
-        zdb_warnp("data: last-header: could not read id from datafile");
-        return index_scan_error(scan, INDEX_SCAN_UNEXPECTED);
-    }
+    if(!(item->flags & INDEX_ENTRY_DELETED))
+        return index_cursor_found(cursor, item, offset);
 
-    zdb_debug("[+] data: last-header: entry found\n");
-    scan.status = INDEX_SCAN_SUCCESS;
+    cursor->deleted += 1;
 
-    return scan;
+    return index_cursor_backward(cursor, item, offset);
 }
 
+index_scan_status_t index_cursor_next(index_cursor_t *cursor) {
+    index_item_t *item;
 
-index_scan_t index_last_header(index_root_t *root) {
-    index_scan_t scan = {
-        .fd = 0,
-        .fileid = root->indexid,
-        .original = root->previous, // offset of the last key
-        .target = root->previous,   // again offset of the last key
-        .header = NULL,
-        .status = INDEX_SCAN_UNEXPECTED,
-    };
-
-    while(1) {
-        // acquire data id fd
-        if((scan.fd = index_grab_fileid(root, scan.fileid)) < 0) {
-            zdb_debug("[-] index scan: last-header: could not open requested file id (%u)\n", scan.fileid);
-            return index_scan_error(scan, INDEX_SCAN_NO_MORE_DATA);
-        }
-
-        // trying to get entry
-        scan = index_last_header_real(scan);
+    if(index_cursor_open(cursor, cursor->fileid))
+        return INDEX_SCAN_NO_MORE_DATA;
 
-        // release fileid
-        index_release_fileid(root, scan.fileid, scan.fd);
-
-        if(scan.status == INDEX_SCAN_SUCCESS)
-            return scan;
+    // current entry length is needed to know
+    // where the next one starts
+    if(!(item = index_cursor_read(cursor, cursor->offset, 0))) {
+        zdb_debug("[-] index cursor: could not read current entry\n");
+        return INDEX_SCAN_UNEXPECTED;
+    }
 
-        if(scan.status == INDEX_SCAN_UNEXPECTED)
-            return scan;
+    return index_cursor_forward(cursor, cursor->offset + sizeof(index_item_t) + item->idlength);
+}
 
-        if(scan.status == INDEX_SCAN_NO_MORE_DATA)
-            return scan;
+index_scan_status_t index_cursor_previous(index_cursor_t *cursor) {
+    index_item_t *item;
 
-        // entry was deleted, scan object is updated
-        // we need to retry fetching new data
-        if(scan.status == INDEX_SCAN_DELETED)
-            continue;
+    if(index_cursor_open(cursor, cursor->fileid))
+        return INDEX_SCAN_NO_MORE_DATA;
 
-        if(scan.status == INDEX_SCAN_REQUEST_PREVIOUS)
-            scan.fileid = scan.fileid - 1;
+    if(!(item = index_cursor_read(cursor, cursor->offset, 1))) {
+        zdb_debug("[-] index cursor: could not read current entry\n");
+        return INDEX_SCAN_UNEXPECTED;
     }
 
-    // never reached
+    return index_cursor_backward(cursor, item, cursor->offset);
 }
-
-
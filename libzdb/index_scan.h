@@ -1,33 +1,45 @@
 #ifndef __ZDB_INDEX_SCAN_H
     #define __ZDB_INDEX_SCAN_H
 
-    // scan internal representation
-    // we use a status and a pointer to the header
-    // in order to know what to do
+    // scan status, returned by cursor moves
     typedef enum index_scan_status_t {
         INDEX_SCAN_SUCCESS,          // requested index entry found
-        INDEX_SCAN_REQUEST_PREVIOUS, // offset requested found in the previous file
-        INDEX_SCAN_EOF_REACHED,      // end of file reached, last key of next file requested
-        INDEX_SCAN_UNEXPECTED,       // unexpected (memory, ...) error
+        INDEX_SCAN_UNEXPECTED,       // unexpected (memory, read, ...) error
         INDEX_SCAN_NO_MORE_DATA,     // last item requested, nothing more
-        INDEX_SCAN_DELETED,          // entry was deleted, scan is updated to go further
 
     } index_scan_status_t;
 
-    typedef struct index_scan_t {
-        int fd;           // file descriptor
-        size_t original;  // offset of the original key requested
-        size_t target;    // offset of the target key (read from the original)
-                          // target will be 0 on the first call
-                          // target will be updated if the offset is in another file
-        index_item_t *header;        // target header, set when found
-        index_scan_status_t status;  // status code
-        fileid_t fileid;             // index file id
-
-    } index_scan_t;
-
-    index_scan_t index_previous_header(index_root_t *root, fileid_t fileid, size_t offset);
-    index_scan_t index_next_header(index_root_t *root, fileid_t fileid, size_t offset);
-    index_scan_t index_first_header(index_root_t *root);
-    index_scan_t index_last_header(index_root_t *root);
+    // index files are read by block of this size when walked
+    // with a cursor, blocks are aligned on INDEX_CURSOR_ALIGN
+    #define INDEX_CURSOR_BLOCK  128 * 1024
+    #define INDEX_CURSOR_ALIGN  4096
+
+    // walk over index entries, forward or backward, index files are read
+    // by large blocks and entries are parsed from the block, current entry
+    // (item) points inside the block and is only valid until next call
+    typedef struct index_cursor_t {
+        index_root_t *root;
+        int fd;                 // descriptor of the index file walked (-1 if none)
+        fileid_t fileid;        // index file id of the current entry
+        size_t offset;          // offset of the current entry
+        index_item_t *item;     // current entry, set when found
+
+        unsigned char *block;   // block read from the index file
+        size_t blockoffset;     // offset of the block on the file
+        size_t blocklength;     // amount of bytes on the block
+
+        size_t entries;         // amount of entries returned
+        size_t deleted;         // amount of deleted entries skipped
+        size_t reads;           // amount of blocks read
+
+    } index_cursor_t;
+
+    index_cursor_t *index_cursor_new(index_root_t *root);
+    void index_cursor_free(index_cursor_t *cursor);
+
+    void index_cursor_seek(index_cursor_t *cursor, fileid_t fileid, size_t offset);
+    index_scan_status_t index_cursor_first(index_cursor_t *cursor);
+    index_scan_status_t index_cursor_last(index_cursor_t *cursor);
+    index_scan_status_t index_cursor_next(index_cursor_t *cursor);
+    index_scan_status_t index_cursor_previous(index_cursor_t *cursor);
 #endif
@@ -1,8 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <inttypes.h>
 #include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "libzdb.h"
 #include "libzdb_private.h"
 
@@ -81,6 +85,205 @@ size_t index_seq_offset(uint32_t relative) {
     return offset;
 }
 
+//
+// sequential entries table
+//
+// without it, each sequential get reads the index entry from disk
+// (relative position on the right index file) then the payload, with
+// the table enabled, entries metadata are kept in memory, indexed by
+// sequential id, only the payload needs to be read
+//
+// table is filled when index files are replayed on load, then kept
+// up-to-date on each change made on the index (append, overwrite and
+// deletion), a slot is 28 bytes, one per sequential id
+//
+index_seqtable_t *index_seqtable_init() {
+    index_seqtable_t *table;
+
+    if(!(table = calloc(sizeof(index_seqtable_t), 1)))
+        zdb_diep("index seqtable: calloc");
+
+    return table;
+}
+
+void index_seqtable_free(index_seqtable_t *table) {
+    if(!table)
+        return;
+
+    free(table->slots);
+    free(table);
+}
+
+static void index_seqtable_grow(index_seqtable_t *table, uint32_t seqid) {
+    size_t allocated = (table->allocated) ? table->allocated : INDEX_SEQTABLE_INITIAL;
+
+    while(allocated <= seqid && allocated < INDEX_SEQTABLE_MAXIMUM)
+        allocated *= 2;
+
+    if(allocated > INDEX_SEQTABLE_MAXIMUM)
+        allocated = INDEX_SEQTABLE_MAXIMUM;
+
+    zdb_debug("[+] index seqtable: growing up table (%zu slots)\n", allocated);
+
+    if(!(table->slots = realloc(table->slots, sizeof(index_seqslot_t) * allocated)))
+        zdb_diep("index seqtable: realloc");
+
+    table->allocated = allocated;
+}
+
+// set slot of this sequential id with entry written on the index,
+// slots skipped (should not happen) are flagged as deleted
+void index_seqtable_set(index_root_t *root, uint32_t seqid, index_item_t *item) {
+    index_seqtable_t *table = root->seqtable;
+
+    if(!table)
+        return;
+
+    if(seqid >= table->allocated)
+        index_seqtable_grow(table, seqid);
+
+    for(; table->length < seqid; table->length++) {
+        memset(&table->slots[table->length], 0x00, sizeof(index_seqslot_t));
+        table->slots[table->length].flags = INDEX_ENTRY_DELETED;
+    }
+
+    index_seqslot_t *slot = &table->slots[seqid];
+
+    slot->offset = item->offset;
+    slot->length = item->length;
+    slot->crc = item->crc;
+    slot->timestamp = item->timestamp;
+    slot->parentoff = item->parentoff;
+    slot->dataid = item->dataid;
+    slot->parentid = item->parentid;
+    slot->flags = item->flags;
+
+    if(seqid >= table->length)
+        table->length = seqid + 1;
+}
+
+index_seqslot_t *index_seqtable_get(index_root_t *root, uint32_t seqid) {
+    if(seqid >= root->seqtable->length)
+        return NULL;
+
+    return &root->seqtable->slots[seqid];
+}
+
+//
+// sealed files mapping
+//
+// alternative to the entries table: sealed index files (not the active
+// one) are mapped read-only, since entries are fixed-length, an entry
+// is read in place (see index_seq_offset), without any open, read or
+// allocation, page cache is the cache
+//
+// sealed files are still updated (overwrite and deletion flag), they
+// are written with pwrite, mapping is shared so it follows the file,
+// file size never changes once sealed, active file is read from disk,
+// files are mapped on load and when jumping to the next file
+//
+// files changed offline (truncated by a compaction, ...) need a
+// namespace reload, like descriptors cache
+//
+index_seqviews_t *index_seqviews_init() {
+    index_seqviews_t *seqviews;
+
+    if(!(seqviews = calloc(sizeof(index_seqviews_t), 1)))
+        zdb_diep("index seqviews: calloc");
+
+    return seqviews;
+}
+
+void index_seqviews_free(index_seqviews_t *seqviews) {
+    if(!seqviews)
+        return;
+
+    for(uint32_t i = 0; i < seqviews->allocated; i++)
+        if(seqviews->views[i].buffer)
+            munmap(seqviews->views[i].buffer, seqviews->views[i].length);
+
+    free(seqviews->views);
+    free(seqviews);
+}
+
+// map a sealed index file, on failure, entries of this
+// file are still read from disk
+int index_seqview_map(index_root_t *root, fileid_t fileid) {
+    index_seqviews_t *seqviews = root->seqviews;
+    struct stat sb;
+    int fd;
+
+    if(fileid >= seqviews->allocated) {
+        uint32_t allocated = (seqviews->allocated) ? seqviews->allocated : 64;
+
+        while(allocated <= fileid)
+            allocated *= 2;
+
+        if(!(seqviews->views = realloc(seqviews->views, sizeof(index_seqview_t) * allocated)))
+            zdb_diep("index seqviews: realloc");
+
+        memset(seqviews->views + seqviews->allocated, 0x00, sizeof(index_seqview_t) * (allocated - seqviews->allocated));
+        seqviews->allocated = allocated;
+    }
+
+    index_seqview_t *view = &seqviews->views[fileid];
+
+    if(view->buffer)
+        return 0;
+
+    if((fd = index_open_file_readonly(root, fileid)) < 0)
+        return 1;
+
+    if(fstat(fd, &sb) < 0 || sb.st_size == 0) {
+        close(fd);
+        return 1;
+    }
+
+    void *buffer = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(buffer == MAP_FAILED) {
+        zdb_warnp("index seqviews: mmap");
+        return 1;
+    }
+
+    // entries are reached by id, not in file order
+    madvise(buffer, sb.st_size, MADV_RANDOM);
+
+    zdb_debug("[+] index seqviews: file %u mapped (%lu bytes)\n", fileid, sb.st_size);
+
+    view->buffer = buffer;
+    view->length = sb.st_size;
+
+    seqviews->length += 1;
+    seqviews->size += view->length;
+
+    return 0;
+}
+
+// map every sealed files, after load
+void index_seqviews_load(index_root_t *root) {
+    for(fileid_t fileid = 0; fileid < root->indexid; fileid++)
+        index_seqview_map(root, fileid);
+
+    zdb_verbose("[+] index: sealed files mapped: %u (%.2f MB)\n", root->seqviews->length, MB(root->seqviews->size));
+}
+
+// entry in place, NULL if the file is not mapped
+index_item_t *index_seqview_item(index_root_t *root, fileid_t fileid, size_t offset) {
+    index_seqviews_t *seqviews = root->seqviews;
+
+    if(fileid >= seqviews->allocated)
+        return NULL;
+
+    index_seqview_t *view = &seqviews->views[fileid];
+
+    if(!view->buffer || offset + sizeof(index_item_t) + sizeof(uint32_t) > view->length)
+        return NULL;
+
+    return (index_item_t *) (view->buffer + offset);
+}
+
 void index_seqid_dump(index_root_t *root) {
     for(fileid_t i = 0; i < root->seqid->length; i++) {
         index_seqmap_t *item = &root->seqid->seqmap[i];
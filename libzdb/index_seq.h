@@ -5,5 +5,16 @@
     void index_seqid_push(index_root_t *root, uint32_t id, fileid_t indexid);
     size_t index_seq_offset(uint32_t relative);
 
+    index_seqtable_t *index_seqtable_init();
+    void index_seqtable_free(index_seqtable_t *table);
+    void index_seqtable_set(index_root_t *root, uint32_t seqid, index_item_t *item);
+    index_seqslot_t *index_seqtable_get(index_root_t *root, uint32_t seqid);
+
+    index_seqviews_t *index_seqviews_init();
+    void index_seqviews_free(index_seqviews_t *seqviews);
+    int index_seqview_map(index_root_t *root, fileid_t fileid);
+    void index_seqviews_load(index_root_t *root);
+    index_item_t *index_seqview_item(index_root_t *root, fileid_t fileid, size_t offset);
+
     void index_seqid_dump(index_root_t *root);
 #endif
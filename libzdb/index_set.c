@@ -77,12 +77,11 @@ int index_seq_overwrite(index_root_t *root, index_set_t *set) {
 
     // jump to the right offset for this entry
     zdb_debug("[+] index: sequential: overwritting at %u/%u\n", seqmap->fileid, offset);
-    lseek(fd, offset, SEEK_SET);
 
     index_item_t *item = index_item_from_set(root, set);
 
     // reading original entry
-    if(read(fd, &original, sizeof(index_item_t)) != sizeof(index_item_t)) {
+    if(pread(fd, &original, sizeof(index_item_t), offset) != sizeof(index_item_t)) {
         zdb_warnp("index_seq_overwrite re-read");
         close(fd);
         return 1;
@@ -93,9 +92,7 @@ int index_seq_overwrite(index_root_t *root, index_set_t *set) {
     item->previous = original.previous;
 
     // overwrite the key
-    lseek(fd, offset, SEEK_SET);
-
-    if(write(fd, item, entrylength) != (ssize_t) entrylength) {
+    if(pwrite(fd, item, entrylength, offset) != (ssize_t) entrylength) {
         zdb_warnp("index_seq_overwrite re-write");
         close(fd);
         return 1;
@@ -103,6 +100,8 @@ int index_seq_overwrite(index_root_t *root, index_set_t *set) {
 
     close(fd);
 
+    index_seqtable_set(root, key, item);
+
     // flag index entry as dirty, it was just modified
     index_dirty_set(root, seqmap->fileid, 1);
 
@@ -133,10 +132,72 @@ index_item_t *index_item_from_set(index_root_t *root, index_set_t *set) {
     return index_transition;
 }
 
+//
+// batch writer
+//
+// when several keys are set at once (eg: MSET), entries are appended
+// to a memory buffer and written with a single write (and a single
+// sync check) on commit, offsets are computed as if they were written
+// right away, so in-memory entries are valid before the commit
+//
+// the batch needs to be committed before anything else touches the
+// index file (jump, checkpoint, ...), caller holds the exclusive lock
+//
+void index_batch_begin(index_root_t *root) {
+    root->batch.length = 0;
+    root->batch.base = lseek(root->indexfd, 0, SEEK_END);
+    root->batch.active = 1;
+}
+
+static void index_batch_append(index_root_t *root, index_item_t *item, size_t length) {
+    index_batch_t *batch = &root->batch;
+
+    if(batch->length + length > batch->allocated) {
+        size_t allocated = (batch->allocated) ? batch->allocated * 2 : 4096;
+
+        while(allocated < batch->length + length)
+            allocated *= 2;
+
+        if(!(batch->buffer = realloc(batch->buffer, allocated)))
+            zdb_diep("index batch: realloc");
+
+        batch->allocated = allocated;
+    }
+
+    memcpy(batch->buffer + batch->length, item, length);
+    batch->length += length;
+}
+
+// write pending entries, on failure none of the entries appended since
+// index_batch_begin are on disk, caller needs to flag them as deleted
+int index_batch_commit(index_root_t *root) {
+    index_batch_t *batch = &root->batch;
+    int value = 0;
+
+    batch->active = 0;
+
+    if(batch->length && !index_write(root->indexfd, batch->buffer, batch->length, root)) {
+        zdb_verbosep("index_batch_commit", "cannot write index entries on disk");
+        value = 1;
+    }
+
+    free(batch->buffer);
+    batch->buffer = NULL;
+    batch->length = 0;
+    batch->allocated = 0;
+
+    return value;
+}
+
 int index_append_entry_on_disk(index_root_t *root, index_set_t *set) {
     index_entry_t *entry = set->entry;
-    off_t curoffset = lseek(root->indexfd, 0, SEEK_END);
     size_t entrylength = sizeof(index_item_t) + entry->idlength;
+    off_t curoffset;
+
+    if(root->batch.active)
+        curoffset = root->batch.base + root->batch.length;
+    else
+        curoffset = lseek(root->indexfd, 0, SEEK_END);
 
     zdb_debug("[+] index: writing entry on disk (%lu bytes)\n", entrylength);
 
@@ -150,6 +211,12 @@ int index_append_entry_on_disk(index_root_t *root, index_set_t *set) {
     // updating global previous
     root->previous = curoffset;
 
+    // written later, with the whole batch
+    if(root->batch.active) {
+        index_batch_append(root, item, entrylength);
+        return 0;
+    }
+
     // writing data on the disk
     if(!index_write(root->indexfd, item, entrylength, root)) {
         zdb_verbosep("index_append_entry_on_disk", "cannot write index entry on disk");
@@ -160,6 +227,10 @@ int index_append_entry_on_disk(index_root_t *root, index_set_t *set) {
         return 1;
     }
 
+    // in sequential mode, the entry position is the next id
+    if(root->mode == ZDB_MODE_SEQUENTIAL)
+        index_seqtable_set(root, root->nextentry, item);
+
     return 0;
 }
 
@@ -174,15 +245,17 @@ int index_append_entry_on_disk(index_root_t *root, index_set_t *set) {
 index_entry_t *index_insert_memory_handler_memkey(index_root_t *root, index_set_t *set) {
     index_entry_t *new = set->entry;
     index_entry_t *entry;
+    uint32_t handle;
 
-    // calloc will ensure any unset fields (eg: flags) are zero
+    // arena will ensure any unset fields (eg: flags) are zero
     size_t entrysize = sizeof(index_entry_t) + new->idlength;
-    if(!(entry = calloc(entrysize, 1)))
+    if(!(handle = index_arena_alloc(root->arena, new->idlength)))
         return NULL;
 
+    entry = index_arena_entry(root->arena, handle);
+
     memcpy(entry->id, set->id, new->idlength);
     entry->idlength = new->idlength;
-    entry->namespace = root->namespace;
     entry->offset = new->offset;
     entry->length = new->length;
     entry->dataid = root->indexid; // WARNING: check this
@@ -194,10 +267,26 @@ index_entry_t *index_insert_memory_handler_memkey(index_root_t *root, index_set_
     entry->parentid = new->parentid;
     entry->parentoff = new->parentoff;
 
-    uint32_t branchkey = index_key_hash(entry->id, entry->idlength);
-
     // commit entry into memory
-    index_branch_append(root->branches, branchkey, entry);
+    if(root->engine == ZDB_INDEX_HASHTABLE) {
+        uint32_t crc = index_key_crc(entry->id, entry->idlength);
+
+        if(index_hash_insert(root->hash, crc, handle)) {
+            index_arena_release(root->arena, handle);
+            return NULL;
+        }
+
+    } else {
+        uint32_t branchkey = index_key_hash(root, entry->id, entry->idlength);
+        index_branch_append(root->arena, root->branches, branchkey, handle);
+    }
+
+    // keeping ordered index in sync, if it can't be
+    // updated, it's dropped instead of being incomplete
+    if(root->tree && index_tree_insert(root->tree, entry)) {
+        zdb_danger("[-] index: cannot update ordered index, disabling it");
+        index_tree_disable(root);
+    }
 
     // update statistics (if the key exists)
     // maybe it doesn't exists if it comes from a replay
@@ -209,6 +298,9 @@ index_entry_t *index_insert_memory_handler_memkey(index_root_t *root, index_set_
     root->nextentry += 1;
     root->nextid += 1;
 
+    // grow memory index if needed, one small step at a time
+    index_resize_step(root, INDEX_RESIZE_STEPS);
+
     return entry;
 }
 
@@ -371,6 +463,10 @@ index_entry_t *index_insert_entry_memkey(index_root_t *root, index_set_t *set) {
     // ensure flags are empty
     set->entry->flags = 0;
 
+    // data and index files jump together, the entry in memory uses
+    // the index id (see handler), the same is written on disk
+    set->entry->dataid = root->indexid;
+
     // append the data on the disk
     if(index_append_entry_on_disk(root, set)) {
         zdb_debug("[-] index: add new entry failed: could not write on disk\n");
@@ -10,8 +10,12 @@
     index_entry_t *index_set(index_root_t *root, index_set_t *new, index_entry_t *existing);
     index_entry_t *index_set_memory(index_root_t *root, void *id, index_entry_t *entry);
 
+    void index_batch_begin(index_root_t *root);
+    int index_batch_commit(index_root_t *root);
+
     index_item_t *index_item_from_set(index_root_t *root, index_set_t *set);
 
     // internal index append functions
     int index_append_entry_on_disk(index_root_t *root, index_set_t *set);
+    index_entry_t *index_insert_memory_handler_memkey(index_root_t *root, index_set_t *set);
 #endif
@@ -0,0 +1,543 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "libzdb.h"
+#include "libzdb_private.h"
+
+//
+// ordered index
+//
+// branches (or hashtable) only allow exact lookup, finding keys by prefix
+// or range needs to walk every entries, when enabled on a namespace, entries
+// are also kept in key order in a b+tree, next to the main memory index
+//
+// the tree doesn't own entries, leaves contains pointers to the entries
+// allocated by the index arena (entries are never moved), internal nodes
+// contains a copy of the first key of each child (except the first one),
+// this way releasing an entry never invalidate any separator
+//
+// keys are ordered like memcmp, a shorter key comes before a longer key
+// with the same prefix, leaves are linked to walk in order
+//
+// there is no rebalancing on removal, nodes are only released when they
+// are empty, when keys are appended in order (eg: tree built on load), the
+// split keeps the left node full, this keeps the tree compact
+//
+#define INDEX_TREE_LEAF(node)      ((index_tree_leaf_t *) (node))
+#define INDEX_TREE_INTERNAL(node)  ((index_tree_internal_t *) (node))
+
+int index_tree_compare(unsigned char *a, size_t alength, unsigned char *b, size_t blength) {
+    size_t length = (alength < blength) ? alength : blength;
+    int value;
+
+    if((value = memcmp(a, b, length)))
+        return value;
+
+    return (alength > blength) - (alength < blength);
+}
+
+static inline int index_tree_compare_entry(index_entry_t *entry, unsigned char *id, size_t idlength) {
+    return index_tree_compare(entry->id, entry->idlength, id, idlength);
+}
+
+static inline size_t index_tree_node_size(int leaf) {
+    return (leaf) ? sizeof(index_tree_leaf_t) : sizeof(index_tree_internal_t);
+}
+
+static index_tree_node_t *index_tree_node_new(index_tree_t *tree, int leaf) {
+    size_t size = index_tree_node_size(leaf);
+    index_tree_node_t *node;
+
+    if(!(node = calloc(size, 1)))
+        zdb_diep("index tree: node calloc");
+
+    node->leaf = leaf;
+    tree->size += size;
+
+    return node;
+}
+
+static index_tree_leaf_t *index_tree_leaf_new(index_tree_t *tree) {
+    return INDEX_TREE_LEAF(index_tree_node_new(tree, 1));
+}
+
+static index_tree_internal_t *index_tree_internal_new(index_tree_t *tree) {
+    return INDEX_TREE_INTERNAL(index_tree_node_new(tree, 0));
+}
+
+static void index_tree_node_free(index_tree_t *tree, index_tree_node_t *node) {
+    tree->size -= index_tree_node_size(node->leaf);
+    free(node);
+}
+
+static index_tree_key_t *index_tree_key_new(index_tree_t *tree, index_entry_t *entry) {
+    index_tree_key_t *key;
+
+    if(!(key = malloc(sizeof(index_tree_key_t) + entry->idlength)))
+        zdb_diep("index tree: key malloc");
+
+    key->length = entry->idlength;
+    memcpy(key->id, entry->id, entry->idlength);
+
+    tree->size += sizeof(index_tree_key_t) + key->length;
+
+    return key;
+}
+
+static void index_tree_key_free(index_tree_t *tree, index_tree_key_t *key) {
+    tree->size -= sizeof(index_tree_key_t) + key->length;
+    free(key);
+}
+
+index_tree_t *index_tree_new() {
+    index_tree_t *tree;
+
+    if(!(tree = calloc(sizeof(index_tree_t), 1))) {
+        zdb_warnp("index tree: calloc");
+        return NULL;
+    }
+
+    tree->root = index_tree_node_new(tree, 1);
+    tree->depth = 1;
+
+    return tree;
+}
+
+static void index_tree_node_release(index_tree_t *tree, index_tree_node_t *node) {
+    if(!node->leaf) {
+        index_tree_internal_t *internal = INDEX_TREE_INTERNAL(node);
+
+        for(int i = 0; i < node->length; i++) {
+            index_tree_node_release(tree, internal->children[i]);
+
+            if(i > 0)
+                index_tree_key_free(tree, internal->keys[i]);
+        }
+    }
+
+    index_tree_node_free(tree, node);
+}
+
+// remove everything, tree stays usable (empty)
+void index_tree_clean(index_tree_t *tree) {
+    index_tree_node_release(tree, tree->root);
+
+    tree->root = index_tree_node_new(tree, 1);
+    tree->length = 0;
+    tree->depth = 1;
+}
+
+void index_tree_free(index_tree_t *tree) {
+    if(!tree)
+        return;
+
+    index_tree_node_release(tree, tree->root);
+    free(tree);
+}
+
+// child of an internal node where a key could be
+// (last child with a lower bound less or equal to the key)
+static int index_tree_child(index_tree_internal_t *node, unsigned char *id, size_t idlength) {
+    int low = 1;
+    int high = node->header.length;
+
+    while(low < high) {
+        int middle = (low + high) / 2;
+        index_tree_key_t *key = node->keys[middle];
+
+        if(index_tree_compare(key->id, key->length, id, idlength) <= 0) {
+            low = middle + 1;
+
+        } else {
+            high = middle;
+        }
+    }
+
+    return low - 1;
+}
+
+// position of the first entry of a leaf not less than the key
+static int index_tree_position(index_tree_leaf_t *leaf, unsigned char *id, size_t idlength) {
+    int low = 0;
+    int high = leaf->header.length;
+
+    while(low < high) {
+        int middle = (low + high) / 2;
+
+        if(index_tree_compare_entry(leaf->entries[middle], id, idlength) < 0) {
+            low = middle + 1;
+
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+// walk down to the leaf where a key could be, internal nodes
+// crossed (and child followed) are kept on the path
+static index_tree_leaf_t *index_tree_descend(index_tree_t *tree, unsigned char *id, size_t idlength, index_tree_internal_t **path, int *slots, int *level) {
+    index_tree_node_t *node = tree->root;
+
+    *level = 0;
+
+    while(!node->leaf) {
+        index_tree_internal_t *internal = INDEX_TREE_INTERNAL(node);
+        int slot = index_tree_child(internal, id, idlength);
+
+        path[*level] = internal;
+        slots[*level] = slot;
+        *level += 1;
+
+        node = internal->children[slot];
+    }
+
+    return INDEX_TREE_LEAF(node);
+}
+
+// insert a new child (and it's lower bound) on an internal node,
+// if the node is full, it's splitted and the new node is returned
+// with the key to insert on the parent
+static index_tree_internal_t *index_tree_internal_insert(index_tree_t *tree, index_tree_internal_t *node, int slot, index_tree_node_t *child, index_tree_key_t **key, int append) {
+    if(node->header.length < INDEX_TREE_ORDER) {
+        int move = node->header.length - slot;
+
+        memmove(&node->children[slot + 1], &node->children[slot], move * sizeof(index_tree_node_t *));
+        memmove(&node->keys[slot + 1], &node->keys[slot], move * sizeof(index_tree_key_t *));
+
+        node->children[slot] = child;
+        node->keys[slot] = *key;
+        node->header.length += 1;
+
+        return NULL;
+    }
+
+    index_tree_node_t *children[INDEX_TREE_ORDER + 1];
+    index_tree_key_t *keys[INDEX_TREE_ORDER + 1];
+    index_tree_internal_t *right = index_tree_internal_new(tree);
+
+    memcpy(children, node->children, slot * sizeof(index_tree_node_t *));
+    memcpy(keys, node->keys, slot * sizeof(index_tree_key_t *));
+
+    children[slot] = child;
+    keys[slot] = *key;
+
+    memcpy(&children[slot + 1], &node->children[slot], (INDEX_TREE_ORDER - slot) * sizeof(index_tree_node_t *));
+    memcpy(&keys[slot + 1], &node->keys[slot], (INDEX_TREE_ORDER - slot) * sizeof(index_tree_key_t *));
+
+    int split = (append) ? INDEX_TREE_ORDER : (INDEX_TREE_ORDER + 1) / 2;
+
+    memcpy(node->children, children, split * sizeof(index_tree_node_t *));
+    memcpy(node->keys, keys, split * sizeof(index_tree_key_t *));
+    node->header.length = split;
+
+    right->header.length = INDEX_TREE_ORDER + 1 - split;
+    memcpy(right->children, &children[split], right->header.length * sizeof(index_tree_node_t *));
+    memcpy(right->keys, &keys[split], right->header.length * sizeof(index_tree_key_t *));
+
+    // lower bound of the first child moves to the parent
+    *key = right->keys[0];
+    right->keys[0] = NULL;
+
+    return right;
+}
+
+int index_tree_insert(index_tree_t *tree, index_entry_t *entry) {
+    index_tree_internal_t *path[INDEX_TREE_DEPTH];
+    int slots[INDEX_TREE_DEPTH];
+    int level;
+
+    index_tree_leaf_t *leaf = index_tree_descend(tree, entry->id, entry->idlength, path, slots, &level);
+    int position = index_tree_position(leaf, entry->id, entry->idlength);
+    int length = leaf->header.length;
+
+    // key already there, pointing to the new entry
+    if(position < length && index_tree_compare_entry(leaf->entries[position], entry->id, entry->idlength) == 0) {
+        leaf->entries[position] = entry;
+        return 0;
+    }
+
+    if(length < INDEX_TREE_ORDER) {
+        memmove(&leaf->entries[position + 1], &leaf->entries[position], (length - position) * sizeof(index_entry_t *));
+        leaf->entries[position] = entry;
+        leaf->header.length += 1;
+        tree->length += 1;
+
+        return 0;
+    }
+
+    // splitting the leaf, when appending after the last key
+    // of the tree, left node is kept full
+    index_entry_t *entries[INDEX_TREE_ORDER + 1];
+    int append = (position == length && leaf->next == NULL);
+    int split = (append) ? INDEX_TREE_ORDER : (INDEX_TREE_ORDER + 1) / 2;
+    index_tree_leaf_t *right;
+    index_tree_key_t *key;
+
+    // a split can grow the tree by one level
+    if(tree->depth >= INDEX_TREE_DEPTH) {
+        zdb_danger("[-] index tree: maximum depth reached");
+        return 1;
+    }
+
+    right = index_tree_leaf_new(tree);
+
+    memcpy(entries, leaf->entries, position * sizeof(index_entry_t *));
+    entries[position] = entry;
+    memcpy(&entries[position + 1], &leaf->entries[position], (INDEX_TREE_ORDER - position) * sizeof(index_entry_t *));
+
+    leaf->header.length = split;
+    memcpy(leaf->entries, entries, split * sizeof(index_entry_t *));
+
+    right->header.length = INDEX_TREE_ORDER + 1 - split;
+    memcpy(right->entries, &entries[split], right->header.length * sizeof(index_entry_t *));
+
+    key = index_tree_key_new(tree, right->entries[0]);
+
+    right->next = leaf->next;
+    right->previous = leaf;
+
+    if(leaf->next)
+        leaf->next->previous = right;
+
+    leaf->next = right;
+    tree->length += 1;
+
+    // inserting new node on parents, up to the root if needed
+    index_tree_node_t *child = &right->header;
+
+    while(level > 0) {
+        level -= 1;
+
+        index_tree_internal_t *splitted = index_tree_internal_insert(tree, path[level], slots[level] + 1, child, &key, append);
+
+        // parent had room, done
+        if(!splitted)
+            return 0;
+
+        child = &splitted->header;
+    }
+
+    // root was splitted, growing the tree
+    index_tree_internal_t *root = index_tree_internal_new(tree);
+
+    root->children[0] = tree->root;
+    root->children[1] = child;
+    root->keys[1] = key;
+    root->header.length = 2;
+
+    tree->root = &root->header;
+    tree->depth += 1;
+
+    return 0;
+}
+
+// remove a child from an internal node, with it's lower bound
+static void index_tree_internal_remove(index_tree_t *tree, index_tree_internal_t *node, int slot) {
+    int move = node->header.length - slot - 1;
+
+    memmove(&node->children[slot], &node->children[slot + 1], move * sizeof(index_tree_node_t *));
+
+    if(slot == 0) {
+        // second child becomes the first one, it's
+        // lower bound is not needed anymore
+        if(node->header.length > 1) {
+            index_tree_key_free(tree, node->keys[1]);
+            memmove(&node->keys[1], &node->keys[2], (move - 1) * sizeof(index_tree_key_t *));
+        }
+
+    } else {
+        index_tree_key_free(tree, node->keys[slot]);
+        memmove(&node->keys[slot], &node->keys[slot + 1], move * sizeof(index_tree_key_t *));
+    }
+
+    node->header.length -= 1;
+}
+
+int index_tree_remove(index_tree_t *tree, index_entry_t *entry) {
+    index_tree_internal_t *path[INDEX_TREE_DEPTH];
+    int slots[INDEX_TREE_DEPTH];
+    int level;
+
+    index_tree_leaf_t *leaf = index_tree_descend(tree, entry->id, entry->idlength, path, slots, &level);
+    int position = index_tree_position(leaf, entry->id, entry->idlength);
+
+    if(position == leaf->header.length || leaf->entries[position] != entry)
+        return 1;
+
+    memmove(&leaf->entries[position], &leaf->entries[position + 1], (leaf->header.length - position - 1) * sizeof(index_entry_t *));
+    leaf->header.length -= 1;
+    tree->length -= 1;
+
+    if(leaf->header.length > 0 || level == 0)
+        return 0;
+
+    // leaf is empty, unlinking and releasing it
+    if(leaf->previous)
+        leaf->previous->next = leaf->next;
+
+    if(leaf->next)
+        leaf->next->previous = leaf->previous;
+
+    index_tree_node_free(tree, &leaf->header);
+
+    // removing it from it's parent, and parents
+    // which becomes empty meanwhile
+    while(level > 0) {
+        level -= 1;
+
+        index_tree_internal_t *node = path[level];
+        index_tree_internal_remove(tree, node, slots[level]);
+
+        if(node->header.length > 0)
+            break;
+
+        if(level == 0) {
+            // everything removed, root is a leaf again
+            index_tree_node_free(tree, &node->header);
+
+            tree->root = index_tree_node_new(tree, 1);
+
+            tree->depth = 1;
+            return 0;
+        }
+
+        index_tree_node_free(tree, &node->header);
+    }
+
+    // shrinking the tree while root has a single child
+    while(!tree->root->leaf && tree->root->length == 1) {
+        index_tree_node_t *root = tree->root;
+
+        tree->root = INDEX_TREE_INTERNAL(root)->children[0];
+        tree->depth -= 1;
+
+        index_tree_node_free(tree, root);
+    }
+
+    return 0;
+}
+
+static index_entry_t *index_tree_current(index_tree_cursor_t *cursor) {
+    // end of the leaf reached, jumping to the next one
+    while(cursor->leaf && cursor->position >= cursor->leaf->header.length) {
+        cursor->leaf = cursor->leaf->next;
+        cursor->position = 0;
+    }
+
+    if(!cursor->leaf)
+        return NULL;
+
+    return cursor->leaf->entries[cursor->position];
+}
+
+// set the cursor on the first entry not less than the key
+// and returns this entry (NULL if there are none)
+index_entry_t *index_tree_seek(index_tree_t *tree, index_tree_cursor_t *cursor, unsigned char *id, size_t idlength) {
+    index_tree_node_t *node = tree->root;
+
+    while(!node->leaf) {
+        index_tree_internal_t *internal = INDEX_TREE_INTERNAL(node);
+        node = internal->children[index_tree_child(internal, id, idlength)];
+    }
+
+    cursor->leaf = INDEX_TREE_LEAF(node);
+    cursor->position = index_tree_position(cursor->leaf, id, idlength);
+
+    return index_tree_current(cursor);
+}
+
+// move the cursor to the next entry and returns it
+index_entry_t *index_tree_next(index_tree_cursor_t *cursor) {
+    if(!cursor->leaf)
+        return NULL;
+
+    cursor->position += 1;
+
+    return index_tree_current(cursor);
+}
+
+//
+// enabling ordered index on an index already loaded
+//
+typedef struct index_tree_build_t {
+    index_entry_t **entries;
+    size_t length;
+    size_t allocated;
+
+} index_tree_build_t;
+
+static int index_tree_build_walker(index_entry_t *entry, void *userptr) {
+    index_tree_build_t *build = (index_tree_build_t *) userptr;
+
+    // should not happen, amount of entries is known
+    if(build->length == build->allocated)
+        return 1;
+
+    build->entries[build->length++] = entry;
+
+    return 0;
+}
+
+static int index_tree_build_compare(const void *a, const void *b) {
+    index_entry_t *x = *(index_entry_t **) a;
+    index_entry_t *y = *(index_entry_t **) b;
+
+    return index_tree_compare(x->id, x->idlength, y->id, y->idlength);
+}
+
+// build the ordered index from entries in memory, entries are sorted
+// first, appending them in order keeps nodes full
+int index_tree_enable(index_root_t *root) {
+    index_tree_build_t build = {
+        .entries = NULL,
+        .length = 0,
+        .allocated = root->stats.entries,
+    };
+
+    if(root->tree)
+        return 0;
+
+    zdb_debug("[+] index: building ordered index (%lu entries)\n", root->stats.entries);
+
+    if(!(root->tree = index_tree_new()))
+        return 1;
+
+    // sequential mode doesn't keep entries in memory
+    if(root->mode != ZDB_MODE_KEY_VALUE)
+        return 0;
+
+    if(build.allocated == 0)
+        return 0;
+
+    if(!(build.entries = malloc(sizeof(index_entry_t *) * build.allocated))) {
+        zdb_warnp("index tree: build malloc");
+        index_tree_disable(root);
+        return 1;
+    }
+
+    index_walk(root, index_tree_build_walker, &build);
+    qsort(build.entries, build.length, sizeof(index_entry_t *), index_tree_build_compare);
+
+    for(size_t i = 0; i < build.length; i++) {
+        if(index_tree_insert(root->tree, build.entries[i])) {
+            free(build.entries);
+            index_tree_disable(root);
+            return 1;
+        }
+    }
+
+    free(build.entries);
+
+    zdb_debug("[+] index: ordered index: %lu entries, depth %u, %.2f KB\n",
+              root->tree->length, root->tree->depth, KB(root->tree->size));
+
+    return 0;
+}
+
+void index_tree_disable(index_root_t *root) {
+    index_tree_free(root->tree);
+    root->tree = NULL;
+}
@@ -0,0 +1,29 @@
+#ifndef __ZDB_INDEX_TREE_H
+    #define __ZDB_INDEX_TREE_H
+
+    // maximum depth of the tree, with 64 entries per node and at least
+    // two children per internal node, this is way more than needed
+    #define INDEX_TREE_DEPTH  32
+
+    // position of a walk over the tree, in key order
+    typedef struct index_tree_cursor_t {
+        index_tree_leaf_t *leaf;
+        int position;
+
+    } index_tree_cursor_t;
+
+    index_tree_t *index_tree_new();
+    void index_tree_free(index_tree_t *tree);
+    void index_tree_clean(index_tree_t *tree);
+
+    int index_tree_compare(unsigned char *a, size_t alength, unsigned char *b, size_t blength);
+
+    int index_tree_insert(index_tree_t *tree, index_entry_t *entry);
+    int index_tree_remove(index_tree_t *tree, index_entry_t *entry);
+
+    index_entry_t *index_tree_seek(index_tree_t *tree, index_tree_cursor_t *cursor, unsigned char *id, size_t idlength);
+    index_entry_t *index_tree_next(index_tree_cursor_t *cursor);
+
+    int index_tree_enable(index_root_t *root);
+    void index_tree_disable(index_root_t *root);
+#endif
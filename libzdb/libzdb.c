@@ -23,6 +23,12 @@ zdb_settings_t zdb_rootsettings = {
     .sync = 0,
     .synctime = 0,
     .mode = ZDB_MODE_KEY_VALUE,
+    .engine = ZDB_INDEX_BRANCHES,
+    .loadthreads = ZDB_DEFAULT_LOADTHREADS,
+    .fdcache = ZDB_DEFAULT_FDCACHE,
+    .datacache = ZDB_DEFAULT_DATACACHE,
+    .seqtable = 0,
+    .seqmmap = 0,
     .hook = NULL,
     .datasize = ZDB_DEFAULT_DATA_MAXSIZE,
     .maxsize = 0,
@@ -130,13 +136,14 @@ void zdb_timelog(FILE *fp) {
 }
 
 char *zdb_header_date(uint32_t epoch, char *target, size_t length) {
-    struct tm *timeval;
+    struct tm timeval;
     time_t unixtime;
 
     unixtime = epoch;
 
-    timeval = localtime(&unixtime);
-    strftime(target, length, "%F %T", timeval);
+    // reentrant version, can be called by namespaces loader threads
+    localtime_r(&unixtime, &timeval);
+    strftime(target, length, "%F %T", &timeval);
 
     return target;
 }
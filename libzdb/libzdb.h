@@ -4,6 +4,7 @@
     #include <stdint.h>
     #include <time.h>
     #include <sys/time.h>
+    #include <pthread.h>
     #include "hook.h"
 
     #ifndef ZDB_REVISION
@@ -12,6 +13,7 @@
 
     #define ZDB_DEFAULT_DATAPATH    "./zdb-data"
     #define ZDB_DEFAULT_INDEXPATH   "./zdb-index"
+    #define ZDB_DEFAULT_LOADTHREADS 4
 
     #define ZDB_PATH_MAX    4096
 
@@ -58,6 +60,8 @@
         uint64_t datawritefailed; // amount of data payload disk write failure
         uint64_t datadiskread;    // amount of data bytes read on disk (except index loader)
         uint64_t datadiskwrite;   // amount of data bytes written on disk (except namespace creation)
+        uint64_t datacachehit;    // amount of payload served from values cache
+        uint64_t datacachemiss;   // amount of payload read from datafiles
 
         uint32_t childwait;       // amount of hook child pending
 
@@ -71,6 +75,12 @@
         int sync;          // force to sync each write
         int synctime;      // force to sync writes after this period (in seconds)
         int mode;          // default index running mode (should be index_mode_t)
+        int engine;        // in-memory index engine (should be index_engine_t)
+        int loadthreads;   // amount of threads used to load index files on startup
+        int fdcache;       // amount of older files kept opened per namespace
+        size_t datacache;  // values cache size (in bytes) shared by namespaces
+        int seqtable;      // keep sequential index entries in memory
+        int seqmmap;       // map sealed sequential index files
         char *hook;        // external hook script to execute
         size_t datasize;   // maximum datafile size before jumping to next one
         size_t maxsize;    // default namespace maximum datasize
@@ -147,15 +157,25 @@
     #define GB(x)   (x / (1024 * 1024 * 1024.0))
     #define TB(x)   (x / (1024 * 1024 * 1024 * 1024.0))
 
+    // statistics counters updated on read paths, which can be
+    // reached by several threads at the same time
+    #define zdb_atomic_add(target, value) __atomic_add_fetch(&(target), (value), __ATOMIC_RELAXED)
+
+    #include "fdcache.h"
+    #include "datacache.h"
     #include "data.h"
     #include "filesystem.h"
     #include "index.h"
     #include "index_branch.h"
+    #include "index_hash.h"
+    #include "index_arena.h"
+    #include "index_checkpoint.h"
     #include "index_get.h"
     #include "index_loader.h"
     #include "index_scan.h"
     #include "index_seq.h"
     #include "index_set.h"
+    #include "index_tree.h"
     #include "namespace.h"
     #include "settings.h"
     #include "bootstrap.h"
@@ -10,6 +10,7 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <time.h>
+#include <pthread.h>
 #include "libzdb.h"
 #include "libzdb_private.h"
 
@@ -85,6 +86,12 @@ void namespace_descriptor_update(namespace_t *namespace, int fd) {
     if(namespace->worm)
         header.flags |= NS_FLAGS_WORM;
 
+    if(!namespace->cache)
+        header.flags |= NS_FLAGS_NOCACHE;
+
+    if(namespace->ordered)
+        header.flags |= NS_FLAGS_ORDERED;
+
     if(write(fd, &header, sizeof(ns_header_legacy_t)) != sizeof(ns_header_legacy_t))
         zdb_warnp("namespace legacy header write");
 
@@ -198,6 +205,8 @@ static int namespace_descriptor_load(namespace_t *namespace) {
     namespace->maxsize = extended.maxsize;
     namespace->public = (header.flags & NS_FLAGS_PUBLIC);
     namespace->worm = (header.flags & NS_FLAGS_WORM);
+    namespace->cache = !(header.flags & NS_FLAGS_NOCACHE);
+    namespace->ordered = (header.flags & NS_FLAGS_ORDERED) ? 1 : 0;
     namespace->version = extended.version;
 
     if(header.passlength) {
@@ -218,6 +227,8 @@ static int namespace_descriptor_load(namespace_t *namespace) {
     zdb_debug("[+] -> password protection: %s\n", namespace->password ? "yes" : "no");
     zdb_debug("[+] -> public access: %s\n", namespace->public ? "yes" : "no");
     zdb_debug("[+] -> worm mode: %s\n", namespace->worm ? "yes" : "no");
+    zdb_debug("[+] -> values cache: %s\n", namespace->cache ? "yes" : "no");
+    zdb_debug("[+] -> ordered index: %s\n", namespace->ordered ? "yes" : "no");
 
     close(fd);
 
@@ -274,8 +285,12 @@ namespace_t *namespace_ensure(namespace_t *namespace) {
 static int namespace_load_lazy(ns_root_t *nsroot, namespace_t *namespace) {
     // now, we are sure the namespace exists, but it could be empty
     // let's call index and data initializer, they will take care of that
-    namespace->index = index_init(nsroot->settings, namespace->indexpath, namespace, nsroot->branches);
+    namespace->index = index_init(nsroot->settings, namespace->indexpath, namespace);
     namespace->data = data_init(nsroot->settings, namespace->datapath, namespace->index->indexid);
+    data_cache_admission(namespace->data, namespace->cache);
+
+    if(namespace->ordered)
+        index_tree_enable(namespace->index);
 
     return 0;
 }
@@ -298,6 +313,8 @@ namespace_t *namespace_load_light(ns_root_t *nsroot, char *name, int ensure) {
     namespace->datapath = namespace_path(nsroot->settings->datapath, name);
     namespace->public = 1;  // by default, namespaces are public (no password)
     namespace->worm = 0;    // by default, worm mode is disabled
+    namespace->cache = 1;   // by default, values are cached
+    namespace->ordered = 0; // by default, keys are not ordered
     namespace->maxsize = 0; // by default, there are no limits
     namespace->idlist = 0;  // by default, no list is set
 
@@ -429,7 +446,80 @@ int namespace_valid_name(char *name) {
 //
 // scan the index directories and load any namespaces found
 //
+//
+// namespaces are independent (each one owns it's own index, memory
+// index and data), extra namespaces are loaded concurrently by a small
+// pool of threads, then committed to the main list in directory order
+//
+// note: global statistics counters updated during loading are not
+//       protected, they are only informative
+//
+typedef struct ns_loader_t {
+    ns_root_t *root;
+    char **names;            // namespaces names to load
+    namespace_t **loaded;    // loaded namespaces, same position as names
+    size_t length;           // amount of namespaces to load
+    size_t next;             // next namespace to pick
+    pthread_mutex_t lock;    // protect next
+
+} ns_loader_t;
+
+static void *namespace_loader_worker(void *args) {
+    ns_loader_t *loader = (ns_loader_t *) args;
+
+    while(1) {
+        pthread_mutex_lock(&loader->lock);
+        size_t index = loader->next++;
+        pthread_mutex_unlock(&loader->lock);
+
+        if(index >= loader->length)
+            break;
+
+        loader->loaded[index] = namespace_load(loader->root, loader->names[index]);
+    }
+
+    return NULL;
+}
+
+static void namespace_loader_run(ns_loader_t *loader, int threads) {
+    pthread_t *workers;
+
+    if((size_t) threads > loader->length)
+        threads = loader->length;
+
+    pthread_mutex_init(&loader->lock, NULL);
+
+    // nothing to gain, loading everything directly
+    if(threads < 2) {
+        namespace_loader_worker(loader);
+        pthread_mutex_destroy(&loader->lock);
+        return;
+    }
+
+    if(!(workers = calloc(sizeof(pthread_t), threads)))
+        zdb_diep("namespaces: loader: calloc");
+
+    zdb_debug("[+] namespaces: loading %lu namespaces using %d threads\n", loader->length, threads);
+
+    for(int i = 0; i < threads; i++)
+        if(pthread_create(&workers[i], NULL, namespace_loader_worker, loader))
+            zdb_diep("namespaces: loader: pthread_create");
+
+    for(int i = 0; i < threads; i++)
+        pthread_join(workers[i], NULL);
+
+    pthread_mutex_destroy(&loader->lock);
+    free(workers);
+}
+
 static int namespace_scanload(ns_root_t *root) {
+    ns_loader_t loader = {
+        .root = root,
+        .names = NULL,
+        .loaded = NULL,
+        .length = 0,
+        .next = 0,
+    };
     int loaded = 0;
     struct dirent *ep;
     DIR *dp;
@@ -447,18 +537,33 @@ static int namespace_scanload(ns_root_t *root) {
 
         zdb_debug("[+] namespaces: extra found: %s\n", ep->d_name);
 
-        // load the namespace
-        namespace_t *namespace;
-        if(!(namespace = namespace_load(root, ep->d_name)))
-            continue;
+        if(!(loader.names = realloc(loader.names, sizeof(char *) * (loader.length + 1))))
+            zdb_diep("namespaces: scanload: realloc");
 
-        // commit to the main list
-        namespace_push(root, namespace);
-        loaded += 1;
+        loader.names[loader.length++] = strdup(ep->d_name);
     }
 
     closedir(dp);
 
+    if(!(loader.loaded = calloc(sizeof(namespace_t *), loader.length + 1)))
+        zdb_diep("namespaces: scanload: calloc");
+
+    // load the namespaces
+    namespace_loader_run(&loader, root->settings->loadthreads);
+
+    for(size_t i = 0; i < loader.length; i++) {
+        // commit to the main list
+        if(loader.loaded[i]) {
+            namespace_push(root, loader.loaded[i]);
+            loaded += 1;
+        }
+
+        free(loader.names[i]);
+    }
+
+    free(loader.names);
+    free(loader.loaded);
+
     zdb_verbose("[+] namespaces: %d extra namespaces loaded\n", loaded);
 
     return loaded;
@@ -470,9 +575,8 @@ static int namespace_scanload(ns_root_t *root) {
 // the index and data, and prepare everything for a working system
 //
 // previously, there was only one index and one data set, now for each
-// namespace, we load each of them separatly, but keep only one big index
-// in memory (because he use a big initial array, we can't keep lot of them)
-// and keep a reference to the namespace for each entry
+// namespace, we load each of them separatly, each index owns it's own
+// memory index, sized on the amount of keys of that namespace
 //
 // because this is the first entry point, this will be the only place where
 // we know everything about index and data, so we keep every pointer and allocation
@@ -490,26 +594,19 @@ ns_root_t *namespaces_allocate(zdb_settings_t *settings) {
     root->length = 1;             // we start with the default one, only
     root->effective = 1;          // no namespace has been loaded yet
     root->settings = settings;    // keep the reference to the settings, needed for paths
-    root->branches = NULL;        // maybe we don't need the branches, see below
 
     if(!(root->namespaces = (namespace_t **) malloc(sizeof(namespace_t *) * root->length)))
         zdb_diep("namespace malloc");
 
-    // allocating (if needed, only some modes need it) the big (single) index branches
-    if(settings->mode == ZDB_MODE_KEY_VALUE || settings->mode == ZDB_MODE_MIX) {
-        zdb_debug("[+] namespaces: pre-allocating index (%d lazy branches)\n", buckets_branches);
-
-        // allocating minimal branches array
-        if(!(root->branches = index_buckets_init()))
-            zdb_diep("buckets allocation");
-    }
-
     return root;
 }
 
 int namespaces_init(zdb_settings_t *settings) {
     zdb_verbose("[+] namespaces: initializing\n");
 
+    // values cache shared by all namespaces
+    datacache_init(settings->datacache);
+
     // allocating global namespaces
     nsroot = namespaces_allocate(settings);
 
@@ -535,19 +632,6 @@ void namespace_free(namespace_t *namespace) {
 // this is called when we receive a graceful exit request
 // let's clean all indices, data and namespace arrays
 int namespaces_destroy() {
-    // freeing the big index buffer
-    // since branches want an index as argument, let's use
-    // the first namespace (default), since they all share
-    // the same buffer
-    if(nsroot->branches) {
-        zdb_debug("[+] namespaces: cleaning branches\n");
-        for(uint32_t b = 0; b < buckets_branches; b++)
-            index_branch_free(nsroot->namespaces[0]->index->branches, b);
-
-        // freeing the big index array
-        free(nsroot->branches);
-    }
-
     // freeing each namespace's index and data buffers
     zdb_debug("[+] namespaces: cleaning index and data\n");
 
@@ -565,6 +649,7 @@ int namespaces_destroy() {
 
     // clean globally allocated index stuff
     index_destroy_global();
+    datacache_destroy();
 
     // freeing internal namespaces support
     free(nsroot->namespaces);
@@ -15,6 +15,8 @@
         NS_FLAGS_PUBLIC = 1,   // public read-only namespace
         NS_FLAGS_WORM = 2,     // worm mode enabled or not
         NS_FLAGS_EXTENDED = 4, // extended header is present
+        NS_FLAGS_NOCACHE = 8,  // values not admitted on values cache
+        NS_FLAGS_ORDERED = 16, // ordered index enabled
 
     } ns_flags_t;
 
@@ -66,6 +68,8 @@
         ns_lock_t locked;      // set namespace read/write temporary status
         char worm;             // worm mode (write only read multiple)
                                // this mode disable overwrite/deletion
+        char cache;            // values read are admitted on values cache
+        char ordered;          // keys are kept ordered in memory (prefix and range lookup)
 
     } namespace_t;
 
@@ -74,14 +78,6 @@
         size_t effective;          // amount of namespaces currently loaded
         namespace_t **namespaces;  // pointers to namespaces
         zdb_settings_t *settings;  // global settings reminder
-        index_branch_t **branches; // unique global branches list
-
-        // as explained in namespace.c, we keep a single big
-        // index which that contains everything (all namespaces together)
-        //
-        // for each index structure, we will point the branches to the
-        // same big index branches all the time, this is why we keep
-        // this one here, as the 'original one'
 
     } ns_root_t;
 
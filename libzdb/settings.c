@@ -15,6 +15,11 @@ static char *zdb_modes[] = {
     "mixed mode",
 };
 
+static char *zdb_engines[] = {
+    "branches",
+    "hashtable",
+};
+
 //
 // public settings accessor
 //
@@ -34,6 +39,14 @@ char *zdb_running_mode(index_mode_t mode) {
     return zdb_modes[mode];
 }
 
+// returns in-memory index engine in readable string
+char *zdb_index_engine(index_engine_t engine) {
+    if(engine > (sizeof(zdb_engines) / sizeof(char *)) - 1)
+        return "unsupported engine";
+
+    return zdb_engines[engine];
+}
+
 // returns zdb string id
 char *zdb_id() {
     if(!zdb_rootsettings.zdbid)
@@ -7,6 +7,7 @@
     char *zdb_revision();
 
     char *zdb_running_mode(index_mode_t mode);
+    char *zdb_index_engine(index_engine_t engine);
 
     char *zdb_id();
     char *zdb_id_set(char *id);
@@ -39,10 +39,20 @@ sleep 1
 rm -rf /tmp/zdbtest
 
 # starting test suite with small datasize, generating lot of file jump
-./zdbd/zdb --background --verbose --socket /tmp/zdb.sock --data /tmp/zdbtest/ --index /tmp/zdbtest/ --hook /bin/true --datasize 32
+# (payloads on sealed files are read by the read pool)
+./zdbd/zdb --background --verbose --socket /tmp/zdb.sock --data /tmp/zdbtest/ --index /tmp/zdbtest/ --hook /bin/true --datasize 32 --checkpoint 1 --fd-cache 2 --cache-size 65536 --read-threads 2
 ./tests/zdbtests
 sleep 1
 
+# reload lot of files, serial and parallel loader
+./zdbd/zdb --verbose --data /tmp/zdbtest/ --index /tmp/zdbtest/ --dump --load-threads 1
+./zdbd/zdb --verbose --data /tmp/zdbtest/ --index /tmp/zdbtest/ --dump --load-threads 8
+./zdbd/zdb --data /tmp/zdbtest/ --index /tmp/zdbtest/ --dump --load-threads 0 || true
+
+# reload without checkpoint (full replay)
+rm -f /tmp/zdbtest/*/zdb-checkpoint
+./zdbd/zdb --verbose --data /tmp/zdbtest/ --index /tmp/zdbtest/ --dump
+
 # cleaning stuff again
 rm -rf /tmp/zdbtest
 
@@ -50,6 +60,8 @@ rm -rf /tmp/zdbtest
 ./zdbd/zdb --background --verbose --socket /tmp/zdb.sock --data /tmp/zdbtest/ --index /tmp/zdbtest/ \
     --admin protect \
     --synctime 10 \
+    --group-commit 100 \
+    --threads 2 \
     --mode user
 
 ./tests/zdbtests
@@ -59,9 +71,11 @@ rm -rf /tmp/zdbtest
 
 # launch tcp testsuite
 # by the way, separate data and index directories
+# and io_uring event backend (epoll if not supported)
 ./zdbd/zdb --background --verbose --data /tmp/zdbtest-data/ --index /tmp/zdbtest-index/ --admin root \
   --logfile /tmp/zdb.logs \
   --listen 127.0.0.1 --port 9900 \
+  --io-uring \
   --sync
 
 ./tests/zdbtests
@@ -96,11 +110,40 @@ rm -rf /tmp/zdbtest
 ./zdbd/zdb --data /tmp/zdbtest --index /tmp/zdbtest --dump --mode nonexist || true
 rm -rf /tmp/zdbtest
 
+# trying non existing index engine
+./zdbd/zdb --data /tmp/zdbtest --index /tmp/zdbtest --dump --index-engine nonexist || true
+rm -rf /tmp/zdbtest
+
+# run tests with hashtable index engine, on multiple reactors
+./zdbd/zdb --background --verbose --socket /tmp/zdb.sock --data /tmp/zdbtest --index /tmp/zdbtest --index-engine hashtable --threads 4
+./tests/zdbtests
+sleep 1
+
+# reload database with hashtable index engine
+./zdbd/zdb --verbose --data /tmp/zdbtest --index /tmp/zdbtest --index-engine hashtable --dump
+rm -rf /tmp/zdbtest
+
 # run tests in sequential mode
 ./zdbd/zdb --background --socket /tmp/zdb.sock --data /tmp/zdbtest --index /tmp/zdbtest --mode seq
 ./tests/zdbtests
 
 # reload sequential database
 ./zdbd/zdb --socket /tmp/zdb.sock --data /tmp/zdbtest --index /tmp/zdbtest --mode seq --dump
+rm -rf /tmp/zdbtest
+
+# run tests in sequential mode, entries kept in memory
+./zdbd/zdb --background --socket /tmp/zdb.sock --data /tmp/zdbtest --index /tmp/zdbtest --mode seq --seq-table
+./tests/zdbtests
+
+# reload sequential database, table built on load
+./zdbd/zdb --socket /tmp/zdb.sock --data /tmp/zdbtest --index /tmp/zdbtest --mode seq --seq-table --dump
+rm -rf /tmp/zdbtest
+
+# run tests in sequential mode, lot of sealed index files mapped
+./zdbd/zdb --background --socket /tmp/zdb.sock --data /tmp/zdbtest --index /tmp/zdbtest --mode seq --seq-mmap --datasize 32
+./tests/zdbtests
+
+# reload sequential database, sealed files mapped on load
+./zdbd/zdb --socket /tmp/zdb.sock --data /tmp/zdbtest --index /tmp/zdbtest --mode seq --seq-mmap --dump
 
 echo "All tests done."
@@ -170,6 +170,22 @@ runtest_prio(110, default_del_hello_seq) {
     return zdb_result(reply, TEST_SUCCESS);
 }
 
+runtest_prio(110, default_get_deleted_seq) {
+    if(test->mode == USERKEY)
+        return TEST_SKIPPED;
+
+    redisReply *reply;
+    uint32_t key = 0;
+
+    if(!(reply = redisCommand(test->zdb, "GET %b", &key, sizeof(key))))
+        return zdb_result(reply, TEST_FAILED_FATAL);
+
+    if(reply->type != REDIS_REPLY_NIL)
+        return zdb_result(reply, TEST_FAILED);
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
 runtest_prio(110, default_set_hello_again_seq) {
     if(test->mode == USERKEY)
         return TEST_SKIPPED;
@@ -254,6 +270,24 @@ runtest_prio(115, simple_overwrite_longer) {
     return overwrite(test, "overwrite_longer", "original", "newvaluelonger");
 }
 
+// value read (and cached) before being overwritten
+runtest_prio(115, simple_overwrite_cached) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    if(zdb_set(test, "overwrite_cached", "original") != TEST_SUCCESS)
+        return TEST_FAILED;
+
+    for(int i = 0; i < 2; i++)
+        if(zdb_check(test, "overwrite_cached", "original") != TEST_SUCCESS)
+            return TEST_FAILED;
+
+    if(zdb_set(test, "overwrite_cached", "newvalue") != TEST_SUCCESS)
+        return TEST_FAILED;
+
+    return zdb_check(test, "overwrite_cached", "newvalue");
+}
+
 runtest_prio(115, simple_overwrite_same_value) {
     if(test->mode == SEQUENTIAL)
         return TEST_SKIPPED;
@@ -272,6 +306,161 @@ runtest_prio(115, simple_overwrite_same_value) {
     return zdb_result(reply, TEST_SUCCESS);
 }
 
+//
+// multi-keys commands (MSET, MGET, MDEL)
+//
+runtest_prio(116, multi_mset) {
+    const char *argv[] = {"MSET", "multi-1", "hello", "multi-2", "world", "multi-3", ""};
+
+    if(test->mode == SEQUENTIAL)
+        return zdb_command_error(test, argvsz(argv), argv);
+
+    return zdb_command(test, argvsz(argv), argv);
+}
+
+runtest_prio(116, multi_mset_missing_value) {
+    const char *argv[] = {"MSET", "multi-1", "hello", "multi-2"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(116, multi_mset_duplicate) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"MSET", "multi-dup", "first", "multi-dup", "second"};
+
+    if(zdb_command(test, argvsz(argv), argv) != TEST_SUCCESS)
+        return TEST_FAILED;
+
+    return zdb_check(test, "multi-dup", "second");
+}
+
+runtest_prio(116, multi_mget) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"MGET", "multi-2", "multi-unknown", "multi-1", "multi-3"};
+    redisReply *reply;
+
+    if(!(reply = redisCommandArgv(test->zdb, argvsz(argv), argv, NULL)))
+        return zdb_result(reply, TEST_FAILED_FATAL);
+
+    if(reply->type != REDIS_REPLY_ARRAY || reply->elements != 4)
+        return zdb_result(reply, TEST_FAILED);
+
+    if(reply->element[0]->type != REDIS_REPLY_STRING || strcmp(reply->element[0]->str, "world"))
+        return zdb_result(reply, TEST_FAILED);
+
+    if(reply->element[1]->type != REDIS_REPLY_NIL)
+        return zdb_result(reply, TEST_FAILED);
+
+    if(reply->element[2]->type != REDIS_REPLY_STRING || strcmp(reply->element[2]->str, "hello"))
+        return zdb_result(reply, TEST_FAILED);
+
+    if(reply->element[3]->type != REDIS_REPLY_STRING || reply->element[3]->len != 0)
+        return zdb_result(reply, TEST_FAILED);
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+runtest_prio(116, multi_mget_missing_args) {
+    const char *argv[] = {"MGET"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(116, multi_mdel) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"MDEL", "multi-1", "multi-unknown", "multi-2", "multi-1"};
+    long long value = zdb_command_integer(test, argvsz(argv), argv);
+
+    if(value == 2)
+        return TEST_SUCCESS;
+
+    return TEST_FAILED;
+}
+
+runtest_prio(116, multi_mdel_check) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"GET", "multi-1"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+//
+// ranged reads (GETRANGE)
+// value "helloworld", key noupdate (user-key) or 2 (sequential)
+//
+static int getrange_check(test_t *test, char *offset, char *length, char *expected) {
+    redisReply *reply;
+    uint32_t seqkey = 2;
+    void *key = "noupdate";
+    size_t keylen = strlen("noupdate");
+
+    if(test->mode == SEQUENTIAL) {
+        key = &seqkey;
+        keylen = sizeof(uint32_t);
+    }
+
+    if(!(reply = redisCommand(test->zdb, "GETRANGE %b %s %s", key, keylen, offset, length)))
+        return zdb_result(reply, TEST_FAILED_FATAL);
+
+    if(reply->type != REDIS_REPLY_STRING) {
+        log("%s\n", reply->str);
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    if(reply->len != strlen(expected) || memcmp(reply->str, expected, reply->len))
+        return zdb_result(reply, TEST_FAILED);
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+runtest_prio(117, range_window) {
+    return getrange_check(test, "5", "3", "wor");
+}
+
+runtest_prio(117, range_head) {
+    return getrange_check(test, "0", "5", "hello");
+}
+
+runtest_prio(117, range_truncated) {
+    return getrange_check(test, "5", "4096", "world");
+}
+
+runtest_prio(117, range_after_end) {
+    return getrange_check(test, "10", "4", "");
+}
+
+runtest_prio(117, range_empty) {
+    return getrange_check(test, "2", "0", "");
+}
+
+runtest_prio(117, range_invalid) {
+    const char *argv[] = {"GETRANGE", "noupdate", "-1", "4"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(117, range_invalid_length) {
+    const char *argv[] = {"GETRANGE", "noupdate", "0", "abc"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(117, range_missing_args) {
+    const char *argv[] = {"GETRANGE", "noupdate", "0"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(117, range_notfound) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"GETRANGE", "multi-1", "0", "4"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
 runtest_prio(110, default_set_empty_key) {
     if(test->mode == SEQUENTIAL)
         return TEST_SKIPPED;
@@ -84,8 +84,8 @@ runtest_prio(sp, lowlevel_too_many_arguments) {
     if(test->type != CONNECTION_TYPE_TCP)
         return TEST_SKIPPED;
 
-    // too many argument
-    strcpy(buffer, "*32\r\n");
+    // too many argument (see REDIS_MAX_ARGUMENTS)
+    strcpy(buffer, "*65536\r\n");
 
     return lowlevel_send_invalid(test, buffer, sizeof(buffer));
 }
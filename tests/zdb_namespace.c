@@ -298,6 +298,17 @@ runtest_prio(sp, namespace_nsset_unknown_property) {
     return zdb_command_error(test, argvsz(argv), argv);
 }
 
+// disable and enable back values cache
+runtest_prio(sp, namespace_nsset_cache_disable) {
+    const char *argv[] = {"NSSET", namespace_created, "cache", "0"};
+    return zdb_command(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, namespace_nsset_cache_enable) {
+    const char *argv[] = {"NSSET", namespace_created, "cache", "1"};
+    return zdb_command(test, argvsz(argv), argv);
+}
+
 // nsset on long value
 runtest_prio(sp, namespace_nsset_long_value_light) {
     const char value[120] = {0};
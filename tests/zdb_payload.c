@@ -123,6 +123,41 @@ runtest_prio(sp, payload_set_8m) {
     return set_fixed_payload(test, 8);
 }
 
+// payload larger than 8 MB is streamed to the datafile, only in
+// key-value mode (even if larger than a datafile), in sequential
+// mode the payload is discarded and the client can keep going
+runtest_prio(sp, payload_set_12m_stream) {
+    size_t length = 12 * 1024 * 1024;
+    redisReply *reply;
+    char *payload;
+
+    if(!(payload = malloc(length)))
+        return TEST_FAILED_FATAL;
+
+    memset(payload, 0x42, length);
+
+    reply = redisCommand(test->zdb, "SET %s %b", "data-stream", payload, length);
+    free(payload);
+
+    if(!reply)
+        return TEST_FAILED_FATAL;
+
+    if(test->mode == SEQUENTIAL) {
+        if(reply->type != REDIS_REPLY_ERROR || strcmp(reply->str, "Payload too big"))
+            return zdb_result(reply, TEST_FAILED);
+
+        freeReplyObject(reply);
+
+        const char *argv[] = {"PING"};
+        return zdb_command(test, argvsz(argv), argv);
+    }
+
+    if(reply->type != REDIS_REPLY_STRING || strcmp(reply->str, "data-stream"))
+        return zdb_result(reply, TEST_FAILED);
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
 /*
 // client is disconnected if payload is too big
 //
@@ -175,3 +210,91 @@ runtest_prio(sp, payload_get_8m) {
 }
 
 
+runtest_prio(sp, payload_get_12m_stream) {
+    redisReply *reply;
+
+    // payload was not accepted (see payload_set_12m_stream)
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    if(!(reply = redisCommand(test->zdb, "GET %s", "data-stream")))
+        return TEST_FAILED_FATAL;
+
+    if(reply->type != REDIS_REPLY_STRING || reply->len != 12 * 1024 * 1024)
+        return zdb_result(reply, TEST_FAILED);
+
+    if(reply->str[0] != 0x42 || reply->str[reply->len - 1] != 0x42)
+        return zdb_result(reply, TEST_FAILED);
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+// window of a large payload, in the middle, large
+// enough to be sent from the datafile
+runtest_prio(sp, payload_getrange_8m) {
+    redisReply *reply;
+    uint32_t index = 8;
+    char key[64];
+    size_t keylen;
+
+    if(test->mode == USERKEY) {
+        keylen = sprintf(key, "data-%lu", sizes_payload[index]);
+
+    } else {
+        memcpy(key, &index, sizeof(uint32_t));
+        keylen = sizeof(uint32_t);
+    }
+
+    if(!(reply = redisCommand(test->zdb, "GETRANGE %b %d %d", key, keylen, 4 * 1024 * 1024, 512 * 1024)))
+        return TEST_FAILED_FATAL;
+
+    if(reply->type != REDIS_REPLY_STRING || reply->len != 512 * 1024)
+        return zdb_result(reply, TEST_FAILED);
+
+    if(reply->str[0] != 0x42 || reply->str[reply->len - 1] != 0x42)
+        return zdb_result(reply, TEST_FAILED);
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+// pipeline large (sent from datafile) and small reads
+// and ensure replies are kept in order
+runtest_prio(sp, payload_get_pipeline) {
+    uint32_t order[] = {8, 0, 7, 1, 5, 2};
+    size_t length = sizeof(order) / sizeof(uint32_t);
+    redisReply *reply;
+    char key[64];
+    size_t keylen;
+
+    for(size_t i = 0; i < length; i++) {
+        if(test->mode == USERKEY) {
+            keylen = sprintf(key, "data-%lu", sizes_payload[order[i]]);
+
+        } else {
+            memcpy(key, &order[i], sizeof(uint32_t));
+            keylen = sizeof(uint32_t);
+        }
+
+        redisAppendCommand(test->zdb, "GET %b", key, keylen);
+    }
+
+    for(size_t i = 0; i < length; i++) {
+        if(redisGetReply(test->zdb, (void **) &reply) != REDIS_OK)
+            return TEST_FAILED_FATAL;
+
+        if(reply->type != REDIS_REPLY_STRING || reply->len != sizes_payload[order[i]]) {
+            log("unexpected reply for payload %lu\n", sizes_payload[order[i]]);
+            freeReplyObject(reply);
+            return TEST_FAILED_FATAL;
+        }
+
+        if(reply->str[0] != 0x42 || reply->str[reply->len - 1] != 0x42) {
+            freeReplyObject(reply);
+            return TEST_FAILED_FATAL;
+        }
+
+        freeReplyObject(reply);
+    }
+
+    return TEST_SUCCESS;
+}
@@ -117,6 +117,140 @@ runtest_prio(sp, scan_get_new_last_key) {
     return scan_check(test, argvsz(argv), argv, "key5");
 }
 
+// walk the whole namespace, following the cursor
+// until the end, keys are spread on many index files
+// when the datasize is small
+static int scan_walk(test_t *test, const char *command, char *first, char *last) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    redisReply *reply, *previous = NULL;
+    char lastkey[64] = {0};
+    size_t keys = 0;
+
+    while(1) {
+        if(previous) {
+            redisReply *cursor = previous->element[0];
+            reply = redisCommand(test->zdb, "%s %b", command, cursor->str, cursor->len);
+            freeReplyObject(previous);
+
+        } else {
+            reply = redisCommand(test->zdb, "%s", command);
+        }
+
+        if(!reply)
+            return TEST_FAILED_FATAL;
+
+        // end of the walk
+        if(reply->type != REDIS_REPLY_ARRAY)
+            break;
+
+        redisReply *list = reply->element[1];
+
+        for(size_t i = 0; i < list->elements; i++) {
+            if(keys == 0 && strcmp(list->element[i]->element[0]->str, first))
+                return zdb_result(reply, TEST_FAILED);
+
+            strncpy(lastkey, list->element[i]->element[0]->str, sizeof(lastkey) - 1);
+            keys += 1;
+        }
+
+        previous = reply;
+    }
+
+    if(keys != 4 || strcmp(lastkey, last)) {
+        log("walked %lu keys, last: %s\n", keys, lastkey);
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+runtest_prio(sp, scan_walk_forward) {
+    return scan_walk(test, "SCAN", "key2", "key5");
+}
+
+runtest_prio(sp, scan_walk_backward) {
+    return scan_walk(test, "RSCAN", "key5", "key2");
+}
+
+// walk one entry at a time, checking payloads
+static int scanv_walk(test_t *test, const char *command, char *first, char *last) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    redisReply *reply, *previous = NULL;
+    char lastkey[64] = {0};
+    size_t keys = 0;
+
+    while(1) {
+        if(previous) {
+            redisReply *cursor = previous->element[0];
+            reply = redisCommand(test->zdb, "%s %b COUNT 1", command, cursor->str, cursor->len);
+            freeReplyObject(previous);
+
+        } else {
+            reply = redisCommand(test->zdb, "%s COUNT 1", command);
+        }
+
+        if(!reply)
+            return TEST_FAILED_FATAL;
+
+        // end of the walk
+        if(reply->type != REDIS_REPLY_ARRAY)
+            break;
+
+        redisReply *list = reply->element[1];
+
+        if(list->elements != 1)
+            return zdb_result(reply, TEST_FAILED);
+
+        redisReply **entry = list->element[0]->element;
+        char expected[5];
+
+        // key<n> payload is 4 times the n-th letter
+        memset(expected, 'a' + entry[0]->str[3] - '1', 4);
+        expected[4] = '\0';
+
+        if(keys == 0 && strcmp(entry[0]->str, first))
+            return zdb_result(reply, TEST_FAILED);
+
+        if(entry[1]->type != REDIS_REPLY_STRING || strcmp(entry[1]->str, expected)) {
+            log("%s: unexpected payload\n", entry[0]->str);
+            return zdb_result(reply, TEST_FAILED);
+        }
+
+        // with a single entry, its cursor is the next cursor
+        if(entry[3]->len != reply->element[0]->len || memcmp(entry[3]->str, reply->element[0]->str, entry[3]->len))
+            return zdb_result(reply, TEST_FAILED);
+
+        strncpy(lastkey, entry[0]->str, sizeof(lastkey) - 1);
+        keys += 1;
+
+        previous = reply;
+    }
+
+    if(keys != 4 || strcmp(lastkey, last)) {
+        log("walked %lu keys, last: %s\n", keys, lastkey);
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+runtest_prio(sp, scanv_walk_forward) {
+    return scanv_walk(test, "SCANV", "key2", "key5");
+}
+
+runtest_prio(sp, scanv_walk_backward) {
+    return scanv_walk(test, "RSCANV", "key5", "key2");
+}
+
+runtest_prio(sp, scanv_invalid_count) {
+    const char *argv[] = {"SCANV", "COUNT", "0"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
 // scan on unknown key
 runtest_prio(sp, scan_non_existing) {
     const char *argv[] = {"SCAN", "nonexisting"};
@@ -172,6 +306,75 @@ runtest_prio(sp, scan_kscan_invalid) {
     return zdb_command_error(test, argvsz(argv), argv);
 }
 
+// keys and cursor returned by KSCAN or KRANGE
+static int kscan_check(test_t *test, int argc, const char *argv[], char *cursor, char **keys, size_t length) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    redisReply *reply;
+
+    if(!(reply = zdb_response_scan(test, argc, argv)))
+        return zdb_result(reply, TEST_FAILED_FATAL);
+
+    redisReply *list = reply->element[1];
+
+    if(strcmp(reply->element[0]->str, cursor) || list->elements != length) {
+        log("cursor: %s, %lu keys\n", reply->element[0]->str, list->elements);
+        return zdb_result(reply, TEST_FAILED);
+    }
+
+    for(size_t i = 0; i < length; i++)
+        if(strcmp(list->element[i]->str, keys[i]))
+            return zdb_result(reply, TEST_FAILED);
+
+    return zdb_result(reply, TEST_SUCCESS);
+}
+
+runtest_prio(sp, scan_kscan_ordered_enable) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"NSSET", namespace_scan, "ordered", "1"};
+    return zdb_command(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, scan_kscan_ordered) {
+    const char *argv[] = {"KSCAN", "key", "COUNT", "2"};
+    char *keys[] = {"key2", "key3"};
+
+    return kscan_check(test, argvsz(argv), argv, "key3", keys, 2);
+}
+
+runtest_prio(sp, scan_kscan_ordered_next) {
+    const char *argv[] = {"KSCAN", "key", "key3", "COUNT", "2"};
+    char *keys[] = {"key4", "key5"};
+
+    return kscan_check(test, argvsz(argv), argv, "", keys, 2);
+}
+
+runtest_prio(sp, scan_kscan_ordered_nomatch) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"KSCAN", "nokey"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
+runtest_prio(sp, scan_krange) {
+    const char *argv[] = {"KRANGE", "key3", "key5"};
+    char *keys[] = {"key3", "key4"};
+
+    return kscan_check(test, argvsz(argv), argv, "", keys, 2);
+}
+
+runtest_prio(sp, scan_kscan_invalid_count) {
+    if(test->mode == SEQUENTIAL)
+        return TEST_SKIPPED;
+
+    const char *argv[] = {"KSCAN", "key", "COUNT", "0"};
+    return zdb_command_error(test, argvsz(argv), argv);
+}
+
 runtest_prio(sp, scan_kscan_switch_default) {
     const char *argv[] = {"SELECT", "default"};
     return zdb_command(test, argvsz(argv), argv);
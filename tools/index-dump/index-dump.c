@@ -27,21 +27,27 @@ int index_dump_files(index_root_t *zdbindex, uint64_t maxfile) {
         printf("[+] index-dump: index mode: %s\n", zdb_running_mode(header->mode));
 
         //
-        // dumping contents
+        // dumping contents, entries are parsed in place
+        // from the file mapping
         //
         index_item_t *entry = NULL;
         size_t entrycount = 0;
-        off_t curoff;
+        zdb_map_t map;
+        size_t curoff;
+        size_t offset;
 
-        curoff = zdb_index_raw_offset(zdbindex);
+        if(zdb_file_map(zdbindex->indexfd, &map))
+            return 1;
+
+        curoff = offset = sizeof(index_header_t);
 
-        while((entry = zdb_index_raw_fetch_entry(zdbindex))) {
+        while((entry = zdb_index_item_next(map.buffer, map.length, &offset))) {
             entrycount += 1;
             totalentries += 1;
 
             zdb_header_date(entry->timestamp, datestr, sizeof(datestr));
 
-            printf("[+] index entry: %lu, offset: %" PRId64 "\n", entrycount, (int64_t) curoff);
+            printf("[+] index entry: %lu, offset: %lu\n", entrycount, curoff);
             printf("[+]   id length  : %" PRIu8 "\n", entry->idlength);
             printf("[+]   data length: %" PRIu32 "\n", entry->length);
             printf("[+]   data offset: %" PRIu32 "\n", entry->offset);
@@ -57,10 +63,14 @@ int index_dump_files(index_root_t *zdbindex, uint64_t maxfile) {
             printf("\n");
 
             // saving current offset
-            curoff = zdb_index_raw_offset(zdbindex);
-            free(entry);
+            curoff = offset;
         }
 
+        if(offset < map.length)
+            printf("[-] index-dump: incomplete entry at offset %lu, ignored\n", offset);
+
+        zdb_file_unmap(&map);
+
         printf("[+] ---------------------------\n");
         printf("[+] file done, file entries found: %lu\n", entrycount);
 
@@ -55,32 +55,40 @@ int index_data_jump_to(fileid_t fileid, index_root_t *zdbindex, data_root_t *zdb
 
 ssize_t index_rebuild_pass(index_root_t *zdbindex, data_root_t *zdbdata, time_t timestamp) {
     size_t entrycount = 0;
-    uint8_t idlength;
     data_entry_header_t *entry = NULL;
+    zdb_map_t map;
 
     // now it's time to read each entries
     // each time, one entry starts by the entry-header
     // then entry payload.
     // the entry headers starts with the amount of bytes
     // of the key, which is needed to read the full header
+    //
+    // datafile is mapped and headers are parsed in place,
+    // payloads are skipped without being read
+    if(zdb_file_map(zdbdata->datafd, &map))
+        return -1;
 
-    while(read(zdbdata->datafd, &idlength, sizeof(idlength)) == sizeof(idlength)) {
-        // we have the length of the key
-        ssize_t entrylength = sizeof(data_entry_header_t) + idlength;
-        if(!(entry = realloc(entry, entrylength)))
-            zdb_diep("realloc");
+    // entries starts after the header already validated
+    size_t current = sizeof(data_header_t);
 
-        // rollback the 1 byte read for the id length
-        off_t current = lseek(zdbdata->datafd, -1, SEEK_CUR);
+    while(current + sizeof(data_entry_header_t) <= map.length) {
+        entry = (data_entry_header_t *) (map.buffer + current);
+
+        // we have the length of the key
+        size_t entrylength = sizeof(data_entry_header_t) + entry->idlength;
 
-        if(read(zdbdata->datafd, entry, entrylength) != entrylength)
-            zdb_diep("data header read failed");
+        if(current + entrylength > map.length) {
+            fprintf(stderr, "[-] index-rebuild: data header truncated, stopping here\n");
+            break;
+        }
 
         printf("[+] processing key: ");
         zdb_tools_hexdump(entry->id, entry->idlength);
 
         if(timestamp > 0 && entry->timestamp > timestamp) {
             printf("[+] index-rebuild: timestamp limit reached, stopping here\n");
+            zdb_file_unmap(&map);
             return entrycount;
         }
 
@@ -100,6 +108,14 @@ ssize_t index_rebuild_pass(index_root_t *zdbindex, data_root_t *zdbdata, time_t
             .id = entry->id,
         };
 
+        // streamed payload never completed, this entry
+        // was never part of the index, skipping it
+        if(entry->flags & DATA_ENTRY_STREAMING) {
+            current += entrylength + entry->datalength;
+            entrycount += 1;
+            continue;
+        }
+
         // fetching existing if any
         // this is needed to keep track of the history
         index_entry_t *existing = index_get(zdbindex, entry->id, entry->idlength);
@@ -107,22 +123,24 @@ ssize_t index_rebuild_pass(index_root_t *zdbindex, data_root_t *zdbdata, time_t
         if(entry->flags & DATA_ENTRY_DELETED) {
             if(index_entry_delete(zdbindex, existing)) {
                 fprintf(stderr, "[-] index-rebuild: could not delete index item\n");
+                zdb_file_unmap(&map);
                 return -1;
             }
 
         } else {
             if(!index_set(zdbindex, &setter, existing)) {
                 fprintf(stderr, "[-] index-rebuild: could not insert index item\n");
+                zdb_file_unmap(&map);
                 return -1;
             }
         }
 
         // skipping data payload
-        lseek(zdbdata->datafd, entry->datalength, SEEK_CUR);
+        current += entrylength + entry->datalength;
         entrycount += 1;
     }
 
-    free(entry);
+    zdb_file_unmap(&map);
 
     printf("[+] index-rebuild: index pass entries: %lu\n", entrycount);
 
@@ -293,7 +311,7 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    if(!(zdbindex = zdb_index_init(zdb_settings, namespace->indexpath, namespace, nsroot->branches))) {
+    if(!(zdbindex = zdb_index_init(zdb_settings, namespace->indexpath, namespace))) {
         fprintf(stderr, "[-] index-rebuild: cannot initialize index\n");
         exit(EXIT_FAILURE);
     }
@@ -81,6 +81,13 @@ int data_integrity(data_root_t *zdbdata) {
         if(entry->datalength == 0)
             continue;
 
+        // incomplete streamed payload, not part of the dataset
+        if(entry->flags & DATA_ENTRY_STREAMING) {
+            printf("[+]   data crc       : skipped, incomplete stream\n");
+            lseek(zdbdata->datafd, entry->datalength, SEEK_CUR);
+            continue;
+        }
+
         if(!(buffer = realloc(buffer, entry->datalength)))
             zdb_diep("realloc");
 
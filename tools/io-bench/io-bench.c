@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <sys/uio.h>
+#include <sys/time.h>
+#include "libzdb.h"
+
+//
+// i/o syscalls benchmark
+//
+// this tool is linked with '--wrap' on each i/o syscall used by libzdb,
+// calls made by the library goes through a counter before reaching
+// the real function, this gives the exact amount of syscalls needed
+// by each api call, without any external tracer
+//
+// usage: io-bench <directory> [keys] [datasize]
+//
+// the directory is cleaned and used as data and index path
+//
+
+enum {
+    IO_OPEN, IO_CLOSE, IO_READ, IO_WRITE, IO_PREAD, IO_PWRITE,
+    IO_READV, IO_WRITEV, IO_PREADV, IO_PWRITEV, IO_LSEEK, IO_FSYNC,
+    IO_TOTAL
+};
+
+static char *io_names[] = {
+    "open", "close", "read", "write", "pread", "pwrite",
+    "readv", "writev", "preadv", "pwritev", "lseek", "fsync",
+};
+
+static uint64_t io_counters[IO_TOTAL];
+
+//
+// wrappers
+//
+int __real_open(const char *pathname, int flags, ...);
+int __real_close(int fd);
+ssize_t __real_read(int fd, void *buf, size_t count);
+ssize_t __real_write(int fd, const void *buf, size_t count);
+ssize_t __real_pread(int fd, void *buf, size_t count, off_t offset);
+ssize_t __real_pwrite(int fd, const void *buf, size_t count, off_t offset);
+ssize_t __real_readv(int fd, const struct iovec *iov, int iovcnt);
+ssize_t __real_writev(int fd, const struct iovec *iov, int iovcnt);
+ssize_t __real_preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+ssize_t __real_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+off_t __real_lseek(int fd, off_t offset, int whence);
+int __real_fsync(int fd);
+
+int __wrap_open(const char *pathname, int flags, ...) {
+    mode_t mode = 0;
+
+    if(flags & O_CREAT) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, int);
+        va_end(args);
+    }
+
+    io_counters[IO_OPEN] += 1;
+    return __real_open(pathname, flags, mode);
+}
+
+int __wrap_close(int fd) {
+    io_counters[IO_CLOSE] += 1;
+    return __real_close(fd);
+}
+
+ssize_t __wrap_read(int fd, void *buf, size_t count) {
+    io_counters[IO_READ] += 1;
+    return __real_read(fd, buf, count);
+}
+
+ssize_t __wrap_write(int fd, const void *buf, size_t count) {
+    io_counters[IO_WRITE] += 1;
+    return __real_write(fd, buf, count);
+}
+
+ssize_t __wrap_pread(int fd, void *buf, size_t count, off_t offset) {
+    io_counters[IO_PREAD] += 1;
+    return __real_pread(fd, buf, count, offset);
+}
+
+ssize_t __wrap_pwrite(int fd, const void *buf, size_t count, off_t offset) {
+    io_counters[IO_PWRITE] += 1;
+    return __real_pwrite(fd, buf, count, offset);
+}
+
+ssize_t __wrap_readv(int fd, const struct iovec *iov, int iovcnt) {
+    io_counters[IO_READV] += 1;
+    return __real_readv(fd, iov, iovcnt);
+}
+
+ssize_t __wrap_writev(int fd, const struct iovec *iov, int iovcnt) {
+    io_counters[IO_WRITEV] += 1;
+    return __real_writev(fd, iov, iovcnt);
+}
+
+ssize_t __wrap_preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset) {
+    io_counters[IO_PREADV] += 1;
+    return __real_preadv(fd, iov, iovcnt, offset);
+}
+
+ssize_t __wrap_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset) {
+    io_counters[IO_PWRITEV] += 1;
+    return __real_pwritev(fd, iov, iovcnt, offset);
+}
+
+off_t __wrap_lseek(int fd, off_t offset, int whence) {
+    io_counters[IO_LSEEK] += 1;
+    return __real_lseek(fd, offset, whence);
+}
+
+int __wrap_fsync(int fd) {
+    io_counters[IO_FSYNC] += 1;
+    return __real_fsync(fd);
+}
+
+//
+// benchmark
+//
+static double bench_now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+static void bench_report(char *name, uint64_t *before, size_t operations, double elapsed) {
+    uint64_t total = 0;
+
+    printf("[+] %-6s %lu operations, %.2f ops/sec\n", name, operations, operations / elapsed);
+
+    for(int i = 0; i < IO_TOTAL; i++) {
+        uint64_t diff = io_counters[i] - before[i];
+
+        if(diff == 0)
+            continue;
+
+        printf("[+]   %-8s %10lu  (%.2f / op)\n", io_names[i], diff, (double) diff / operations);
+        total += diff;
+    }
+
+    printf("[+]   %-8s %10lu  (%.2f / op)\n", "total", total, (double) total / operations);
+}
+
+typedef zdb_api_t *(*bench_call_t)(namespace_t *ns, char *key, size_t ksize, char *payload, size_t psize);
+
+static zdb_api_t *bench_set(namespace_t *ns, char *key, size_t ksize, char *payload, size_t psize) {
+    return zdb_api_set(ns, key, ksize, payload, psize);
+}
+
+static zdb_api_t *bench_get(namespace_t *ns, char *key, size_t ksize, char *payload, size_t psize) {
+    (void) payload;
+    (void) psize;
+    return zdb_api_get(ns, key, ksize);
+}
+
+static zdb_api_t *bench_check(namespace_t *ns, char *key, size_t ksize, char *payload, size_t psize) {
+    (void) payload;
+    (void) psize;
+    return zdb_api_check(ns, key, ksize);
+}
+
+static zdb_api_t *bench_del(namespace_t *ns, char *key, size_t ksize, char *payload, size_t psize) {
+    (void) payload;
+    (void) psize;
+    return zdb_api_del(ns, key, ksize);
+}
+
+static void bench_run(namespace_t *ns, char *name, bench_call_t call, size_t keys, zdb_api_type_t expected) {
+    uint64_t before[IO_TOTAL];
+    char payload[128];
+    char key[32];
+    size_t failed = 0;
+
+    memset(payload, 'x', sizeof(payload));
+    memcpy(before, io_counters, sizeof(before));
+
+    double start = bench_now();
+
+    for(size_t i = 0; i < keys; i++) {
+        // keys are spread over all the files
+        size_t id = (i * 7919) % keys;
+        int ksize = sprintf(key, "key-%lu", id);
+
+        zdb_api_t *reply = call(ns, key, ksize, payload, sizeof(payload));
+
+        if(reply->status != expected)
+            failed += 1;
+
+        zdb_api_reply_free(reply);
+    }
+
+    bench_report(name, before, keys, bench_now() - start);
+
+    if(failed)
+        printf("[-]   %lu operations failed\n", failed);
+}
+
+int main(int argc, char *argv[]) {
+    if(argc < 2) {
+        fprintf(stderr, "Usage: %s directory [keys] [datasize]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    char *path = argv[1];
+    size_t keys = (argc > 2) ? strtoul(argv[2], NULL, 10) : 100000;
+    size_t datasize = (argc > 3) ? strtoul(argv[3], NULL, 10) : 4 * 1024 * 1024;
+
+    printf("[*] 0-db engine v%s\n", zdb_version());
+    printf("[+] io-bench: %lu keys, datafile size: %.2f MB\n", keys, MB(datasize));
+
+    zdb_settings_t *zdb_settings = zdb_initialize();
+    zdb_id_set("io-bench");
+
+    zdb_settings->datapath = path;
+    zdb_settings->indexpath = path;
+    zdb_settings->datasize = datasize;
+    zdb_settings->mode = ZDB_MODE_KEY_VALUE;
+
+    if(zdb_dir_exists(path) == ZDB_DIRECTORY_EXISTS) {
+        fprintf(stderr, "[-] io-bench: %s already exists, refusing to overwrite it\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    if(!zdb_open(zdb_settings)) {
+        fprintf(stderr, "[-] io-bench: cannot open database\n");
+        exit(EXIT_FAILURE);
+    }
+
+    namespace_t *ns = namespace_get_default();
+
+    bench_run(ns, "set", bench_set, keys, ZDB_API_BUFFER);
+    bench_run(ns, "get", bench_get, keys, ZDB_API_ENTRY);
+    bench_run(ns, "check", bench_check, keys, ZDB_API_TRUE);
+    bench_run(ns, "del", bench_del, keys, ZDB_API_SUCCESS);
+
+    zdb_close(zdb_settings);
+
+    return 0;
+}
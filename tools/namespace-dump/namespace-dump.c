@@ -42,6 +42,7 @@ int main(int argc, char *argv[]) {
     printf("[+] password    : %s\n", ns->password ? ns->password : "<no password set>");
     printf("[+] public flag : %d\n", ns->public);
     printf("[+] mode worm   : %d\n", ns->worm);
+    printf("[+] values cache: %d\n", ns->cache);
     printf("[+] maximum size: %lu bytes (%.2f MB)\n", ns->maxsize, MB(ns->maxsize));
     printf("[+] -----------------------------------------\n");
 
@@ -481,7 +481,7 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    if(!(output.zdbindex = zdb_index_init(output.zdbsettings, output.namespace->indexpath, output.namespace, output.nsroot->branches))) {
+    if(!(output.zdbindex = zdb_index_init(output.zdbsettings, output.namespace->indexpath, output.namespace))) {
         fprintf(stderr, "[-] quick-compact: output: cannot initialize index\n");
         exit(EXIT_FAILURE);
     }
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,6 +8,7 @@
 #include <sys/time.h>
 #include <inttypes.h>
 #include <time.h>
+#include <pthread.h>
 #include "libzdb.h"
 #include "zdbd.h"
 #include "redis.h"
@@ -74,7 +76,7 @@ int command_args_validate(redis_client_t *client, int expected) {
 int command_admin_authorized(redis_client_t *client) {
     if(!client->admin) {
         // update failed statistics
-        zdbd_rootsettings.stats.adminfailed += 1;
+        zdb_atomic_add(zdbd_rootsettings.stats.adminfailed, 1);
 
         redis_hardsend(client, "-Permission denied");
         return 0;
@@ -107,52 +109,115 @@ int command_args_namespace(redis_client_t *client, int argidx) {
 
 // command parser
 // dispatch command to the right handler
+//
+// commands flagged shared only read the database and can be executed
+// concurrently by several reactors (see engine lock below), any other
+// command is executed alone
 
 static command_t commands_handlers[] = {
     // replication
-    {.command = "*",       .handler = command_asterisk}, // special command used to match all in WAIT
-    {.command = "WAIT",    .handler = command_wait},     // custom WAIT command to wait on events
-    {.command = "MIRROR",  .handler = command_mirror},   // custom MIRROR command to sync full network traffic
-    {.command = "MASTER",  .handler = command_master},   // custom MASTER command to flag client as sync source
+    {.command = "*",       .handler = command_asterisk,   .shared = 0}, // special command used to match all in WAIT
+    {.command = "WAIT",    .handler = command_wait,       .shared = 0}, // custom WAIT command to wait on events
+    {.command = "MIRROR",  .handler = command_mirror,     .shared = 0}, // custom MIRROR command to sync full network traffic
+    {.command = "MASTER",  .handler = command_master,     .shared = 0}, // custom MASTER command to flag client as sync source
 
     // system
-    {.command = "PING",    .handler = command_ping},     // default PING command
-    {.command = "TIME",    .handler = command_time},     // default TIME command
-    {.command = "AUTH",    .handler = command_auth},     // custom AUTH command to authentifcate admin
-    {.command = "HOOKS",   .handler = command_hooks},    // custom HOOKS command to list running hooks
-    {.command = "INDEX",   .handler = command_index},    // custom INDEX command to query internal index
+    {.command = "PING",    .handler = command_ping,       .shared = 1}, // default PING command
+    {.command = "TIME",    .handler = command_time,       .shared = 1}, // default TIME command
+    {.command = "AUTH",    .handler = command_auth,       .shared = 1}, // custom AUTH command to authentifcate admin
+    {.command = "HOOKS",   .handler = command_hooks,      .shared = 0}, // custom HOOKS command to list running hooks
+    {.command = "INDEX",   .handler = command_index,      .shared = 0}, // custom INDEX command to query internal index
 
     // dataset
-    {.command = "SET",     .handler = command_set},      // default SET command
-    {.command = "SETX",    .handler = command_set},      // alias for SET command
-    {.command = "GET",     .handler = command_get},      // default GET command
-    {.command = "DEL",     .handler = command_del},      // default DEL command
-    {.command = "EXISTS",  .handler = command_exists},   // default EXISTS command
-    {.command = "CHECK",   .handler = command_check},    // custom command to verify data integrity
-    {.command = "SCAN",    .handler = command_scan},     // modified SCAN which walk forward dataset
-    {.command = "SCANX",   .handler = command_scan},     // alias for SCAN command
-    {.command = "RSCAN",   .handler = command_rscan},    // custom command to walk backward dataset
-    {.command = "KSCAN",   .handler = command_kscan},    // custom command to iterate over keys matching pattern
-    {.command = "HISTORY", .handler = command_history},  // custom command to get previous version of a key
-    {.command = "KEYCUR",  .handler = command_keycur},   // custom command to get cursor id from a key
+    {.command = "SET",     .handler = command_set,        .shared = 0}, // default SET command
+    {.command = "SETX",    .handler = command_set,        .shared = 0}, // alias for SET command
+    {.command = "GET",     .handler = command_get,        .shared = 1}, // default GET command
+    {.command = "GETRANGE", .handler = command_getrange,  .shared = 1}, // custom GETRANGE command to read part of a value
+    {.command = "DEL",     .handler = command_del,        .shared = 0}, // default DEL command
+    {.command = "MSET",    .handler = command_mset,       .shared = 0}, // default MSET command (key-value mode)
+    {.command = "MGET",    .handler = command_mget,       .shared = 1}, // default MGET command
+    {.command = "MDEL",    .handler = command_mdel,       .shared = 0}, // custom command to delete multiple keys
+    {.command = "EXISTS",  .handler = command_exists,     .shared = 1}, // default EXISTS command
+    {.command = "CHECK",   .handler = command_check,      .shared = 1}, // custom command to verify data integrity
+    {.command = "SCAN",    .handler = command_scan,       .shared = 1}, // modified SCAN which walk forward dataset
+    {.command = "SCANX",   .handler = command_scan,       .shared = 1}, // alias for SCAN command
+    {.command = "RSCAN",   .handler = command_rscan,      .shared = 1}, // custom command to walk backward dataset
+    {.command = "SCANV",   .handler = command_scanv,      .shared = 1}, // custom SCAN returning values
+    {.command = "RSCANV",  .handler = command_rscanv,     .shared = 1}, // custom RSCAN returning values
+    {.command = "KSCAN",   .handler = command_kscan,      .shared = 1}, // custom command to iterate over keys matching pattern
+    {.command = "KRANGE",  .handler = command_krange,     .shared = 1}, // custom command to iterate over keys in a range
+    {.command = "HISTORY", .handler = command_history,    .shared = 1}, // custom command to get previous version of a key
+    {.command = "KEYCUR",  .handler = command_keycur,     .shared = 1}, // custom command to get cursor id from a key
 
     // query
-    {.command = "INFO",    .handler = command_info},     // returns 0-db server name
-    {.command = "STOP",    .handler = command_stop},     // custom command for debug purposes
+    {.command = "INFO",    .handler = command_info,       .shared = 0}, // returns 0-db server name
+    {.command = "STOP",    .handler = command_stop,       .shared = 0}, // custom command for debug purposes
 
     // namespace
-    {.command = "DBSIZE",  .handler = command_dbsize},   // default DBSIZE command
-    {.command = "NSNEW",   .handler = command_nsnew},    // custom command to create a namespace
-    {.command = "NSDEL",   .handler = command_nsdel},    // custom command to remove a namespace
-    {.command = "NSLIST",  .handler = command_nslist},   // custom command to list namespaces
-    {.command = "NSSET",   .handler = command_nsset},    // custom command to edit namespace settings
-    {.command = "NSINFO",  .handler = command_nsinfo},   // custom command to get namespace information
-    {.command = "SELECT",  .handler = command_select},   // default SELECT (with pwd) namespace switch
-    {.command = "RELOAD",  .handler = command_reload},   // custom command to reload a namespace
-    {.command = "FLUSH",   .handler = command_flush},    // custom command to reset a namespace
+    {.command = "DBSIZE",  .handler = command_dbsize,     .shared = 1}, // default DBSIZE command
+    {.command = "NSNEW",   .handler = command_nsnew,      .shared = 0}, // custom command to create a namespace
+    {.command = "NSDEL",   .handler = command_nsdel,      .shared = 0}, // custom command to remove a namespace
+    {.command = "NSLIST",  .handler = command_nslist,     .shared = 0}, // custom command to list namespaces
+    {.command = "NSSET",   .handler = command_nsset,      .shared = 0}, // custom command to edit namespace settings
+    {.command = "NSINFO",  .handler = command_nsinfo,     .shared = 0}, // custom command to get namespace information
+    {.command = "SELECT",  .handler = command_select,     .shared = 0}, // default SELECT (with pwd) namespace switch
+    {.command = "RELOAD",  .handler = command_reload,     .shared = 0}, // custom command to reload a namespace
+    {.command = "FLUSH",   .handler = command_flush,      .shared = 0}, // custom command to reset a namespace
 };
 
-int redis_dispatcher(redis_client_t *client) {
+//
+// engine lock
+//
+// with several reactors (see --threads), each reactor executes the commands
+// of its own clients, shared (read-only) commands can run in parallel, any
+// other command needs the engine for itself
+//
+// writes are serialized on this single lock and not per namespace, write
+// paths of the library share some global state (reusable buffers, hooks,
+// global statistics) which can't be reached concurrently
+//
+// lock order is: engine, clients list, client
+//
+static pthread_rwlock_t engine;
+
+void command_engine_init() {
+    pthread_rwlockattr_t attr;
+
+    pthread_rwlockattr_init(&attr);
+
+    #ifdef __linux__
+    // don't let a continuous flow of reads starve writes
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    #endif
+
+    if(pthread_rwlock_init(&engine, &attr))
+        zdbd_diep("engine: pthread_rwlock_init");
+
+    pthread_rwlockattr_destroy(&attr);
+}
+
+void command_engine_lock(int shared) {
+    if(shared) {
+        pthread_rwlock_rdlock(&engine);
+        return;
+    }
+
+    pthread_rwlock_wrlock(&engine);
+}
+
+void command_engine_unlock() {
+    pthread_rwlock_unlock(&engine);
+}
+
+static command_t *command_lookup(resp_object_t *key) {
+    for(unsigned int i = 0; i < sizeof(commands_handlers) / sizeof(command_t); i++)
+        if(strncasecmp(key->buffer, commands_handlers[i].command, key->length) == 0)
+            return &commands_handlers[i];
+
+    return NULL;
+}
+
+static int redis_dispatcher_real(redis_client_t *client, command_t *command) {
     resp_request_t *request = client->request;
     resp_object_t *key = request->argv[0];
 
@@ -178,22 +243,20 @@ int redis_dispatcher(redis_client_t *client) {
 
     zdbd_debug("[+] command: '%.*s' [+%d args]\n", key->length, (char *) key->buffer, request->argc - 1);
 
-    for(unsigned int i = 0; i < sizeof(commands_handlers) / sizeof(command_t); i++) {
-        if(strncasecmp(key->buffer, commands_handlers[i].command, key->length) == 0) {
-            // save last command executed
-            client->executed = &commands_handlers[i];
+    if(command) {
+        // save last command executed
+        client->executed = command;
 
-            // update statistics
-            zdbd_rootsettings.stats.cmdsvalid += 1;
+        // update statistics
+        zdb_atomic_add(zdbd_rootsettings.stats.cmdsvalid, 1);
 
-            // execute handler
-            return commands_handlers[i].handler(client);
-        }
+        // execute handler
+        return command->handler(client);
     }
 
     // unknown command
     zdb_log("[-] command: unsupported redis command\n");
-    zdbd_rootsettings.stats.cmdsfailed += 1;
+    zdb_atomic_add(zdbd_rootsettings.stats.cmdsfailed, 1);
 
     // reset executed flag, this was a non-existing command
     client->executed = NULL;
@@ -202,6 +265,28 @@ int redis_dispatcher(redis_client_t *client) {
     return 1;
 }
 
+// execute the client request and notify clients waiting
+// for this command, under the engine lock
+int redis_dispatcher(redis_client_t *client) {
+    resp_object_t *key = client->request->argv[0];
+    command_t *command = NULL;
+    int value;
+
+    if(key->type == STRING)
+        command = command_lookup(key);
+
+    command_engine_lock(command && command->shared);
+
+    value = redis_dispatcher_real(client, command);
+
+    zdbd_debug("[+] redis: calling posthandler\n");
+    redis_posthandler_client(client);
+
+    command_engine_unlock();
+
+    return value;
+}
+
 // set the client to wait on a special handler to be triggered
 int command_wait(redis_client_t *client) {
     resp_request_t *request = client->request;
@@ -216,14 +301,7 @@ int command_wait(redis_client_t *client) {
     resp_object_t *key = request->argv[1];
 
     // checking if the requested command is supported
-    for(unsigned int i = 0; i < sizeof(commands_handlers) / sizeof(command_t); i++) {
-        if(strncasecmp(key->buffer, commands_handlers[i].command, key->length) == 0) {
-            handler = &commands_handlers[i];
-            break;
-        }
-    }
-
-    if(handler == NULL) {
+    if(!(handler = command_lookup(key))) {
         redis_hardsend(client, "-Unknown command to watch");
         return 0;
     }
@@ -5,6 +5,10 @@
 
     int redis_dispatcher(redis_client_t *client);
 
+    void command_engine_init();
+    void command_engine_lock(int shared);
+    void command_engine_unlock();
+
     int command_args_validate(redis_client_t *client, int expected);
     int command_args_validate_min(redis_client_t *client, int expected);
     int command_args_validate_null(redis_client_t *client, int expected);
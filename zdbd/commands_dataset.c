@@ -11,6 +11,8 @@
 #include "redis.h"
 #include "commands.h"
 #include "commands_get.h"
+#include "groupcommit.h"
+#include "readpool.h"
 
 int command_exists(redis_client_t *client) {
     resp_request_t *request = client->request;
@@ -31,7 +33,7 @@ int command_exists(redis_client_t *client) {
     zdbd_debughex(request->argv[1]->buffer, request->argv[1]->length);
 
     index_root_t *index = client->ns->index;
-    index_entry_t *entry = index_get(index, request->argv[1]->buffer, request->argv[1]->length);
+    index_entry_t *entry = index_lookup(index, request->argv[1]->buffer, request->argv[1]->length);
 
     zdbd_debug("[+] command: exists: entry found: %s\n", (entry ? "yes" : "no"));
 
@@ -91,6 +93,21 @@ int command_check(redis_client_t *client) {
     zdbd_debug("[+] command: get: data file: %d, data offset: %" PRIu32 "\n", entry->dataid, entry->offset);
 
     data_root_t *data = client->ns->data;
+
+    // full payload is read, sealed datafiles are checked
+    // by the read pool
+    if(readpool_enabled() && entry->dataid != data->dataid) {
+        readpool_job_t *job;
+
+        if((job = readpool_job_new(client, READPOOL_CHECK))) {
+            job->dataid = entry->dataid;
+            job->offset = entry->offset;
+
+            if(readpool_submit(job) == 0)
+                return 0;
+        }
+    }
+
     int status = data_check(data, entry->offset, entry->dataid);
 
     char response[32];
@@ -157,6 +174,9 @@ int command_del(redis_client_t *client) {
         return 0;
     }
 
+    // drop the deleted payload from values cache
+    data_invalidate(data, entry->dataid, entry->offset);
+
     // mark index entry as deleted
     if(index_entry_delete(index, entry)) {
         zdbd_debug("[-] command: del: index delete flag failed\n");
@@ -164,8 +184,130 @@ int command_del(redis_client_t *client) {
         return 0;
     }
 
+    // hold the reply until the deletion is synced
+    groupcommit_register(client);
+
     redis_hardsend(client, "+OK");
 
     return 0;
 }
 
+
+// multi-keys DEL, deletion entries of all keys are appended to the
+// datafile with a single write (see data_insert_batch), missing or
+// already deleted keys are ignored, reply is the amount of keys deleted
+int command_mdel(redis_client_t *client) {
+    resp_request_t *request = client->request;
+    size_t keys = request->argc - 1;
+
+    if(!command_args_validate_min(client, 2))
+        return 1;
+
+    for(size_t i = 0; i < keys; i++) {
+        if(request->argv[i + 1]->length > MAX_KEY_LENGTH) {
+            zdb_log("[-] command: mdel: invalid key size\n");
+            redis_hardsend(client, "-Invalid key");
+            return 1;
+        }
+    }
+
+    if(!client->writable) {
+        zdbd_debug("[-] command: mdel: denied, read-only namespace\n");
+        redis_hardsend(client, "-Namespace is in read-only mode");
+        return 1;
+    }
+
+    if(namespace_is_frozen(client->ns))
+        return command_error_frozen(client);
+
+    if(namespace_is_locked(client->ns))
+        return command_error_locked(client);
+
+    // disable deletion when worm mode enabled
+    if(client->ns->worm) {
+        zdbd_debug("[-] command: mdel: denied, deleting keys with worm mode\n");
+        redis_hardsend(client, "-Cannot delete a key when namespace is in worm mode");
+        return 1;
+    }
+
+    index_root_t *index = client->ns->index;
+    data_root_t *data = client->ns->data;
+    data_request_t *requests = calloc(sizeof(data_request_t), keys);
+    index_entry_t **entries = calloc(sizeof(index_entry_t *), keys);
+    size_t *offsets = calloc(sizeof(size_t), keys);
+    size_t count = 0;
+
+    if(!requests || !entries || !offsets) {
+        zdbd_warnp("command: mdel: calloc");
+        redis_hardsend(client, "-Internal Error");
+        goto cleanup;
+    }
+
+    for(size_t i = 0; i < keys; i++) {
+        resp_object_t *key = request->argv[i + 1];
+        index_entry_t *entry;
+
+        if(!(entry = index_get(index, key->buffer, key->length)))
+            continue;
+
+        if(index_entry_is_deleted(entry))
+            continue;
+
+        // flagged right away, the same key requested twice
+        // is only deleted once (disk flag is set later)
+        entry->flags |= INDEX_ENTRY_DELETED;
+
+        data_request_t dreq = {
+            .data = (unsigned char *) "",
+            .datalength = 0,
+            .vid = entry->id,
+            .idlength = entry->idlength,
+            .flags = DATA_ENTRY_DELETED,
+            .crc = 0,
+        };
+
+        requests[count] = dreq;
+        entries[count] = entry;
+        count += 1;
+    }
+
+    zdbd_debug("[+] command: mdel: %zu keys requested, %zu to delete\n", keys, count);
+
+    // update data file, flag entries deleted
+    if(count && data_insert_batch(data, requests, count, offsets) != count) {
+        zdbd_debug("[-] command: mdel: deleting data failed\n");
+
+        for(size_t i = 0; i < count; i++)
+            entries[i]->flags &= ~INDEX_ENTRY_DELETED;
+
+        redis_hardsend(client, "-Cannot delete key (data)");
+        goto cleanup;
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        // drop the deleted payload from values cache
+        data_invalidate(data, entries[i]->dataid, entries[i]->offset);
+
+        // mark index entry as deleted
+        if(index_entry_delete(index, entries[i])) {
+            zdbd_debug("[-] command: mdel: index delete flag failed\n");
+            redis_hardsend(client, "-Cannot delete key (index)");
+            goto cleanup;
+        }
+    }
+
+    if(count)
+        groupcommit_register(client);
+
+    char response[32];
+    sprintf(response, ":%zu\r\n", count);
+
+    redis_reply_stack(client, response, strlen(response));
+
+cleanup:
+    free(requests);
+    free(entries);
+    free(offsets);
+
+    return 0;
+}
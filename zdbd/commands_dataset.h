@@ -4,4 +4,5 @@
     int command_exists(redis_client_t *client);
     int command_check(redis_client_t *client);
     int command_del(redis_client_t *client);
+    int command_mdel(redis_client_t *client);
 #endif
@@ -11,6 +11,53 @@
 #include "zdbd.h"
 #include "redis.h"
 #include "commands.h"
+#include "commands_get.h"
+#include "readpool.h"
+
+// send the payload (or a window of it, from start) from the datafile to the
+// socket directly, without loading it in memory, only the bulk header and
+// trailer are built here
+static int command_get_sendfile(redis_client_t *client, index_entry_t *entry, size_t start, size_t length) {
+    data_root_t *data = client->ns->data;
+    char header[32];
+    int fd;
+
+    if((fd = data_payload_grab(data, entry->dataid, length)) < 0) {
+        zdb_log("[-] command: get: cannot open payload datafile\n");
+        redis_hardsend(client, "-Internal Error");
+        return 0;
+    }
+
+    size_t offset = data_payload_offset(entry->offset, entry->idlength) + start;
+    int hlength = sprintf(header, "$%zu\r\n", length);
+
+    redis_reply_stack(client, header, hlength);
+    redis_reply_file(client, fd, offset, length);
+    redis_reply_stack(client, "\r\n", 2);
+
+    data_payload_release(data, entry->dataid, fd);
+
+    return 0;
+}
+
+// payload is read by the read pool, or on the ring of the client
+// reactor with io_uring, reply is sent when ready
+static int command_get_deferred(redis_client_t *client, index_entry_t *entry) {
+    readpool_job_t *job;
+
+    if(client->uring)
+        return socket_uring_read(client, client->ns->data, entry->dataid, entry->offset, entry->length, entry->idlength);
+
+    if(!(job = readpool_job_new(client, READPOOL_GET)))
+        return 1;
+
+    job->dataid = entry->dataid;
+    job->offset = entry->offset;
+    job->length = entry->length;
+    job->idlength = entry->idlength;
+
+    return readpool_submit(job);
+}
 
 int command_get(redis_client_t *client) {
     resp_request_t *request = client->request;
@@ -29,7 +76,7 @@ int command_get(redis_client_t *client) {
         return command_error_frozen(client);
 
     // fetching index entry for this key
-    if(!(entry = index_get(client->ns->index, request->argv[1]->buffer, request->argv[1]->length))) {
+    if(!(entry = index_lookup(client->ns->index, request->argv[1]->buffer, request->argv[1]->length))) {
         zdbd_debug("[-] command: get: key not found\n");
         redis_hardsend(client, "$-1");
         return 1;
@@ -47,7 +94,27 @@ int command_get(redis_client_t *client) {
     zdbd_debug("[+] command: get: data file: %d, data offset: %" PRIu32 "\n", entry->dataid, entry->offset);
 
     data_root_t *data = client->ns->data;
-    data_payload_t payload = data_get(data, entry->offset, entry->length, entry->dataid, entry->idlength);
+
+    // large payload are sent straight from the datafile
+    if(entry->length >= REDIS_SENDFILE_THRESHOLD)
+        return command_get_sendfile(client, entry, 0, entry->length);
+
+    data_payload_t payload = {
+        .buffer = NULL,
+        .length = 0,
+    };
+
+    // payload on a sealed datafile and not in memory, disk can
+    // be slow, read is done by the read pool (or the ring)
+    if((readpool_enabled() || client->uring) && entry->dataid != data->dataid) {
+        payload = data_get_cached(data, entry->offset, entry->dataid);
+
+        if(!payload.buffer && command_get_deferred(client, entry) == 0)
+            return 0;
+    }
+
+    if(!payload.buffer)
+        payload = data_get(data, entry->offset, entry->length, entry->dataid, entry->idlength);
 
     if(!payload.buffer) {
         zdb_log("[-] command: get: cannot read payload\n");
@@ -68,3 +135,264 @@ int command_get(redis_client_t *client) {
     return 0;
 }
 
+
+//
+// ranged read
+//
+// only a window of the payload is read from the datafile, this avoid
+// reading and sending a large payload when only a part is needed
+//
+static int command_getrange_argument(resp_object_t *argument, size_t *value) {
+    char buffer[24];
+
+    if(argument->length == 0 || argument->length > 20)
+        return 1;
+
+    for(int i = 0; i < argument->length; i++)
+        if(((char *) argument->buffer)[i] < '0' || ((char *) argument->buffer)[i] > '9')
+            return 1;
+
+    memset(buffer, 0, sizeof(buffer));
+    memcpy(buffer, argument->buffer, argument->length);
+
+    *value = strtoull(buffer, NULL, 10);
+
+    return 0;
+}
+
+// window is read by the read pool, reply is sent when ready
+static int command_getrange_deferred(redis_client_t *client, index_entry_t *entry, size_t start, size_t length) {
+    readpool_job_t *job;
+
+    if(!(job = readpool_job_new(client, READPOOL_RANGE)))
+        return 1;
+
+    job->dataid = entry->dataid;
+    job->offset = entry->offset;
+    job->idlength = entry->idlength;
+    job->start = start;
+    job->length = length;
+
+    return readpool_submit(job);
+}
+
+// GETRANGE key offset length
+//
+// window outside the payload is truncated to the payload end,
+// an empty bulk is returned when offset is after the end
+int command_getrange(redis_client_t *client) {
+    resp_request_t *request = client->request;
+    index_entry_t *entry = NULL;
+    size_t start, length;
+
+    if(!command_args_validate(client, 4))
+        return 1;
+
+    if(request->argv[1]->length > MAX_KEY_LENGTH) {
+        zdbd_debug("[-] command: getrange: invalid key size (too big)\n");
+        redis_hardsend(client, "-Invalid key");
+        return 1;
+    }
+
+    if(command_getrange_argument(request->argv[2], &start) || command_getrange_argument(request->argv[3], &length)) {
+        zdbd_debug("[-] command: getrange: invalid offset or length\n");
+        redis_hardsend(client, "-Invalid range");
+        return 1;
+    }
+
+    if(namespace_is_frozen(client->ns))
+        return command_error_frozen(client);
+
+    if(!(entry = index_lookup(client->ns->index, request->argv[1]->buffer, request->argv[1]->length))) {
+        zdbd_debug("[-] command: getrange: key not found\n");
+        redis_hardsend(client, "$-1");
+        return 1;
+    }
+
+    if(entry->flags & INDEX_ENTRY_DELETED) {
+        zdbd_verbose("[-] command: getrange: key deleted\n");
+        redis_hardsend(client, "$-1");
+        return 1;
+    }
+
+    // truncate window to the payload
+    if(start >= entry->length) {
+        redis_hardsend(client, "$0\r\n");
+        return 0;
+    }
+
+    if(length > entry->length - start)
+        length = entry->length - start;
+
+    zdbd_debug("[+] command: getrange: data file: %d, data offset: %" PRIu32 ", window: %zu+%zu\n", entry->dataid, entry->offset, start, length);
+
+    data_root_t *data = client->ns->data;
+
+    if(length >= REDIS_SENDFILE_THRESHOLD)
+        return command_get_sendfile(client, entry, start, length);
+
+    data_payload_t payload = {
+        .buffer = NULL,
+        .length = 0,
+    };
+
+    // same as GET, payload on a sealed datafile and not
+    // in memory is read by the read pool
+    if(readpool_enabled() && entry->dataid != data->dataid) {
+        payload = data_get_range_cached(data, entry->offset, entry->dataid, start, length);
+
+        if(!payload.buffer && command_getrange_deferred(client, entry, start, length) == 0)
+            return 0;
+    }
+
+    if(!payload.buffer)
+        payload = data_get_range(data, entry->offset, entry->dataid, entry->idlength, start, length);
+
+    if(!payload.buffer) {
+        zdb_log("[-] command: getrange: cannot read payload\n");
+        redis_hardsend(client, "-Internal Error");
+        return 0;
+    }
+
+    redis_bulk_t response = redis_bulk(payload.buffer, payload.length);
+    free(payload.buffer);
+
+    if(!response.buffer) {
+        redis_hardsend(client, "$-1");
+        return 0;
+    }
+
+    redis_reply_heap(client, response.buffer, response.length, free);
+
+    return 0;
+}
+
+
+// multi-keys GET, payloads are read at once, ordered by location
+// (see data_get_batch), reply is an array with one bulk per key,
+// nil when the key doesn't exists, an error when the payload is
+// too large to be buffered (see MGET_MAX_PAYLOADS)
+int command_mget(redis_client_t *client) {
+    resp_request_t *request = client->request;
+    index_root_t *index = client->ns->index;
+    size_t keys = request->argc - 1;
+    size_t payloads = 0;
+    size_t found = 0;
+
+    if(!command_args_validate_min(client, 2))
+        return 1;
+
+    for(size_t i = 0; i < keys; i++) {
+        if(request->argv[i + 1]->length > MAX_KEY_LENGTH) {
+            zdbd_debug("[-] command: mget: invalid key size (too big)\n");
+            redis_hardsend(client, "-Invalid key");
+            return 1;
+        }
+    }
+
+    if(namespace_is_frozen(client->ns))
+        return command_error_frozen(client);
+
+    data_batch_t *batch;
+    ssize_t *slots;
+
+    if(!(batch = calloc(sizeof(data_batch_t), keys)) || !(slots = calloc(sizeof(ssize_t), keys))) {
+        zdbd_warnp("command: mget: calloc");
+        free(batch);
+        redis_hardsend(client, "-Internal Error");
+        return 0;
+    }
+
+    // position of each key on the batch, or MGET_SLOT_*
+    for(size_t i = 0; i < keys; i++) {
+        resp_object_t *key = request->argv[i + 1];
+        index_entry_t *entry;
+
+        slots[i] = MGET_SLOT_MISSING;
+
+        if(!(entry = index_lookup(index, key->buffer, key->length)))
+            continue;
+
+        if(entry->flags & INDEX_ENTRY_DELETED)
+            continue;
+
+        if(entry->length > REDIS_MAX_PAYLOAD || payloads + entry->length > MGET_MAX_PAYLOADS) {
+            slots[i] = MGET_SLOT_TOO_LARGE;
+            continue;
+        }
+
+        payloads += entry->length;
+
+        batch[found].dataid = entry->dataid;
+        batch[found].offset = entry->offset;
+        batch[found].length = entry->length;
+        batch[found].idlength = entry->idlength;
+
+        slots[i] = found++;
+    }
+
+    zdbd_debug("[+] command: mget: %zu keys requested, %zu found (%zu bytes)\n", keys, found, payloads);
+
+    data_get_batch(client->ns->data, batch, found);
+
+    // computing reply length, to build it at once
+    size_t length = 32;
+
+    for(size_t i = 0; i < keys; i++) {
+        if(slots[i] < 0) {
+            length += 64;
+            continue;
+        }
+
+        data_payload_t *payload = &batch[slots[i]].payload;
+        length += (payload->buffer) ? payload->length + 32 : 17;
+    }
+
+    unsigned char *response;
+
+    if(!(response = malloc(length))) {
+        zdbd_warnp("command: mget: malloc");
+        redis_hardsend(client, "-Internal Error");
+        goto cleanup;
+    }
+
+    size_t offset = sprintf((char *) response, "*%zu\r\n", keys);
+
+    for(size_t i = 0; i < keys; i++) {
+        if(slots[i] == MGET_SLOT_MISSING) {
+            offset += sprintf((char *) response + offset, "$-1\r\n");
+            continue;
+        }
+
+        if(slots[i] == MGET_SLOT_TOO_LARGE) {
+            offset += sprintf((char *) response + offset, "-Payload too large, use GET\r\n");
+            continue;
+        }
+
+        data_payload_t *payload = &batch[slots[i]].payload;
+
+        if(!payload->buffer) {
+            zdb_log("[-] command: mget: cannot read payload\n");
+            offset += sprintf((char *) response + offset, "-Internal Error\r\n");
+            continue;
+        }
+
+        offset += sprintf((char *) response + offset, "$%zu\r\n", payload->length);
+        memcpy(response + offset, payload->buffer, payload->length);
+        offset += payload->length;
+
+        memcpy(response + offset, "\r\n", 2);
+        offset += 2;
+    }
+
+    redis_reply_heap(client, response, offset, free);
+
+cleanup:
+    for(size_t i = 0; i < found; i++)
+        free(batch[i].payload.buffer);
+
+    free(batch);
+    free(slots);
+
+    return 0;
+}
@@ -1,5 +1,15 @@
 #ifndef ZDB_COMMANDS_GET_H
     #define ZDB_COMMANDS_GET_H
 
+    // maximum sum of payloads returned by a single MGET, payloads
+    // larger than REDIS_MAX_PAYLOAD or beyond this limit are not
+    // read, an error is returned in place (GET can be used instead)
+    #define MGET_MAX_PAYLOADS  32 * 1024 * 1024
+
+    #define MGET_SLOT_MISSING   -1
+    #define MGET_SLOT_TOO_LARGE -2
+
     int command_get(redis_client_t *client);
+    int command_getrange(redis_client_t *client);
+    int command_mget(redis_client_t *client);
 #endif
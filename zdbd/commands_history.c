@@ -11,6 +11,8 @@
 #include "redis.h"
 #include "commands.h"
 #include "commands_get.h"
+#include "commands_history.h"
+#include "readpool.h"
 
 // history support
 //
@@ -42,30 +44,28 @@
 //
 // when you reach the end of the chain, the binary received is nil
 
-typedef struct history_response_t {
-    uint32_t timestamp;
-    index_ekey_t *ekey;
-    data_payload_t payload;
-
-} history_response_t;
-
-static int history_send_array(redis_client_t *client, history_response_t *history) {
-    char *response = NULL;
+// array response, with 3 arguments:
+//  - first one is the next HISTORY key to use for previous version
+//  - the second one is the date when the data was set
+//  - the third one is the payload itself
+redis_bulk_t history_response_build(history_response_t *history) {
     char datestr[64];
-    size_t offset = 0;
+    redis_bulk_t bulk = {
+        .buffer = NULL,
+        .length = 0,
+        .writer = 0,
+    };
 
     // computing the full length expected
     size_t fullsize = history->payload.length + 256;
-    if(!(response = malloc(fullsize))) {
+    if(!(bulk.buffer = malloc(fullsize))) {
         zdbd_warnp("history send array: malloc");
-        redis_hardsend(client, "-Internal Error");
-        return 1;
+        return bulk;
     }
 
-    // array response, with 3 arguments:
-    //  - first one is the next HISTORY key to use for previous version
-    //  - the second one is the date when the data was set
-    //  - the third one is the payload itself
+    char *response = (char *) bulk.buffer;
+    size_t offset = 0;
+
     if(history->ekey->indexid != 0 || history->ekey->offset != 0) {
         offset = sprintf(response, "*3\r\n$%lu\r\n", sizeof(index_ekey_t));
 
@@ -91,12 +91,40 @@ static int history_send_array(redis_client_t *client, history_response_t *histor
     memcpy(response + offset, "\r\n", 2);
     offset += 2;
 
-    redis_reply_stack(client, response, offset);
-    free(response);
+    bulk.length = offset;
+
+    return bulk;
+}
+
+static int history_send_array(redis_client_t *client, history_response_t *history) {
+    redis_bulk_t response = history_response_build(history);
+
+    if(!response.buffer) {
+        redis_hardsend(client, "-Internal Error");
+        return 1;
+    }
+
+    redis_reply_heap(client, response.buffer, response.length, free);
 
     return 0;
 }
 
+static int history_send_deferred(redis_client_t *client, index_item_t *item, index_ekey_t *ekey) {
+    readpool_job_t *job;
+
+    if(!(job = readpool_job_new(client, READPOOL_HISTORY)))
+        return 1;
+
+    job->dataid = item->dataid;
+    job->offset = item->offset;
+    job->length = item->length;
+    job->idlength = item->idlength;
+    job->timestamp = item->timestamp;
+    job->ekey = *ekey;
+
+    return readpool_submit(job);
+}
+
 int history_send(redis_client_t *client, index_item_t *item, index_ekey_t *ekey) {
     data_root_t *data = client->ns->data;
     history_response_t response;
@@ -104,8 +132,30 @@ int history_send(redis_client_t *client, index_item_t *item, index_ekey_t *ekey)
     // dump entry found
     index_item_header_dump(item);
 
+    // history payload is sent from memory, a streamed
+    // payload is never buffered
+    if(item->length > REDIS_MAX_PAYLOAD) {
+        redis_hardsend(client, "-Payload too large");
+        free(item);
+        return 0;
+    }
+
+    response.payload.buffer = NULL;
+
+    // payload on a sealed datafile and not in memory, the
+    // read pool reads it and sends the whole array
+    if(readpool_enabled() && item->dataid != data->dataid) {
+        response.payload = data_get_cached(data, item->offset, item->dataid);
+
+        if(!response.payload.buffer && history_send_deferred(client, item, ekey) == 0) {
+            free(item);
+            return 0;
+        }
+    }
+
     // get data payload for this entry
-    response.payload = data_get(data, item->offset, item->length, item->dataid, item->idlength);
+    if(!response.payload.buffer)
+        response.payload = data_get(data, item->offset, item->length, item->dataid, item->idlength);
 
     if(!response.payload.buffer) {
         zdb_log("[-] command: history: cannot read payload\n");
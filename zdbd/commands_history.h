@@ -1,5 +1,13 @@
 #ifndef ZDB_COMMANDS_HISTORY_H
     #define ZDB_COMMANDS_HISTORY_H
 
+    typedef struct history_response_t {
+        uint32_t timestamp;
+        index_ekey_t *ekey;
+        data_payload_t payload;
+
+    } history_response_t;
+
+    redis_bulk_t history_response_build(history_response_t *history);
     int command_history(redis_client_t *client);
 #endif
@@ -12,6 +12,7 @@
 #include "redis.h"
 #include "commands.h"
 #include "auth.h"
+#include "readpool.h"
 
 // create a new namespace
 //   NSNEW [namespace]
@@ -94,6 +95,9 @@ int command_nsdel(redis_client_t *client) {
         return 1;
     }
 
+    // reads queued on the read pool can't use it anymore
+    readpool_cancel();
+
     // delete the new namespace
     if(namespace_delete(namespace)) {
         redis_hardsend(client, "-Could not delete this namespace");
@@ -303,6 +307,7 @@ int command_nsinfo(redis_client_t *client) {
     len += sprintf(info + len, "public: %s\n", namespace->public ? "yes" : "no");
     len += sprintf(info + len, "worm: %s\n", namespace->worm ? "yes" : "no");
     len += sprintf(info + len, "locked: %s\n", namespace->locked ? "yes" : "no");
+    len += sprintf(info + len, "cache: %s\n", namespace->cache ? "yes" : "no");
     len += sprintf(info + len, "password: %s\n", namespace->password ? "yes" : "no");
     len += sprintf(info + len, "data_size_bytes: %lu\n", namespace->index->stats.datasize);
     len += sprintf(info + len, "data_size_mb: %.2f\n", MB(namespace->index->stats.datasize));
@@ -311,12 +316,55 @@ int command_nsinfo(redis_client_t *client) {
     len += sprintf(info + len, "index_size_kb: %.2f\n", KB(namespace->index->stats.size));
     len += sprintf(info + len, "next_internal_id: 0x%08x\n", bswap_32(nextid));
     len += sprintf(info + len, "mode: %s\n", index_modename(namespace->index));
+    len += sprintf(info + len, "index_engine: %s\n", zdb_index_engine(namespace->index->engine));
+    len += sprintf(info + len, "index_buckets: %lu\n", index_capacity(namespace->index));
+    len += sprintf(info + len, "index_load_factor: %.2f\n", index_load_factor(namespace->index));
+    len += sprintf(info + len, "index_resizing: %s\n", index_resize_pending(namespace->index) ? "yes" : "no");
+    len += sprintf(info + len, "index_resize_progress: %.2f\n", index_resize_progress(namespace->index));
+    len += sprintf(info + len, "index_ordered: %s\n", namespace->index->tree ? "yes" : "no");
+
+    if(namespace->index->tree) {
+        index_tree_t *tree = namespace->index->tree;
+
+        len += sprintf(info + len, "index_ordered_entries: %lu\n", tree->length);
+        len += sprintf(info + len, "index_ordered_depth: %u\n", tree->depth);
+        len += sprintf(info + len, "index_ordered_size_bytes: %lu\n", tree->size);
+        len += sprintf(info + len, "index_ordered_size_kb: %.2f\n", KB(tree->size));
+    }
+
+    len += sprintf(info + len, "index_seqtable: %s\n", namespace->index->seqtable ? "yes" : "no");
+
+    if(namespace->index->seqtable) {
+        index_seqtable_t *seqtable = namespace->index->seqtable;
+        size_t seqsize = seqtable->allocated * sizeof(index_seqslot_t);
+
+        len += sprintf(info + len, "index_seqtable_entries: %zu\n", seqtable->length);
+        len += sprintf(info + len, "index_seqtable_size_bytes: %lu\n", seqsize);
+        len += sprintf(info + len, "index_seqtable_size_kb: %.2f\n", KB(seqsize));
+    }
+
+    len += sprintf(info + len, "index_seqmmap: %s\n", namespace->index->seqviews ? "yes" : "no");
+
+    if(namespace->index->seqviews) {
+        index_seqviews_t *seqviews = namespace->index->seqviews;
+
+        len += sprintf(info + len, "index_seqmmap_files: %u\n", seqviews->length);
+        len += sprintf(info + len, "index_seqmmap_size_bytes: %lu\n", seqviews->size);
+        len += sprintf(info + len, "index_seqmmap_size_mb: %.2f\n", MB(seqviews->size));
+    }
+
     len += sprintf(info + len, "stats_index_io_errors: %lu\n", namespace->index->stats.errors);
     len += sprintf(info + len, "stats_index_io_error_last: %ld\n", namespace->index->stats.lasterr);
+    len += sprintf(info + len, "stats_index_hits: %lu\n", namespace->index->stats.hits);
     len += sprintf(info + len, "stats_index_faults: %lu\n", namespace->index->stats.faults);
     len += sprintf(info + len, "stats_data_io_errors: %lu\n", namespace->data->stats.errors);
     len += sprintf(info + len, "stats_data_io_error_last: %ld\n", namespace->data->stats.lasterr);
+    len += sprintf(info + len, "stats_data_hits: %lu\n", namespace->data->stats.hits);
     len += sprintf(info + len, "stats_data_faults: %lu\n", namespace->data->stats.faults);
+    len += sprintf(info + len, "stats_index_fdcache_hits: %lu\n", namespace->index->fdcache.hits);
+    len += sprintf(info + len, "stats_index_fdcache_misses: %lu\n", namespace->index->fdcache.misses);
+    len += sprintf(info + len, "stats_data_fdcache_hits: %lu\n", namespace->data->fdcache.hits);
+    len += sprintf(info + len, "stats_data_fdcache_misses: %lu\n", namespace->data->fdcache.misses);
 
     if(namespace->maxsize > 0)
         len += sprintf(info + len, "space_available: %lu\n", available);
@@ -415,6 +463,38 @@ static int command_nsset_worm(namespace_t *namespace, char *value) {
     return 0;
 }
 
+// NSSET cache
+static int command_nsset_cache(namespace_t *namespace, char *value) {
+    namespace->cache = (value[0] == '1') ? 1 : 0;
+    data_cache_admission(namespace->data, namespace->cache);
+    zdbd_debug("[+] command: nsset: changing values cache admission to: %d\n", namespace->cache);
+
+    return 0;
+}
+
+// NSSET ordered
+static int command_nsset_ordered(redis_client_t *client, namespace_t *namespace, char *value) {
+    int ordered = (value[0] == '1') ? 1 : 0;
+
+    if(ordered && namespace->index->mode != ZDB_MODE_KEY_VALUE) {
+        redis_hardsend(client, "-Index running mode doesn't support this feature");
+        return 1;
+    }
+
+    if(ordered && index_tree_enable(namespace->index)) {
+        redis_hardsend(client, "-Cannot build ordered index");
+        return 1;
+    }
+
+    if(!ordered)
+        index_tree_disable(namespace->index);
+
+    namespace->ordered = ordered;
+    zdbd_debug("[+] command: nsset: changing ordered index to: %d\n", namespace->ordered);
+
+    return 0;
+}
+
 // NSSET mode
 static int command_nsset_mode(redis_client_t *client, namespace_t *namespace, char *value) {
      zdb_settings_t *settings = zdb_settings_get();
@@ -480,6 +560,8 @@ static int command_nsset_freeze(namespace_t *namespace, char *value) {
 //                                          if this is more than actual size, there
 //                                          is no shrink, it stay as it
 //   NSSET [namespace] public [1 or 0]   -> enable or disable public access
+//   NSSET [namespace] cache [1 or 0]    -> enable or disable values cache admission
+//   NSSET [namespace] ordered [1 or 0]  -> enable or disable ordered index (KSCAN, KRANGE)
 int command_nsset(redis_client_t *client) {
     resp_request_t *request = client->request;
     namespace_t *namespace = NULL;
@@ -531,6 +613,14 @@ int command_nsset(redis_client_t *client) {
         if(command_nsset_freeze(namespace, value) == 1)
             return 1;
 
+    } else if(strcmp(command, "cache") == 0) {
+        if(command_nsset_cache(namespace, value) == 1)
+            return 1;
+
+    } else if(strcmp(command, "ordered") == 0) {
+        if(command_nsset_ordered(client, namespace, value) == 1)
+            return 1;
+
     // checking if we try to change settings on
     // the default namespace, after this point, we
     // deny any changes on default namespace
@@ -606,6 +696,9 @@ int command_reload(redis_client_t *client) {
         return 1;
     }
 
+    // reads queued on the read pool can't use it anymore
+    readpool_cancel();
+
     // reload that namespace
     namespace_reload(namespace);
 
@@ -622,6 +715,9 @@ int command_flush(redis_client_t *client) {
         return 1;
     }
 
+    // reads queued on the read pool can't use it anymore
+    readpool_cancel();
+
     if(namespace_flush(namespace)) {
         redis_hardsend(client, "-Internal Server Error");
         return 1;
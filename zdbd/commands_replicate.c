@@ -16,7 +16,7 @@ int command_mirror(redis_client_t *client) {
     if(!command_admin_authorized(client))
         return 1;
 
-    client->mirror = 1;
+    redis_client_set_mirror(client);
     redis_hardsend(client, "+Starting mirroring");
 
     return 0;
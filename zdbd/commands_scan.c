@@ -27,38 +27,83 @@ uint64_t ustime() {
 //
 // scan list management
 //
+// entries are serialized on the list buffer while walking, this
+// buffer is then sent as it is, after the reply header
+//
+static void scanlist_init(scan_list_t *scanlist) {
+    memset(scanlist, 0x00, sizeof(scan_list_t));
+}
+
+static void scanlist_free(scan_list_t *scanlist) {
+    free(scanlist->buffer);
+}
+
+// write prefix followed by value (in decimal), this is called
+// a few times per entry, sprintf is too slow for that
+static inline char *scanlist_header(char *target, char *prefix, size_t length, uint32_t value) {
+    char digits[16];
+    int index = sizeof(digits);
+
+    memcpy(target, prefix, length);
+    target += length;
+
+    do {
+        digits[--index] = '0' + (value % 10);
+        value /= 10;
+    } while(value);
 
-// append one entry into the scanlist result
+    memcpy(target, digits + index, sizeof(digits) - index);
+    target += sizeof(digits) - index;
+
+    return target;
+}
+
+// append current entry of the cursor into the scanlist result
 // if the list is not large enough to contains the entry
-// growing it up a little bit
-static scan_list_t *scanlist_append(scan_list_t *scanlist, index_scan_t *scan, scan_info_t *info) {
-    if(scanlist->length + 1 > scanlist->allocated) {
-        scanlist->allocated += 32;
+// growing it up
+static scan_list_t *scanlist_append(scan_list_t *scanlist, index_cursor_t *cursor) {
+    index_item_t *item = cursor->item;
 
-        if(!(scanlist->items = realloc(scanlist->items, scanlist->allocated * sizeof(index_item_t *))))
-            return NULL;
+    // array of 3 entries: key, payload length and timestamp
+    if(scanlist->used + item->idlength + 64 > scanlist->allocated) {
+        size_t allocated = (scanlist->allocated) ? scanlist->allocated * 2 : SCAN_LIST_INITIAL;
+        unsigned char *buffer;
 
-        if(!(scanlist->scansinfo = realloc(scanlist->scansinfo, scanlist->allocated * sizeof(scan_info_t))))
+        if(!(buffer = realloc(scanlist->buffer, allocated)))
             return NULL;
+
+        scanlist->buffer = buffer;
+        scanlist->allocated = allocated;
     }
 
-    scanlist->items[scanlist->length] = scan->header;
-    scanlist->scansinfo[scanlist->length] = *info;
-    scanlist->length += 1;
+    char *target = (char *) scanlist->buffer + scanlist->used;
+    char *start = target;
 
-    return scanlist;
-}
+    target = scanlist_header(target, "*3\r\n$", 5, item->idlength);
 
-static void scanlist_init(scan_list_t *scanlist) {
-    memset(scanlist, 0x00, sizeof(scan_list_t));
-}
+    memcpy(target, "\r\n", 2);
+    target += 2;
 
-static void scanlist_free(scan_list_t *scanlist) {
-    for(size_t i = 0; i < scanlist->length; i++)
-        free(scanlist->items[i]);
+    memcpy(target, item->id, item->idlength);
+    target += item->idlength;
+
+    target = scanlist_header(target, "\r\n:", 3, item->length);
+    target = scanlist_header(target, "\r\n:", 3, item->timestamp);
+
+    memcpy(target, "\r\n", 2);
+    target += 2;
 
-    free(scanlist->items);
-    free(scanlist->scansinfo);
+    scanlist->used += target - start;
+    scanlist->length += 1;
+
+    // keeping track of the last entry, needed
+    // to build the key of the next call
+    scanlist->last = *item;
+    scanlist->info.idxid = cursor->fileid;
+    scanlist->info.idxoffset = cursor->offset;
+    scanlist->info.dataid = item->dataid;
+
+    return scanlist;
 }
 
 static void scaninfo_dump(scan_info_t *info) {
@@ -69,14 +114,6 @@ static void scaninfo_dump(scan_info_t *info) {
 #endif
 }
 
-static void scaninfo_from_scan(scan_info_t *info, index_scan_t *scan) {
-    info->dataid = scan->header->dataid;
-    info->idxid = scan->fileid;
-    info->idxoffset = scan->target;
-
-    scaninfo_dump(info);
-}
-
 static void scaninfo_from_entry(scan_info_t *info, index_entry_t *entry) {
     info->dataid = entry->dataid;
     info->idxid = entry->indexid;
@@ -89,10 +126,7 @@ static void scaninfo_from_entry(scan_info_t *info, index_entry_t *entry) {
 // redis serialization of the scan list
 //
 static int command_scan_send_scanlist(scan_list_t *scanlist, redis_client_t *client) {
-    char *response;
-    size_t offset = 0;
-    index_item_t *entry;
-    scan_info_t *scaninfo;
+    char header[sizeof(index_bkey_t) + 64];
     index_bkey_t bkey;
 
     // if the list is empty, we have nothing
@@ -102,68 +136,36 @@ static int command_scan_send_scanlist(scan_list_t *scanlist, redis_client_t *cli
         return 0;
     }
 
-    for(size_t i = 0; i < scanlist->length; i++) {
-        scaninfo_dump(&scanlist->scansinfo[i]);
-    }
+    scaninfo_dump(&scanlist->info);
 
     // array response, with 2 arguments:
     //  - first one is the next SCAN key value
     //    (in our case, this is always the same value as the returned id)
     //  - the second one is another array, of each keys found, each entry containins
     //    information about this key like timestamp and size
-    if(!(response = malloc(((MAX_KEY_LENGTH * 2) + 128) * scanlist->length)))
-        return 1;
-
+    //
     // converting the last object key into a binary serialized key
-    entry = scanlist->items[scanlist->length - 1];
-    scaninfo = &scanlist->scansinfo[scanlist->length - 1];
-    bkey = index_item_serialize(entry, scaninfo->idxoffset, scaninfo->idxid);
+    bkey = index_item_serialize(&scanlist->last, scanlist->info.idxoffset, scanlist->info.idxid);
 
     // get last entry for the next key value
-    offset = sprintf(response, "*2\r\n$%ld\r\n", sizeof(index_bkey_t));
+    size_t offset = sprintf(header, "*2\r\n$%ld\r\n", sizeof(index_bkey_t));
 
     // copy the key
-    memcpy(response + offset, &bkey, sizeof(index_bkey_t));
+    memcpy(header + offset, &bkey, sizeof(index_bkey_t));
     offset += sizeof(index_bkey_t);
 
-    // iterating over the full list and building the list response
-    offset += sprintf(response + offset, "\r\n*%lu\r\n", scanlist->length);
-
-    for(size_t i = 0; i < scanlist->length; i++) {
-        entry = scanlist->items[i];
-
-        // end of the key
-        // adding the array of response with the single response
-        offset += sprintf(response + offset, "*3\r\n");
-
-        // adding the key
-        offset += sprintf(response + offset, "$%u\r\n", entry->idlength);
-        memcpy(response + offset, entry->id, entry->idlength);
-        offset += entry->idlength;
+    // list of entries, already serialized
+    offset += sprintf(header + offset, "\r\n*%lu\r\n", scanlist->length);
 
-        // adding the length of the payload
-        offset += sprintf(response + offset, "\r\n:%d\r\n", entry->length);
+    redis_reply_stack(client, header, offset);
+    redis_reply_heap(client, scanlist->buffer, scanlist->used, free);
 
-        // adding the timestamp to the payload
-        offset += sprintf(response + offset, ":%d\r\n", entry->timestamp);
-    }
-
-    redis_reply_heap(client, response, offset, free);
+    // buffer is now owned by the reply
+    scanlist->buffer = NULL;
 
     return 0;
 }
 
-static scan_info_t *scan_initial_info(scan_info_t *info, scan_list_t *scanlist, index_scan_t *scan) {
-    // could not get initial scan entry
-    if(scan->status != INDEX_SCAN_SUCCESS)
-        return NULL;
-
-    scaninfo_from_scan(info, scan);
-    scanlist_append(scanlist, scan, info);
-
-    return info;
-}
-
 static scan_info_t *scan_initial_get(scan_info_t *info, redis_client_t *client) {
     index_entry_t *entry = NULL;
     index_bkey_t bkey;
@@ -182,88 +184,138 @@ static scan_info_t *scan_initial_get(scan_info_t *info, redis_client_t *client)
         return NULL;
     }
 
-    // FIXME
-    #if 0
-    // grabbing original entry
-    if(!(entry = redis_get_handlers[rootsettings.mode](client))) {
-        zdbd_debug("[-] command: scan: key not found\n");
-        redis_hardsend(client, "-Invalid index");
-        return NULL;
-    }
-
-    if(index_entry_is_deleted(entry)) {
-        zdbd_verbose("[-] command: scan: key deleted\n");
-        redis_hardsend(client, "-Invalid index");
-        return NULL;
-    }
-    #endif
-
     scaninfo_from_entry(info, entry);
-    // scaninfo_dump(info);
     free(entry);
 
     return info;
 }
 
-static int scan_failure(index_scan_t *scan, redis_client_t *client) {
-    if(scan->status == INDEX_SCAN_NO_MORE_DATA)
+static int scan_failure(index_scan_status_t status, redis_client_t *client) {
+    if(status == INDEX_SCAN_NO_MORE_DATA)
         redis_hardsend(client, "-No more data");
 
-    if(scan->status == INDEX_SCAN_UNEXPECTED)
+    if(status == INDEX_SCAN_UNEXPECTED)
         redis_hardsend(client, "-Internal Error");
 
     return 1;
 }
 
+// optional 'COUNT count' arguments, starting at argument 'index', count
+// is set when valid, otherwise an error is sent and 1 is returned
+static int scan_count_option(redis_client_t *client, int index, size_t maximum, size_t *count) {
+    resp_object_t *keyword = client->request->argv[index];
+    resp_object_t *argument = client->request->argv[index + 1];
+    char buffer[16];
+
+    if(keyword->length != 5 || strncasecmp(keyword->buffer, "COUNT", 5)) {
+        redis_hardsend(client, "-Invalid arguments");
+        return 1;
+    }
+
+    if(argument->length == 0 || argument->length > 8) {
+        redis_hardsend(client, "-Invalid count");
+        return 1;
+    }
+
+    for(int i = 0; i < argument->length; i++) {
+        if(((char *) argument->buffer)[i] < '0' || ((char *) argument->buffer)[i] > '9') {
+            redis_hardsend(client, "-Invalid count");
+            return 1;
+        }
+    }
+
+    memset(buffer, 0, sizeof(buffer));
+    memcpy(buffer, argument->buffer, argument->length);
+
+    size_t value = strtoul(buffer, NULL, 10);
+
+    if(value == 0 || value > maximum) {
+        redis_hardsend(client, "-Invalid count");
+        return 1;
+    }
+
+    *count = value;
+
+    return 0;
+}
+
 //
-// SCAN
+// SCAN and RSCAN
 //
-int command_scan(redis_client_t *client) {
-    index_scan_t scan;
+// walk forward (SCAN) or backward (RSCAN) from the key provided (or
+// from the first or last key), during SCAN_TIMESLICE_US at most
+//
+static int command_scan_walk(redis_client_t *client, int backward) {
+    index_scan_status_t status;
+    index_cursor_t *cursor;
     scan_list_t scanlist;
     scan_info_t info;
 
     if(namespace_is_frozen(client->ns))
         return command_error_frozen(client);
 
+    if(!(cursor = index_cursor_new(client->ns->index))) {
+        redis_hardsend(client, "-Internal Error");
+        return 1;
+    }
+
     // initialize empty scanlist
     scanlist_init(&scanlist);
 
     // scan requested without initial key
     if(client->request->argc == 1) {
-        scan = index_first_header(client->ns->index);
+        status = (backward) ? index_cursor_last(cursor) : index_cursor_first(cursor);
 
-        if(!scan_initial_info(&info, &scanlist, &scan))
-            return scan_failure(&scan, client);
+        if(status != INDEX_SCAN_SUCCESS || !scanlist_append(&scanlist, cursor)) {
+            index_cursor_free(cursor);
+            scanlist_free(&scanlist);
+            return scan_failure(status, client);
+        }
 
     } else {
         // scan requested with an initial key
-        if(!scan_initial_get(&info, client))
+        if(!scan_initial_get(&info, client)) {
+            index_cursor_free(cursor);
             return 1;
+        }
+
+        index_cursor_seek(cursor, info.idxid, info.idxoffset);
     }
 
     // we have everything needed to start walking over
     // the keys and building our scan response
     uint64_t basetime = ustime();
 
-    while(ustime() - basetime < SCAN_TIMESLICE_US) {
-        zdbd_debug("[+] scan: elapsed time: %" PRIu64 " us\n", ustime() - basetime);
+    while(1) {
+        // clock is only checked every few entries,
+        // reading it costs more than parsing an entry
+        if(scanlist.length % SCAN_TIMESLICE_CHECK == 0 && ustime() - basetime >= SCAN_TIMESLICE_US)
+            break;
 
-        // reading entry and appending it
-        scan = index_next_header(client->ns->index, info.idxid, info.idxoffset);
+        status = (backward) ? index_cursor_previous(cursor) : index_cursor_next(cursor);
 
         // this scan failed, let's guess it's the end
-        if(scan.status != INDEX_SCAN_SUCCESS)
+        if(status != INDEX_SCAN_SUCCESS)
             break;
 
-        // preparing next call
-        scaninfo_from_scan(&info, &scan);
-
         // append object to the list
-        scanlist_append(&scanlist, &scan, &info);
+        if(!scanlist_append(&scanlist, cursor)) {
+            zdbd_warnp("command: scan: realloc");
+            break;
+        }
     }
 
-    zdbd_debug("[+] scan: retreived %lu entries in %" PRIu64 " us\n", scanlist.length, ustime() - basetime);
+#ifndef RELEASE
+    char *name = (backward) ? "rscan" : "scan";
+    uint64_t elapsed = ustime() - basetime;
+
+    zdbd_debug("[+] %s: retreived %lu entries in %" PRIu64 " us (%.0f keys/sec)\n",
+               name, scanlist.length, elapsed, (elapsed) ? (scanlist.length * 1000000.0) / elapsed : 0.0);
+
+    zdbd_debug("[+] %s: %lu deleted entries skipped, %lu blocks read\n", name, cursor->deleted, cursor->reads);
+#endif
+
+    index_cursor_free(cursor);
 
     if(command_scan_send_scanlist(&scanlist, client))
         redis_hardsend(client, "-Internal Error");
@@ -272,63 +324,275 @@ int command_scan(redis_client_t *client) {
     return 0;
 }
 
+int command_scan(redis_client_t *client) {
+    return command_scan_walk(client, 0);
+}
+
+int command_rscan(redis_client_t *client) {
+    return command_scan_walk(client, 1);
+}
+
 //
-// RSCAN
+// SCANV and RSCANV
 //
-int command_rscan(redis_client_t *client) {
-    index_scan_t scan;
-    scan_list_t scanlist;
+// same walk as SCAN and RSCAN, but values are returned with the keys, this
+// avoid a GET (and an index lookup) per key to export a dataset, walk stops
+// after COUNT entries, before payloads exceed SCANV_MAX_PAYLOADS or after
+// SCAN_TIMESLICE_US, payloads are then read at once, ordered by location
+// (see data_get_batch), neighbor payloads are read with a single syscall
+//
+// a payload larger than SCANV_MAX_PAYLOADS (streamed value) is never
+// read, an error is returned in place, GETRANGE can be used instead
+//
+static void scanvlist_free(scanv_list_t *list) {
+    for(size_t i = 0; i < list->batchlength; i++)
+        free(list->batch[i].payload.buffer);
+
+    free(list->entries);
+    free(list->batch);
+    free(list->keys);
+}
+
+static scanv_list_t *scanvlist_append(scanv_list_t *list, index_cursor_t *cursor) {
+    index_item_t *item = cursor->item;
+
+    if(list->length + 1 > list->allocated) {
+        size_t allocated = (list->allocated) ? list->allocated * 2 : 64;
+        scanv_entry_t *entries;
+        data_batch_t *batch;
+
+        if(!(entries = realloc(list->entries, allocated * sizeof(scanv_entry_t))))
+            return NULL;
+
+        list->entries = entries;
+
+        if(!(batch = realloc(list->batch, allocated * sizeof(data_batch_t))))
+            return NULL;
+
+        list->batch = batch;
+        list->allocated = allocated;
+    }
+
+    if(list->keysused + item->idlength > list->keysallocated) {
+        size_t allocated = (list->keysallocated) ? list->keysallocated * 2 : 16 * 1024;
+        unsigned char *keys;
+
+        if(!(keys = realloc(list->keys, allocated)))
+            return NULL;
+
+        list->keys = keys;
+        list->keysallocated = allocated;
+    }
+
+    scanv_entry_t *entry = &list->entries[list->length];
+
+    entry->bkey = index_item_serialize(item, cursor->offset, cursor->fileid);
+    entry->timestamp = item->timestamp;
+    entry->idlength = item->idlength;
+    entry->key = list->keysused;
+    entry->batch = -1;
+
+    memcpy(list->keys + list->keysused, item->id, item->idlength);
+    list->keysused += item->idlength;
+
+    list->length += 1;
+
+    // payload too large, not read
+    if(item->length > SCANV_MAX_PAYLOADS)
+        return list;
+
+    data_batch_t *batch = &list->batch[list->batchlength];
+
+    batch->dataid = item->dataid;
+    batch->offset = item->offset;
+    batch->length = item->length;
+    batch->idlength = item->idlength;
+    batch->payload.buffer = NULL;
+    batch->payload.length = 0;
+
+    entry->batch = list->batchlength;
+    list->batchlength += 1;
+    list->payloads += item->length;
+
+    return list;
+}
+
+// payload of this entry would exceed the budget, entry is kept
+// for the next call (except if the list is still empty)
+static int scanvlist_full(scanv_list_t *list, index_item_t *item) {
+    if(list->length == 0 || item->length > SCANV_MAX_PAYLOADS)
+        return 0;
+
+    return (list->payloads + item->length > SCANV_MAX_PAYLOADS);
+}
+
+static int command_scanv_send_list(scanv_list_t *list, redis_client_t *client) {
+    size_t offset = 0;
+    char *response;
+
+    if(list->length == 0) {
+        redis_hardsend(client, "-No more data");
+        return 0;
+    }
+
+    // computing reply length, to build it at once
+    size_t length = 64 + sizeof(index_bkey_t);
+
+    for(size_t i = 0; i < list->length; i++)
+        length += list->entries[i].idlength + sizeof(index_bkey_t) + 96;
+
+    for(size_t i = 0; i < list->batchlength; i++)
+        length += list->batch[i].length;
+
+    if(!(response = malloc(length)))
+        return 1;
+
+    // array response, with 2 arguments, like SCAN: the next cursor and
+    // the entries, each entry contains 4 fields: key, payload,
+    // timestamp and cursor of this entry
+    offset = sprintf(response, "*2\r\n$%zu\r\n", sizeof(index_bkey_t));
+    memcpy(response + offset, &list->entries[list->length - 1].bkey, sizeof(index_bkey_t));
+    offset += sizeof(index_bkey_t);
+
+    offset += sprintf(response + offset, "\r\n*%zu\r\n", list->length);
+
+    for(size_t i = 0; i < list->length; i++) {
+        scanv_entry_t *entry = &list->entries[i];
+        data_payload_t *payload = (entry->batch >= 0) ? &list->batch[entry->batch].payload : NULL;
+
+        offset += sprintf(response + offset, "*4\r\n$%u\r\n", entry->idlength);
+        memcpy(response + offset, list->keys + entry->key, entry->idlength);
+        offset += entry->idlength;
+
+        if(!payload) {
+            offset += sprintf(response + offset, "\r\n-Payload too large, use GETRANGE");
+
+        } else if(payload->buffer) {
+            offset += sprintf(response + offset, "\r\n$%zu\r\n", payload->length);
+            memcpy(response + offset, payload->buffer, payload->length);
+            offset += payload->length;
+
+        } else {
+            zdb_log("[-] command: scanv: cannot read payload\n");
+            offset += sprintf(response + offset, "\r\n-Internal Error");
+        }
+
+        offset += sprintf(response + offset, "\r\n:%u\r\n$%zu\r\n", entry->timestamp, sizeof(index_bkey_t));
+        memcpy(response + offset, &entry->bkey, sizeof(index_bkey_t));
+        offset += sizeof(index_bkey_t);
+
+        memcpy(response + offset, "\r\n", 2);
+        offset += 2;
+    }
+
+    redis_reply_heap(client, response, offset, free);
+
+    return 0;
+}
+
+// SCANV [cursor] [COUNT count]
+static int command_scanv_walk(redis_client_t *client, int backward) {
+    resp_request_t *request = client->request;
+    size_t count = SCANV_MAX_COUNT;
+    index_scan_status_t status;
+    index_cursor_t *cursor;
+    scanv_list_t list;
     scan_info_t info;
 
+    if(request->argc > 4) {
+        redis_hardsend(client, "-Invalid arguments");
+        return 1;
+    }
+
+    // optional COUNT at the end, with or without cursor
+    int counter = (request->argc == 3 || request->argc == 4);
+
+    if(counter && scan_count_option(client, request->argc - 2, SCANV_MAX_COUNT, &count))
+        return 1;
+
     if(namespace_is_frozen(client->ns))
         return command_error_frozen(client);
 
-    // initialize empty scanlist
-    scanlist_init(&scanlist);
+    if(!(cursor = index_cursor_new(client->ns->index))) {
+        redis_hardsend(client, "-Internal Error");
+        return 1;
+    }
 
-    // scan requested without initial key
-    if(client->request->argc == 1) {
-        scan = index_last_header(client->ns->index);
+    memset(&list, 0x00, sizeof(scanv_list_t));
+
+    // walk requested without initial key
+    if(request->argc == 1 || request->argc == 3) {
+        status = (backward) ? index_cursor_last(cursor) : index_cursor_first(cursor);
 
-        if(!scan_initial_info(&info, &scanlist, &scan))
-            return scan_failure(&scan, client);
+        if(status != INDEX_SCAN_SUCCESS || !scanvlist_append(&list, cursor)) {
+            index_cursor_free(cursor);
+            scanvlist_free(&list);
+            return scan_failure(status, client);
+        }
 
     } else {
-        // scan requested with an initial key
-        if(!scan_initial_get(&info, client))
+        // walk requested with an initial key
+        if(!scan_initial_get(&info, client)) {
+            index_cursor_free(cursor);
             return 1;
+        }
+
+        index_cursor_seek(cursor, info.idxid, info.idxoffset);
     }
 
-    // we have everything needed to start walking over
-    // the keys and building our scan response
     uint64_t basetime = ustime();
 
-    while(ustime() - basetime < SCAN_TIMESLICE_US) {
-        zdbd_debug("[+] rscan: elapsed time: %" PRIu64 " us\n", ustime() - basetime);
+    while(list.length < count) {
+        // same as SCAN, clock is only checked every few entries
+        if(list.length % SCAN_TIMESLICE_CHECK == 0 && ustime() - basetime >= SCAN_TIMESLICE_US)
+            break;
 
-        // reading entry and appending it
-        scan = index_previous_header(client->ns->index, info.idxid, info.idxoffset);
+        status = (backward) ? index_cursor_previous(cursor) : index_cursor_next(cursor);
 
-        // this scan failed, let's guess it's the end
-        if(scan.status != INDEX_SCAN_SUCCESS)
+        if(status != INDEX_SCAN_SUCCESS)
             break;
 
-        // preparing next call
-        scaninfo_from_scan(&info, &scan);
+        // this payload doesn't fit anymore, next call starts from it
+        if(scanvlist_full(&list, cursor->item))
+            break;
 
-        // append object to the list
-        scanlist_append(&scanlist, &scan, &info);
+        if(!scanvlist_append(&list, cursor)) {
+            zdbd_warnp("command: scanv: realloc");
+            break;
+        }
     }
 
-    zdbd_debug("[+] rscan: retreived %lu entries in %" PRIu64 " us\n", scanlist.length, ustime() - basetime);
+    index_cursor_free(cursor);
 
-    if(command_scan_send_scanlist(&scanlist, client))
+#ifndef RELEASE
+    char *name = (backward) ? "rscanv" : "scanv";
+    uint64_t walked = ustime() - basetime;
+#endif
+
+    // reading all payloads at once
+    data_get_batch(client->ns->data, list.batch, list.batchlength);
+
+#ifndef RELEASE
+    zdbd_debug("[+] %s: %zu entries (%zu bytes), walked in %" PRIu64 " us, read in %" PRIu64 " us\n",
+               name, list.length, list.payloads, walked, ustime() - basetime - walked);
+#endif
+
+    if(command_scanv_send_list(&list, client))
         redis_hardsend(client, "-Internal Error");
 
-    scanlist_free(&scanlist);
+    scanvlist_free(&list);
+
     return 0;
 }
 
+int command_scanv(redis_client_t *client) {
+    return command_scanv_walk(client, 0);
+}
+
+int command_rscanv(redis_client_t *client) {
+    return command_scanv_walk(client, 1);
+}
+
 //
 // KEYCUR
 //
@@ -404,11 +668,20 @@ void list_free(list_t *list) {
 
 
 //
-// KSCAN
+// KSCAN and KRANGE
+//
+// keys are returned in order, walking the ordered index of the namespace
+// (see index_tree.c), starting from the prefix (or range start) or after
+// the cursor, at most 'count' keys are returned, the cursor returned is
+// the last key sent, it's empty when there are no more keys
+//
+// without ordered index (debug only), every entries are walked and
+// matching keys are sorted afterward
 //
-static int command_kscan_send_list(redis_client_t *client, list_t *list) {
+static int command_kscan_send_list(redis_client_t *client, list_t *list, index_entry_t *next) {
     char *response;
     size_t offset = 0;
+    size_t length = 64;
     index_entry_t *entry;
 
     // if the list is empty, we have nothing
@@ -418,18 +691,28 @@ static int command_kscan_send_list(redis_client_t *client, list_t *list) {
         return 0;
     }
 
-    // array response, with 2 arguments:
-    //  - first one is the next SCAN key value
-    //    (in our case, this is always the same value as the returned id)
-    //  - the second one is another array, of each keys found, each entry containins
-    //    information about this key like timestamp and size
-    if(!(response = malloc(((MAX_KEY_LENGTH * 2) + 128) * list->length)))
+    for(size_t i = 0; i < list->length; i++)
+        length += ((index_entry_t *) list->items[i])->idlength + 16;
+
+    if(next)
+        length += next->idlength;
+
+    if(!(response = malloc(length)))
         return 1;
 
-    offset = sprintf(response, "*2\r\n$1\r\n0\r\n");
+    // array response, with 2 arguments:
+    //  - first one is the cursor to send to continue walking
+    //    (the last key sent), empty when there are no more keys
+    //  - the second one is another array, of each keys found
+    offset = sprintf(response, "*2\r\n$%u\r\n", next ? next->idlength : 0);
+
+    if(next) {
+        memcpy(response + offset, next->id, next->idlength);
+        offset += next->idlength;
+    }
 
     // iterating over the full list and building the list response
-    offset += sprintf(response + offset, "*%lu\r\n", list->length);
+    offset += sprintf(response + offset, "\r\n*%lu\r\n", list->length);
 
     for(size_t i = 0; i < list->length; i++) {
         entry = list->items[i];
@@ -448,14 +731,111 @@ static int command_kscan_send_list(redis_client_t *client, list_t *list) {
     return 0;
 }
 
-int command_kscan(redis_client_t *client) {
+typedef struct kscan_query_t {
+    resp_object_t *prefix;  // keys starting with this prefix (or NULL)
+    resp_object_t *start;   // first key, included (or NULL)
+    resp_object_t *end;     // last key, excluded (or NULL)
+    resp_object_t *cursor;  // last key of the previous call (or NULL)
+    size_t count;           // maximum amount of keys returned
+    list_t keys;
+
+} kscan_query_t;
+
+static inline int kscan_compare(index_entry_t *entry, resp_object_t *key) {
+    return index_tree_compare(entry->id, entry->idlength, key->buffer, key->length);
+}
+
+// key is not before the first key requested
+static int kscan_query_after_start(kscan_query_t *query, index_entry_t *entry) {
+    if(query->start && kscan_compare(entry, query->start) < 0)
+        return 0;
+
+    if(query->cursor && kscan_compare(entry, query->cursor) <= 0)
+        return 0;
+
+    return 1;
+}
+
+// key is not after the last key requested, since keys are walked
+// in order, the walk can stop on the first key where this is false
+static int kscan_query_before_end(kscan_query_t *query, index_entry_t *entry) {
+    if(query->prefix) {
+        if(entry->idlength < query->prefix->length)
+            return 0;
+
+        if(memcmp(entry->id, query->prefix->buffer, query->prefix->length))
+            return 0;
+    }
+
+    if(query->end && query->end->length && kscan_compare(entry, query->end) >= 0)
+        return 0;
+
+    return 1;
+}
+
+// walking the ordered index, one extra key is kept
+// to know if there are more keys after the last one
+static void kscan_query_ordered(index_tree_t *tree, kscan_query_t *query) {
+    resp_object_t *from = query->start;
+    index_tree_cursor_t cursor;
+    index_entry_t *entry;
+
+    if(query->cursor && (!from || index_tree_compare(query->cursor->buffer, query->cursor->length, from->buffer, from->length) >= 0))
+        from = query->cursor;
+
+    // without lower bound, starting from the first key
+    if(from) {
+        entry = index_tree_seek(tree, &cursor, from->buffer, from->length);
+
+    } else {
+        entry = index_tree_seek(tree, &cursor, (unsigned char *) "", 0);
+    }
+
+    for(; entry && query->keys.length <= query->count; entry = index_tree_next(&cursor)) {
+        if(!kscan_query_after_start(query, entry))
+            continue;
+
+        if(!kscan_query_before_end(query, entry))
+            break;
+
+        list_append(&query->keys, entry);
+    }
+}
+
+static int kscan_query_walker(index_entry_t *entry, void *userptr) {
+    kscan_query_t *query = (kscan_query_t *) userptr;
+
+    if(kscan_query_after_start(query, entry) && kscan_query_before_end(query, entry))
+        list_append(&query->keys, entry);
+
+    return 0;
+}
+
+static int kscan_query_sort(const void *a, const void *b) {
+    index_entry_t *x = *(index_entry_t **) a;
+    index_entry_t *y = *(index_entry_t **) b;
+
+    return index_tree_compare(x->id, x->idlength, y->id, y->idlength);
+}
+
+// walking every entries
+static void kscan_query_walk(index_root_t *index, kscan_query_t *query) {
+    index_walk(index, kscan_query_walker, query);
+    qsort(query->keys.items, query->keys.length, sizeof(void *), kscan_query_sort);
+}
+
+// common part of KSCAN and KRANGE, 'fixed' is the amount of arguments
+// before optional '[cursor] [COUNT count]'
+static int command_kscan_query(redis_client_t *client, kscan_query_t *query, int fixed) {
     resp_request_t *request = client->request;
     index_root_t *index = client->ns->index;
+    index_entry_t *next = NULL;
+    int options = request->argc - fixed;
 
-    #ifdef RELEASE
-    redis_hardsend(client, "-Command disabled in release code, not yet available");
-    return 1;
-    #endif
+    if(options < 0 || options > 3) {
+        redis_hardsend(client, "-Invalid arguments");
+        return 1;
+    }
 
     // it doesn't make sens to do that on sequential index
     if(index->mode != ZDB_MODE_KEY_VALUE) {
@@ -463,37 +843,78 @@ int command_kscan(redis_client_t *client) {
         return 1;
     }
 
-    if(!command_args_validate(client, 2))
-        return 1;
+    if(options == 1 || options == 3)
+        query->cursor = request->argv[fixed];
 
-    resp_object_t *key = request->argv[1];
-    list_t keys = list_init(NULL);
+    if(options >= 2 && scan_count_option(client, request->argc - 2, KSCAN_MAX_COUNT, &query->count))
+        return 1;
 
-    for(size_t i = 0; i < buckets_branches; i++) {
-        index_branch_t *branch = index->branches[i];
+    if(namespace_is_frozen(client->ns))
+        return command_error_frozen(client);
 
-        // skipping not allocated branches
-        if(!branch)
-            continue;
+    if(index->tree) {
+        kscan_query_ordered(index->tree, query);
 
-        for(index_entry_t *entry = branch->list; entry; entry = entry->next) {
-            // this key doesn't belong to the current namespace
-            if(entry->namespace != client->ns)
-                continue;
+    } else {
+        #ifdef RELEASE
+        redis_hardsend(client, "-Ordered index not enabled on this namespace");
+        return 1;
+        #endif
 
-            // key is shorter than requested prefix
-            // it won't match at all
-            if(entry->idlength < key->length)
-                continue;
+        kscan_query_walk(index, query);
+    }
 
-            if(memcmp(entry->id, key->buffer, key->length) == 0)
-                list_append(&keys, entry);
-        }
+    // more keys than requested, last key
+    // sent is the cursor for the next call
+    if(query->keys.length > query->count) {
+        query->keys.length = query->count;
+        next = query->keys.items[query->count - 1];
     }
 
-    command_kscan_send_list(client, &keys);
-    list_free(&keys);
+    command_kscan_send_list(client, &query->keys, next);
+    list_free(&query->keys);
 
     return 0;
 }
 
+// KSCAN prefix [cursor] [COUNT count]
+int command_kscan(redis_client_t *client) {
+    resp_request_t *request = client->request;
+
+    if(request->argc < 2) {
+        redis_hardsend(client, "-Invalid arguments");
+        return 1;
+    }
+
+    kscan_query_t query = {
+        .prefix = request->argv[1],
+        .start = request->argv[1],
+        .end = NULL,
+        .cursor = NULL,
+        .count = KSCAN_DEFAULT_COUNT,
+        .keys = list_init(NULL),
+    };
+
+    return command_kscan_query(client, &query, 2);
+}
+
+// KRANGE start end [cursor] [COUNT count]
+int command_krange(redis_client_t *client) {
+    resp_request_t *request = client->request;
+
+    if(request->argc < 3) {
+        redis_hardsend(client, "-Invalid arguments");
+        return 1;
+    }
+
+    kscan_query_t query = {
+        .prefix = NULL,
+        .start = request->argv[1],
+        .end = request->argv[2],
+        .cursor = NULL,
+        .count = KSCAN_DEFAULT_COUNT,
+        .keys = list_init(NULL),
+    };
+
+    return command_kscan_query(client, &query, 3);
+}
@@ -3,8 +3,11 @@
 
     int command_scan(redis_client_t *client);
     int command_rscan(redis_client_t *client);
+    int command_scanv(redis_client_t *client);
+    int command_rscanv(redis_client_t *client);
     int command_keycur(redis_client_t *client);
     int command_kscan(redis_client_t *client);
+    int command_krange(redis_client_t *client);
 
     typedef struct scan_info_t {
         fileid_t dataid;
@@ -13,14 +16,46 @@
 
     } scan_info_t;
 
+    // entries found by SCAN/RSCAN, already serialized
     typedef struct scan_list_t {
-        size_t length;
-        size_t allocated;
-        index_item_t **items;
-        scan_info_t *scansinfo;
+        size_t length;          // amount of entries
+        unsigned char *buffer;  // serialized entries
+        size_t used;            // amount of bytes used on buffer
+        size_t allocated;       // size of the buffer
+
+        index_item_t last;      // last entry header and location,
+        scan_info_t info;       // needed to build the next key
 
     } scan_list_t;
 
+    // one entry found by SCANV/RSCANV, payload
+    // location is on the batch list
+    typedef struct scanv_entry_t {
+        index_bkey_t bkey;   // cursor of this entry
+        uint32_t timestamp;  // entry timestamp
+        size_t key;          // key offset on the keys buffer
+        uint8_t idlength;    // key length
+        ssize_t batch;       // payload index on the batch list (-1 if too large)
+
+    } scanv_entry_t;
+
+    // entries found by SCANV/RSCANV, payloads are read
+    // at once at the end of the walk (see data_get_batch)
+    typedef struct scanv_list_t {
+        size_t length;           // amount of entries
+        size_t allocated;        // amount of entries allocated
+        scanv_entry_t *entries;  // entries found
+        data_batch_t *batch;     // payloads location and content
+        size_t batchlength;      // amount of payloads to read
+
+        unsigned char *keys;     // keys of entries
+        size_t keysused;         // amount of bytes used on keys
+        size_t keysallocated;    // size of keys buffer
+
+        size_t payloads;         // sum of payloads length
+
+    } scanv_list_t;
+
     typedef struct list_t {
         void **items;
         size_t length;
@@ -32,4 +67,22 @@
     // 2000 microseconds (2 milliseconds)
     #define SCAN_TIMESLICE_US  2000
 
+    // amount of entries walked between two clock checks
+    #define SCAN_TIMESLICE_CHECK  64
+
+    // initial size of the scan list buffer
+    #define SCAN_LIST_INITIAL  64 * 1024
+
+    // SCANV/RSCANV stops walking before payloads found exceed
+    // this size (at least one entry is always returned), a single
+    // payload larger than this is not returned (error in place)
+    #define SCANV_MAX_PAYLOADS  4 * 1024 * 1024
+
+    // maximum value of COUNT argument
+    #define SCANV_MAX_COUNT  65536
+
+    // amount of keys returned by KSCAN/KRANGE, by default and at most
+    #define KSCAN_DEFAULT_COUNT  1000
+    #define KSCAN_MAX_COUNT      65536
+
 #endif
@@ -12,6 +12,9 @@
 #include "redis.h"
 #include "commands.h"
 #include "commands_get.h"
+#include "commands_set.h"
+#include "groupcommit.h"
+#include "readpool.h"
 
 static time_t timestamp_from_set(resp_request_t *request) {
     // no timestamp on request, setting current time
@@ -79,6 +82,10 @@ static size_t redis_set_handler_userkey(redis_client_t *client, index_entry_t *e
         return 0;
     }
 
+    // previous payload is superseded
+    if(existing)
+        data_invalidate(data, existing->dataid, existing->offset);
+
     zdbd_debug("[+] command: set: userkey: ");
     zdbd_debughex(id, idlength);
 
@@ -116,6 +123,9 @@ static size_t redis_set_handler_userkey(redis_client_t *client, index_entry_t *e
         return 0;
     }
 
+    // hold the reply until the write is synced
+    groupcommit_register(client);
+
     redis_reply_heap(client, response.buffer, response.length, free);
 
     return offset;
@@ -187,6 +197,10 @@ static size_t redis_set_handler_sequential(redis_client_t *client, index_entry_t
         return 0;
     }
 
+    // previous payload is superseded
+    if(existing)
+        data_invalidate(data, existing->dataid, existing->offset);
+
     zdbd_debug("[+] command: set: sequential-key: ");
     zdbd_debughex(&id, idlength);
 
@@ -225,6 +239,9 @@ static size_t redis_set_handler_sequential(redis_client_t *client, index_entry_t
         return 0;
     }
 
+    // hold the reply until the write is synced
+    groupcommit_register(client);
+
     redis_reply_heap(client, response.buffer, response.length, free);
 
     return offset;
@@ -237,9 +254,370 @@ static size_t (*redis_set_handlers[])(redis_client_t *client, index_entry_t *exi
     redis_set_handler_sequential, // fixed blocks mode (not implemented yet)
 };
 
+//
+// streamed SET
+//
+// payload larger than REDIS_MAX_PAYLOAD are not kept in memory, as soon
+// as the payload header is parsed (key is already known), the entry is
+// started on the datafile (see data_stream_begin) and the payload is
+// written by chunk while received, crc is computed meanwhile
+//
+// when the request is complete, it's dispatched like any SET and the
+// entry is validated and indexed, only the client memory chunk is used
+// during the upload, whatever the payload size
+//
+// if the request can't be accepted, payload is still received (but
+// discarded) and the error is the reply of the request, if the client
+// disconnects before the end, the entry is aborted
+//
+// the datafile can't be changed during the upload (entry is
+// indexed on the current index file)
+//
+int command_set_streamable(redis_client_t *client) {
+    resp_request_t *request = client->request;
+    resp_object_t *command = request->argv[0];
+
+    // only the value of a plain SET (no timestamp) from a
+    // regular client (replication appends an argument)
+    if(request->argc != 3 || request->fillin != 2 || client->master)
+        return 0;
+
+    if(command->length == 3 && strncasecmp(command->buffer, "SET", 3) == 0)
+        return 1;
+
+    if(command->length == 4 && strncasecmp(command->buffer, "SETX", 4) == 0)
+        return 1;
+
+    return 0;
+}
+
+// check and start the stream, returns the error reply on failure
+static char *command_set_stream_start(redis_client_t *client, set_stream_t *stream, size_t length) {
+    resp_object_t *key = client->request->argv[1];
+    zdb_settings_t *zdb_settings = zdb_settings_get();
+
+    if(client->ns == NULL)
+        return "-Your active namespace is not available anymore (probably removed).\r\n";
+
+    index_root_t *index = client->ns->index;
+    data_root_t *data = client->ns->data;
+
+    if(key->length == 0)
+        return "-Invalid argument, key needed\r\n";
+
+    if(key->length > MAX_KEY_LENGTH)
+        return "-Key too large\r\n";
+
+    if(index->mode != ZDB_MODE_KEY_VALUE)
+        return "-Payload too big\r\n";
+
+    if(!client->writable)
+        return "-Namespace is in read-only mode\r\n";
+
+    if(namespace_is_frozen(client->ns))
+        return "-Namespace is temporarily frozen (read-write disabled)\r\n";
+
+    if(namespace_is_locked(client->ns))
+        return "-Namespace is temporarily locked (read-only)\r\n";
+
+    index_entry_t *existing = index_get(index, key->buffer, key->length);
+
+    if(existing && client->ns->worm)
+        return "-Namespace is protected by worm mode\r\n";
+
+    if(client->ns->maxsize) {
+        size_t floating = existing ? existing->length : 0;
+
+        if(index->stats.datasize + length > client->ns->maxsize + floating)
+            return "-No space left on this namespace\r\n";
+    }
+
+    // like any SET, an entry larger than a datafile is written
+    // alone on a new datafile, which then exceeds the limit
+    size_t entrylength = sizeof(data_entry_header_t) + key->length + length;
+
+    // jumping to the next files _before_ adding data (see command_set)
+    if(data_next_offset(data) + entrylength > zdb_settings->datasize) {
+        size_t newid;
+
+        if((newid = index_jump_next(index)) == 0)
+            return "-Namespace definitely full\r\n";
+
+        data_jump_next(data, newid);
+    }
+
+    data_request_t dreq = {
+        .data = NULL,
+        .datalength = length,
+        .vid = key->buffer,
+        .idlength = key->length,
+        .flags = 0,
+        .crc = 0,
+        .timestamp = stream->timestamp,
+    };
+
+    if(data_stream_begin(data, &stream->data, &dreq))
+        return "-Cannot write data right now\r\n";
+
+    stream->epoch = readpool_epoch();
+
+    return NULL;
+}
+
+// payload header of a streamed SET parsed, payload comes next, the
+// stream is always attached, returns 1 if the stream could not be
+// allocated (client needs to be discarded)
+int command_set_stream_begin(redis_client_t *client, size_t length) {
+    set_stream_t *stream;
+
+    if(!(stream = calloc(sizeof(set_stream_t), 1))) {
+        zdbd_warnp("command: set: stream: calloc");
+        return 1;
+    }
+
+    if(!(stream->buffer = malloc(SET_STREAM_CHUNK))) {
+        zdbd_warnp("command: set: stream: malloc");
+        free(stream);
+        return 1;
+    }
+
+    stream->data.fd = -1;
+    stream->data.length = length;
+    stream->timestamp = time(NULL);
+
+    zdbd_debug("[+] command: set: streaming %zu bytes payload\n", length);
+
+    command_engine_lock(0);
+    stream->error = command_set_stream_start(client, stream, length);
+    command_engine_unlock();
+
+    if(stream->error)
+        zdbd_debug("[-] command: set: stream refused: %s", stream->error);
+
+    client->stream = stream;
+
+    return 0;
+}
+
+// where the next bytes of the payload can be received, length is the
+// amount of bytes still expected and is reduced to the space available
+void *command_set_stream_target(redis_client_t *client, size_t *length) {
+    set_stream_t *stream = client->stream;
+    size_t available = SET_STREAM_CHUNK - stream->pending;
+
+    if(*length > available)
+        *length = available;
+
+    return stream->buffer + stream->pending;
+}
+
+// bytes received on the chunk, chunk is written when full or when
+// the payload is complete (trailing crlf is not part of it)
+//
+// when deferred, the chunk can be written by the event backend of the
+// client (io_uring) while next bytes are received, the last one is always
+// written inline, the entry is committed straight after
+static void command_set_stream_chunk(redis_client_t *client, size_t length, int deferred) {
+    set_stream_t *stream = client->stream;
+    data_stream_t *data = &stream->data;
+
+    stream->pending += length;
+    stream->received += length;
+
+    if(stream->pending < SET_STREAM_CHUNK && stream->received < data->length)
+        return;
+
+    size_t payload = data->length - data->written;
+
+    if(payload > stream->pending)
+        payload = stream->pending;
+
+    stream->pending = 0;
+
+    if(stream->error || payload == 0)
+        return;
+
+    if(deferred && stream->received < data->length) {
+        if(socket_uring_write(client, data->fd, stream->buffer, payload, data_stream_offset(data)) == 0) {
+            stream->writing = payload;
+            return;
+        }
+    }
+
+    if(data_stream_write(data, stream->buffer, payload))
+        stream->error = "-Cannot write data right now\r\n";
+}
+
+// bytes received straight on the chunk
+void command_set_stream_received(redis_client_t *client, size_t length) {
+    command_set_stream_chunk(client, length, 1);
+}
+
+// chunk still written by the event backend, nothing more can be
+// received (and processed) until it's done
+int command_set_stream_busy(redis_client_t *client) {
+    set_stream_t *stream = client->stream;
+    return (stream->writing != 0);
+}
+
+// chunk written by the event backend, error is
+// the errno of the write, zero on success
+void command_set_stream_written(redis_client_t *client, int error) {
+    set_stream_t *stream = client->stream;
+    size_t length = stream->writing;
+
+    stream->writing = 0;
+
+    if(data_stream_written(&stream->data, stream->buffer, length, error))
+        stream->error = "-Cannot write data right now\r\n";
+}
+
+// payload bytes already received on the client buffer
+void command_set_stream_write(redis_client_t *client, void *buffer, size_t length) {
+    unsigned char *source = buffer;
+
+    while(length > 0) {
+        size_t chunk = length;
+        void *target = command_set_stream_target(client, &chunk);
+
+        memcpy(target, source, chunk);
+        command_set_stream_chunk(client, chunk, 0);
+
+        source += chunk;
+        length -= chunk;
+    }
+}
+
+// release the stream, the entry is aborted if not committed, data
+// is the data root of the stream, NULL if not valid anymore
+static void command_set_stream_release(redis_client_t *client, data_root_t *data) {
+    set_stream_t *stream = client->stream;
+
+    if(stream->data.fd >= 0)
+        data_stream_abort(data, &stream->data);
+
+    free(stream->buffer);
+    free(stream);
+
+    client->stream = NULL;
+}
+
+// client disconnected or request not dispatched before
+// the end of the stream, engine lock is not held
+void command_set_stream_abort(redis_client_t *client) {
+    set_stream_t *stream = client->stream;
+    data_root_t *data = NULL;
+
+    zdbd_debug("[-] command: set: stream aborted\n");
+
+    command_engine_lock(0);
+
+    if(client->ns && stream->epoch == readpool_epoch())
+        data = client->ns->data;
+
+    command_set_stream_release(client, data);
+
+    command_engine_unlock();
+}
+
+// the whole payload was received, request dispatched
+static int command_set_stream_finish(redis_client_t *client) {
+    set_stream_t *stream = client->stream;
+    resp_object_t *key = client->request->argv[1];
+    index_root_t *index = client->ns->index;
+    data_root_t *data = client->ns->data;
+
+    if(stream->error) {
+        redis_reply_stack(client, stream->error, strlen(stream->error));
+
+        // stream did start, the data root can't
+        // have changed if the epoch is the same
+        command_set_stream_release(client, (stream->epoch == readpool_epoch()) ? data : NULL);
+        return 0;
+    }
+
+    // namespace reloaded or removed meanwhile, or another
+    // write jumped to the next datafile, entry can't be indexed
+    if(stream->epoch != readpool_epoch() || stream->data.dataid != data->dataid) {
+        zdbd_debug("[-] command: set: stream: datafile changed during upload\n");
+        redis_hardsend(client, "-Datafile changed during upload, try again");
+        command_set_stream_release(client, (stream->epoch == readpool_epoch()) ? data : NULL);
+        return 0;
+    }
+
+    if(namespace_is_frozen(client->ns)) {
+        command_set_stream_release(client, data);
+        return command_error_frozen(client);
+    }
+
+    index_entry_t *existing = index_get(index, key->buffer, key->length);
+
+    if(existing && client->ns->worm) {
+        redis_hardsend(client, "-Namespace is protected by worm mode");
+        command_set_stream_release(client, data);
+        return 0;
+    }
+
+    // data unchanged, entry is dropped (see redis_set_handler_userkey)
+    if(existing && existing->crc == stream->data.crc) {
+        zdbd_debug("[+] command: set: stream: crc match, ignoring\n");
+        redis_hardsend(client, "$-1");
+        command_set_stream_release(client, data);
+        return 0;
+    }
+
+    if(data_stream_commit(data, &stream->data)) {
+        redis_hardsend(client, "-Cannot write data right now");
+        command_set_stream_release(client, data);
+        return 0;
+    }
+
+    // previous payload is superseded
+    if(existing)
+        data_invalidate(data, existing->dataid, existing->offset);
+
+    index_entry_t idxreq = {
+        .idlength = key->length,
+        .offset = stream->data.offset,
+        .length = stream->data.length,
+        .crc = stream->data.crc,
+        .flags = 0,
+        .timestamp = stream->timestamp,
+    };
+
+    index_set_t setter = {
+        .entry = &idxreq,
+        .id = key->buffer,
+    };
+
+    command_set_stream_release(client, data);
+
+    if(!index_set(index, &setter, existing)) {
+        redis_hardsend(client, "-Cannot write index right now");
+        return 0;
+    }
+
+    redis_bulk_t response = redis_bulk(key->buffer, key->length);
+    if(!response.buffer) {
+        redis_hardsend(client, "$-1");
+        return 0;
+    }
+
+    // hold the reply until the write is synced
+    groupcommit_register(client);
+
+    redis_reply_heap(client, response.buffer, response.length, free);
+
+    return 0;
+}
+
 int command_set(redis_client_t *client) {
     resp_request_t *request = client->request;
 
+    // payload was streamed to the datafile
+    if(client->stream)
+        return command_set_stream_finish(client);
+
     if(request->argc == 4) {
         // we have a timestamp request
         // this is only authorized to admin users
@@ -334,3 +712,208 @@ int command_set(redis_client_t *client) {
     return 0;
 }
 
+
+// is this key already part of the pending requests
+static int mset_pending(data_request_t *requests, size_t count, resp_object_t *key) {
+    for(size_t i = 0; i < count; i++)
+        if(requests[i].idlength == key->length && memcmp(requests[i].vid, key->buffer, key->length) == 0)
+            return 1;
+
+    return 0;
+}
+
+// multi-keys SET (key-value mode only)
+//
+// all payloads are appended to the datafile with a single write, index
+// entries aswell (see data_insert_batch and index_batch_begin), sync
+// check is done once per file for the whole request
+//
+// keys with unchanged payload are skipped, like SET does, reply
+// is a simple OK when everything was written
+int command_mset(redis_client_t *client) {
+    resp_request_t *request = client->request;
+    index_root_t *index = client->ns->index;
+    data_root_t *data = client->ns->data;
+    size_t pairs = (request->argc - 1) / 2;
+
+    if(request->argc < 3 || (request->argc % 2) == 0) {
+        redis_hardsend(client, "-Unexpected arguments");
+        return 1;
+    }
+
+    if(index->mode != ZDB_MODE_KEY_VALUE) {
+        redis_hardsend(client, "-MSET only supported in key-value mode");
+        return 1;
+    }
+
+    for(size_t i = 0; i < pairs; i++) {
+        resp_object_t *key = request->argv[1 + (i * 2)];
+
+        if(key->length == 0) {
+            redis_hardsend(client, "-Invalid argument, key needed");
+            return 1;
+        }
+
+        if(key->length > MAX_KEY_LENGTH) {
+            redis_hardsend(client, "-Key too large");
+            return 1;
+        }
+    }
+
+    if(!client->writable) {
+        zdbd_debug("[-] command: mset: denied, read-only namespace\n");
+        redis_hardsend(client, "-Namespace is in read-only mode");
+        return 1;
+    }
+
+    if(namespace_is_frozen(client->ns))
+        return command_error_frozen(client);
+
+    if(namespace_is_locked(client->ns))
+        return command_error_locked(client);
+
+    data_request_t *requests = calloc(sizeof(data_request_t), pairs);
+    index_entry_t **entries = calloc(sizeof(index_entry_t *), pairs);
+    size_t *offsets = calloc(sizeof(size_t), pairs);
+    size_t floating = 0;
+    size_t total = 0;
+    size_t count = 0;
+    time_t timestamp = time(NULL);
+
+    if(!requests || !entries || !offsets) {
+        zdbd_warnp("command: mset: calloc");
+        redis_hardsend(client, "-Internal Error");
+        goto cleanup;
+    }
+
+    for(size_t i = 0; i < pairs; i++) {
+        resp_object_t *key = request->argv[1 + (i * 2)];
+        resp_object_t *value = request->argv[2 + (i * 2)];
+        index_entry_t *existing = index_get(index, key->buffer, key->length);
+        uint32_t crc = data_crc32(value->buffer, value->length);
+
+        // checking if worm mode enabled and key already exists
+        if(client->ns->worm && (existing || mset_pending(requests, count, key))) {
+            zdbd_debug("[-] command: mset: denied, overwriting an existing key with worm mode\n");
+            redis_hardsend(client, "-Namespace is protected by worm mode");
+            goto cleanup;
+        }
+
+        // data unchanged, nothing to do for this key (unless
+        // the key was already set earlier on this request)
+        if(existing && existing->crc == crc && !mset_pending(requests, count, key))
+            continue;
+
+        if(existing)
+            floating += existing->length;
+
+        data_request_t dreq = {
+            .data = value->buffer,
+            .datalength = value->length,
+            .vid = key->buffer,
+            .idlength = key->length,
+            .flags = 0,
+            .crc = crc,
+            .timestamp = timestamp,
+        };
+
+        requests[count++] = dreq;
+        total += value->length;
+    }
+
+    zdbd_debug("[+] command: mset: %zu keys, %zu to write (%zu bytes)\n", pairs, count, total);
+
+    if(count == 0) {
+        redis_hardsend(client, "+OK");
+        goto cleanup;
+    }
+
+    // check if namespace limitation is set, replaced payloads
+    // are released, like SET does
+    if(client->ns->maxsize) {
+        if(index->stats.datasize + total > client->ns->maxsize + floating) {
+            redis_hardsend(client, "-No space left on this namespace");
+            goto cleanup;
+        }
+    }
+
+    // jumping to the next files _before_ adding data (see command_set)
+    // the whole request lands on the same datafile
+    zdb_settings_t *zdb_settings = zdb_settings_get();
+
+    if(data_next_offset(data) + total > zdb_settings->datasize) {
+        size_t newid;
+
+        // do not jump if next id is zero, this mean an error occured
+        if((newid = index_jump_next(index)) == 0) {
+            redis_hardsend(client, "-Namespace definitely full");
+            goto cleanup;
+        }
+
+        data_jump_next(data, newid);
+    }
+
+    // nothing is indexed if any payload could not be written
+    if(data_insert_batch(data, requests, count, offsets) != count) {
+        redis_hardsend(client, "-Cannot write data right now");
+        goto cleanup;
+    }
+
+    index_batch_begin(index);
+
+    for(size_t i = 0; i < count; i++) {
+        data_request_t *dreq = &requests[i];
+
+        // looking up again, the same key can be set
+        // twice on the same request
+        index_entry_t *existing = index_get(index, dreq->vid, dreq->idlength);
+
+        // previous payload is superseded
+        if(existing)
+            data_invalidate(data, existing->dataid, existing->offset);
+
+        index_entry_t idxreq = {
+            .idlength = dreq->idlength,
+            .offset = offsets[i],
+            .length = dreq->datalength,
+            .crc = dreq->crc,
+            .flags = 0,
+            .timestamp = timestamp,
+        };
+
+        index_set_t setter = {
+            .entry = &idxreq,
+            .id = dreq->vid,
+        };
+
+        if(!(entries[i] = index_set(index, &setter, existing)))
+            break;
+    }
+
+    // entries set on memory are not on disk, they can't be used
+    if(index_batch_commit(index)) {
+        for(size_t i = 0; i < count && entries[i]; i++)
+            entries[i]->flags |= INDEX_ENTRY_DELETED;
+
+        redis_hardsend(client, "-Cannot write index right now");
+        goto cleanup;
+    }
+
+    // some keys could not be inserted (memory issue)
+    if(!entries[count - 1]) {
+        redis_hardsend(client, "-Cannot write index right now");
+        goto cleanup;
+    }
+
+    // hold the reply until the write is synced
+    groupcommit_register(client);
+
+    redis_hardsend(client, "+OK");
+
+cleanup:
+    free(requests);
+    free(entries);
+    free(offsets);
+
+    return 0;
+}
@@ -1,5 +1,33 @@
 #ifndef ZDB_COMMANDS_SET_H
     #define ZDB_COMMANDS_SET_H
 
+    // payload larger than REDIS_MAX_PAYLOAD is streamed to the
+    // datafile by chunk of this size, while received
+    #define SET_STREAM_CHUNK  512 * 1024
+
+    // SET request with a streamed payload, attached to the
+    // client from the payload header until the request is done
+    typedef struct set_stream_t {
+        data_stream_t data;     // datafile side of the stream
+        uint64_t epoch;         // namespaces epoch when started
+        time_t timestamp;       // entry timestamp
+        unsigned char *buffer;  // chunk being received
+        size_t pending;         // amount of bytes on the chunk
+        size_t received;        // amount of bytes received (with trailing crlf)
+        size_t writing;         // chunk length being written by the event backend
+        char *error;            // error reply, payload is discarded when set
+
+    } set_stream_t;
+
     int command_set(redis_client_t *client);
+    int command_mset(redis_client_t *client);
+
+    int command_set_streamable(redis_client_t *client);
+    int command_set_stream_begin(redis_client_t *client, size_t length);
+    void *command_set_stream_target(redis_client_t *client, size_t *length);
+    void command_set_stream_received(redis_client_t *client, size_t length);
+    void command_set_stream_write(redis_client_t *client, void *buffer, size_t length);
+    int command_set_stream_busy(redis_client_t *client);
+    void command_set_stream_written(redis_client_t *client, int error);
+    void command_set_stream_abort(redis_client_t *client);
 #endif
@@ -106,6 +106,54 @@ int command_info(redis_client_t *client) {
     len += sprintf(info + len, "network_tx_bytes: %" PRIu64 "\n", dstats->networktx);
     len += sprintf(info + len, "network_tx_mb: %.2f\n", dstats->networktx / (1024 * 1024.0));
 
+    len += sprintf(info + len, "\n# group commit\n");
+    len += sprintf(info + len, "group_commit_enabled: %d\n", zdbd_rootsettings.groupcommit);
+    len += sprintf(info + len, "group_commit_delay_us: %d\n", zdbd_rootsettings.commitdelay);
+    len += sprintf(info + len, "group_commit_batches: %" PRIu64 "\n", dstats->commitbatches);
+    len += sprintf(info + len, "group_commit_writes: %" PRIu64 "\n", dstats->commitwrites);
+    len += sprintf(info + len, "group_commit_batch_avg: %.2f\n", dstats->commitbatches ? dstats->commitwrites / (double) dstats->commitbatches : 0);
+    len += sprintf(info + len, "group_commit_batch_last: %" PRIu64 "\n", dstats->commitlast);
+    len += sprintf(info + len, "group_commit_batch_max: %" PRIu64 "\n", dstats->commitmax);
+    len += sprintf(info + len, "group_commit_failed: %" PRIu64 "\n", dstats->commitfailed);
+
+    len += sprintf(info + len, "\n# read pool\n");
+    len += sprintf(info + len, "read_pool_threads: %d\n", zdbd_rootsettings.readthreads);
+    len += sprintf(info + len, "read_pool_queue_depth: %" PRIu64 "\n", dstats->readqueued);
+    len += sprintf(info + len, "read_pool_queue_max: %" PRIu64 "\n", dstats->readqueuemax);
+    len += sprintf(info + len, "read_pool_completed: %" PRIu64 "\n", dstats->readjobs);
+    len += sprintf(info + len, "read_pool_cancelled: %" PRIu64 "\n", dstats->readcancelled);
+    len += sprintf(info + len, "read_pool_latency_avg_us: %.2f\n", dstats->readjobs ? dstats->readlatency / (double) dstats->readjobs : 0);
+    len += sprintf(info + len, "read_pool_latency_max_us: %" PRIu64 "\n", dstats->readlatencymax);
+
+    datacache_t *cache = datacache_get();
+
+    len += sprintf(info + len, "\n# values cache\n");
+    len += sprintf(info + len, "values_cache_size_bytes: %zu\n", cache->size);
+    len += sprintf(info + len, "values_cache_used_bytes: %zu\n", cache->usage);
+    len += sprintf(info + len, "values_cache_entries: %zu\n", cache->queues[DATACACHE_SMALL].length + cache->queues[DATACACHE_MAIN].length);
+    len += sprintf(info + len, "values_cache_hits: %" PRIu64 "\n", lstats->datacachehit);
+    len += sprintf(info + len, "values_cache_misses: %" PRIu64 "\n", lstats->datacachemiss);
+    len += sprintf(info + len, "values_cache_admitted: %zu\n", cache->admitted);
+    len += sprintf(info + len, "values_cache_evicted: %zu\n", cache->evicted);
+
+    // memory index summary over all namespaces
+    size_t idxentries = 0, idxcapacity = 0, idxresizing = 0;
+
+    for(namespace_t *ns = namespace_iter(); ns; ns = namespace_iter_next(ns)) {
+        if(index_capacity(ns->index) == 0)
+            continue;
+
+        idxentries += ns->index->stats.entries;
+        idxcapacity += index_capacity(ns->index);
+        idxresizing += index_resize_pending(ns->index);
+    }
+
+    len += sprintf(info + len, "\n# index\n");
+    len += sprintf(info + len, "index_engine: %s\n", zdb_index_engine(zdb_settings->engine));
+    len += sprintf(info + len, "index_buckets: %lu\n", idxcapacity);
+    len += sprintf(info + len, "index_load_factor: %.2f\n", idxcapacity ? idxentries / (double) idxcapacity : 0);
+    len += sprintf(info + len, "index_resizing_namespaces: %lu\n", idxresizing);
+
     redis_bulk_t response = redis_bulk(info, len);
     if(!response.buffer) {
         redis_hardsend(client, "$-1");
@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "libzdb.h"
+#include "zdbd.h"
+#include "redis.h"
+#include "groupcommit.h"
+
+//
+// group commit
+//
+// with group commit enabled, writes are not synced inline anymore, instead
+// each write command registers the files it modified on the pending batch
+// and its reply is held
+//
+// a background flusher thread takes the pending batch, fsync each file
+// of the batch, then notifies the event loop (through a pipe), which
+// release replies of every clients waiting for that batch
+//
+// when the flusher is busy, new writes are accumulated on the next
+// pending batch, one fsync is shared by all of them, optionally the flusher
+// can wait some extra time (delay) to let more writes joins the batch
+//
+static struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    int running;      // flusher thread running
+    int delay;        // maximum batch delay (microseconds)
+    int notify[2];    // flusher to event loop pipe
+
+    groupcommit_batch_t pending;   // batch filled by the event loop
+    groupcommit_batch_t flushing;  // batch synced by the flusher
+
+} commit = {
+    .running = 0,
+    .notify = {-1, -1},
+};
+
+static int groupcommit_file_append(groupcommit_batch_t *batch, void *owner, fileid_t fileid, int fd) {
+    // file already part of this batch
+    for(size_t i = 0; i < batch->length; i++)
+        if(batch->files[i].owner == owner && batch->files[i].fileid == fileid)
+            return 0;
+
+    if(batch->length == batch->size) {
+        size_t size = batch->size ? batch->size * 2 : 8;
+        groupcommit_file_t *files;
+
+        if(!(files = realloc(batch->files, sizeof(groupcommit_file_t) * size))) {
+            zdbd_warnp("groupcommit: realloc");
+            return 1;
+        }
+
+        batch->files = files;
+        batch->size = size;
+    }
+
+    groupcommit_file_t *file = &batch->files[batch->length];
+
+    if((file->fd = dup(fd)) < 0) {
+        zdbd_warnp("groupcommit: dup");
+        return 1;
+    }
+
+    file->owner = owner;
+    file->fileid = fileid;
+    batch->length += 1;
+
+    return 0;
+}
+
+static uint32_t groupcommit_batch_sync(groupcommit_batch_t *batch) {
+    uint32_t error = 0;
+
+    for(size_t i = 0; i < batch->length; i++) {
+        if(fsync(batch->files[i].fd) < 0) {
+            zdbd_warnp("groupcommit: fsync");
+            error = 1;
+        }
+
+        close(batch->files[i].fd);
+    }
+
+    return error;
+}
+
+static void groupcommit_deadline(struct timespec *deadline, int delay) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+
+    deadline->tv_sec += delay / 1000000;
+    deadline->tv_nsec += (delay % 1000000) * 1000;
+
+    if(deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec += 1;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+static void *groupcommit_flusher(void *args) {
+    (void) args;
+
+    pthread_mutex_lock(&commit.lock);
+
+    // on shutdown, keep going until the last pending
+    // batch is synced
+    while(commit.running || commit.pending.writes) {
+        if(commit.pending.writes == 0) {
+            pthread_cond_wait(&commit.cond, &commit.lock);
+            continue;
+        }
+
+        // give a chance to more writes to join this batch
+        if(commit.delay && commit.running) {
+            struct timespec deadline;
+            groupcommit_deadline(&deadline, commit.delay);
+
+            while(commit.running)
+                if(pthread_cond_timedwait(&commit.cond, &commit.lock, &deadline) == ETIMEDOUT)
+                    break;
+        }
+
+        // swap batches, event loop can keep filling the
+        // next one while this one is synced
+        groupcommit_batch_t batch = commit.pending;
+
+        commit.pending = commit.flushing;
+        commit.pending.id = batch.id + 1;
+        commit.pending.writes = 0;
+        commit.pending.length = 0;
+
+        pthread_mutex_unlock(&commit.lock);
+
+        groupcommit_done_t done = {
+            .id = batch.id,
+            .writes = batch.writes,
+            .error = groupcommit_batch_sync(&batch),
+        };
+
+        // message is smaller than PIPE_BUF, write is atomic
+        if(write(commit.notify[1], &done, sizeof(done)) != sizeof(done))
+            zdbd_warnp("groupcommit: notify");
+
+        pthread_mutex_lock(&commit.lock);
+        commit.flushing = batch;
+    }
+
+    pthread_mutex_unlock(&commit.lock);
+
+    return NULL;
+}
+
+// initialize flusher thread, returns the notification descriptor
+// which needs to be watched by the event loop
+int groupcommit_start(int delay) {
+    if(pipe(commit.notify) < 0)
+        zdbd_diep("groupcommit: pipe");
+
+    fcntl(commit.notify[0], F_SETFL, fcntl(commit.notify[0], F_GETFL) | O_NONBLOCK);
+
+    pthread_mutex_init(&commit.lock, NULL);
+    pthread_cond_init(&commit.cond, NULL);
+
+    memset(&commit.pending, 0, sizeof(groupcommit_batch_t));
+    memset(&commit.flushing, 0, sizeof(groupcommit_batch_t));
+
+    commit.pending.id = 1;
+    commit.delay = delay;
+    commit.running = 1;
+
+    if(pthread_create(&commit.thread, NULL, groupcommit_flusher, NULL))
+        zdbd_diep("groupcommit: pthread_create");
+
+    zdbd_verbose("[+] groupcommit: flusher started, batch delay: %d us\n", delay);
+
+    return commit.notify[0];
+}
+
+void groupcommit_stop() {
+    if(!commit.running)
+        return;
+
+    pthread_mutex_lock(&commit.lock);
+    commit.running = 0;
+    pthread_cond_signal(&commit.cond);
+    pthread_mutex_unlock(&commit.lock);
+
+    pthread_join(commit.thread, NULL);
+
+    free(commit.pending.files);
+    free(commit.flushing.files);
+
+    close(commit.notify[0]);
+    close(commit.notify[1]);
+
+    commit.notify[0] = -1;
+    commit.notify[1] = -1;
+}
+
+// attach the files written by the client last command
+// to the pending batch and hold the client replies until
+// the batch is synced
+void groupcommit_register(redis_client_t *client) {
+    data_root_t *data = client->ns->data;
+    index_root_t *index = client->ns->index;
+    int error = 0;
+
+    if(!commit.running)
+        return;
+
+    // commit id is checked by the main reactor when
+    // a batch is synced, the client can be served by another
+    pthread_mutex_lock(&client->lock);
+    pthread_mutex_lock(&commit.lock);
+
+    error |= groupcommit_file_append(&commit.pending, data, data->dataid, data->datafd);
+    error |= groupcommit_file_append(&commit.pending, index, index->indexid, index->indexfd);
+
+    client->commitid = commit.pending.id;
+    commit.pending.writes += 1;
+
+    pthread_cond_signal(&commit.cond);
+    pthread_mutex_unlock(&commit.lock);
+    pthread_mutex_unlock(&client->lock);
+
+    // could not attach files to the batch, falling back
+    // to inline sync, this is slow but still safe
+    if(error) {
+        fsync(data->datafd);
+        fsync(index->indexfd);
+    }
+}
+
+// notification received from the flusher, some batches
+// are synced, releasing clients waiting for them
+// (only watched by the main reactor)
+void groupcommit_notified(int fd) {
+    zdbd_stats_t *dstats = &zdbd_rootsettings.stats;
+    groupcommit_done_t done;
+
+    while(read(fd, &done, sizeof(done)) == sizeof(done)) {
+        zdbd_debug("[+] groupcommit: batch %lu synced, %u writes\n", done.id, done.writes);
+
+        dstats->commitbatches += 1;
+        dstats->commitwrites += done.writes;
+        dstats->commitlast = done.writes;
+
+        if(done.writes > dstats->commitmax)
+            dstats->commitmax = done.writes;
+
+        if(done.error)
+            dstats->commitfailed += 1;
+
+        redis_clients_commit(done.id, done.error);
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef __ZDBD_GROUPCOMMIT_H
+    #define __ZDBD_GROUPCOMMIT_H
+
+    // one file (data or index) modified by the pending batch
+    // the descriptor is a duplicate owned by the batch, this way
+    // files can be rotated or closed without affecting the flusher
+    typedef struct groupcommit_file_t {
+        void *owner;       // data or index root
+        fileid_t fileid;   // file id on this root
+        int fd;            // duplicated descriptor
+
+    } groupcommit_file_t;
+
+    typedef struct groupcommit_batch_t {
+        uint64_t id;                // batch id, clients wait for it
+        size_t writes;              // amount of writes in the batch
+        size_t length;              // amount of files to sync
+        size_t size;                // allocated files
+        groupcommit_file_t *files;
+
+    } groupcommit_batch_t;
+
+    // message sent by the flusher to the event loop
+    // when a batch is fully synced
+    typedef struct groupcommit_done_t {
+        uint64_t id;
+        uint32_t writes;
+        uint32_t error;
+
+    } groupcommit_done_t;
+
+    int groupcommit_start(int delay);
+    void groupcommit_stop();
+
+    void groupcommit_register(redis_client_t *client);
+    void groupcommit_notified(int fd);
+#endif
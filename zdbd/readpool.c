@@ -0,0 +1,307 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <pthread.h>
+#include "libzdb.h"
+#include "zdbd.h"
+#include "redis.h"
+#include "commands.h"
+#include "commands_history.h"
+#include "readpool.h"
+
+//
+// read pool
+//
+// payloads stored on sealed datafiles (not the current one) are usually
+// cold, reading them can hit the disk and block the reactor for a while,
+// every other clients of that reactor waits meanwhile
+//
+// with the read pool enabled, such reads (GET, GETRANGE, CHECK, HISTORY)
+// are handed to worker threads, the client gets a placeholder response on
+// its queue, replies produced meanwhile (pipelining) are queued behind it,
+// when the worker is done, the placeholder is filled and the queue is
+// flushed, this way replies order is preserved
+//
+// workers read under the shared engine lock, like any read-only command,
+// namespaces removed, flushed or reloaded (exclusive lock) bump the
+// epoch, jobs queued before that point are answered with an error,
+// their data root is not valid anymore
+//
+// when a client disconnects with reads in progress, its pending responses
+// are orphaned (client set to NULL), the worker discards the result,
+// this is done under the pool lock, lock order is pool then client
+//
+static struct {
+    pthread_t *threads;
+    int length;           // amount of workers
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    int running;          // workers accepting jobs
+    uint64_t epoch;       // bumped when namespaces are destroyed
+
+    readpool_job_t *head; // pending jobs, oldest first
+    readpool_job_t *tail;
+
+} pool = {
+    .length = 0,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .running = 0,
+    .epoch = 0,
+};
+
+// short reply (status, error), copied on the heap
+static redis_bulk_t readpool_reply(char *message) {
+    redis_bulk_t bulk = {
+        .buffer = (unsigned char *) strdup(message),
+        .length = strlen(message),
+        .writer = 0,
+    };
+
+    return bulk;
+}
+
+// reading the payload and building the reply, called
+// with the shared engine lock held
+static redis_bulk_t readpool_read(readpool_job_t *job) {
+    redis_bulk_t reply = {
+        .buffer = NULL,
+        .length = 0,
+        .writer = 0,
+    };
+
+    if(job->kind == READPOOL_CHECK) {
+        int status = data_check(job->data, job->offset, job->dataid);
+        char response[32];
+
+        sprintf(response, ":%d\r\n", status);
+        return readpool_reply(response);
+    }
+
+    data_payload_t payload;
+
+    if(job->kind == READPOOL_RANGE) {
+        payload = data_get_range(job->data, job->offset, job->dataid, job->idlength, job->start, job->length);
+
+    } else {
+        payload = data_get(job->data, job->offset, job->length, job->dataid, job->idlength);
+    }
+
+    if(!payload.buffer) {
+        zdbd_log("[-] readpool: cannot read payload\n");
+        return readpool_reply("-Internal Error\r\n");
+    }
+
+    if(job->kind == READPOOL_GET || job->kind == READPOOL_RANGE)
+        reply = redis_bulk(payload.buffer, payload.length);
+
+    if(job->kind == READPOOL_HISTORY) {
+        history_response_t history = {
+            .timestamp = job->timestamp,
+            .ekey = &job->ekey,
+            .payload = payload,
+        };
+
+        reply = history_response_build(&history);
+    }
+
+    free(payload.buffer);
+
+    if(!reply.buffer)
+        return readpool_reply("-Internal Error\r\n");
+
+    return reply;
+}
+
+static void readpool_process(readpool_job_t *job) {
+    zdbd_stats_t *dstats = &zdbd_rootsettings.stats;
+    redis_bulk_t reply;
+    struct timespec done;
+
+    command_engine_lock(1);
+
+    // namespace destroyed since queued, data root
+    // is not valid anymore
+    if(job->epoch != pool.epoch) {
+        zdbd_debug("[-] readpool: namespace changed, job cancelled\n");
+        reply = readpool_reply("-Namespace changed, try again\r\n");
+        zdb_atomic_add(dstats->readcancelled, 1);
+
+    } else {
+        reply = readpool_read(job);
+    }
+
+    command_engine_unlock();
+
+    clock_gettime(CLOCK_MONOTONIC, &done);
+    uint64_t latency = ((done.tv_sec - job->queued.tv_sec) * 1000000) + ((done.tv_nsec - job->queued.tv_nsec) / 1000);
+
+    pthread_mutex_lock(&pool.lock);
+
+    dstats->readjobs += 1;
+    dstats->readlatency += latency;
+
+    if(latency > dstats->readlatencymax)
+        dstats->readlatencymax = latency;
+
+    if(job->client) {
+        redis_reply_complete(job->client, job->response, reply.buffer, reply.length);
+
+    } else {
+        // client disconnected meanwhile
+        free(reply.buffer);
+        redis_response_free(job->response);
+    }
+
+    pthread_mutex_unlock(&pool.lock);
+
+    free(job);
+}
+
+static void *readpool_worker(void *args) {
+    zdbd_stats_t *dstats = &zdbd_rootsettings.stats;
+    (void) args;
+
+    pthread_mutex_lock(&pool.lock);
+
+    // on shutdown, keep going until the queue is empty
+    while(pool.running || pool.head) {
+        if(!pool.head) {
+            pthread_cond_wait(&pool.cond, &pool.lock);
+            continue;
+        }
+
+        readpool_job_t *job = pool.head;
+
+        if(!(pool.head = job->next))
+            pool.tail = NULL;
+
+        dstats->readqueued -= 1;
+
+        pthread_mutex_unlock(&pool.lock);
+        readpool_process(job);
+        pthread_mutex_lock(&pool.lock);
+    }
+
+    pthread_mutex_unlock(&pool.lock);
+
+    return NULL;
+}
+
+int readpool_start(int threads) {
+    if(!(pool.threads = calloc(sizeof(pthread_t), threads)))
+        zdbd_diep("readpool: calloc");
+
+    pool.running = 1;
+    pool.length = threads;
+
+    for(int i = 0; i < threads; i++)
+        if(pthread_create(&pool.threads[i], NULL, readpool_worker, NULL))
+            zdbd_diep("readpool: pthread_create");
+
+    zdbd_verbose("[+] readpool: %d read workers started\n", threads);
+
+    return 0;
+}
+
+void readpool_stop() {
+    if(!pool.running)
+        return;
+
+    pthread_mutex_lock(&pool.lock);
+    pool.running = 0;
+    pthread_cond_broadcast(&pool.cond);
+    pthread_mutex_unlock(&pool.lock);
+
+    for(int i = 0; i < pool.length; i++)
+        pthread_join(pool.threads[i], NULL);
+
+    free(pool.threads);
+    pool.threads = NULL;
+    pool.length = 0;
+}
+
+int readpool_enabled() {
+    return pool.running;
+}
+
+readpool_job_t *readpool_job_new(redis_client_t *client, readpool_kind_t kind) {
+    readpool_job_t *job;
+
+    if(!(job = calloc(sizeof(readpool_job_t), 1))) {
+        zdbd_warnp("readpool: calloc");
+        return NULL;
+    }
+
+    job->kind = kind;
+    job->client = client;
+    job->data = client->ns->data;
+
+    return job;
+}
+
+// queue a job, its reply place is reserved on the client queue,
+// on failure the job is released and caller needs to read inline
+int readpool_submit(readpool_job_t *job) {
+    zdbd_stats_t *dstats = &zdbd_rootsettings.stats;
+
+    if(!(job->response = redis_reply_pending(job->client, job))) {
+        free(job);
+        return 1;
+    }
+
+    // epoch only changes under exclusive engine
+    // lock, commands hold the engine lock
+    job->epoch = pool.epoch;
+    clock_gettime(CLOCK_MONOTONIC, &job->queued);
+
+    pthread_mutex_lock(&pool.lock);
+
+    if(pool.tail)
+        pool.tail->next = job;
+
+    pool.tail = job;
+
+    if(!pool.head)
+        pool.head = job;
+
+    dstats->readqueued += 1;
+
+    if(dstats->readqueued > dstats->readqueuemax)
+        dstats->readqueuemax = dstats->readqueued;
+
+    pthread_cond_signal(&pool.cond);
+    pthread_mutex_unlock(&pool.lock);
+
+    return 0;
+}
+
+// namespaces are about to be destroyed (exclusive engine lock held),
+// jobs queued until now are cancelled
+void readpool_cancel() {
+    pool.epoch += 1;
+}
+
+// namespaces epoch, changes when namespaces are destroyed, a data
+// root kept between two commands is only valid for the same epoch
+uint64_t readpool_epoch() {
+    return pool.epoch;
+}
+
+void readpool_lock() {
+    pthread_mutex_lock(&pool.lock);
+}
+
+void readpool_unlock() {
+    pthread_mutex_unlock(&pool.lock);
+}
+
+// client disconnected, result of this job will be discarded
+// (pool lock needs to be held)
+void readpool_orphan(void *job) {
+    ((readpool_job_t *) job)->client = NULL;
+}
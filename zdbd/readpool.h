@@ -0,0 +1,55 @@
+#ifndef __ZDBD_READPOOL_H
+    #define __ZDBD_READPOOL_H
+
+    #include <time.h>
+
+    // maximum amount of read workers
+    #define READPOOL_MAX_THREADS  256
+
+    typedef enum readpool_kind_t {
+        READPOOL_GET,      // bulk payload
+        READPOOL_CHECK,    // integrity check status
+        READPOOL_HISTORY,  // history array (key, timestamp, payload)
+        READPOOL_RANGE,    // bulk window of a payload
+
+    } readpool_kind_t;
+
+    // one payload read handed to the workers, the client
+    // keeps a placeholder response on its queue until the
+    // read is done, later replies are queued behind it
+    typedef struct readpool_job_t {
+        readpool_kind_t kind;
+        redis_client_t *client;      // NULL when client disconnected meanwhile
+        redis_response_t *response;  // placeholder on client responses queue
+        data_root_t *data;           // data root of the namespace
+        uint64_t epoch;              // namespaces epoch when queued
+
+        // payload location
+        fileid_t dataid;
+        uint32_t offset;
+        uint32_t length;
+        uint8_t idlength;
+        uint32_t start;              // window start (range only)
+
+        // history context
+        uint32_t timestamp;
+        index_ekey_t ekey;
+
+        struct timespec queued;      // submission time, for latency
+        struct readpool_job_t *next;
+
+    } readpool_job_t;
+
+    int readpool_start(int threads);
+    void readpool_stop();
+    int readpool_enabled();
+
+    readpool_job_t *readpool_job_new(redis_client_t *client, readpool_kind_t kind);
+    int readpool_submit(readpool_job_t *job);
+    void readpool_cancel();
+    uint64_t readpool_epoch();
+
+    void readpool_lock();
+    void readpool_unlock();
+    void readpool_orphan(void *job);
+#endif
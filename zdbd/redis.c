@@ -6,18 +6,28 @@
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <sys/un.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 #include <fcntl.h>
 #include <time.h>
 #include <sys/time.h>
 #include <inttypes.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sys/resource.h>
 #include "sockets.h"
 #include "libzdb.h"
 #include "zdbd.h"
 #include "redis.h"
 #include "commands.h"
+#include "commands_set.h"
+#include "groupcommit.h"
+#include "readpool.h"
 
 // full protocol debug
 // this produce full dump of socket payload
@@ -43,8 +53,13 @@ static int yes = 1;
 static redis_clients_t clients = {
     .length = 0,
     .list = NULL,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .listeners = 0,
 };
 
+// set by the reactor which received a STOP
+static int shutdown_requested = 0;
+
 //
 // custom buffer
 //
@@ -106,7 +121,8 @@ static void buffer_free(buffer_t *buffer) {
 // since sending responses to clients can take more than one send call
 // we need a way to deal with these clients without losing performance
 // for the other clients connected, while threading or any parallel execution
-// is prohibited by design in this project
+// is prohibited by design in this project (with several reactors, each
+// client is still served by a single reactor)
 //
 // when we need to send a response to a client, we try to do it without
 // any extra allocation, we just send data as it, if they was sent in one shot, there
@@ -127,6 +143,7 @@ redis_response_t *redis_response_new(void *payload, size_t length, void (*destru
     response->length = length;
     response->reader = response->buffer;
     response->destructor = destructor;
+    response->fd = -1;
 
     return response;
 }
@@ -137,23 +154,81 @@ void redis_response_free(redis_response_t *response) {
     if(response->destructor)
         response->destructor(response->buffer);
 
+    if(response->fd >= 0)
+        close(response->fd);
+
     free(response);
 }
 
 // add a response to the client responses queue
 void redis_response_push(redis_client_t *client, redis_response_t *response) {
-    // no pending response was there, just point to the new one
+    response->next = NULL;
+
     if(client->responses == NULL) {
+        // no pending response was there, just point to the new one
         client->responses = response;
-        client->responsetail = response;
-        response->next = NULL;
-        return;
+
+    } else {
+        // there are already pending response on the queue
+        // appending our response to the list
+        client->responsetail->next = response;
     }
 
-    // there are already pending response on the queue
-    // appending our response to the list
-    client->responsetail->next = response;
     client->responsetail = response;
+
+    // responses of a client served by io_uring are
+    // sent by its reactor, which needs to know it
+    if(client->uring)
+        socket_uring_flush(client);
+}
+
+// a reply can be sent straight away only if nothing is queued before
+// it (protocol order) and if it's not held by group commit, clients
+// served by io_uring never send directly (see socket_uring)
+static int redis_client_direct(redis_client_t *client) {
+    return (client->responses == NULL && client->commitid == 0 && client->uring == NULL);
+}
+
+#ifdef __linux__
+static ssize_t redis_send_file(int sockfd, redis_response_t *response) {
+    return sendfile(sockfd, response->fd, &response->offset, response->length);
+}
+#else
+// no compatible sendfile available, falling back
+// to a bounded read and send
+static ssize_t redis_send_file(int sockfd, redis_response_t *response) {
+    char buffer[REDIS_BUFFER_SIZE];
+    size_t length = response->length < sizeof(buffer) ? response->length : sizeof(buffer);
+    ssize_t sent;
+
+    if((length = pread(response->fd, buffer, length, response->offset)) <= 0)
+        return length;
+
+    if((sent = send(sockfd, buffer, length, 0)) > 0)
+        response->offset += sent;
+
+    return sent;
+}
+#endif
+
+// send a chunk of the response, from memory or from
+// the file attached to the response
+static ssize_t redis_send_chunk(redis_client_t *client, redis_response_t *response) {
+    if(response->fd < 0)
+        return send(client->fd, response->reader, response->length, 0);
+
+    ssize_t sent = redis_send_file(client->fd, response);
+
+    // file is shorter than expected, header was already sent and
+    // the stream can't be recovered anymore, dropping the client
+    if(sent == 0) {
+        zdbd_danger("[-] redis: send: unexpected end of file, dropping client %d", client->fd);
+        shutdown(client->fd, SHUT_RDWR);
+        errno = EPIPE;
+        return -1;
+    }
+
+    return sent;
 }
 
 // try to send a response to a client, if succeed returns NULL
@@ -165,7 +240,7 @@ redis_response_t *redis_send_response(redis_client_t *client, redis_response_t *
     while(response->length > 0) {
         zdbd_debug("[+] redis: sending reply to %d (%ld bytes remains)\n", client->fd, response->length);
 
-        if((sent = send(client->fd, response->reader, response->length, 0)) < 0) {
+        if((sent = redis_send_chunk(client, response)) < 0) {
             if(errno != EAGAIN) {
                 zdbd_warnp("redis_send_reply: send");
 
@@ -188,9 +263,12 @@ redis_response_t *redis_send_response(redis_client_t *client, redis_response_t *
         }
 
         // updating statistics
-        zdbd_rootsettings.stats.networktx += sent;
+        zdb_atomic_add(zdbd_rootsettings.stats.networktx, sent);
+
+        // file responses already track their offset
+        if(response->fd < 0)
+            response->reader += sent;
 
-        response->reader += sent;
         response->length -= sent;
     }
 
@@ -198,62 +276,293 @@ redis_response_t *redis_send_response(redis_client_t *client, redis_response_t *
     return NULL;
 }
 
+// pop the first response of the queue, fully sent
+static void redis_client_shift(redis_client_t *client) {
+    redis_response_t *response = client->responses;
+
+    client->responses = response->next;
+
+    // this was the last response, cleaning the tail
+    if(client->responses == NULL)
+        client->responsetail = NULL;
+
+    redis_response_free(response);
+}
+
+// gather consecutive in-memory responses ready to be sent, from the
+// head of the queue, returns the amount of buffers set (zero when the
+// head is held or sent from a file)
+int redis_client_gather(redis_client_t *client, struct iovec *iov, int length) {
+    int count = 0;
+
+    for(redis_response_t *item = client->responses; item && count < length; item = item->next) {
+        if(item->pending || item->fd >= 0)
+            break;
+
+        iov[count].iov_base = item->reader;
+        iov[count].iov_len = item->length;
+        count += 1;
+    }
+
+    return count;
+}
+
+// amount of bytes sent from the first count responses, responses
+// fully sent are released, returns 1 if the last one was only partially
+// sent (socket full), a file response is always sent alone
+int redis_client_sent(redis_client_t *client, int count, size_t sent) {
+    // updating statistics
+    zdb_atomic_add(zdbd_rootsettings.stats.networktx, sent);
+
+    for(int i = 0; i < count; i++) {
+        redis_response_t *response = client->responses;
+
+        if(response->length > sent) {
+            // file responses track their offset
+            if(response->fd >= 0)
+                response->offset += sent;
+            else
+                response->reader += sent;
+
+            response->length -= sent;
+            return 1;
+        }
+
+        sent -= response->length;
+        redis_client_shift(client);
+    }
+
+    return 0;
+}
+
+// socket is not able to receive theses responses
+// anyway, dropping the first count of them
+void redis_client_drop(redis_client_t *client, int count) {
+    for(int i = 0; i < count && client->responses; i++)
+        redis_client_shift(client);
+}
+
+// send responses queued for a client, as much as the socket accepts
+// consecutive in-memory responses are sent with a single writev
+// client lock needs to be held
+static void redis_client_flush(redis_client_t *client) {
+    struct iovec iov[REDIS_FLUSH_IOV];
+
+    // replies are held until group commit is done
+    if(client->commitid)
+        return;
+
+    // responses are sent by the reactor owning the client
+    if(client->uring) {
+        socket_uring_flush(client);
+        return;
+    }
+
+    zdbd_debug("[+] redis: sending available buffer to socket %d\n", client->fd);
+    while(client->responses) {
+        redis_response_t *response = client->responses;
+
+        // reply not ready yet, everything after it waits
+        if(response->pending)
+            return;
+
+        // payload sent from a file, alone
+        if(response->fd >= 0) {
+            // if the send_response returns us something, then it
+            // was not fully sent, let's try again later, we are done for now
+            if(redis_send_response(client, response) != NULL)
+                return;
+
+            redis_client_shift(client);
+            continue;
+        }
+
+        // gathering following in-memory responses
+        int count = redis_client_gather(client, iov, REDIS_FLUSH_IOV);
+
+        zdbd_debug("[+] redis: sending %d responses to %d\n", count, client->fd);
+
+        ssize_t sent = writev(client->fd, iov, count);
+
+        if(sent < 0) {
+            // socket not ready, we will be notified when
+            // the write is available again
+            if(errno == EAGAIN)
+                return;
+
+            // this is an error, the socket is not ready to
+            // receive theses replies anyway, dropping them
+            zdbd_warnp("redis_client_flush: writev");
+            redis_client_drop(client, count);
+
+            continue;
+        }
+
+        // removing what was fully sent, socket is
+        // full if something remains, keep going later
+        if(redis_client_sent(client, count, sent))
+            return;
+    }
+}
+
 // callback called when a socket becomes available in write
 // this mean the client was waiting something (in theory), so let's
 // start sending the buffer/queue attached to that client
 resp_status_t redis_delayed_write(int fd) {
     redis_client_t *client = clients.list[fd];
-    redis_response_t *response;
 
-    if(!client || client->responses == NULL) {
-        zdbd_debug("[+] redis: nothing to send to client (fd: %d)\n", fd);
+    if(!client)
         return 0;
+
+    pthread_mutex_lock(&client->lock);
+
+    if(client->responses == NULL)
+        zdbd_debug("[+] redis: nothing to send to client (fd: %d)\n", fd);
+
+    redis_client_flush(client);
+
+    pthread_mutex_unlock(&client->lock);
+
+    return 0;
+}
+
+//
+// output arena
+//
+// when a batch is in progress (corked), replies are not sent one by one,
+// they are appended to the client output arena and sent at once when the
+// batch is done, pipelined requests costs one syscall per batch and
+// no allocation per reply
+//
+// the arena content always comes after the responses queue, when
+// something needs to be queued (large or file reply, reply held by
+// the read pool), the arena is flushed first
+//
+// client lock needs to be held
+//
+
+// send (or queue) what's pending on the arena
+static void redis_output_flush(redis_client_t *client) {
+    redis_output_t *output = &client->output;
+    redis_response_t response;
+
+    if(output->length == 0)
+        return;
+
+    memset(&response, 0, sizeof(redis_response_t));
+    response.buffer = output->buffer;
+    response.reader = output->buffer;
+    response.length = output->length;
+    response.fd = -1;
+
+    if(redis_client_direct(client)) {
+        if(redis_send_response(client, &response) == NULL) {
+            output->length = 0;
+            return;
+        }
+    }
+
+    // remaining part is queued, the buffer is handed to the response
+    redis_response_t *newresponse;
+
+    if(!(newresponse = redis_response_new(output->buffer, output->length, free))) {
+        zdbd_warnp("redis_output_flush: malloc");
+        output->length = 0;
+        return;
     }
 
-    response = client->responses;
+    newresponse->reader = response.reader;
+    newresponse->length = response.length;
+    redis_response_push(client, newresponse);
 
-    zdbd_debug("[+] redis: sending available buffer to socket %d\n", fd);
-    while(response) {
-        // sending this response
-        // if the send_response returns us something, then it
-        // was not fully sent, let's try again later, we are done for now
-        if(redis_send_response(client, response) != NULL)
-            return 0;
+    output->buffer = NULL;
+    output->length = 0;
+    output->allocated = 0;
+}
 
-        // this response was successfuly sent
-        // let's remove it from the list and keep going
+static int redis_output_append(redis_client_t *client, void *payload, size_t length) {
+    redis_output_t *output = &client->output;
 
-        // saving the next pointer
-        redis_response_t *next = response->next;
+    if(output->length + length > output->allocated) {
+        size_t allocated = (output->allocated) ? output->allocated : REDIS_BUFFER_SIZE;
+        unsigned char *buffer;
 
-        // freeing this response
-        redis_response_free(response);
-        response = next;
+        while(allocated < output->length + length)
+            allocated *= 2;
 
-        // updating list
-        client->responses = next;
+        if(!(buffer = realloc(output->buffer, allocated))) {
+            zdbd_warnp("redis_output_append: realloc");
+            return 1;
+        }
 
-        // this was the last response, cleaning the tail
-        if(next == NULL)
-            client->responsetail = NULL;
+        output->buffer = buffer;
+        output->allocated = allocated;
     }
 
+    memcpy(output->buffer + output->length, payload, length);
+    output->length += length;
+
+    // don't keep too much data, even if the batch is not done
+    if(output->length >= REDIS_OUTPUT_MAX)
+        redis_output_flush(client);
+
     return 0;
 }
 
+// a batch of requests starts, replies are held on the arena
+void redis_output_cork(redis_client_t *client) {
+    pthread_mutex_lock(&client->lock);
+    client->output.corked = 1;
+    pthread_mutex_unlock(&client->lock);
+}
+
+// batch is done, replies are sent
+void redis_output_uncork(redis_client_t *client) {
+    redis_output_t *output = &client->output;
+
+    pthread_mutex_lock(&client->lock);
+
+    output->corked = 0;
+    redis_output_flush(client);
+
+    // large arena is not kept between batches
+    if(output->allocated > REDIS_BUFFER_SIZE) {
+        free(output->buffer);
+        output->buffer = NULL;
+        output->allocated = 0;
+    }
+
+    pthread_mutex_unlock(&client->lock);
+}
+
 // entry point when you want to send data to the client, and the buffer
 // was allocated on the heap (malloc), this function will just take the payload
 // create a response based on that, and send it (pushing on the queue if needed)
-int redis_reply_heap(redis_client_t *client, void *payload, size_t length, void (*destructor)(void *)) {
+static int redis_reply_heap_real(redis_client_t *client, void *payload, size_t length, void (*destructor)(void *)) {
     redis_response_t *response;
 
+    if(client->output.corked) {
+        // small reply, copied with the batch
+        if(length < REDIS_OUTPUT_INLINE) {
+            int value = redis_output_append(client, payload, length);
+
+            if(destructor)
+                destructor(payload);
+
+            return value;
+        }
+
+        // large reply, batch content needs to be sent first
+        redis_output_flush(client);
+    }
+
     // create a response based on parameters
     if(!(response = redis_response_new(payload, length, destructor))) {
         zdbd_warnp("redis_reply_head: malloc");
         return 1;
     }
 
-    if(client->responses == NULL) {
+    if(redis_client_direct(client)) {
         // try to send this response a first time
         if(redis_send_response(client, response) == NULL) {
             pzdbd_debug("[+] redis: reply heap: send was made in single shot\n");
@@ -275,20 +584,27 @@ int redis_reply_heap(redis_client_t *client, void *payload, size_t length, void
 //
 // we first try to send it as it, and if this succeed, we're done, otherwise
 // we duplicate that data and push it to the client queue
-int redis_reply_stack(redis_client_t *client, void *payload, size_t length) {
+static int redis_reply_stack_real(redis_client_t *client, void *payload, size_t length) {
     redis_response_t response;
 
+    // batch in progress, sent with the next replies
+    if(client->output.corked)
+        return redis_output_append(client, payload, length);
+
     response.buffer = payload;
     response.reader = payload;
     response.length = length;
     response.destructor = NULL;
+    response.fd = -1;
 
     // try to send this response a first time, without any extra allocation
     // usually from the stack this will be enough
     //
     // this can only be done if nothing was pending, otherwise we will
     // break protocol serialization (some pending stuff needs to be sent before)
-    if(client->responses == NULL) {
+    //
+    // replies held by group commit needs to be queued as well
+    if(redis_client_direct(client)) {
         if(redis_send_response(client, &response) == NULL) {
             pzdbd_debug("[+] redis: reply stack: no stack duplication needed\n");
             return 0;
@@ -325,6 +641,113 @@ int redis_reply_stack(redis_client_t *client, void *payload, size_t length) {
     return 0;
 }
 
+// entry point when the payload to send is located on a file
+// the payload is sent from the kernel directly (sendfile), without
+// any copy in userspace
+//
+// the descriptor is only borrowed, if the payload can't be sent in one shot
+// the descriptor is duplicated and the response queued
+static int redis_reply_file_real(redis_client_t *client, int fd, off_t offset, size_t length) {
+    redis_response_t response;
+
+    // batch content needs to be sent first
+    if(client->output.corked)
+        redis_output_flush(client);
+
+    memset(&response, 0, sizeof(redis_response_t));
+    response.fd = fd;
+    response.offset = offset;
+    response.length = length;
+
+    if(redis_client_direct(client)) {
+        if(redis_send_response(client, &response) == NULL) {
+            pzdbd_debug("[+] redis: reply file: sent in single shot\n");
+            return 0;
+        }
+    }
+
+    redis_response_t *newresponse;
+
+    if(!(newresponse = redis_response_new(NULL, response.length, NULL)))
+        return 1;
+
+    // keeping the file reachable, even if it's
+    // rotated or closed in the meantime
+    if((newresponse->fd = dup(fd)) < 0) {
+        zdbd_warnp("redis_reply_file: dup");
+        free(newresponse);
+        return 1;
+    }
+
+    newresponse->offset = response.offset;
+    redis_response_push(client, newresponse);
+
+    return 0;
+}
+
+// replies can be sent to a client by another reactor (eg: watchers
+// notification), responses queue is protected by the client lock
+int redis_reply_heap(redis_client_t *client, void *payload, size_t length, void (*destructor)(void *)) {
+    pthread_mutex_lock(&client->lock);
+    int value = redis_reply_heap_real(client, payload, length, destructor);
+    pthread_mutex_unlock(&client->lock);
+
+    return value;
+}
+
+int redis_reply_stack(redis_client_t *client, void *payload, size_t length) {
+    pthread_mutex_lock(&client->lock);
+    int value = redis_reply_stack_real(client, payload, length);
+    pthread_mutex_unlock(&client->lock);
+
+    return value;
+}
+
+int redis_reply_file(redis_client_t *client, int fd, off_t offset, size_t length) {
+    pthread_mutex_lock(&client->lock);
+    int value = redis_reply_file_real(client, fd, offset, length);
+    pthread_mutex_unlock(&client->lock);
+
+    return value;
+}
+
+// reserve the place of a reply which will be filled later by the
+// read pool, replies sent meanwhile are queued behind it, this way
+// the order of replies is preserved
+redis_response_t *redis_reply_pending(redis_client_t *client, void *job) {
+    redis_response_t *response;
+
+    if(!(response = redis_response_new(NULL, 0, NULL)))
+        return NULL;
+
+    response->pending = job;
+
+    pthread_mutex_lock(&client->lock);
+
+    // replies already produced are sent before
+    redis_output_flush(client);
+    redis_response_push(client, response);
+    pthread_mutex_unlock(&client->lock);
+
+    return response;
+}
+
+// pending reply is ready, payload is owned by the response from now,
+// everything queued (up to the next pending reply) can be sent
+void redis_reply_complete(redis_client_t *client, redis_response_t *response, void *payload, size_t length) {
+    pthread_mutex_lock(&client->lock);
+
+    response->buffer = payload;
+    response->reader = payload;
+    response->length = length;
+    response->destructor = free;
+    response->pending = NULL;
+
+    redis_client_flush(client);
+
+    pthread_mutex_unlock(&client->lock);
+}
+
 //
 // auto-bulk builder/responder
 //
@@ -433,10 +856,9 @@ static resp_status_t redis_handle_resp_empty(redis_client_t *client) {
         return RESP_STATUS_ABNORMAL;
     }
 
-    // we don't have any command
-    // with more than like 4 or 5 arguments
-    // but let put a higher limit, just in case
-    if(request->argc > 8) {
+    // most commands have less than 4 or 5 arguments
+    // but multi-keys commands (eg: MGET) can have a lot
+    if(request->argc < 0 || request->argc > REDIS_MAX_ARGUMENTS) {
         resp_discard(client, "Too many arguments");
         return RESP_STATUS_ABNORMAL;
     }
@@ -499,15 +921,35 @@ static resp_status_t redis_handle_resp_header(redis_client_t *client) {
     resp_object_t *argument = request->argv[request->fillin];
 
     // reading the length of the array
-    argument->length = atoi(buffer->reader + 1);
-    // real size is the length + 2 (\r\n)
-    argument->size = argument->length + 2;
+    long long length = strtoll(buffer->reader + 1, NULL, 10);
+
+    // large payload, only accepted as value of a SET, it's written
+    // to the datafile while received and not kept in memory
+    if(length > REDIS_MAX_PAYLOAD) {
+        if(length > REDIS_MAX_STREAM_PAYLOAD || !command_set_streamable(client)) {
+            resp_discard(client, "Payload too big");
+            return RESP_STATUS_DISCARD;
+        }
 
-    if(argument->length > REDIS_MAX_PAYLOAD) {
-        resp_discard(client, "Payload too big");
-        return RESP_STATUS_DISCARD;
+        argument->length = length;
+        argument->size = length + 2;
+        argument->type = STRING;
+
+        buffer->reader = match + 1;
+        request->state = RESP_FILLIN_PAYLOAD;
+
+        if(command_set_stream_begin(client, length)) {
+            resp_discard(client, "Internal memory error");
+            return RESP_STATUS_DISCARD;
+        }
+
+        return RESP_STATUS_CONTINUE;
     }
 
+    argument->length = length;
+    // real size is the length + 2 (\r\n)
+    argument->size = argument->length + 2;
+
     if(!(argument->buffer = (unsigned char *) malloc(argument->size))) {
         zdbd_warnp("argument buffer malloc");
         resp_discard(client, "Internal memory error");
@@ -522,6 +964,17 @@ static resp_status_t redis_handle_resp_header(redis_client_t *client) {
     return RESP_STATUS_CONTINUE;
 }
 
+// copy payload bytes received on the client buffer to the argument,
+// a streamed payload is handed to its stream instead
+static void redis_argument_fill(redis_client_t *client, resp_object_t *argument, void *source, size_t length) {
+    if(client->stream) {
+        command_set_stream_write(client, source, length);
+        return;
+    }
+
+    memcpy(argument->buffer + argument->filled, source, length);
+}
+
 static resp_status_t redis_handle_resp_payload(redis_client_t *client) {
     resp_request_t *request = client->request;
     buffer_t *buffer = &client->buffer;
@@ -554,8 +1007,7 @@ static resp_status_t redis_handle_resp_payload(redis_client_t *client) {
 
     if(available >= needed) {
         pzdbd_debug("[+] redis: more (or equals) available/needed, extracting needed\n");
-        void *argbuf = argument->buffer + argument->filled;
-        memcpy(argbuf, buffer->reader, needed);
+        redis_argument_fill(client, argument, buffer->reader, needed);
 
         // let update counters
         argument->filled += needed;
@@ -581,7 +1033,7 @@ static resp_status_t redis_handle_resp_payload(redis_client_t *client) {
     // to fill the complete payload, let's take everything available
     // and place it on the request buffer, reseting source buffer
     // and waiting for more data to come (by the caller)
-    memcpy(argument->buffer + argument->filled, buffer->reader, available);
+    redis_argument_fill(client, argument, buffer->reader, available);
     argument->filled += available;
 
     pzdbd_debug("[+] redis: resetting buffer\n");
@@ -656,8 +1108,9 @@ static resp_status_t redis_handle_resp_finished(redis_client_t *client) {
     value = redis_dispatcher(client);
     zdbd_debug("[+] redis: dispatcher done, return code: %d\n", value);
 
-    zdbd_debug("[+] redis: calling posthandler\n");
-    redis_posthandler_client(client);
+    // streamed request not handled (eg: namespace removed)
+    if(client->stream)
+        command_set_stream_abort(client);
 
     // clearing the request
     redis_free_request(request);
@@ -669,69 +1122,110 @@ static resp_status_t redis_handle_resp_finished(redis_client_t *client) {
     return value;
 }
 
-// function called as soon as something is available on
-// one client socket
-resp_status_t redis_chunk_read(int fd) {
-    redis_client_t *client = clients.list[fd];
+// large argument expected and nothing left on the shared buffer, the
+// payload is received straight into the argument buffer, without
+// going through the client buffer (and an extra copy per chunk)
+static resp_object_t *redis_direct_argument(redis_client_t *client) {
     resp_request_t *request = client->request;
     buffer_t *buffer = &client->buffer;
-    ssize_t length;
 
-    // default return value
-    int value = RESP_STATUS_SUCCESS;
+    if(request->state != RESP_FILLIN_PAYLOAD)
+        return NULL;
 
-go_again:
-    // buffer is full, this is probably a bug
-    if(buffer->remain == 0) {
-        zdbd_debug("[-] resp: new chunk requested and buffer full\n");
-        return RESP_STATUS_DISCARD;
-    }
+    // something not parsed yet is still on the buffer
+    if(buffer->reader != buffer->writer)
+        return NULL;
 
-    pzdbd_debug("[+] redis: perform read on the socket\n");
-    if((length = recv(fd, buffer->writer, buffer->remain, 0)) < 0) {
-        if(errno != EAGAIN && errno != EWOULDBLOCK) {
-            zdbd_warnp("client recv");
-            return RESP_STATUS_ABNORMAL;
-        }
+    resp_object_t *argument = request->argv[request->fillin];
 
-        // we hit a EGAIN or EWOULDBLOCK, nothing wrong here,
-        // this is probably because the request was done
-        // and nothing more is available on the socket, let's
-        // return the caller the value we received from the
-        // process (or success if nothing was done)
-        return value;
-    }
+    // small payloads keep using the client buffer, they
+    // can be received with the next requests at once
+    if(argument->size - argument->filled < REDIS_BUFFER_SIZE)
+        return NULL;
 
-    if(length == 0) {
-        // socket was empty
-        // this is probably a connection reset by peer
-        // let's disconnect this client
-        zdbd_debug("[+] resp: empty socket read, client disconnected\n");
-        return RESP_STATUS_DISCONNECTED;
-    }
+    buffer_reset(buffer);
 
-    // updating statistics
-    zdbd_rootsettings.stats.networkrx += length;
+    return argument;
+}
 
-    buffer->writer += length;
-    buffer->length += length;
-    buffer->remain -= length;
+// payload received straight into the argument buffer
+static resp_status_t redis_handle_resp_direct(redis_client_t *client, size_t length) {
+    resp_request_t *request = client->request;
+    resp_object_t *argument = request->argv[request->fillin];
 
-    #ifdef PROTOCOL_DEBUG
-    zdbd_fulldump((uint8_t *) buffer->buffer, buffer->length);
-    #endif
+    argument->filled += length;
 
-    // ensure string (needed for testing later)
-    // buffer->buffer[buffer->length] = '\0';
+    if(client->stream)
+        command_set_stream_received(client, length);
 
-    // while we didn't parsed everything available
-    // on the buffer
-    while(buffer->reader < buffer->writer) {
-        pzdbd_debug("[+] redis: buffer parsing (r: %p, w: %p)\n", buffer->reader, buffer->writer);
+    if(argument->filled < argument->size)
+        return RESP_STATUS_CONTINUE;
 
-        // checking if the current request is empty
-        // if it is, let's doing a parsing to see if enough
-        // data are available to build the request and if
+    pzdbd_debug("[+] redis: direct payload completed\n");
+
+    request->fillin += 1;
+    request->state = RESP_FILLIN_HEADER;
+
+    if(request->fillin == request->argc)
+        return redis_handle_resp_finished(client);
+
+    return RESP_STATUS_CONTINUE;
+}
+
+// where the next bytes received needs to land, the argument is returned
+// when they go straight to a (large) argument
+static resp_object_t *redis_chunk_target(redis_client_t *client, char **target, size_t *remain) {
+    buffer_t *buffer = &client->buffer;
+    resp_object_t *argument;
+
+    if((argument = redis_direct_argument(client))) {
+        *target = (char *) argument->buffer + argument->filled;
+        *remain = argument->size - argument->filled;
+
+        // streamed payload, received on the stream chunk
+        if(client->stream)
+            *target = command_set_stream_target(client, remain);
+
+        return argument;
+    }
+
+    *target = buffer->writer;
+    *remain = buffer->remain;
+
+    return NULL;
+}
+
+// parse and execute what was just received on the target
+static resp_status_t redis_chunk_process(redis_client_t *client, resp_object_t *argument, size_t length) {
+    resp_request_t *request = client->request;
+    buffer_t *buffer = &client->buffer;
+    int value = RESP_STATUS_SUCCESS;
+
+    // updating statistics
+    zdb_atomic_add(zdbd_rootsettings.stats.networkrx, length);
+
+    if(argument)
+        return redis_handle_resp_direct(client, length);
+
+    buffer->writer += length;
+    buffer->length += length;
+    buffer->remain -= length;
+
+    #ifdef PROTOCOL_DEBUG
+    zdbd_fulldump((uint8_t *) buffer->buffer, buffer->length);
+    #endif
+
+    // ensure string (needed for testing later)
+    // buffer->buffer[buffer->length] = '\0';
+
+    // while we didn't parsed everything available
+    // on the buffer
+    while(buffer->reader < buffer->writer) {
+        pzdbd_debug("[+] redis: buffer parsing (r: %p, w: %p)\n", buffer->reader, buffer->writer);
+
+        // checking if the current request is empty
+        // if it is, let's doing a parsing to see if enough
+        // data are available to build the request and if
         // the data is well formated
         if(request->state == RESP_EMPTY) {
             if((value = redis_handle_resp_empty(client)) != RESP_STATUS_SUCCESS) {
@@ -781,6 +1275,55 @@ go_again:
         }
     }
 
+    return value;
+}
+
+// function called as soon as something is available on
+// one client socket
+static resp_status_t redis_chunk_read_real(int fd) {
+    redis_client_t *client = clients.list[fd];
+    resp_object_t *argument;
+    ssize_t length;
+    char *target;
+    size_t remain;
+
+    // default return value
+    int value = RESP_STATUS_SUCCESS;
+
+go_again:
+    argument = redis_chunk_target(client, &target, &remain);
+
+    // buffer is full, this is probably a bug
+    if(remain == 0) {
+        zdbd_debug("[-] resp: new chunk requested and buffer full\n");
+        return RESP_STATUS_DISCARD;
+    }
+
+    pzdbd_debug("[+] redis: perform read on the socket\n");
+    if((length = recv(fd, target, remain, 0)) < 0) {
+        if(errno != EAGAIN && errno != EWOULDBLOCK) {
+            zdbd_warnp("client recv");
+            return RESP_STATUS_ABNORMAL;
+        }
+
+        // we hit a EGAIN or EWOULDBLOCK, nothing wrong here,
+        // this is probably because the request was done
+        // and nothing more is available on the socket, let's
+        // return the caller the value we received from the
+        // process (or success if nothing was done)
+        return value;
+    }
+
+    if(length == 0) {
+        // socket was empty
+        // this is probably a connection reset by peer
+        // let's disconnect this client
+        zdbd_debug("[+] resp: empty socket read, client disconnected\n");
+        return RESP_STATUS_DISCONNECTED;
+    }
+
+    value = redis_chunk_process(client, argument, length);
+
     // do not keep going on this request/client
     if(value == RESP_STATUS_DISCARD || value == RESP_STATUS_DISCONNECTED) {
         pzdbd_debug("[+] redis: discard or disconnected received\n");
@@ -804,6 +1347,70 @@ go_again:
     return RESP_STATUS_SUCCESS;
 }
 
+// every requests available on the socket are executed as one batch,
+// their replies are sent together when the batch is done
+resp_status_t redis_chunk_read(int fd) {
+    redis_client_t *client = clients.list[fd];
+
+    redis_output_cork(client);
+    resp_status_t value = redis_chunk_read_real(fd);
+    redis_output_uncork(client);
+
+    return value;
+}
+
+//
+// completion based event backend (io_uring)
+//
+// the backend receives on its own, straight on the target provided
+// here (client buffer, large argument or stream chunk), the target is
+// owned by the client and only changes when the received bytes are
+// processed, it stays valid until the receive completes
+//
+
+// where the next receive needs to land, target is NULL (and length is
+// zero) if nothing can be received until the stream chunk is written,
+// returns RESP_STATUS_DISCARD if the client buffer is full
+resp_status_t redis_chunk_buffer(redis_client_t *client, void **target, size_t *length) {
+    char *buffer;
+
+    *target = NULL;
+    *length = 0;
+
+    if(client->stream && command_set_stream_busy(client))
+        return RESP_STATUS_SUCCESS;
+
+    redis_chunk_target(client, &buffer, length);
+
+    // buffer is full, this is probably a bug
+    if(*length == 0) {
+        zdbd_debug("[-] resp: new chunk requested and buffer full\n");
+        return RESP_STATUS_DISCARD;
+    }
+
+    *target = buffer;
+
+    return RESP_STATUS_SUCCESS;
+}
+
+// bytes received on the target, executed as one batch, like
+// redis_chunk_read (status is never 'try again')
+resp_status_t redis_chunk_received(redis_client_t *client, size_t length) {
+    resp_object_t *argument = redis_direct_argument(client);
+
+    redis_output_cork(client);
+    resp_status_t value = redis_chunk_process(client, argument, length);
+    redis_output_uncork(client);
+
+    if(value == RESP_STATUS_DISCARD || value == RESP_STATUS_DISCONNECTED)
+        return value;
+
+    if(value == RESP_STATUS_DONE || value == RESP_STATUS_SHUTDOWN)
+        return value;
+
+    return RESP_STATUS_SUCCESS;
+}
+
 void socket_nonblock(int fd) {
     int flags;
 
@@ -829,6 +1436,14 @@ redis_client_t *socket_client_new(int fd) {
         redis_client_t **newlist = NULL;
         size_t newlength = clients.length + fd;
 
+        // with several reactors, the list is read without lock and
+        // can't be moved, it's allocated for the maximum amount of
+        // descriptors on startup
+        if(zdbd_rootsettings.threads > 1) {
+            zdbd_warning("[-] redis: client %d: out of clients list, refused", fd);
+            return NULL;
+        }
+
         // growing the list
         if(!(newlist = (redis_client_t **) realloc(clients.list, sizeof(redis_client_t *) * newlength)))
             return NULL;
@@ -859,6 +1474,10 @@ redis_client_t *socket_client_new(int fd) {
     client->mirror = 0;
     client->master = 0;
     client->nonce = NULL;
+    client->commitid = 0;
+    client->stream = NULL;
+    client->uring = NULL;
+    client->watchtimeout = 0;
 
     // initialize wait timeout
     memset(&client->watchtime, 0, sizeof(struct timespec));
@@ -880,6 +1499,7 @@ redis_client_t *socket_client_new(int fd) {
     // no pending responses
     client->responses = NULL;
     client->responsetail = NULL;
+    memset(&client->output, 0, sizeof(redis_output_t));
 
     client->request->state = RESP_EMPTY;
     client->request->argc = 0;
@@ -895,15 +1515,36 @@ redis_client_t *socket_client_new(int fd) {
     // set all users to admin if no password are set
     client->admin = (zdbd_rootsettings.adminpwd) ? 0 : 1;
 
+    // replies can be sent from another reactor while
+    // the client itself is sending something
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&client->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    pthread_mutex_lock(&clients.lock);
+
     // set client to the list
     clients.list[fd] = client;
 
     // update statistics
     zdbd_rootsettings.stats.clients += 1;
 
+    pthread_mutex_unlock(&clients.lock);
+
     return client;
 }
 
+// client connected on this descriptor, if any
+redis_client_t *socket_client_get(int fd) {
+    if(fd < 0 || (size_t) fd >= clients.length)
+        return NULL;
+
+    return clients.list[fd];
+}
+
 // free allocated client when disconnected
 void socket_client_free(int fd) {
     redis_client_t *client = clients.list[fd];
@@ -915,6 +1556,48 @@ void socket_client_free(int fd) {
     zdbd_debug("[+] client: stayed %.f seconds, %lu commands\n", elapsed, client->commands);
     #endif
 
+    // disconnected while uploading a large payload
+    if(client->stream)
+        command_set_stream_abort(client);
+
+    // removing the client from the list before closing the
+    // socket, once closed, the same descriptor can be reused
+    // straight away by another reactor
+    pthread_mutex_lock(&clients.lock);
+
+    // allow new client on this spot
+    clients.list[fd] = NULL;
+
+    if(client->watching || client->mirror)
+        __atomic_sub_fetch(&clients.listeners, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_unlock(&clients.lock);
+
+    // dropping replies not sent, replies still read by the read
+    // pool are detached, the worker will discard them
+    readpool_lock();
+    pthread_mutex_lock(&client->lock);
+
+    for(redis_response_t *response = client->responses, *next; response; response = next) {
+        next = response->next;
+
+        if(response->pending) {
+            readpool_orphan(response->pending);
+            continue;
+        }
+
+        redis_response_free(response);
+    }
+
+    client->responses = NULL;
+    client->responsetail = NULL;
+
+    free(client->output.buffer);
+    client->output.buffer = NULL;
+
+    pthread_mutex_unlock(&client->lock);
+    readpool_unlock();
+
     // closing socket
     close(client->fd);
 
@@ -922,13 +1605,12 @@ void socket_client_free(int fd) {
     redis_free_request(client->request);
     buffer_free(&client->buffer);
 
+    pthread_mutex_destroy(&client->lock);
+
     free(client->nonce);
     free(client->request);
     free(client);
 
-    // allow new client on this spot
-    clients.list[fd] = NULL;
-
     // maybe we could reduce the list usage now
 }
 
@@ -936,6 +1618,8 @@ void socket_client_free(int fd) {
 // if they matches, move them to a special state, waiting
 // for disconnection (with alert)
 int redis_detach_clients(namespace_t *namespace) {
+    pthread_mutex_lock(&clients.lock);
+
     for(size_t i = 0; i < clients.length; i++) {
         if(!clients.list[i])
             continue;
@@ -946,9 +1630,48 @@ int redis_detach_clients(namespace_t *namespace) {
         }
     }
 
+    pthread_mutex_unlock(&clients.lock);
+
     return 0;
 }
 
+// group commit batch synced, release replies of all clients
+// waiting for that batch (or an older one)
+//
+// if the sync failed, writes are not durable and cannot be
+// acknowledged, clients are disconnected instead
+void redis_clients_commit(uint64_t commitid, int error) {
+    pthread_mutex_lock(&clients.lock);
+
+    for(size_t i = 0; i < clients.length; i++) {
+        redis_client_t *client = clients.list[i];
+
+        if(!client)
+            continue;
+
+        pthread_mutex_lock(&client->lock);
+
+        if(client->commitid == 0 || client->commitid > commitid) {
+            pthread_mutex_unlock(&client->lock);
+            continue;
+        }
+
+        client->commitid = 0;
+
+        if(error) {
+            zdbd_debug("[-] redis: client %d: group commit failed, disconnecting\n", client->fd);
+            shutdown(client->fd, SHUT_RDWR);
+
+        } else {
+            redis_client_flush(client);
+        }
+
+        pthread_mutex_unlock(&client->lock);
+    }
+
+    pthread_mutex_unlock(&clients.lock);
+}
+
 
 int redis_mirror_client(redis_client_t *source, redis_client_t *target) {
     char temp[256];
@@ -967,6 +1690,14 @@ int redis_mirror_client(redis_client_t *source, redis_client_t *target) {
         return 0;
     }
 
+    // streamed payload is not in memory, it can't be forwarded
+    for(int i = 0; i < source->request->argc; i++) {
+        if(!source->request->argv[i]->buffer) {
+            zdbd_debug("[-] redis: mirror: streamed payload, not forwarding\n");
+            return 0;
+        }
+    }
+
     // computing the buffer size
     size_t length = 0;
     size_t offset = 0;
@@ -1023,6 +1754,12 @@ int redis_mirror_client(redis_client_t *source, redis_client_t *target) {
 void redis_client_set_watcher(redis_client_t *client, command_t *handler, size_t timeoutms) {
     zdbd_debug("[+] redis: set watcher: command %s, timeout: %lu ms\n", handler->command, timeoutms);
 
+    pthread_mutex_lock(&client->lock);
+
+    // one more client to notify
+    if(!client->watching && !client->mirror)
+        __atomic_add_fetch(&clients.listeners, 1, __ATOMIC_RELAXED);
+
     // nothing to send to client, he is waiting now
     // we set the command pointer to that client waiting flag
     // and as soon as someone else on the same namespace will
@@ -1032,16 +1769,37 @@ void redis_client_set_watcher(redis_client_t *client, command_t *handler, size_t
     // set initial waiting time and timeout
     gettimeofday(&client->watchtime, NULL);
     client->watchtimeout = timeoutms;
+
+    pthread_mutex_unlock(&client->lock);
 }
 
 // unset needed flags to set client not watching command anymore
 void redis_client_unset_watcher(redis_client_t *client) {
+    pthread_mutex_lock(&client->lock);
+
+    if(client->watching && !client->mirror)
+        __atomic_sub_fetch(&clients.listeners, 1, __ATOMIC_RELAXED);
+
     // trigger done, discarding watcher
     client->watching = NULL;
 
     // reset timeout
     client->watchtimeout = 0;
     memset(&client->watchtime, 0, sizeof(client->watchtime));
+
+    pthread_mutex_unlock(&client->lock);
+}
+
+// forward all the traffic to this client
+void redis_client_set_mirror(redis_client_t *client) {
+    pthread_mutex_lock(&client->lock);
+
+    if(!client->watching && !client->mirror)
+        __atomic_add_fetch(&clients.listeners, 1, __ATOMIC_RELAXED);
+
+    client->mirror = 1;
+
+    pthread_mutex_unlock(&client->lock);
 }
 
 uint64_t timeval_delta_ms(struct timeval *begin, struct timeval *end) {
@@ -1055,6 +1813,12 @@ static void redis_watch_timeout() {
     struct timeval timecheck;
     char response[64];
 
+    // nobody is waiting
+    if(__atomic_load_n(&clients.listeners, __ATOMIC_RELAXED) == 0)
+        return;
+
+    pthread_mutex_lock(&clients.lock);
+
     for(size_t i = 0; i < clients.length; i++) {
         if(!clients.list[i])
             continue;
@@ -1062,6 +1826,8 @@ static void redis_watch_timeout() {
         // shortcut
         redis_client_t *checking = clients.list[i];
 
+        pthread_mutex_lock(&checking->lock);
+
         // checking if watching timeout is reached
         if(checking->watching) {
             gettimeofday(&timecheck, NULL);
@@ -1078,7 +1844,11 @@ static void redis_watch_timeout() {
                 redis_reply_stack(checking, response, strlen(response));
             }
         }
+
+        pthread_mutex_unlock(&checking->lock);
     }
+
+    pthread_mutex_unlock(&clients.lock);
 }
 
 void redis_files_rotate() {
@@ -1104,18 +1874,191 @@ void redis_files_rotate() {
     }
 }
 
+// move forward memory index resize in progress (or start
+// one if needed), a bounded amount of work per namespace
+void redis_index_resize() {
+    namespace_t *ns;
+
+    for(ns = namespace_iter(); ns; ns = namespace_iter_next(ns))
+        index_resize_step(ns->index, INDEX_RESIZE_IDLE_STEPS);
+}
+
+// index checkpoint are written by a forked child, the child gets a frozen
+// copy of the memory index and can walk it without any lock, the parent
+// keeps serving clients in the meantime
+//
+// marks are taken before forking and only committed (as last checkpoint)
+// when the child succeed
+typedef struct redis_checkpoint_t {
+    char *name;                  // namespace name
+    index_root_t *root;          // index at fork time
+    index_checkpoint_t mark;     // high-water mark written
+
+} redis_checkpoint_t;
+
+static struct {
+    pid_t pid;                   // child pid, zero when idle
+    time_t last;                 // last checkpoint round
+    redis_checkpoint_t *list;
+    size_t length;
+
+} checkpoints = {
+    .pid = 0,
+    .last = 0,
+    .list = NULL,
+    .length = 0,
+};
+
+static void redis_index_checkpoint_release() {
+    for(size_t i = 0; i < checkpoints.length; i++)
+        free(checkpoints.list[i].name);
+
+    free(checkpoints.list);
+
+    checkpoints.list = NULL;
+    checkpoints.length = 0;
+    checkpoints.pid = 0;
+}
+
+static void redis_index_checkpoint_commit() {
+    for(size_t i = 0; i < checkpoints.length; i++) {
+        redis_checkpoint_t *checkpoint = &checkpoints.list[i];
+        namespace_t *ns;
+
+        // namespace could be removed or flushed in the meantime
+        if(!(ns = namespace_get(checkpoint->name)) || ns->index != checkpoint->root)
+            continue;
+
+        ns->index->checkpoint = checkpoint->mark;
+    }
+
+    redis_index_checkpoint_release();
+}
+
+static void redis_index_checkpoint_wait() {
+    int status;
+    pid_t pid;
+
+    if((pid = waitpid(checkpoints.pid, &status, WNOHANG)) == 0)
+        return;
+
+    if(pid < 0) {
+        // child already reaped by hooks cleanup, status is
+        // lost, marks are not committed and next round will
+        // write them again
+        zdbd_debug("[-] system: checkpoint: child status lost\n");
+        redis_index_checkpoint_release();
+        return;
+    }
+
+    zdb_settings_get()->stats.childwait -= 1;
+
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        zdbd_warning("[-] system: checkpoint: writer failed, will retry next time");
+        redis_index_checkpoint_release();
+        return;
+    }
+
+    zdbd_debug("[+] system: checkpoint: writer done\n");
+    redis_index_checkpoint_commit();
+}
+
+// periodically write index checkpoint of each namespace
+// which changed since last checkpoint
+void redis_index_checkpoint() {
+    namespace_t *ns;
+
+    // checkpoint disabled, nothing to do here
+    if(zdbd_rootsettings.checkpointsec == 0)
+        return;
+
+    // a checkpoint is already in progress
+    if(checkpoints.pid > 0) {
+        redis_index_checkpoint_wait();
+        return;
+    }
+
+    if(checkpoints.last == 0)
+        checkpoints.last = time(NULL);
+
+    if(time(NULL) - checkpoints.last < zdbd_rootsettings.checkpointsec)
+        return;
+
+    checkpoints.last = time(NULL);
+
+    for(ns = namespace_iter(); ns; ns = namespace_iter_next(ns)) {
+        if(!index_checkpoint_needed(ns->index))
+            continue;
+
+        if(!(checkpoints.list = realloc(checkpoints.list, sizeof(redis_checkpoint_t) * (checkpoints.length + 1))))
+            zdbd_diep("checkpoint: realloc");
+
+        redis_checkpoint_t *checkpoint = &checkpoints.list[checkpoints.length];
+
+        checkpoint->name = strdup(ns->name);
+        checkpoint->root = ns->index;
+        index_checkpoint_mark(ns->index, &checkpoint->mark);
+
+        checkpoints.length += 1;
+    }
+
+    // nothing changed since last round
+    if(checkpoints.length == 0)
+        return;
+
+    zdbd_verbose("[+] system: checkpoint: writing %lu namespaces\n", checkpoints.length);
+
+    // don't duplicate pending logs on the child
+    fflush(stdout);
+
+    if((checkpoints.pid = fork()) < 0) {
+        zdbd_warnp("checkpoint: fork");
+        redis_index_checkpoint_release();
+        return;
+    }
+
+    if(checkpoints.pid > 0) {
+        // one more pending child, shared with hooks
+        zdb_settings_get()->stats.childwait += 1;
+        return;
+    }
+
+    // child process now, any failure discard the commit of the
+    // whole round, checkpoints already written are still valid
+    int status = EXIT_SUCCESS;
+
+    for(size_t i = 0; i < checkpoints.length; i++)
+        if(index_checkpoint_write(checkpoints.list[i].root, &checkpoints.list[i].mark))
+            status = EXIT_FAILURE;
+
+    fflush(stdout);
+    _exit(status);
+}
+
 // recurring or periodic actions we can do
 // when the server is in idle state (no clients action
 // for a certain amount of time)
+//
+// only executed by the main reactor, with the engine for itself
 void redis_idle_process() {
+    command_engine_lock(0);
+
     // watch commands timeout
     redis_watch_timeout();
 
     // rotate files if requested after some time
     redis_files_rotate();
 
+    // incremental index resize
+    redis_index_resize();
+
+    // periodic index checkpoint
+    redis_index_checkpoint();
+
     // discard any pending hook child
     libzdb_hooks_cleanup();
+
+    command_engine_unlock();
 }
 
 // handler executed after each command executed
@@ -1131,6 +2074,13 @@ int redis_posthandler_client(redis_client_t *client) {
     if(!client->executed)
         return 0;
 
+    // nobody is waiting or mirroring, this avoid walking
+    // over all clients (and locking the list) on each command
+    if(__atomic_load_n(&clients.listeners, __ATOMIC_RELAXED) == 0)
+        return 0;
+
+    pthread_mutex_lock(&clients.lock);
+
     for(size_t i = 0; i < clients.length; i++) {
         redis_client_t *checking = clients.list[i];
 
@@ -1144,11 +2094,15 @@ int redis_posthandler_client(redis_client_t *client) {
             continue;
         }
 
+        pthread_mutex_lock(&checking->lock);
+
         // or this client is not waiting on commands
         // or this client is not waiting on the same namespace
         // ignoring
-        if(!checking || !checking->watching || checking->ns != client->ns)
+        if(!checking->watching || checking->ns != client->ns) {
+            pthread_mutex_unlock(&checking->lock);
             continue;
+        }
 
         // matching on the exact command
         // or the wildcard command
@@ -1167,17 +2121,33 @@ int redis_posthandler_client(redis_client_t *client) {
             snprintf(response, sizeof(response), "+%s\r\n", matching);
             redis_reply_stack(checking, response, strlen(response));
         }
+
+        pthread_mutex_unlock(&checking->lock);
     }
 
+    pthread_mutex_unlock(&clients.lock);
+
     return 0;
 }
 
+void redis_shutdown_request() {
+    __atomic_store_n(&shutdown_requested, 1, __ATOMIC_RELAXED);
+}
+
+int redis_shutdown_requested() {
+    return __atomic_load_n(&shutdown_requested, __ATOMIC_RELAXED);
+}
+
 // one namespace is removed
 // we need to move the client attached to this namespace
 // to a non-valid namespace, in order to notify them
 
 // classic tcp socket
-static int redis_tcp_listen(char *listenaddr, char *port) {
+//
+// with several reactors, each reactor gets its own listening socket on
+// the same address (reuseport), the kernel balances new connections
+// between them
+static int redis_tcp_listen(char *listenaddr, char *port, int reuseport) {
     struct addrinfo hints;
     struct addrinfo *sinfo;
     int status;
@@ -1198,6 +2168,13 @@ static int redis_tcp_listen(char *listenaddr, char *port) {
     if(setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int)) == -1)
         zdbd_diep("tcp setsockopt");
 
+    #ifdef SO_REUSEPORT
+    if(reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(int)) == -1)
+        zdbd_diep("tcp setsockopt: reuseport");
+    #else
+    (void) reuseport;
+    #endif
+
     if(bind(fd, sinfo->ai_addr, sinfo->ai_addrlen) == -1)
         zdbd_diep("tcp bind");
 
@@ -1276,45 +2253,92 @@ int redis_socket_init(redis_handler_t *redis, char *listenaddr, char *socket) {
     return redis->fdlen;
 }
 
-int redis_listen(char *listenaddr, char *port, char *socket) {
-    zdb_settings_t *zdb_settings = zdb_settings_get();
-    redis_handler_t redis;
-    int fdindex = 0;
+// allocate the clients list, with several reactors the list can't
+// be moved anymore later, it's sized for the maximum amount of descriptors
+static void redis_clients_init(int threads) {
+    struct rlimit limit;
 
-    // allocating space for clients
     clients.length = REDIS_CLIENTS_INITIAL_LENGTH;
 
+    if(threads > 1) {
+        if(getrlimit(RLIMIT_NOFILE, &limit) < 0)
+            zdbd_diep("getrlimit");
+
+        // keep a sane upper bound with unlimited limit
+        clients.length = (limit.rlim_cur == RLIM_INFINITY) ? 1 << 20 : limit.rlim_cur;
+    }
+
     if(!(clients.list = calloc(sizeof(redis_client_t *), clients.length)))
         zdbd_diep("clients malloc");
+}
+
+static void *redis_reactor(void *args) {
+    redis_handler_t *handler = (redis_handler_t *) args;
+
+    zdbd_debug("[+] redis: reactor %d: started\n", handler->id);
+    socket_handler(handler);
 
-    redis_socket_init(&redis, listenaddr, socket);
+    return NULL;
+}
+
+int redis_listen(char *listenaddr, char *port, char *socket) {
+    zdb_settings_t *zdb_settings = zdb_settings_get();
+    int threads = zdbd_rootsettings.threads;
+    redis_handler_t *redis;
+    pthread_t *reactors;
+    int unixfd = -1;
 
-    // if unix socket is requested, adding it
+    // allocating space for clients
+    redis_clients_init(threads);
+
+    if(!(redis = calloc(sizeof(redis_handler_t), threads)))
+        zdbd_diep("reactors malloc");
+
+    if(!(reactors = calloc(sizeof(pthread_t), threads)))
+        zdbd_diep("reactors malloc");
+
+    // if unix socket is requested, adding it, the same
+    // socket is shared by all the reactors
     if(socket) {
-        redis.mainfd[fdindex] = redis_unix_listen(socket);
-        zdbd_log("[+] listen request: unix://%s (fd: %d)\n", socket, redis.mainfd[fdindex]);
+        unixfd = redis_unix_listen(socket);
+        zdbd_log("[+] listen request: unix://%s (fd: %d)\n", socket, unixfd);
 
-        socket_nonblock(redis.mainfd[fdindex]);
-        fdindex += 1;
-    }
+        socket_nonblock(unixfd);
 
-    // if tcp socket is requested, adding it
-    if(listenaddr) {
-        redis.mainfd[fdindex] = redis_tcp_listen(listenaddr, port);
-        zdbd_log("[+] listen request: tcp://%s:%s (fd: %d)\n", listenaddr, port, redis.mainfd[fdindex]);
+        if(listen(unixfd, SOMAXCONN) == -1)
+            zdbd_diep("listen");
 
-        socket_nonblock(redis.mainfd[fdindex]);
-        fdindex += 1;
+        zdbd_success("[+] listening on socket %d", unixfd);
     }
 
-    // configuring each sockets
-    for(int i = 0; i < redis.fdlen; i++) {
-        socket_nonblock(redis.mainfd[i]);
+    for(int id = 0; id < threads; id++) {
+        redis_handler_t *handler = &redis[id];
+        int fdindex = 0;
 
-        if(listen(redis.mainfd[i], SOMAXCONN) == -1)
-            zdbd_diep("listen");
+        redis_socket_init(handler, listenaddr, socket);
+        handler->id = id;
+        handler->commitfd = -1;
+
+        if(socket)
+            handler->mainfd[fdindex++] = unixfd;
+
+        // if tcp socket is requested, adding it
+        if(listenaddr) {
+            int fd = redis_tcp_listen(listenaddr, port, threads > 1);
+
+            if(id == 0)
+                zdbd_log("[+] listen request: tcp://%s:%s (fd: %d)\n", listenaddr, port, fd);
 
-        zdbd_success("[+] listening on socket %d", redis.mainfd[i]);
+            socket_nonblock(fd);
+
+            if(listen(fd, SOMAXCONN) == -1)
+                zdbd_diep("listen");
+
+            if(id == 0)
+                zdbd_success("[+] listening on socket %d", fd);
+
+            handler->mainfd[fdindex++] = fd;
+        }
     }
 
     // notify we are ready
@@ -1336,18 +2360,60 @@ int redis_listen(char *listenaddr, char *port, char *socket) {
     if(zdbd_rootsettings.background)
         daemonize();
 
-    // entering the worker loop
-    int handler = socket_handler(&redis);
+    command_engine_init();
+
+    // flusher thread needs to be started after
+    // daemonize, threads does not survive fork
+    if(zdbd_rootsettings.groupcommit)
+        redis[0].commitfd = groupcommit_start(zdbd_rootsettings.commitdelay);
+
+    // read workers, same rule than flusher
+    if(zdbd_rootsettings.readthreads)
+        readpool_start(zdbd_rootsettings.readthreads);
+
+    // additional reactors, same rule than flusher
+    // about daemonize
+    if(threads > 1)
+        zdbd_verbose("[+] redis: starting %d reactors\n", threads);
+
+    for(int id = 1; id < threads; id++)
+        if(pthread_create(&reactors[id], NULL, redis_reactor, &redis[id]))
+            zdbd_diep("reactor: pthread_create");
+
+    // entering the worker loop, main thread
+    // runs the main reactor
+    int handler = socket_handler(&redis[0]);
+
+    // reactors leave their loop as soon as
+    // the shutdown is requested
+    for(int id = 1; id < threads; id++)
+        pthread_join(reactors[id], NULL);
+
+    // complete reads still queued
+    readpool_stop();
+
+    // sync and release last pending batch
+    groupcommit_stop();
 
     // cleaning clients list
     for(size_t i = 0; i < clients.length; i++)
         if(clients.list[i])
             socket_client_free(i);
 
-    for(int i = 0; i < fdindex; i++)
-        close(redis.mainfd[i]);
+    for(int id = 0; id < threads; id++) {
+        for(int i = 0; i < redis[id].fdlen; i++)
+            if(redis[id].mainfd[i] != unixfd)
+                close(redis[id].mainfd[i]);
+
+        close(redis[id].evfd);
+        free(redis[id].mainfd);
+    }
+
+    if(unixfd >= 0)
+        close(unixfd);
 
-    free(redis.mainfd);
+    free(redis);
+    free(reactors);
     free(clients.list);
 
     // notifing source that we are done
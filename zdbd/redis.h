@@ -2,6 +2,9 @@
     #define __ZDB_REDIS_H
 
     #include <sys/time.h>
+    #include <sys/uio.h>
+    #include <pthread.h>
+    #include <limits.h>
 
     // redis_hardsend is a macro that allows us to send
     // easily a hardcoded message to the client, without the need to
@@ -96,10 +99,31 @@
         // the buffer
         void (*destructor)(void *target);
 
+        // payload can be sent straight from a file (eg: datafile), in that
+        // case fd is set (otherwise -1), the descriptor is owned by the response
+        // and length is the amount of bytes remaining to send from offset
+        int fd;
+        off_t offset;
+
+        // payload still being read (by the read pool or the io_uring ring),
+        // the response holds its place on the queue and is not sent yet (job)
+        void *pending;
+
         struct redis_response_t *next;
 
     } redis_response_t;
 
+    // replies produced while a batch of requests is processed (everything
+    // parsed from one read on the socket) are appended to this arena and
+    // sent at once when the batch is done, instead of one send per reply
+    typedef struct redis_output_t {
+        unsigned char *buffer;
+        size_t length;     // amount of bytes waiting to be sent
+        size_t allocated;  // amount of bytes allocated
+        int corked;        // batch in progress, replies are appended
+
+    } redis_output_t;
+
     typedef struct command_t command_t;
     typedef struct redis_client_t redis_client_t;
 
@@ -107,6 +131,7 @@
     struct command_t {
         char *command;
         int (*handler)(redis_client_t *client);
+        int shared;       // read-only command, can run concurrently
 
     };
 
@@ -141,6 +166,28 @@
         // client
         redis_response_t *responses;
         redis_response_t *responsetail;
+
+        // replies of the batch in progress, they are
+        // sent after anything queued on responses
+        redis_output_t output;
+
+        // with group commit, replies are held until the
+        // batch containing the client writes is synced
+        uint64_t commitid;
+
+        // large SET payload written to the datafile while
+        // received (see commands_set), NULL otherwise
+        void *stream;
+
+        // connection state of the io_uring backend (see socket_uring),
+        // NULL with epoll, when set, nothing is sent or received
+        // directly, the reactor owning the client does it
+        void *uring;
+
+        // a client is owned by one reactor, but other reactors can
+        // reply to it (watchers, mirroring, group commit), responses
+        // queue and watcher state are protected by this (recursive) lock
+        pthread_mutex_t lock;
     };
 
     // represents all clients in memory
@@ -148,6 +195,14 @@
         size_t length;
         redis_client_t **list;
 
+        // protects the list against clients added or
+        // removed while another reactor walks over it
+        pthread_mutex_t lock;
+
+        // amount of clients waiting for events (watchers or
+        // mirrors), when zero, nobody needs to be notified
+        int listeners;
+
     } redis_clients_t;
 
     // minimum (default) amount of clients pre-allocated
@@ -159,10 +214,37 @@
     // maximum payload size
     #define REDIS_MAX_PAYLOAD 8 * 1024 * 1024
 
+    // maximum payload size of a SET streamed to the datafile
+    // (argument length and trailing crlf needs to fit an int)
+    #define REDIS_MAX_STREAM_PAYLOAD  INT_MAX - 2
+
+    // output arena is sent when it reaches this size, even if
+    // the batch is not done, heap replies larger than the inline
+    // size are not copied to the arena
+    #define REDIS_OUTPUT_MAX 64 * 1024
+    #define REDIS_OUTPUT_INLINE 8192
+
+    // maximum amount of responses sent with a single writev
+    #define REDIS_FLUSH_IOV 64
+
+    // maximum amount of arguments of a request
+    // (multi-keys commands, eg: MGET, MSET)
+    #define REDIS_MAX_ARGUMENTS 4096
+
+    // payload size from which a reply is sent directly
+    // from the datafile, without copying it in memory
+    #define REDIS_SENDFILE_THRESHOLD 64 * 1024
+
+    // one handler per reactor (see --threads), each reactor owns its
+    // event handler and the clients it accepted, reactor zero is the
+    // main one and is the only one running idle process and group commit
     typedef struct redis_handler_t {
+        int id;       // reactor id
         int *mainfd;  // main sockets handler (support multiple sockets)
         int fdlen;    // amount of sockets on the list
         int evfd;     // event handler (epoll, kqueue, ...)
+        int commitfd; // group commit notification (-1 if disabled)
+        size_t events; // amount of events processed by this reactor
 
     } redis_handler_t;
 
@@ -177,6 +259,14 @@
     resp_status_t redis_chunk_read(int fd);
     resp_status_t redis_delayed_write(int fd);
 
+    // completion based backend (io_uring), receiving and
+    // sending on its own (see socket_uring)
+    resp_status_t redis_chunk_buffer(redis_client_t *client, void **target, size_t *length);
+    resp_status_t redis_chunk_received(redis_client_t *client, size_t length);
+    int redis_client_gather(redis_client_t *client, struct iovec *iov, int length);
+    int redis_client_sent(redis_client_t *client, int count, size_t sent);
+    void redis_client_drop(redis_client_t *client, int count);
+
     void socket_nonblock(int fd);
     void socket_keepalive(int fd);
     void socket_block(int fd);
@@ -184,6 +274,7 @@
     // wait command helpers
     void redis_client_set_watcher(redis_client_t *client, command_t *handler, size_t timeoutms);
     void redis_client_unset_watcher(redis_client_t *client);
+    void redis_client_set_mirror(redis_client_t *client);
 
     void redis_bulk_append(redis_bulk_t *bulk, void *data, size_t length);
     redis_bulk_t redis_bulk(void *payload, size_t length);
@@ -192,16 +283,45 @@
     // code (see socket_epoll, socket_kqueue, ...)
     int socket_handler(redis_handler_t *handler);
 
+    // io_uring backend (see socket_uring), linux only, can be
+    // disabled at build time (make NO_URING=1), selected at runtime
+    // with --io-uring, epoll is used when the kernel doesn't support it
+    #if defined(__linux__) && !defined(ZDBD_NO_URING) && defined(__has_include)
+        #if __has_include(<linux/io_uring.h>)
+            #define ZDBD_URING
+        #endif
+    #endif
+
+    int socket_handler_epoll(redis_handler_t *handler);
+    int socket_handler_uring(redis_handler_t *handler);
+
+    // client served by the io_uring backend: responses queued, streamed
+    // chunk written and payload read on the ring of its reactor, the
+    // last two returns 1 if the client is not served by io_uring
+    void socket_uring_flush(redis_client_t *client);
+    int socket_uring_write(redis_client_t *client, int fd, void *buffer, size_t length, off_t offset);
+    int socket_uring_read(redis_client_t *client, data_root_t *data, fileid_t dataid, size_t offset, size_t length, uint8_t idlength);
+
     // managing clients
     redis_client_t *socket_client_new(int fd);
     void socket_client_free(int fd);
+    redis_client_t *socket_client_get(int fd);
     int redis_detach_clients(namespace_t *namespace);
+    void redis_clients_commit(uint64_t commitid, int error);
 
     // socket generic reply
     redis_response_t *redis_response_new(void *payload, size_t length, void (*destructor)(void *));
+    void redis_response_free(redis_response_t *response);
     int redis_reply_heap(redis_client_t *client, void *payload, size_t length, void (*destructor)(void *));
     int redis_reply_stack(redis_client_t *client, void *payload, size_t length);
+    int redis_reply_file(redis_client_t *client, int fd, off_t offset, size_t length);
+    redis_response_t *redis_reply_pending(redis_client_t *client, void *job);
+    void redis_reply_complete(redis_client_t *client, redis_response_t *response, void *payload, size_t length);
 
     int redis_posthandler_client(redis_client_t *client);
     void redis_idle_process();
+
+    // shutdown requested (STOP), every reactor leaves its loop
+    void redis_shutdown_request();
+    int redis_shutdown_requested();
 #endif
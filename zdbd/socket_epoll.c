@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -13,6 +14,7 @@
 #include "libzdb.h"
 #include "zdbd.h"
 #include "redis.h"
+#include "groupcommit.h"
 
 #define MAXEVENTS 64
 #define EVTIMEOUT 200
@@ -21,13 +23,20 @@ static int socket_client_accept(redis_handler_t *redis, int fd) {
     int clientfd;
 
     if((clientfd = accept(fd, NULL, NULL)) == -1) {
-        zdbd_verbosep("socket_event", "accept");
+        // another reactor was faster on a shared socket
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+            zdbd_verbosep("socket_event", "accept");
+
         return 0;
     }
 
     socket_nonblock(clientfd);
     socket_keepalive(clientfd);
-    socket_client_new(clientfd);
+
+    if(!socket_client_new(clientfd)) {
+        close(clientfd);
+        return 0;
+    }
 
     zdbd_verbose("[+] incoming connection (socket %d)\n", clientfd);
 
@@ -66,6 +75,13 @@ static int socket_event(struct epoll_event *events, int notified, redis_handler_
             continue;
         }
 
+        // group commit notification, some writes
+        // are now synced on disk
+        if(ev->data.fd == redis->commitfd) {
+            groupcommit_notified(redis->commitfd);
+            continue;
+        }
+
         // main socket event: we have a new client
         // create the new client and accept it
         for(int i = 0; i < redis->fdlen; i++) {
@@ -93,12 +109,11 @@ static int socket_event(struct epoll_event *events, int notified, redis_handler_
                 continue;
             }
 
-            // (dirty) way the STOP event is handled
+            // (dirty) way the STOP event is handled, every
+            // reactors stops, sockets are closed by the caller
             if(ctrl == RESP_STATUS_SHUTDOWN) {
                 zdb_log("[+] stopping daemon\n");
-
-                for(int i = 0; i < redis->fdlen; i++)
-                    close(redis->mainfd[i]);
+                redis_shutdown_request();
 
                 return 1;
             }
@@ -114,7 +129,7 @@ static int socket_event(struct epoll_event *events, int notified, redis_handler_
     return 0;
 }
 
-int socket_handler(redis_handler_t *handler) {
+int socket_handler_epoll(redis_handler_t *handler) {
     struct epoll_event event;
     struct epoll_event *events = NULL;
     zdbd_stats_t *dstats = &zdbd_rootsettings.stats;
@@ -130,43 +145,78 @@ int socket_handler(redis_handler_t *handler) {
         event.data.fd = handler->mainfd[i];
         event.events = EPOLLIN;
 
+        // unix socket is shared between reactors, only
+        // wake up one of them per new connection
+        if(zdbd_rootsettings.threads > 1)
+            event.events |= EPOLLEXCLUSIVE;
+
         if(epoll_ctl(handler->evfd, EPOLL_CTL_ADD, handler->mainfd[i], &event) < 0)
             zdbd_diep("epoll_ctl");
     }
 
+    if(handler->commitfd >= 0) {
+        event.data.fd = handler->commitfd;
+        event.events = EPOLLIN;
+
+        if(epoll_ctl(handler->evfd, EPOLL_CTL_ADD, handler->commitfd, &event) < 0)
+            zdbd_diep("epoll_ctl");
+    }
+
     events = calloc(MAXEVENTS, sizeof event);
 
     // wait for clients
     // this is how we support multi-client using a single thread
     // note that, we will only handle one request at a time
     // allows multiple clients to be connected
+    //
+    // with several reactors, each one runs this loop on its own
+    // thread, with its own clients
 
-    while(1) {
+    while(!redis_shutdown_requested()) {
         int n = epoll_wait(handler->evfd, events, MAXEVENTS, EVTIMEOUT);
-        dstats->netevents += 1;
+        zdb_atomic_add(dstats->netevents, 1);
+        handler->events += 1;
 
         if(n == 0) {
             // timeout reached, checking for background
             // or pending recurring task to do
-            redis_idle_process();
+            if(handler->id == 0)
+                redis_idle_process();
+
             continue;
         }
 
-        if(socket_event(events, n, handler) == 1) {
-            free(events);
-            return 1;
-        }
+        if(socket_event(events, n, handler) == 1)
+            break;
 
         // force idle process trigger after fixed amount
         // of commands, otherwise spamming the server enough
         // would never trigger it
-        if(dstats->netevents % 100 == 0) {
-            zdbd_debug("[+] sockets: forcing idle process [%lu]\n", dstats->netevents);
+        if(handler->id == 0 && handler->events % 100 == 0) {
+            zdbd_debug("[+] sockets: forcing idle process [%lu]\n", handler->events);
             redis_idle_process();
         }
     }
 
-    return 0;
+    free(events);
+
+    return 1;
+}
+
+int socket_handler(redis_handler_t *handler) {
+    #ifdef ZDBD_URING
+    if(zdbd_rootsettings.uring) {
+        int value;
+
+        if((value = socket_handler_uring(handler)) >= 0)
+            return value;
+
+        if(handler->id == 0)
+            zdbd_warning("[-] system: io_uring not supported by the kernel, using epoll");
+    }
+    #endif
+
+    return socket_handler_epoll(handler);
 }
 
 #endif // __linux__
@@ -13,6 +13,7 @@
 #include "libzdb.h"
 #include "zdbd.h"
 #include "redis.h"
+#include "groupcommit.h"
 
 #define MAXEVENTS 64
 #define EVTIMEOUT 150
@@ -65,6 +66,13 @@ static int socket_event(struct kevent *events, int notified, redis_handler_t *re
 
         }
 
+        // group commit notification, some writes
+        // are now synced on disk
+        if((int) ev->ident == redis->commitfd) {
+            groupcommit_notified(redis->commitfd);
+            continue;
+        }
+
         // main socket event: we have a new client
         // creating the new client and accepting it
         for(int i = 0; i < redis->fdlen; i++) {
@@ -90,11 +98,10 @@ static int socket_event(struct kevent *events, int notified, redis_handler_t *re
             }
 
             // (dirty) way the STOP event is handled
+            // sockets are closed by the caller
             if(ctrl == RESP_STATUS_SHUTDOWN) {
                 zdb_log("[+] stopping daemon\n");
-
-                for(int i = 0; i < redis->fdlen; i++)
-                    close(redis->mainfd[i]);
+                redis_shutdown_request();
 
                 return 1;
             }
@@ -128,12 +135,21 @@ int socket_handler(redis_handler_t *handler) {
             zdbd_diep("kevent");
     }
 
+    if(handler->commitfd >= 0) {
+        EV_SET(&evset, handler->commitfd, EVFILT_READ, EV_ADD, 0, 0, NULL);
+
+        if(kevent(handler->evfd, &evset, 1, NULL, 0, NULL) == -1)
+            zdbd_diep("kevent");
+    }
+
     // wait for clients
     // this is how we support multi-client using a single thread
     // note that, we will only handle one request at a time
     // allows multiple clients to be connected
+    //
+    // only one reactor is supported with kqueue
 
-    while(1) {
+    while(!redis_shutdown_requested()) {
         int n = kevent(handler->evfd, NULL, 0, evlist, MAXEVENTS, &timeout);
         dstats->netevents += 1;
 
@@ -156,7 +172,7 @@ int socket_handler(redis_handler_t *handler) {
         }
     }
 
-    return 0;
+    return 1;
 }
 
 #endif // __APPLE__
@@ -0,0 +1,1086 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include "libzdb.h"
+#include "zdbd.h"
+#include "redis.h"
+#include "commands.h"
+#include "commands_set.h"
+#include "groupcommit.h"
+#include "readpool.h"
+
+// this implementation is only used on linux, when
+// enabled at runtime (--io-uring)
+#ifdef ZDBD_URING
+
+#include <sys/eventfd.h>
+#include <linux/io_uring.h>
+
+//
+// io_uring backend
+//
+// unlike epoll backend (readiness), everything is a request submitted
+// to a ring shared with the kernel, which completes it on its own:
+//  - new connections are accepted by the kernel (accept requests),
+//    each reactor keeps one accept armed per listening socket, only
+//    one reactor completes for a new connection
+//  - each client always has one receive in flight, straight on the
+//    place the parser expects the next bytes (client buffer, large
+//    argument or stream chunk), requests received are executed when
+//    it completes, then the next receive is submitted
+//  - responses queued for a client are sent by its reactor, consecutive
+//    in-memory ones with a single sendmsg, they stay on the client queue
+//    until the send completes, payloads sent from a datafile are read on
+//    the ring by chunk on a client buffer, then sent
+//  - chunks of a streamed SET are written (appended to the datafile) on
+//    the ring, the next bytes are received when the write is done
+//  - GET payloads stored on sealed datafiles are read on the ring, the
+//    reply holds its place on the client queue until then (like the
+//    read pool does)
+//  - everything queued while processing completions is submitted with
+//    a single syscall, which is also the one waiting for the next ones
+//
+// other threads (reactors notifying watchers or group commit, read pool
+// workers) can reply to a client, they can't use the ring of the reactor
+// owning it, the client is added to the reactor flush list and the
+// reactor is woken up (eventfd)
+//
+// a client disconnected is released only when nothing is in flight
+// anymore, the socket is shutdown meanwhile, requests still pending
+// on it completes straight away, buffers they use stays valid
+//
+// the ring is setup without any library (kernel headers only), kernel
+// needs to support multishot poll and extended wait argument (timeout),
+// otherwise socket_handler falls back to epoll
+//
+#define URING_ENTRIES    256
+#define EVTIMEOUT        200
+
+// payloads sent from a datafile are read
+// (then sent) by chunk of this size
+#define URING_FILE_CHUNK  128 * 1024
+
+// multishot poll landed on the same kernel release
+// (5.13) than resources tags feature flag
+#define URING_FEATURES   (IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS)
+
+typedef enum uring_kind_t {
+    URING_ACCEPT = 1,  // listening socket, new client accepted
+    URING_COMMIT,      // group commit notification (poll)
+    URING_WAKEUP,      // responses queued by another thread (eventfd read)
+    URING_RECV,        // bytes received from a client
+    URING_SEND,        // client responses sent
+    URING_FILEREAD,    // chunk of a file response read
+    URING_FILESEND,    // chunk of a file response sent
+    URING_WRITE,       // streamed payload chunk written
+    URING_READ,        // payload read (GET)
+
+} uring_kind_t;
+
+typedef struct uring_t uring_t;
+typedef struct uring_conn_t uring_conn_t;
+
+// user data attached to each request
+typedef struct uring_op_t {
+    uring_kind_t kind;
+    int fd;               // listening socket, notification descriptor
+    uring_conn_t *conn;   // client requests
+
+} uring_op_t;
+
+// client state, owned by the reactor which accepted it
+struct uring_conn_t {
+    redis_client_t *client;
+    uring_t *ring;
+    int fd;
+
+    int inflight;       // requests not completed yet
+    int closing;        // disconnected, released when nothing is in flight
+    int stalled;        // waiting the stream chunk to be written to receive
+
+    uring_op_t recv;
+    uring_op_t send;    // responses or file chunk (one at a time)
+    uring_op_t write;
+    int sending;
+
+    // in-memory responses sent (head of the client queue)
+    struct msghdr msg;
+    struct iovec iov[REDIS_FLUSH_IOV];
+    int iovcount;
+
+    // chunk of the file response being sent
+    unsigned char *file;
+    size_t filelength;  // amount of bytes read on the chunk
+    size_t filesent;    // amount of bytes of the chunk sent
+
+    // streamed payload chunk being written
+    int wfd;
+    unsigned char *wbuffer;
+    size_t wlength;
+    size_t wdone;
+    off_t woffset;
+
+    // flush list of the reactor
+    int dirty;
+    uring_conn_t *next;
+};
+
+// payload read (GET), the reply is held by a pending response
+typedef struct uring_read_t {
+    uring_op_t op;
+    redis_response_t *response;
+    int fd;               // datafile, duplicated
+
+    data_root_t *data;    // valid while epoch doesn't change
+    uint64_t epoch;
+    fileid_t dataid;
+    size_t offset;        // entry offset
+    size_t position;      // payload offset
+    size_t length;
+    size_t done;          // amount of bytes read so far
+    unsigned char *buffer;
+
+} uring_read_t;
+
+struct uring_t {
+    int fd;
+
+    // submission queue
+    unsigned *sqhead;
+    unsigned *sqtail;
+    unsigned *sqmask;
+    unsigned *sqarray;
+    unsigned sqentries;
+    struct io_uring_sqe *sqes;
+
+    // completion queue
+    unsigned *cqhead;
+    unsigned *cqtail;
+    unsigned *cqmask;
+    struct io_uring_cqe *cqes;
+
+    // mapped areas
+    void *sqring;
+    size_t sqringsize;
+    void *cqring;
+    size_t cqringsize;
+    size_t sqessize;
+
+    uring_op_t *accept;   // one per listening socket
+    uring_op_t commit;
+    uring_op_t wakeup;
+    int wakefd;
+    uint64_t wakevalue;
+
+    // clients with responses to send, filled by any thread, protected
+    // by this lock (taken with the client lock held)
+    pthread_mutex_t lock;
+    uring_conn_t *dirty;
+    int woken;            // wake up requested, not processed yet
+};
+
+// ring of the reactor running on this thread
+static __thread uring_t *uring_self = NULL;
+
+static int uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int fd, unsigned submit, unsigned wait, unsigned flags, void *arg, size_t argsize) {
+    return (int) syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg, argsize);
+}
+
+static void uring_free(uring_t *ring) {
+    if(ring->sqes)
+        munmap(ring->sqes, ring->sqessize);
+
+    if(ring->cqring && ring->cqring != ring->sqring)
+        munmap(ring->cqring, ring->cqringsize);
+
+    if(ring->sqring)
+        munmap(ring->sqring, ring->sqringsize);
+}
+
+static int uring_init(uring_t *ring) {
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(uring_t));
+    memset(&params, 0, sizeof(params));
+
+    if((ring->fd = uring_setup(URING_ENTRIES, &params)) < 0) {
+        zdbd_verbosep("uring", "io_uring_setup");
+        return -1;
+    }
+
+    if((params.features & URING_FEATURES) != URING_FEATURES) {
+        zdbd_verbose("[-] uring: kernel too old, missing features (%x)\n", params.features);
+        close(ring->fd);
+        return -1;
+    }
+
+    ring->sqringsize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqringsize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqessize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // both rings share the same mapping
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        if(ring->cqringsize > ring->sqringsize)
+            ring->sqringsize = ring->cqringsize;
+
+        ring->cqringsize = ring->sqringsize;
+    }
+
+    ring->sqring = mmap(NULL, ring->sqringsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if(ring->sqring == MAP_FAILED) {
+        zdbd_warnp("uring: mmap sq ring");
+        ring->sqring = NULL;
+        goto failed;
+    }
+
+    ring->cqring = ring->sqring;
+
+    if(!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        ring->cqring = mmap(NULL, ring->cqringsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if(ring->cqring == MAP_FAILED) {
+            zdbd_warnp("uring: mmap cq ring");
+            ring->cqring = NULL;
+            goto failed;
+        }
+    }
+
+    ring->sqes = mmap(NULL, ring->sqessize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if(ring->sqes == MAP_FAILED) {
+        zdbd_warnp("uring: mmap sqes");
+        ring->sqes = NULL;
+        goto failed;
+    }
+
+    if((ring->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        zdbd_warnp("uring: eventfd");
+        goto failed;
+    }
+
+    char *sq = (char *) ring->sqring;
+    char *cq = (char *) ring->cqring;
+
+    ring->sqhead = (unsigned *) (sq + params.sq_off.head);
+    ring->sqtail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sqmask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sqarray = (unsigned *) (sq + params.sq_off.array);
+    ring->sqentries = params.sq_entries;
+
+    ring->cqhead = (unsigned *) (cq + params.cq_off.head);
+    ring->cqtail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cqmask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+    pthread_mutex_init(&ring->lock, NULL);
+
+    return ring->fd;
+
+failed:
+    uring_free(ring);
+    close(ring->fd);
+    return -1;
+}
+
+// submit everything queued, without waiting
+static void uring_submit(uring_t *ring) {
+    unsigned pending = *ring->sqtail - __atomic_load_n(ring->sqhead, __ATOMIC_ACQUIRE);
+
+    if(pending && uring_enter(ring->fd, pending, 0, 0, NULL, 0) < 0)
+        zdbd_verbosep("uring", "io_uring_enter");
+}
+
+static struct io_uring_sqe *uring_sqe(uring_t *ring) {
+    unsigned tail = *ring->sqtail;
+
+    // submission queue full, flushing it first
+    if(tail - __atomic_load_n(ring->sqhead, __ATOMIC_ACQUIRE) == ring->sqentries)
+        uring_submit(ring);
+
+    unsigned index = tail & *ring->sqmask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    ring->sqarray[index] = index;
+
+    __atomic_store_n(ring->sqtail, tail + 1, __ATOMIC_RELEASE);
+
+    return sqe;
+}
+
+static struct io_uring_sqe *uring_request(uring_t *ring, uint8_t opcode, int fd, uring_op_t *op) {
+    struct io_uring_sqe *sqe = uring_sqe(ring);
+
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->user_data = (uint64_t) (uintptr_t) op;
+
+    return sqe;
+}
+
+static void uring_accept(uring_t *ring, uring_op_t *op) {
+    uring_request(ring, IORING_OP_ACCEPT, op->fd, op);
+}
+
+static void uring_poll(uring_t *ring, uring_op_t *op, uint32_t events) {
+    struct io_uring_sqe *sqe = uring_request(ring, IORING_OP_POLL_ADD, op->fd, op);
+
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = events;
+}
+
+static void uring_wakeup_watch(uring_t *ring) {
+    struct io_uring_sqe *sqe = uring_request(ring, IORING_OP_READ, ring->wakefd, &ring->wakeup);
+
+    sqe->addr = (uint64_t) (uintptr_t) &ring->wakevalue;
+    sqe->len = sizeof(ring->wakevalue);
+}
+
+//
+// clients
+//
+static void uring_client_sendmsg(uring_t *ring, uring_conn_t *conn, int flags) {
+    struct io_uring_sqe *sqe;
+
+    conn->iovcount = redis_client_gather(conn->client, conn->iov, REDIS_FLUSH_IOV);
+
+    memset(&conn->msg, 0, sizeof(struct msghdr));
+    conn->msg.msg_iov = conn->iov;
+    conn->msg.msg_iovlen = conn->iovcount;
+
+    zdbd_debug("[+] uring: sending %d responses to %d\n", conn->iovcount, conn->fd);
+
+    sqe = uring_request(ring, IORING_OP_SENDMSG, conn->fd, &conn->send);
+    sqe->addr = (uint64_t) (uintptr_t) &conn->msg;
+    sqe->len = 1;
+    sqe->msg_flags = flags;
+
+    conn->send.kind = URING_SEND;
+    conn->sending = 1;
+    conn->inflight += 1;
+}
+
+// requests pending on the socket completes straight away, replies
+// ready (eg: error of a discarded request) are sent a last time,
+// without waiting for the socket, like epoll backend does
+static void uring_client_linger(uring_t *ring, uring_conn_t *conn) {
+    redis_client_t *client = conn->client;
+    redis_response_t *response;
+    int how = SHUT_RDWR;
+
+    pthread_mutex_lock(&client->lock);
+
+    if((response = client->responses) && !conn->sending && !client->commitid) {
+        if(!response->pending && response->fd < 0) {
+            uring_client_sendmsg(ring, conn, MSG_DONTWAIT);
+            how = SHUT_RD;
+        }
+    }
+
+    pthread_mutex_unlock(&client->lock);
+
+    shutdown(conn->fd, how);
+}
+
+static void uring_client_close(uring_t *ring, uring_conn_t *conn) {
+    if(!conn->closing) {
+        zdbd_debug("[+] uring: client %d: closing\n", conn->fd);
+        conn->closing = 1;
+
+        uring_client_linger(ring, conn);
+    }
+
+    // buffers are still used by requests in flight, client
+    // is released by the last completion
+    if(conn->inflight > 0)
+        return;
+
+    socket_client_free(conn->fd);
+
+    // nobody can reach the client anymore, removing
+    // it from the flush list, if it was there
+    pthread_mutex_lock(&ring->lock);
+
+    for(uring_conn_t **item = &ring->dirty; *item; item = &(*item)->next) {
+        if(*item == conn) {
+            *item = conn->next;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&ring->lock);
+
+    free(conn->file);
+    free(conn);
+}
+
+// receive the next bytes, straight where the parser expects them,
+// returns 1 if the client needs to be discarded
+static int uring_client_recv(uring_t *ring, uring_conn_t *conn) {
+    struct io_uring_sqe *sqe;
+    void *target;
+    size_t length;
+
+    if(redis_chunk_buffer(conn->client, &target, &length) != RESP_STATUS_SUCCESS)
+        return 1;
+
+    // stream chunk still written, receive
+    // is submitted when the write is done
+    if(!target) {
+        conn->stalled = 1;
+        return 0;
+    }
+
+    sqe = uring_request(ring, IORING_OP_RECV, conn->fd, &conn->recv);
+    sqe->addr = (uint64_t) (uintptr_t) target;
+    sqe->len = length;
+
+    conn->inflight += 1;
+
+    return 0;
+}
+
+static void uring_client_filesend(uring_t *ring, uring_conn_t *conn) {
+    struct io_uring_sqe *sqe = uring_request(ring, IORING_OP_SEND, conn->fd, &conn->send);
+
+    sqe->addr = (uint64_t) (uintptr_t) (conn->file + conn->filesent);
+    sqe->len = conn->filelength - conn->filesent;
+
+    conn->send.kind = URING_FILESEND;
+    conn->inflight += 1;
+}
+
+// send what's ready on the client queue, responses are kept on the
+// queue until the send completes, client lock needs to be held
+static void uring_client_send(uring_t *ring, uring_conn_t *conn) {
+    redis_client_t *client = conn->client;
+    redis_response_t *response = client->responses;
+    struct io_uring_sqe *sqe;
+
+    if(conn->sending || conn->closing || client->commitid)
+        return;
+
+    // nothing to send or reply not ready yet
+    if(!response || response->pending)
+        return;
+
+    // payload sent from a file, chunk is read first
+    if(response->fd >= 0) {
+        size_t length = (response->length < URING_FILE_CHUNK) ? response->length : URING_FILE_CHUNK;
+
+        if(!conn->file && !(conn->file = malloc(URING_FILE_CHUNK))) {
+            zdbd_warnp("uring: file chunk malloc");
+            shutdown(conn->fd, SHUT_RDWR);
+            return;
+        }
+
+        sqe = uring_request(ring, IORING_OP_READ, response->fd, &conn->send);
+        sqe->addr = (uint64_t) (uintptr_t) conn->file;
+        sqe->len = length;
+        sqe->off = response->offset;
+
+        conn->send.kind = URING_FILEREAD;
+        conn->sending = 1;
+        conn->inflight += 1;
+
+        return;
+    }
+
+    uring_client_sendmsg(ring, conn, 0);
+}
+
+static void uring_client_write(uring_t *ring, uring_conn_t *conn) {
+    struct io_uring_sqe *sqe = uring_request(ring, IORING_OP_WRITE, conn->wfd, &conn->write);
+
+    sqe->addr = (uint64_t) (uintptr_t) (conn->wbuffer + conn->wdone);
+    sqe->len = conn->wlength - conn->wdone;
+    sqe->off = conn->woffset + conn->wdone;
+
+    conn->inflight += 1;
+}
+
+static void uring_read_submit(uring_t *ring, uring_read_t *read) {
+    struct io_uring_sqe *sqe = uring_request(ring, IORING_OP_READ, read->fd, &read->op);
+
+    sqe->addr = (uint64_t) (uintptr_t) (read->buffer + read->done);
+    sqe->len = read->length - read->done;
+    sqe->off = read->position + read->done;
+
+    read->op.conn->inflight += 1;
+}
+
+static void socket_client_accepted(uring_t *ring, int clientfd) {
+    redis_client_t *client;
+    uring_conn_t *conn;
+
+    // socket is kept blocking, nothing is sent or received outside
+    // of the ring, the kernel waits for the socket to be ready itself
+    socket_keepalive(clientfd);
+
+    if(!(conn = calloc(sizeof(uring_conn_t), 1))) {
+        zdbd_warnp("uring: client calloc");
+        close(clientfd);
+        return;
+    }
+
+    if(!(client = socket_client_new(clientfd))) {
+        close(clientfd);
+        free(conn);
+        return;
+    }
+
+    zdbd_verbose("[+] incoming connection (socket %d)\n", clientfd);
+
+    conn->client = client;
+    conn->ring = ring;
+    conn->fd = clientfd;
+    conn->recv.kind = URING_RECV;
+    conn->recv.conn = conn;
+    conn->send.conn = conn;
+    conn->write.kind = URING_WRITE;
+    conn->write.conn = conn;
+
+    pthread_mutex_lock(&client->lock);
+    client->uring = conn;
+    pthread_mutex_unlock(&client->lock);
+
+    if(uring_client_recv(ring, conn))
+        uring_client_close(ring, conn);
+}
+
+// bytes received, requests available are executed
+static int socket_client_received(uring_t *ring, uring_conn_t *conn, int result) {
+    conn->inflight -= 1;
+
+    if(conn->closing) {
+        uring_client_close(ring, conn);
+        return 0;
+    }
+
+    if(result == 0) {
+        zdbd_debug("[+] uring: client %d: disconnected\n", conn->fd);
+        uring_client_close(ring, conn);
+        return 0;
+    }
+
+    if(result < 0) {
+        if(result != -ECONNRESET)
+            zdbd_verbose("[-] uring: recv client %d: %s\n", conn->fd, strerror(-result));
+
+        uring_client_close(ring, conn);
+        return 0;
+    }
+
+    resp_status_t ctrl = redis_chunk_received(conn->client, result);
+
+    // client error, we discard it
+    if(ctrl == RESP_STATUS_DISCARD || ctrl == RESP_STATUS_DISCONNECTED) {
+        uring_client_close(ring, conn);
+        return 0;
+    }
+
+    // (dirty) way the STOP event is handled, every
+    // reactors stops, sockets are closed by the caller
+    if(ctrl == RESP_STATUS_SHUTDOWN) {
+        zdb_log("[+] stopping daemon\n");
+        redis_shutdown_request();
+
+        return 1;
+    }
+
+    if(uring_client_recv(ring, conn))
+        uring_client_close(ring, conn);
+
+    return 0;
+}
+
+// responses sent (or chunk of a file response read or
+// sent), the next ones are sent, if any
+static void socket_client_sent(uring_t *ring, uring_conn_t *conn, uring_kind_t kind, int result) {
+    redis_client_t *client = conn->client;
+
+    pthread_mutex_lock(&client->lock);
+
+    conn->inflight -= 1;
+
+    if(conn->closing) {
+        pthread_mutex_unlock(&client->lock);
+        uring_client_close(ring, conn);
+        return;
+    }
+
+    if(kind == URING_FILEREAD) {
+        if(result > 0) {
+            conn->filelength = result;
+            conn->filesent = 0;
+
+            uring_client_filesend(ring, conn);
+            pthread_mutex_unlock(&client->lock);
+            return;
+        }
+
+        // file is shorter than expected, header was already sent and
+        // the stream can't be recovered anymore, dropping the client
+        zdbd_danger("[-] uring: send: unexpected end of file, dropping client %d", conn->fd);
+        redis_client_drop(client, 1);
+        shutdown(conn->fd, SHUT_RDWR);
+
+    } else if(kind == URING_FILESEND && result > 0) {
+        conn->filesent += result;
+
+        // socket full, keep going with the rest of the chunk
+        if(conn->filesent < conn->filelength) {
+            uring_client_filesend(ring, conn);
+            pthread_mutex_unlock(&client->lock);
+            return;
+        }
+
+        redis_client_sent(client, 1, conn->filelength);
+
+    } else if(kind == URING_SEND && result >= 0) {
+        redis_client_sent(client, conn->iovcount, result);
+
+    } else {
+        // this is an error, the socket is not ready to
+        // receive theses replies anyway, dropping them
+        errno = (result < 0) ? -result : EPIPE;
+        zdbd_warnp("uring: send");
+        redis_client_drop(client, (kind == URING_SEND) ? conn->iovcount : 1);
+    }
+
+    conn->sending = 0;
+    uring_client_send(ring, conn);
+
+    pthread_mutex_unlock(&client->lock);
+}
+
+// streamed chunk written, receiving the rest of the payload
+static void socket_client_written(uring_t *ring, uring_conn_t *conn, int result) {
+    conn->inflight -= 1;
+
+    // partial write, keep going with the rest of the chunk
+    if(result > 0 && !conn->closing && conn->wdone + result < conn->wlength) {
+        conn->wdone += result;
+        uring_client_write(ring, conn);
+        return;
+    }
+
+    if(conn->closing) {
+        uring_client_close(ring, conn);
+        return;
+    }
+
+    int error = (result < 0) ? -result : (result == 0) ? EIO : 0;
+
+    if(error) {
+        errno = error;
+        zdbd_warnp("uring: stream write");
+    }
+
+    command_set_stream_written(conn->client, error);
+
+    if(conn->stalled) {
+        conn->stalled = 0;
+
+        if(uring_client_recv(ring, conn))
+            uring_client_close(ring, conn);
+    }
+}
+
+// payload read, pending reply is completed
+static void socket_client_read(uring_t *ring, uring_read_t *read, int result) {
+    uring_conn_t *conn = read->op.conn;
+    redis_bulk_t reply = {
+        .buffer = NULL,
+        .length = 0,
+        .writer = 0,
+    };
+
+    conn->inflight -= 1;
+
+    // short read, keep going with the rest of the payload
+    if(result > 0 && !conn->closing && read->done + result < read->length) {
+        read->done += result;
+        uring_read_submit(ring, read);
+        return;
+    }
+
+    if(result >= 0 && read->done + result == read->length) {
+        reply = redis_bulk(read->buffer, read->length);
+
+        // kept in memory like any payload read, data root
+        // is still valid if the epoch didn't change
+        command_engine_lock(1);
+
+        if(read->epoch == readpool_epoch())
+            data_cache_insert(read->data, read->dataid, read->offset, read->buffer, read->length);
+
+        command_engine_unlock();
+
+    } else {
+        zdbd_verbose("[-] uring: read: %s\n", (result < 0) ? strerror(-result) : "unexpected end of file");
+    }
+
+    if(!reply.buffer) {
+        reply.buffer = (unsigned char *) strdup("-Internal Error\r\n");
+        reply.length = strlen("-Internal Error\r\n");
+    }
+
+    // reply is always completed, even if the client is
+    // closing, the placeholder can't stay pending
+    redis_reply_complete(conn->client, read->response, reply.buffer, reply.length);
+
+    close(read->fd);
+    free(read->buffer);
+    free(read);
+
+    if(conn->closing)
+        uring_client_close(ring, conn);
+}
+
+// send responses of clients on the flush list
+static void uring_flush(uring_t *ring) {
+    while(1) {
+        uring_conn_t *conn;
+
+        pthread_mutex_lock(&ring->lock);
+
+        if((conn = ring->dirty)) {
+            ring->dirty = conn->next;
+            conn->dirty = 0;
+
+        } else {
+            ring->woken = 0;
+        }
+
+        pthread_mutex_unlock(&ring->lock);
+
+        if(!conn)
+            return;
+
+        pthread_mutex_lock(&conn->client->lock);
+        uring_client_send(ring, conn);
+        pthread_mutex_unlock(&conn->client->lock);
+    }
+}
+
+static int socket_event(uring_t *ring, struct io_uring_cqe *cqe) {
+    uring_op_t *op = (uring_op_t *) (uintptr_t) cqe->user_data;
+
+    switch(op->kind) {
+        case URING_ACCEPT:
+            // new client accepted by the kernel
+            if(cqe->res >= 0)
+                socket_client_accepted(ring, cqe->res);
+
+            else if(cqe->res != -EAGAIN && cqe->res != -ECONNABORTED)
+                zdbd_verbose("[-] uring: accept: %s\n", strerror(-cqe->res));
+
+            // waiting for next one
+            uring_accept(ring, op);
+            return 0;
+
+        case URING_COMMIT:
+            // group commit notification, some writes
+            // are now synced on disk
+            groupcommit_notified(op->fd);
+
+            if(!(cqe->flags & IORING_CQE_F_MORE))
+                uring_poll(ring, op, POLLIN);
+
+            return 0;
+
+        case URING_WAKEUP:
+            // responses queued by another thread, clients
+            // are on the flush list, waiting for next one
+            uring_wakeup_watch(ring);
+            return 0;
+
+        case URING_RECV:
+            return socket_client_received(ring, op->conn, cqe->res);
+
+        case URING_SEND:
+        case URING_FILEREAD:
+        case URING_FILESEND:
+            socket_client_sent(ring, op->conn, op->kind, cqe->res);
+            return 0;
+
+        case URING_WRITE:
+            socket_client_written(ring, op->conn, cqe->res);
+            return 0;
+
+        case URING_READ:
+            socket_client_read(ring, (uring_read_t *) op, cqe->res);
+            return 0;
+    }
+
+    return 0;
+}
+
+// process completions available, returns amount of
+// completions, or -1 when shutdown was requested
+static int socket_events(uring_t *ring) {
+    unsigned head = *ring->cqhead;
+    int processed = 0;
+
+    while(head != __atomic_load_n(ring->cqtail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe cqe = ring->cqes[head & *ring->cqmask];
+
+        // release the entry before processing it, processing can
+        // queue new requests, completions space needs to be available
+        head += 1;
+        __atomic_store_n(ring->cqhead, head, __ATOMIC_RELEASE);
+
+        processed += 1;
+
+        if(socket_event(ring, &cqe) == 1)
+            return -1;
+    }
+
+    return processed;
+}
+
+// submit pending requests and wait for at least one completion
+static void socket_wait(uring_t *ring) {
+    struct __kernel_timespec timeout = {
+        .tv_sec = EVTIMEOUT / 1000,
+        .tv_nsec = (EVTIMEOUT % 1000) * 1000000,
+    };
+
+    struct io_uring_getevents_arg arg = {
+        .sigmask = 0,
+        .sigmask_sz = _NSIG / 8,
+        .ts = (uint64_t) (uintptr_t) &timeout,
+    };
+
+    unsigned pending = *ring->sqtail - __atomic_load_n(ring->sqhead, __ATOMIC_ACQUIRE);
+    unsigned flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+
+    if(uring_enter(ring->fd, pending, 1, flags, &arg, sizeof(arg)) < 0)
+        if(errno != ETIME && errno != EINTR && errno != EBUSY)
+            zdbd_verbosep("uring", "io_uring_enter");
+}
+
+int socket_handler_uring(redis_handler_t *handler) {
+    zdbd_stats_t *dstats = &zdbd_rootsettings.stats;
+    uring_t ring;
+
+    if((handler->evfd = uring_init(&ring)) < 0)
+        return -1;
+
+    if(!(ring.accept = calloc(sizeof(uring_op_t), handler->fdlen)))
+        zdbd_diep("uring: accept calloc");
+
+    uring_self = &ring;
+
+    if(handler->id == 0)
+        zdbd_verbose("[+] uring: io_uring backend enabled (%u entries)\n", ring.sqentries);
+
+    // one accept request per listening socket, shared unix
+    // socket included, the kernel completes only one of them
+    for(int i = 0; i < handler->fdlen; i++) {
+        ring.accept[i].kind = URING_ACCEPT;
+        ring.accept[i].fd = handler->mainfd[i];
+        uring_accept(&ring, &ring.accept[i]);
+    }
+
+    if(handler->commitfd >= 0) {
+        ring.commit.kind = URING_COMMIT;
+        ring.commit.fd = handler->commitfd;
+        uring_poll(&ring, &ring.commit, POLLIN);
+    }
+
+    ring.wakeup.kind = URING_WAKEUP;
+    ring.wakeup.fd = ring.wakefd;
+    uring_wakeup_watch(&ring);
+
+    while(!redis_shutdown_requested()) {
+        uring_flush(&ring);
+        socket_wait(&ring);
+
+        zdb_atomic_add(dstats->netevents, 1);
+        handler->events += 1;
+
+        int n = socket_events(&ring);
+
+        if(n < 0) {
+            // last replies (eg: STOP) are sent
+            uring_flush(&ring);
+            uring_submit(&ring);
+            break;
+        }
+
+        if(n == 0) {
+            // timeout reached, checking for background
+            // or pending recurring task to do
+            if(handler->id == 0)
+                redis_idle_process();
+
+            continue;
+        }
+
+        // force idle process trigger after fixed amount
+        // of events, like epoll backend
+        if(handler->id == 0 && handler->events % 100 == 0) {
+            zdbd_debug("[+] sockets: forcing idle process [%lu]\n", handler->events);
+            redis_idle_process();
+        }
+    }
+
+    // descriptor is closed by the caller, requests still in
+    // flight are cancelled with it, clients are not released
+    uring_free(&ring);
+
+    return 1;
+}
+
+// responses queued for a client, sent by the reactor owning it, when
+// queued by another thread, the reactor is woken up
+//
+// client lock needs to be held
+void socket_uring_flush(redis_client_t *client) {
+    uring_conn_t *conn = client->uring;
+    uring_t *ring = conn->ring;
+    int wakeup = 0;
+
+    pthread_mutex_lock(&ring->lock);
+
+    if(!conn->dirty) {
+        conn->dirty = 1;
+        conn->next = ring->dirty;
+        ring->dirty = conn;
+    }
+
+    if(ring != uring_self && !ring->woken) {
+        ring->woken = 1;
+        wakeup = 1;
+    }
+
+    pthread_mutex_unlock(&ring->lock);
+
+    if(wakeup && eventfd_write(ring->wakefd, 1) < 0)
+        zdbd_warnp("uring: eventfd_write");
+}
+
+// streamed chunk written (appended) on the ring, the buffer
+// is not available until command_set_stream_written
+int socket_uring_write(redis_client_t *client, int fd, void *buffer, size_t length, off_t offset) {
+    uring_conn_t *conn = client->uring;
+
+    if(!conn || conn->closing)
+        return 1;
+
+    conn->wfd = fd;
+    conn->wbuffer = buffer;
+    conn->wlength = length;
+    conn->wdone = 0;
+    conn->woffset = offset;
+
+    uring_client_write(conn->ring, conn);
+
+    return 0;
+}
+
+// payload read on the ring, the reply holds its place on the
+// client queue until the read is done
+int socket_uring_read(redis_client_t *client, data_root_t *data, fileid_t dataid, size_t offset, size_t length, uint8_t idlength) {
+    uring_conn_t *conn = client->uring;
+    uring_read_t *read;
+    int fd;
+
+    if(!conn || conn->closing)
+        return 1;
+
+    if(!(read = calloc(sizeof(uring_read_t), 1))) {
+        zdbd_warnp("uring: read calloc");
+        return 1;
+    }
+
+    if(!(read->buffer = malloc(length ? length : 1))) {
+        zdbd_warnp("uring: read malloc");
+        free(read);
+        return 1;
+    }
+
+    if((fd = data_payload_grab(data, dataid, length)) < 0) {
+        free(read->buffer);
+        free(read);
+        return 1;
+    }
+
+    // keeping the file reachable, even if it's
+    // rotated or closed in the meantime
+    read->fd = dup(fd);
+    data_payload_release(data, dataid, fd);
+
+    if(read->fd < 0) {
+        zdbd_warnp("uring: read: dup");
+        free(read->buffer);
+        free(read);
+        return 1;
+    }
+
+    read->op.kind = URING_READ;
+    read->op.conn = conn;
+    read->data = data;
+    read->epoch = readpool_epoch();
+    read->dataid = dataid;
+    read->offset = offset;
+    read->position = data_payload_offset(offset, idlength);
+    read->length = length;
+
+    if(!(read->response = redis_reply_pending(client, read))) {
+        close(read->fd);
+        free(read->buffer);
+        free(read);
+        return 1;
+    }
+
+    uring_read_submit(conn->ring, read);
+
+    return 0;
+}
+
+#else
+
+// io_uring not available on this build, clients
+// are never served by it (see socket_handler)
+
+void socket_uring_flush(redis_client_t *client) {
+    (void) client;
+}
+
+int socket_uring_write(redis_client_t *client, int fd, void *buffer, size_t length, off_t offset) {
+    (void) client;
+    (void) fd;
+    (void) buffer;
+    (void) length;
+    (void) offset;
+
+    return 1;
+}
+
+int socket_uring_read(redis_client_t *client, data_root_t *data, fileid_t dataid, size_t offset, size_t length, uint8_t idlength) {
+    (void) client;
+    (void) data;
+    (void) dataid;
+    (void) offset;
+    (void) length;
+    (void) idlength;
+
+    return 1;
+}
+
+#endif // ZDBD_URING
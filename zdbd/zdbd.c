@@ -15,6 +15,7 @@
 #include "libzdb.h"
 #include "zdbd.h"
 #include "redis.h"
+#include "readpool.h"
 
 //
 // global system settings
@@ -30,6 +31,12 @@ zdbd_settings_t zdbd_rootsettings = {
     .protect = 0,
     .dualnet = 0,
     .rotatesec = 0,
+    .checkpointsec = ZDBD_DEFAULT_CHECKPOINT,
+    .groupcommit = 0,
+    .commitdelay = 0,
+    .threads = ZDBD_DEFAULT_THREADS,
+    .readthreads = 0,
+    .uring = 0,
 };
 
 static struct option long_options[] = {
@@ -42,8 +49,18 @@ static struct option long_options[] = {
     {"verbose",    no_argument,       0, 'v'},
     {"sync",       no_argument,       0, 's'},
     {"synctime",   required_argument, 0, 't'},
+    {"group-commit", required_argument, 0, 'G'},
+    {"threads",    required_argument, 0, 'T'},
+    {"read-threads", required_argument, 0, 'R'},
+    {"io-uring",   no_argument,       0, 'U'},
     {"dump",       no_argument,       0, 'x'},
     {"mode",       required_argument, 0, 'm'},
+    {"index-engine", required_argument, 0, 'E'},
+    {"load-threads", required_argument, 0, 'L'},
+    {"fd-cache",   required_argument, 0, 'F'},
+    {"cache-size", required_argument, 0, 'c'},
+    {"seq-table",  no_argument,       0, 'Q'},
+    {"seq-mmap",   no_argument,       0, 'J'},
     {"background", no_argument,       0, 'b'},
     {"logfile",    required_argument, 0, 'o'},
     {"admin",      required_argument, 0, 'a'},
@@ -52,6 +69,7 @@ static struct option long_options[] = {
     {"maxsize",    required_argument, 0, 'M'},
     {"protect",    no_argument,       0, 'P'},
     {"rotate",     required_argument, 0, 'r'},
+    {"checkpoint", required_argument, 0, 'C'},
     {"version",    no_argument,       0, 'V'},
     {"help",       no_argument,       0, 'h'},
     {0, 0, 0, 0}
@@ -226,6 +244,11 @@ static int proceed(zdb_settings_t *zdb_settings, zdbd_settings_t *zdbd_settings)
     signal_intercept(SIGINT, sighandler);
     signal_intercept(SIGTERM, sighandler);
 
+    // replies can be sent to a client which already closed its
+    // connection (eg: reply completed by the read pool), this needs
+    // to fail with EPIPE and not kill the process
+    signal_intercept(SIGPIPE, SIG_IGN);
+
     zdbd_id_set(zdbd_settings->listen, zdbd_settings->port, zdbd_settings->socket);
 
     if(!zdb_open(zdb_settings)) {
@@ -271,13 +294,24 @@ void usage() {
     printf("                       > user: default user key-value mode\n");
     printf("                       > seq: sequential keys generated\n");
     printf("                      note: if not specified, zdb will run in mixed mode\n");
-    printf("  --datasize <size>   maximum datafile size before split (default: %.2f MB)\n\n", MB(ZDB_DEFAULT_DATA_MAXSIZE));
+    printf("  --datasize <size>   maximum datafile size before split (default: %.2f MB)\n", MB(ZDB_DEFAULT_DATA_MAXSIZE));
+    printf("  --index-engine <e>  in-memory index engine (user mode):\n");
+    printf("                       > branches: buckets of linked-list (default)\n");
+    printf("                       > hashtable: open-addressing table, per namespace\n");
+    printf("  --load-threads <n>  threads used to load namespaces and index files (default %d)\n", ZDB_DEFAULT_LOADTHREADS);
+    printf("  --fd-cache <n>      older index and data files kept opened per namespace (default %d)\n", ZDB_DEFAULT_FDCACHE);
+    printf("  --cache-size <size> values cache size shared by namespaces, in bytes (default: disabled)\n");
+    printf("  --seq-table         keep sequential index entries in memory, one read per get (seq mode)\n");
+    printf("  --seq-mmap          map sealed index files, entries read in place (seq mode, without --seq-table)\n\n");
 
     printf(" Network options:\n");
     printf("  --listen <addr>     listen address (default " ZDBD_DEFAULT_LISTENADDR ")\n");
     printf("  --port   <port>     listen port (default %s)\n", ZDBD_DEFAULT_PORT);
     printf("  --socket <path>     unix socket path (override listen and port without --dualnet)\n");
-    printf("  --dualnet           listen on unix socket and tcp socket\n\n");
+    printf("  --dualnet           listen on unix socket and tcp socket\n");
+    printf("  --threads <n>       network reactors, one thread each (default %d)\n", ZDBD_DEFAULT_THREADS);
+    printf("  --read-threads <n>  read sealed datafiles payloads from <n> workers (default disabled)\n");
+    printf("  --io-uring          use io_uring event backend (linux, fallback to epoll if unsupported)\n\n");
 
     printf(" Administrative:\n");
     printf("  --hook     <file>   execute external hook script\n");
@@ -289,9 +323,12 @@ void usage() {
     printf("  --verbose           enable verbose (debug) information\n");
     printf("  --dump              only dump index contents, then exit (debug)\n");
     printf("  --sync              force all write to be synced\n");
+    printf("  --group-commit <us> sync writes from a background thread, in batches\n");
+    printf("                      delayed up to <us> microseconds, replies are held until synced\n");
     printf("  --background        run in background (daemon), when ready\n");
     printf("  --logfile <file>    log file (only in daemon mode)\n");
     printf("  --rotate <secs>     force file (index and data) rotation after x seconds\n");
+    printf("  --checkpoint <secs> write index checkpoint every x seconds (default %d, 0 to disable)\n", ZDBD_DEFAULT_CHECKPOINT);
     printf("  --version           print version and exit\n");
     printf("  --help              print this message\n");
 
@@ -369,6 +406,17 @@ int main(int argc, char *argv[]) {
                 zdb_settings->synctime = atoi(optarg);
                 break;
 
+            case 'G':
+                zdbd_settings->groupcommit = 1;
+                zdbd_settings->commitdelay = atoi(optarg);
+
+                if(zdbd_settings->commitdelay < 0) {
+                    zdbd_danger("[-] invalid group commit delay '%s'", optarg);
+                    exit(EXIT_FAILURE);
+                }
+
+                break;
+
             case 'a':
                 zdbd_settings->adminpwd = optarg;
                 zdbd_verbose("[+] system: admin password set\n");
@@ -416,6 +464,58 @@ int main(int argc, char *argv[]) {
 
                 break;
 
+            case 'E':
+                if(strcmp(optarg, "branches") == 0) {
+                    zdb_settings->engine = ZDB_INDEX_BRANCHES;
+
+                } else if(strcmp(optarg, "hashtable") == 0) {
+                    zdb_settings->engine = ZDB_INDEX_HASHTABLE;
+
+                } else {
+                    zdbd_danger("[-] invalid index engine '%s'", optarg);
+                    fprintf(stderr, "[-] engine 'branches' or 'hashtable' expected\n");
+                    exit(EXIT_FAILURE);
+                }
+
+                break;
+
+            case 'L':
+                zdb_settings->loadthreads = atoi(optarg);
+
+                if(zdb_settings->loadthreads < 1) {
+                    zdbd_danger("[-] invalid amount of load threads '%s'", optarg);
+                    exit(EXIT_FAILURE);
+                }
+
+                break;
+
+            case 'F':
+                zdb_settings->fdcache = atoi(optarg);
+
+                if(zdb_settings->fdcache < 0) {
+                    zdbd_danger("[-] invalid file descriptors cache size '%s'", optarg);
+                    exit(EXIT_FAILURE);
+                }
+
+                break;
+
+            case 'c':
+                if(atol(optarg) < 0) {
+                    zdbd_danger("[-] invalid values cache size '%s'", optarg);
+                    exit(EXIT_FAILURE);
+                }
+
+                zdb_settings->datacache = atol(optarg);
+                break;
+
+            case 'Q':
+                zdb_settings->seqtable = 1;
+                break;
+
+            case 'J':
+                zdb_settings->seqmmap = 1;
+                break;
+
             case 'u':
                 zdbd_settings->socket = optarg;
                 break;
@@ -429,6 +529,11 @@ int main(int argc, char *argv[]) {
                 zdbd_verbose("[+] system: file rotation time: %d seconds\n", zdbd_settings->rotatesec);
                 break;
 
+            case 'C':
+                zdbd_settings->checkpointsec = atoi(optarg);
+                zdbd_verbose("[+] system: index checkpoint time: %d seconds\n", zdbd_settings->checkpointsec);
+                break;
+
             case 'D':
                 zdb_settings->datasize = atol(optarg);
                 size_t maxsize = 0xffffffff;
@@ -444,6 +549,30 @@ int main(int argc, char *argv[]) {
             case 'h':
                 usage();
 
+            case 'T':
+                zdbd_settings->threads = atoi(optarg);
+
+                if(zdbd_settings->threads < 1 || zdbd_settings->threads > ZDBD_MAX_THREADS) {
+                    zdbd_danger("[-] invalid amount of threads '%s'", optarg);
+                    exit(EXIT_FAILURE);
+                }
+
+                break;
+
+            case 'R':
+                zdbd_settings->readthreads = atoi(optarg);
+
+                if(zdbd_settings->readthreads < 0 || zdbd_settings->readthreads > READPOOL_MAX_THREADS) {
+                    zdbd_danger("[-] invalid amount of read threads '%s'", optarg);
+                    exit(EXIT_FAILURE);
+                }
+
+                break;
+
+            case 'U':
+                zdbd_settings->uring = 1;
+                break;
+
             case '?':
             default:
                exit(EXIT_FAILURE);
@@ -459,6 +588,42 @@ int main(int argc, char *argv[]) {
     // print information relative to database instance
     //
     zdb_log("[+] system: running mode: " COLOR_GREEN "%s" COLOR_RESET "\n", zdb_running_mode(zdb_settings->mode));
+    zdbd_verbose("[+] system: index engine: %s\n", zdb_index_engine(zdb_settings->engine));
+    zdbd_verbose("[+] system: load threads: %d\n", zdb_settings->loadthreads);
+
+    if(zdb_settings->seqtable)
+        zdbd_verbose("[+] system: sequential entries kept in memory\n");
+
+    if(zdb_settings->seqmmap && !zdb_settings->seqtable)
+        zdbd_verbose("[+] system: sequential sealed index files mapped\n");
+
+    // group commit replaces inline sync, writes are synced
+    // by the flusher thread and not on each write anymore
+    if(zdbd_settings->groupcommit) {
+        zdb_settings->sync = 0;
+        zdbd_verbose("[+] system: group commit enabled, batch delay: %d us\n", zdbd_settings->commitdelay);
+    }
+
+    // several reactors relies on epoll features (exclusive
+    // wakeup, per-reactor event handler)
+    #ifndef __linux__
+    if(zdbd_settings->threads > 1) {
+        zdbd_warning("[-] system: multiple threads not supported on this platform, using one");
+        zdbd_settings->threads = 1;
+    }
+    #endif
+
+    #ifndef ZDBD_URING
+    if(zdbd_settings->uring) {
+        zdbd_warning("[-] system: io_uring not available on this build, using default backend");
+        zdbd_settings->uring = 0;
+    }
+    #endif
+
+    zdbd_verbose("[+] system: network threads: %d\n", zdbd_settings->threads);
+
+    if(zdbd_settings->readthreads)
+        zdbd_verbose("[+] system: read workers: %d\n", zdbd_settings->readthreads);
 
     // max database size is maximum datafile size multiplied by amount of files
     size_t maxfiles = index_max_files();
@@ -10,6 +10,10 @@
 
     #define ZDBD_PATH_MAX    4096
 
+    #define ZDBD_DEFAULT_CHECKPOINT  600
+    #define ZDBD_DEFAULT_THREADS     1
+    #define ZDBD_MAX_THREADS         256
+
     // define here version of 0-db itself
     // version is made as following:
     //
@@ -41,6 +45,21 @@
         uint64_t networktx;       // amount of bytes transmitted over the network
         uint64_t netevents;       // amount of socket events received
 
+        // group commit
+        uint64_t commitbatches;   // amount of batches synced
+        uint64_t commitwrites;    // amount of writes synced by batches
+        uint64_t commitlast;      // amount of writes on the last batch
+        uint64_t commitmax;       // largest batch seen
+        uint64_t commitfailed;    // amount of batches which failed to sync
+
+        // read pool
+        uint64_t readjobs;        // amount of reads completed by the pool
+        uint64_t readcancelled;   // amount of reads cancelled (namespace changed)
+        uint64_t readqueued;      // amount of reads currently queued
+        uint64_t readqueuemax;    // largest queue depth seen
+        uint64_t readlatency;     // total time from queued to completed (microseconds)
+        uint64_t readlatencymax;  // slowest read (microseconds)
+
     } zdbd_stats_t;
 
     typedef struct zdbd_settings_t {
@@ -54,6 +73,12 @@
         int protect;      // flag default namespace to use admin password (for writing)
         int dualnet;      // support for dual socket listening
         int rotatesec;    // amount of seconds before forcing rotation of index/data
+        int checkpointsec; // amount of seconds between index checkpoint (0 to disable)
+        int groupcommit;  // hold write replies until synced by the flusher thread
+        int commitdelay;  // maximum group commit batch delay (microseconds)
+        int threads;      // amount of network reactors (threads)
+        int readthreads;  // amount of read workers (0: reads done inline)
+        int uring;        // use io_uring event backend, when supported
 
         zdbd_stats_t stats;
 